@@ -0,0 +1,119 @@
+# Упаковка веб-интерфейса для LittleFS: один файл assets.bin с манифестом и сжатыми gzip телами
+# Формат (little-endian) читает src/web_assets.h:
+#   заголовок 16 байт: magic "WAST", версия u16, количество u16, резерв u32, смещение данных u32
+#   записи по 20 байт, отсортированы по hash: hash u32 (FNV-1a пути), offset u32, size u32, etag u32 (CRC32
+#   исходного файла), тип содержимого u8, флаги u8 (бит 0 - gzip), резерв u16
+#   тела файлов подряд
+# Запуск без PlatformIO: python asset_pack.py docs/data data/assets.bin
+
+import gzip
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b"WAST"
+VERSION = 1
+HEADER = struct.Struct("<4sHHII")
+ENTRY = struct.Struct("<IIIIBBH")
+FLAG_GZIP = 1
+
+# Индексы совпадают с web_assets::CONTENT_TYPES
+CONTENT_TYPES = [
+    ("application/octet-stream", ()),
+    ("text/html", (".html", ".htm")),
+    ("text/css", (".css",)),
+    ("application/javascript", (".js",)),
+    ("application/json", (".json",)),
+    ("image/png", (".png",)),
+    ("image/jpeg", (".jpg", ".jpeg")),
+    ("image/svg+xml", (".svg",)),
+    ("image/x-icon", (".ico",)),
+    ("text/plain", (".txt",)),
+]
+# Уже сжатые форматы gzip не уменьшает
+NO_GZIP = {".png", ".jpg", ".jpeg"}
+
+
+def fnv1a(text):
+    value = 0x811C9DC5
+    for byte in text.encode("utf-8"):
+        value = ((value ^ byte) * 0x01000193) & 0xFFFFFFFF
+    return value
+
+
+def content_type(path):
+    ext = os.path.splitext(path)[1].lower()
+    for index, (_, extensions) in enumerate(CONTENT_TYPES):
+        if ext in extensions:
+            return index
+    return 0
+
+
+def collect(src_dir, skip=()):
+    """Файлы каталога как {"/css/style.css": bytes}"""
+    files = {}
+    for root, _, names in os.walk(src_dir):
+        for name in sorted(names):
+            full = os.path.join(root, name)
+            if os.path.abspath(full) in skip:
+                continue
+            path = "/" + os.path.relpath(full, src_dir).replace(os.sep, "/")
+            with open(full, "rb") as f:
+                files[path] = f.read()
+    return files
+
+
+def pack(files):
+    """{путь: содержимое} -> bytes assets.bin"""
+    entries = []
+    for path, data in files.items():
+        ext = os.path.splitext(path)[1].lower()
+        body, flags = data, 0
+        if ext not in NO_GZIP:
+            compressed = gzip.compress(data, compresslevel=9, mtime=0)     # mtime=0: одинаковый результат при каждой сборке
+            if len(compressed) < len(data):
+                body, flags = compressed, FLAG_GZIP
+        entries.append((fnv1a(path), path, body, zlib.crc32(data) & 0xFFFFFFFF, content_type(path), flags))
+
+    entries.sort(key=lambda e: e[0])
+    for a, b in zip(entries, entries[1:]):
+        if a[0] == b[0]:
+            raise ValueError(f"asset_pack: совпал hash путей {a[1]} и {b[1]}, переименуйте файл")
+    if len(entries) > 0xFFFF:
+        raise ValueError("asset_pack: слишком много файлов")
+
+    data_offset = HEADER.size + ENTRY.size * len(entries)
+    table, bodies = bytearray(), bytearray()
+    for hash_, _, body, etag, type_, flags in entries:
+        table += ENTRY.pack(hash_, data_offset + len(bodies), len(body), etag, type_, flags, 0)
+        bodies += body
+    return HEADER.pack(MAGIC, VERSION, len(entries), 0, data_offset) + bytes(table) + bytes(bodies)
+
+
+def read_manifest(blob):
+    """Разбор assets.bin обратно: [(hash, offset, size, etag, type, flags)], для тестов и проверки"""
+    magic, version, count, _, data_offset = HEADER.unpack_from(blob, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("asset_pack: не assets.bin")
+    entries = [ENTRY.unpack_from(blob, HEADER.size + i * ENTRY.size)[:6] for i in range(count)]
+    return data_offset, entries
+
+
+def pack_dir(src_dir, out_path, extra=None):
+    files = collect(src_dir, skip={os.path.abspath(out_path)})
+    files.update(extra or {})
+    blob = pack(files)
+    os.makedirs(os.path.dirname(out_path) or ".", exist_ok=True)
+    with open(out_path, "wb") as f:
+        f.write(blob)
+    raw = sum(len(data) for data in files.values())
+    return len(files), raw, len(blob)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        print("usage: asset_pack.py <web_dir> <assets.bin>")
+        sys.exit(1)
+    count, raw, packed = pack_dir(sys.argv[1], sys.argv[2])
+    print(f"{count} files, {raw} -> {packed} bytes")
@@ -1,38 +1,78 @@
-// Обновление статуса каждые 5 секунд
+// Статус приходит потоком /api/events: при подключении полный снимок, дальше только изменившиеся поля.
+// uptime между событиями считается здесь. Без EventSource - опрос /api/status каждые 5 секунд.
+const status = { uptime: 0 };
+let uptimeAt = Date.now();
+
+function applyStatus(fields) {
+    Object.assign(status, fields);
+    if ('uptime' in fields) uptimeAt = Date.now();
+    if ('wifi' in fields) document.getElementById('wifi-status').textContent = status.wifi;
+    if ('ip' in fields) document.getElementById('ip-address').textContent = status.ip;
+    if ('brightness' in fields && !commands.pending.brightness) {
+        document.getElementById('brightness').value = status.brightness;
+    }
+    renderUptime();
+}
+
+function renderUptime() {
+    const uptime = status.uptime + Math.floor((Date.now() - uptimeAt) / 1000);
+    document.getElementById('uptime').textContent = uptime + 's';
+}
+
 async function updateStatus() {
     try {
         const response = await fetch('/api/status');
-        const data = await response.json();
-        
-        document.getElementById('wifi-status').textContent = data.wifi;
-        document.getElementById('ip-address').textContent = data.ip;
-        document.getElementById('uptime').textContent = data.uptime + 's';
+        applyStatus(await response.json());
     } catch (error) {
         console.error('Status update failed:', error);
     }
 }
 
-// Управление светом
-async function controlLight(state) {
-    try {
-        const response = await fetch(`/api/light?state=${state}`);
-        const result = await response.text();
-        alert(`Light: ${result}`);
-    } catch (error) {
-        alert('Control failed: ' + error);
+function connectEvents() {
+    if (!window.EventSource) {
+        setInterval(updateStatus, 5000);
+        updateStatus();
+        return;
     }
+    const events = new EventSource('/api/events');      // переподключается сам через retry
+    events.onmessage = (event) => applyStatus(JSON.parse(event.data));
+    events.onerror = () => { document.getElementById('wifi-status').textContent = 'reconnecting...'; };
 }
 
-// Установка яркости
-async function setBrightness(value) {
+// Команды света копятся и уходят одним запросом: не чаще раза в COMMAND_DELAY мс и не больше
+// одного запроса одновременно. Из движения ползунка на устройство попадает последнее значение.
+const COMMAND_DELAY = 100;
+const commands = { pending: {}, timer: null, inFlight: false };
+
+function queueCommand(fields) {
+    Object.assign(commands.pending, fields);
+    if (!commands.timer && !commands.inFlight) commands.timer = setTimeout(flushCommands, COMMAND_DELAY);
+}
+
+async function flushCommands() {
+    commands.timer = null;
+    const body = new URLSearchParams(commands.pending);
+    commands.pending = {};
+    commands.inFlight = true;
     try {
-        await fetch(`/api/brightness?value=${value}`);
-        console.log('Brightness set to:', value);
+        await fetch('/api/cmd', { method: 'POST', body });
     } catch (error) {
-        console.error('Brightness set failed:', error);
+        console.error('Command failed:', error);
+    } finally {
+        commands.inFlight = false;
+        if (Object.keys(commands.pending).length) commands.timer = setTimeout(flushCommands, COMMAND_DELAY);
     }
 }
 
-// Автоматическое обновление статуса
-setInterval(updateStatus, 5000);
-updateStatus(); // Первый вызов
\ No newline at end of file
+// Управление светом
+function controlLight(state) {
+    queueCommand({ light: state });
+}
+
+// Установка яркости
+function setBrightness(value) {
+    queueCommand({ brightness: value });
+}
+
+setInterval(renderUptime, 1000);
+connectEvents();
@@ -1,10 +1,14 @@
 import os
+import sys
 import shutil
 import json
 from datetime import datetime
 
 Import("env")
 
+sys.path.insert(0, env.subst("$PROJECT_DIR"))
+import asset_pack
+
 def before_upload(source, target, env):
     print("\n=== Preparing files for LittleFS ===")
     
@@ -38,6 +42,20 @@ def before_upload(source, target, env):
     
     print(f"Created version file: {version_path}")
     
+    # Веб-интерфейс одним файлом: манифест + gzip, прошивка отдает его без поиска по каталогам (web_assets.h)
+    web_dir = env.GetProjectOption("custom_web_dir", os.path.join("docs", "data"))
+    if os.path.isdir(web_dir):
+        with open(version_path, "rb") as f:
+            extra = {"/config/version.json": f.read()}
+        count, raw, packed = asset_pack.pack_dir(web_dir, os.path.join(data_dir, "assets.bin"), extra)
+        print(f"Packed web UI: {web_dir} -> {data_dir}/assets.bin, {count} files, {raw} -> {packed} bytes")
+
+        # Настройки прошивка читает обычным файлом (settings_fs.h): при изменении JSON пересоберет settings.bin
+        settings_src = os.path.join(web_dir, "config", "settings.json")
+        if os.path.isfile(settings_src):
+            shutil.copyfile(settings_src, os.path.join(data_dir, "config", "settings.json"))
+            print(f"Copied settings: {settings_src}")
+
     # Подсчет файлов
     file_count = 0
     total_size = 0
@@ -51,4 +69,9 @@ def before_upload(source, target, env):
     
     print(f"Total files: {file_count}")
     print(f"Total size: {total_size} bytes")
-    print("===============================\n")
\ No newline at end of file
+    print("===============================\n")
+
+# PreAction на buildfs/uploadfs срабатывает уже после сборки образа из data, поэтому готовим файлы
+# при загрузке скрипта, до того как SCons соберет список источников образа
+if any(t in ("buildfs", "uploadfs", "uploadfsota") for t in COMMAND_LINE_TARGETS):
+    before_upload(None, None, env)
@@ -0,0 +1,137 @@
+#pragma once
+// Поэтапная загрузка с журналом времени
+// setup() выполняет только критичные этапы (светодиод, Морзе, ESP-NOW) - run(). Все остальное (самотесты,
+// проверка выводов, печать отчета) откладывается - defer() - и выполняется задачей планировщика после
+// загрузки, по шагам: шаг возвращает мс до следующего шага или DONE, так что и долгая диагностика не
+// блокирует loop(). Журнал: имя этапа, начало и конец в мкс от старта, выгрузка в CSV командой /boot.
+//
+//   boot_stages::sequence<16, boot_micros> boot;     // uint32_t boot_micros() { return micros(); }
+//   boot.run("led", [] { blinkLED->off(); });
+//   boot.defer("selftest", [](uint32_t) { etl::unittest::test_all(Serial); return boot_stages::DONE; });
+//   boot.mark("ready");
+//   scheduler.add("boot", [](void*, uint32_t now) { return boot.tick(now); }, nullptr);
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace boot_stages {
+
+constexpr uint32_t DONE  = UINT32_MAX;      // шаг отложенного этапа: этап завершен
+constexpr uint32_t NEVER = UINT32_MAX;      // tick(): отложенных этапов нет
+
+using step_t = uint32_t (*)(uint32_t now);  // now, мс. return: мс до следующего шага или DONE
+
+struct entry_t {
+    const char* name     = nullptr;
+    uint32_t    start_us = 0;
+    uint32_t    end_us   = 0;
+    bool        deferred = false;
+
+    uint32_t duration_us() const { return end_us - start_us; }
+};
+
+// N - записей в журнале и отложенных этапов, Micros - часы журнала
+template<size_t N, uint32_t (*Micros)()>
+class sequence
+{
+public:
+    // Выполнить этап сразу и записать его время
+    template<typename Stage>
+    void run(const char* name, Stage&& stage)
+    {
+        uint32_t start = Micros();
+        stage();
+        record(name, start, Micros(), false);
+    }
+
+    // Отметка без длительности: "ready", первый маяк
+    void mark(const char* name)
+    {
+        uint32_t now = Micros();
+        record(name, now, now, false);
+    }
+
+    // Отложить этап до tick(). Этапы выполняются по порядку, следующий - после DONE предыдущего
+    bool defer(const char* name, step_t step)
+    {
+        if(queued_ >= N) return false;
+        queue_[queued_++] = {name, step, 0, false};
+        return true;
+    }
+
+    // Шаг текущего отложенного этапа. return: мс до следующего шага, NEVER - очередь пуста
+    uint32_t tick(uint32_t now)
+    {
+        if(current_ >= queued_) {
+            current_ = queued_ = 0;     // очередь отработана - defer() снова пишет с начала
+            return NEVER;
+        }
+        pending_t& p = queue_[current_];
+        if(!p.started) {
+            p.started = true;
+            p.start_us = Micros();
+        }
+        uint32_t next = p.step(now);
+        if(next != DONE) return next;
+        record(p.name, p.start_us, Micros(), true);
+        ++current_;
+        return current_ < queued_ ? 0 : tick(now);
+    }
+
+    size_t pending() const { return queued_ - current_; }
+    size_t size() const { return count_; }
+    const entry_t& entry(size_t i) const { return entries_[i]; }
+
+    // Последняя запись с этим именем, nullptr - не было
+    const entry_t* find(const char* name) const
+    {
+        for(size_t i = count_; i-- > 0;) if(strcmp(entries_[i].name, name) == 0) return &entries_[i];
+        return nullptr;
+    }
+
+    // CSV: boot,name,start_us,duration_us,deferred
+    template<typename WriteLine>
+    void write_csv(WriteLine write_line) const
+    {
+        char line[80];
+        write_line("boot,name,start_us,duration_us,deferred");
+        for(size_t i = 0; i < count_; ++i) {
+            const entry_t& e = entries_[i];
+            snprintf(line, sizeof(line), "boot,%s,%lu,%lu,%u", e.name, static_cast<unsigned long>(e.start_us),
+                     static_cast<unsigned long>(e.duration_us()), e.deferred ? 1u : 0u);
+            write_line(line);
+        }
+        if(dropped_) {
+            snprintf(line, sizeof(line), "boot,dropped,%lu,0,0", static_cast<unsigned long>(dropped_));
+            write_line(line);
+        }
+    }
+
+private:
+    struct pending_t {
+        const char* name;
+        step_t      step;
+        uint32_t    start_us;
+        bool        started;
+    };
+
+    void record(const char* name, uint32_t start, uint32_t end, bool deferred)
+    {
+        if(count_ >= N) {
+            ++dropped_;
+            return;
+        }
+        entries_[count_++] = {name, start, end, deferred};
+    }
+
+    entry_t   entries_[N];
+    pending_t queue_[N] = {};
+    size_t    count_   = 0;
+    size_t    queued_  = 0;
+    size_t    current_ = 0;
+    uint32_t  dropped_ = 0;
+};
+
+}// namespace boot_stages
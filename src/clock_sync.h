@@ -0,0 +1,149 @@
+#pragma once
+// Оценка смещения и ухода часов клиента относительно сервера по обмену kCount -> kTime (как в NTP)
+// Клиент отмечает время отправки запроса t1 и приема ответа t4 по своим часам, сервер возвращает метку
+// запроса и середину своего интервала обработки (t2 + t3) / 2. При симметричной задержке радиоканала
+//   offset = server - (t1 + t4) / 2,  ошибка не больше rtt / 2.
+// Задержка в очередях бывает только больше, поэтому смещение - среднее по окну с весом, падающим с ростом
+// rtt сверх минимального в окне (RTT_SCALE). Уход (мс на мс) - по смещению центров окна, разнесенных не меньше
+// чем на DRIFT_SPAN: на коротком окне миллисекундные метки дают шум в сотни ppm. Без учета ухода кварцы ESP
+// (+-40 ppm) расходятся на 2.4 мс за минуту без ответов.
+//
+//   clock_sync::estimator<> sync;
+//   sync.on_request(t1);                        // отправлен kCount с меткой t1
+//   sync.on_reply(echo, server_time, t4);       // принят kTime
+//   uint32_t local = sync.to_local(start);      // момент start по часам сервера - по своим часам
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace clock_sync {
+
+// Замер хранится целыми мс, середина запроса t1 + rtt / 2 - с половинами в fit()
+struct sample_t {
+    uint32_t t1     = 0;        // отправка запроса по часам клиента
+    int32_t  offset = 0;        // время сервера - t1, мс
+    uint32_t rtt    = 0;
+};
+
+// N - замеров в окне, PENDING - запросов в ожидании ответа
+template<size_t N = 8, size_t PENDING = 4>
+class estimator
+{
+public:
+    static constexpr float    RTT_SCALE = 4;            // мс: замер с rtt на 4 мс больше лучшего весит вчетверо меньше
+    static constexpr uint32_t DRIFT_SPAN = 60000;       // мс между центрами окна для оценки ухода
+    static constexpr float    MAX_DRIFT = 200e-6f;      // больше - ошибка замеров, а не кварц
+
+    // Отправлен запрос с меткой t1 (своими часами)
+    void on_request(uint32_t t1)
+    {
+        pending_[pending_next_++ % PENDING] = {t1, true};
+    }
+
+    // Принят ответ: echo - метка запроса, server_time - время сервера, t4 - время приема.
+    // return: false - ответ не на наш запрос (в группе ответ видят все клиенты) или повтор
+    bool on_reply(uint32_t echo, uint32_t server_time, uint32_t t4)
+    {
+        for(auto& p : pending_) {
+            if(!p.active || p.t1 != echo) continue;
+            p.active = false;
+            sample_t s;
+            s.t1 = echo;
+            s.offset = static_cast<int32_t>(server_time - echo);
+            s.rtt = t4 - echo;
+            samples_[count_++ % N] = s;
+            fit();
+            return true;
+        }
+        return false;
+    }
+
+    bool valid() const { return count_ > 0; }
+    size_t samples() const { return count_ < N ? count_ : N; }
+    float drift() const { return drift_; }                      // мс на мс, 1e-6 = 1 ppm
+    uint32_t error_bound() const { return best_rtt_ / 2; }      // худшая ошибка смещения при асимметрии канала
+
+    // Сервер - клиент в момент local. Часы плат стартуют когда придется, смещение - хоть сутки:
+    // целая часть отдельно, во float только поправка прямой
+    int32_t offset(uint32_t local) const
+    {
+        return base_ + round(residual_ + drift_ * static_cast<float>(static_cast<int32_t>(local - ref_)));
+    }
+
+    uint32_t to_server(uint32_t local) const { return local + static_cast<uint32_t>(offset(local)); }
+    uint32_t to_local(uint32_t server) const
+    {
+        uint32_t guess = server - static_cast<uint32_t>(base_);
+        return server - static_cast<uint32_t>(offset(guess));
+    }
+
+    void reset() { *this = estimator(); }
+
+private:
+    struct pending_t {
+        uint32_t t1;
+        bool     active;
+    };
+
+    static int32_t round(float value) { return static_cast<int32_t>(value < 0 ? value - 0.5f : value + 0.5f); }
+
+    void fit()
+    {
+        size_t n = samples();
+        best_rtt_ = UINT32_MAX;
+        for(size_t i = 0; i < n; ++i) if(samples_[i].rtt < best_rtt_) best_rtt_ = samples_[i].rtt;
+        ref_ = samples_[(count_ - 1) % N].t1;
+        base_ = samples_[(count_ - 1) % N].offset;
+        // Относительно отправки последнего запроса: разности малы, float хватает
+        float sw = 0, sx = 0, sy = 0, sr = 0;
+        for(size_t i = 0; i < n; ++i) {
+            const sample_t& s = samples_[i];
+            float half = static_cast<float>(s.rtt) / 2;
+            float x = static_cast<float>(static_cast<int32_t>(s.t1 - ref_)) + half;
+            float y = static_cast<float>(static_cast<int32_t>(s.offset - base_)) - half;
+            float k = 1 + static_cast<float>(s.rtt - best_rtt_) / RTT_SCALE;
+            float w = 1 / (k * k);
+            sw += w; sx += w * x; sy += w * y;
+            sr += w * (y - drift_ * x);             // смещение в ref_ с поправкой на уход внутри окна
+        }
+        residual_ = sr / sw;
+
+        // Центр окна - точка на прямой смещения; уход по двум центрам через DRIFT_SPAN
+        uint32_t center = ref_ + static_cast<uint32_t>(round(sx / sw));
+        float center_offset = sy / sw;
+        if(!anchored_) {
+            anchored_ = true;
+            anchor_ = center;
+            anchor_base_ = base_;
+            anchor_offset_ = center_offset;
+            return;
+        }
+        int32_t span = static_cast<int32_t>(center - anchor_);
+        if(span < static_cast<int32_t>(DRIFT_SPAN)) return;
+        float drift = (static_cast<float>(base_ - anchor_base_) + center_offset - anchor_offset_) / static_cast<float>(span);
+        if(drift > MAX_DRIFT) drift = MAX_DRIFT;
+        if(drift < -MAX_DRIFT) drift = -MAX_DRIFT;
+        drift_ = drift_measured_ ? (drift_ + drift) / 2 : drift;
+        drift_measured_ = true;
+        anchor_ = center;
+        anchor_base_ = base_;
+        anchor_offset_ = center_offset;
+    }
+
+    sample_t  samples_[N];
+    size_t    count_ = 0;
+    pending_t pending_[PENDING] = {};
+    size_t    pending_next_ = 0;
+    uint32_t  ref_ = 0;
+    int32_t   base_ = 0;
+    float     residual_ = 0;
+    float     drift_ = 0;
+    bool      drift_measured_ = false;
+    bool      anchored_ = false;
+    uint32_t  anchor_ = 0;              // центр окна при прошлой оценке ухода
+    int32_t   anchor_base_ = 0;
+    float     anchor_offset_ = 0;
+    uint32_t  best_rtt_ = 0;
+};
+
+}// namespace clock_sync
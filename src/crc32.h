@@ -0,0 +1,30 @@
+#pragma once
+// CRC-32 (IEEE 802.3, как zlib.crc32 в Python): таблица на 16 полубайт - 64 байта вместо 1 КБ
+//   uint32_t crc = checksum::crc32(data, size);
+//   crc = checksum::crc32(more, more_size, crc);   // продолжить по частям
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace checksum {
+
+namespace detail {
+constexpr uint32_t CRC32_NIBBLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+}// namespace detail
+
+inline uint32_t crc32(const void* data, size_t size, uint32_t crc = 0)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for(size_t i = 0; i < size; ++i) {
+        crc ^= p[i];
+        crc = (crc >> 4) ^ detail::CRC32_NIBBLE[crc & 0x0F];
+        crc = (crc >> 4) ^ detail::CRC32_NIBBLE[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+}// namespace checksum
@@ -0,0 +1,163 @@
+#pragma once
+// Кооперативный планировщик по ближайшему сроку
+// Вместо опроса всех tick() на каждой итерации loop() задачи лежат в min-heap по времени следующего запуска.
+// dispatch() запускает только задачи, срок которых наступил, и возвращает время до ближайшего следующего срока -
+// столько loop() может спать (delay / light sleep), не пропуская событий.
+// Часы передаются параметром шаблона, как в GTimer<millis>, поэтому на компьютере подставляются фиктивные.
+//
+//   deadline_scheduler<8, millis> scheduler;
+//   scheduler.add("morse", morse_task, nullptr);        // задача возвращает время до следующего запуска
+//   void loop() { delay(scheduler.dispatch()); }
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Задача: выполнить работу и вернуть время до следующего запуска, мс (NEVER - ждать wake())
+using task_callback_t = uint32_t (*)(void* context, uint32_t now);
+
+struct task_stats_t {
+    const char* name = nullptr;
+    uint32_t    runs = 0;       // количество запусков
+    uint32_t    late_max = 0;   // максимальное опоздание запуска относительно срока, мс
+};
+
+template<size_t N, unsigned long (*clock)()>     // сигнатура как у millis()
+class deadline_scheduler
+{
+public:
+    static constexpr uint32_t NEVER = UINT32_MAX;
+    static constexpr int INVALID = -1;
+
+    // return: идентификатор задачи или INVALID, если нет места
+    int add(const char* name, task_callback_t callback, void* context, uint32_t delay = 0)
+    {
+        if(count_ >= N || !callback) return INVALID;
+        int id = static_cast<int>(count_++);
+        task_t& task = tasks_[id];
+        task.callback = callback;
+        task.context  = context;
+        task.stats    = task_stats_t{};
+        task.stats.name = name;
+        task.heap_pos = INVALID;
+        schedule(id, static_cast<uint32_t>(clock()), delay);
+        return id;
+    }
+
+    // Перенести срок задачи: например, после enqueue() передатчик должен проснуться сразу
+    void wake(int id, uint32_t delay = 0)
+    {
+        if(id < 0 || static_cast<size_t>(id) >= count_) return;
+        schedule(id, static_cast<uint32_t>(clock()), delay);
+    }
+
+    // Запустить задачи с наступившим сроком, каждую не больше одного раза за вызов. return: время до следующего срока, мс (NEVER - задач нет)
+    uint32_t dispatch()
+    {
+        uint32_t now = static_cast<uint32_t>(clock());
+        for(size_t runs = 0; runs < count_ && heap_size_ > 0 && !before(now, tasks_[heap_[0]].deadline); ++runs)
+        {
+            int id = heap_[0];
+            pop_top();
+            task_t& task = tasks_[id];
+            uint32_t late = now - task.deadline;
+            if(late > task.stats.late_max) task.stats.late_max = late;
+            ++task.stats.runs;
+            uint32_t delay = task.callback(task.context, now);
+            now = static_cast<uint32_t>(clock());
+            schedule(id, now, delay);
+        }
+        return time_to_next(now);
+    }
+
+    uint32_t time_to_next(uint32_t now) const
+    {
+        if(heap_size_ == 0) return NEVER;
+        uint32_t deadline = tasks_[heap_[0]].deadline;
+        return before(now, deadline) ? deadline - now : 0;
+    }
+
+    size_t size() const { return count_; }
+    const task_stats_t& stats(int id) const { return tasks_[id].stats; }
+
+private:
+    struct task_t {
+        task_callback_t callback = nullptr;
+        void*           context  = nullptr;
+        uint32_t        deadline = 0;
+        int             heap_pos = INVALID;   // позиция в heap_, INVALID - задача ждет wake()
+        task_stats_t    stats;
+    };
+
+    // Сравнение с учетом переполнения millis() через 49 дней
+    static bool before(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) < 0; }
+
+    bool less(size_t i, size_t j) const { return before(tasks_[heap_[i]].deadline, tasks_[heap_[j]].deadline); }
+
+    void schedule(int id, uint32_t now, uint32_t delay)
+    {
+        task_t& task = tasks_[id];
+        if(task.heap_pos != INVALID) remove(task.heap_pos);
+        if(delay == NEVER) return;
+        task.deadline = now + delay;
+        size_t pos = heap_size_++;
+        heap_[pos] = id;
+        task.heap_pos = static_cast<int>(pos);
+        sift_up(pos);
+    }
+
+    void pop_top() { remove(0); }
+
+    void remove(size_t pos)
+    {
+        tasks_[heap_[pos]].heap_pos = INVALID;
+        --heap_size_;
+        if(pos == heap_size_) return;
+        place(pos, heap_[heap_size_]);
+        sift_down(pos);
+        sift_up(pos);
+    }
+
+    void place(size_t pos, int id)
+    {
+        heap_[pos] = id;
+        tasks_[id].heap_pos = static_cast<int>(pos);
+    }
+
+    void sift_up(size_t pos)
+    {
+        while(pos > 0)
+        {
+            size_t parent = (pos - 1) / 2;
+            if(!less(pos, parent)) break;
+            swap(pos, parent);
+            pos = parent;
+        }
+    }
+
+    void sift_down(size_t pos)
+    {
+        while(true)
+        {
+            size_t smallest = pos;
+            size_t left = 2 * pos + 1, right = left + 1;
+            if(left < heap_size_ && less(left, smallest)) smallest = left;
+            if(right < heap_size_ && less(right, smallest)) smallest = right;
+            if(smallest == pos) break;
+            swap(pos, smallest);
+            pos = smallest;
+        }
+    }
+
+    void swap(size_t i, size_t j)
+    {
+        int a = heap_[i], b = heap_[j];
+        place(i, b);
+        place(j, a);
+    }
+
+private:
+    task_t tasks_[N];
+    int    heap_[N] {};
+    size_t count_ = 0;
+    size_t heap_size_ = 0;
+};
@@ -0,0 +1,318 @@
+#pragma once
+// Пакетная передача сообщений ESP-NOW
+// Кадр ESP-NOW вмещает 250 байт, а morse_message_t занимает 12: вместо кадра на каждое сообщение
+// несколько сообщений собираются в один кадр с заголовком и номером последовательности.
+// Кадр уходит, когда набралось заданное количество сообщений, когда самое старое ждет дольше max_latency_ms
+// или по явному flush(). На приеме кадр разбирается в исходном порядке, пропуски и повторы кадров считаются
+// по каждому отправителю отдельно (у сервера несколько клиентов, у каждого своя нумерация).
+//
+// Формат кадра (little endian):
+//   [0] magic 0xB7 | [1] версия кодека | [2..3] номер кадра | [4] количество сообщений | [5..] данные кодека
+// Кодек определяет раскладку сообщений: raw_codec (версия 1) - структуры подряд побайтно,
+// morse_wire::compact_codec (версия 2) - упакованные записи, см. morse_wire.h.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+namespace espnow_batch {
+
+constexpr size_t  MAX_FRAME_SIZE = 250;     // ограничение ESP-NOW на длину данных
+constexpr uint8_t FRAME_MAGIC    = 0xB7;
+constexpr size_t  HEADER_SIZE    = 5;
+constexpr size_t  MAC_SIZE       = 6;
+
+// Нумерация отправителя начата заново (перезагрузка): номер назад дальше RESYNC_GAP кадров
+// или любой номер назад после тишины дольше RESYNC_SILENCE_MS (повторы MAC-уровня приходят сразу)
+constexpr uint16_t RESYNC_GAP        = 32;
+constexpr uint32_t RESYNC_SILENCE_MS = 1000;
+
+// Отправка готового кадра: transport ESP-NOW или loopback на компьютере
+using send_fn = bool (*)(void* context, const uint8_t* data, size_t length);
+// Транспорт примет кадр (например, в окне espnow_reliable есть место); false - кадр ждет у отправителя
+using ready_fn = bool (*)(void* context);
+
+struct policy_t {
+    uint8_t  max_messages   = 0;    // отправить при таком количестве сообщений, 0 - пока есть место в кадре
+    uint32_t max_latency_ms = 20;   // отправить, если первое сообщение ждет дольше, 0 - только по количеству и flush()
+    uint8_t  max_frame_size = 0;    // 0 - MAX_FRAME_SIZE, меньше - место под заголовок обертки (espnow_reliable)
+};
+
+struct sender_stats_t {
+    uint32_t messages = 0;      // принято в кадры
+    uint32_t frames   = 0;      // отправлено кадров
+    uint32_t failed   = 0;      // кадров, которые transport не смог отправить
+    uint32_t held     = 0;      // отправок отложено: транспорт не готов (ready_fn)
+    uint32_t rejected = 0;      // сообщений не принято: кадр заполнен и ждет транспорт
+};
+
+struct receiver_stats_t {
+    uint32_t frames    = 0;     // принято кадров
+    uint32_t messages  = 0;     // выдано сообщений
+    uint32_t lost      = 0;     // пропущено кадров по номерам
+    uint32_t duplicate = 0;     // повторы и кадры не по порядку, отброшены
+    uint32_t invalid   = 0;     // кадры с неверным заголовком или длиной
+    uint32_t resyncs   = 0;     // отправитель начал нумерацию заново
+    uint32_t evicted   = 0;     // таблица отправителей полна, забыт самый давно молчащий
+};
+
+// Кодек версии 1: сообщения подряд побайтно, раскладка структуры должна совпадать на всех платах
+// Интерфейс кодека: begin()/encode()/finish() при сборке кадра, begin_read()/decode()/end_read() при разборе
+template<typename T>
+struct raw_codec {
+    static_assert(std::is_trivially_copyable<T>::value, "espnow_batch: сообщение копируется побайтно");
+
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t  PREFIX_SIZE = 0;           // данные кадра перед первой записью
+    static constexpr size_t  MAX_RECORD_SIZE = sizeof(T);
+    static constexpr size_t  MAX_TRAILER_SIZE = 0;      // данные кадра после последней записи
+
+    size_t begin(uint8_t*, const T&) { return 0; }
+    size_t encode(uint8_t* out, const T& message)
+    {
+        memcpy(out, &message, sizeof(T));
+        return sizeof(T);
+    }
+    size_t finish(uint8_t*, size_t) { return 0; }       // дописать в конец кадра перед отправкой
+
+    bool begin_read(const uint8_t*&, const uint8_t*) { return true; }
+    bool decode(const uint8_t*& it, const uint8_t* end, T& message)
+    {
+        if(static_cast<size_t>(end - it) < sizeof(T)) return false;
+        memcpy(&message, it, sizeof(T));
+        it += sizeof(T);
+        return true;
+    }
+    bool end_read(const uint8_t* it, const uint8_t* end) { return it == end; }
+};
+
+// Заголовок кадра в порядке байт little endian, без зависимости от выравнивания структуры
+inline void write_header(uint8_t* frame, uint8_t version, uint16_t sequence, uint8_t count)
+{
+    frame[0] = FRAME_MAGIC;
+    frame[1] = version;
+    frame[2] = static_cast<uint8_t>(sequence);
+    frame[3] = static_cast<uint8_t>(sequence >> 8);
+    frame[4] = count;
+}
+
+// Версия кодека кадра пакетной передачи, 0 - это не кадр пакетной передачи (например, одиночное сообщение)
+inline uint8_t frame_version(const uint8_t* data, size_t length)
+{
+    return (length >= HEADER_SIZE && data[0] == FRAME_MAGIC) ? data[1] : 0;
+}
+
+// Сборщик кадров: сообщения T кодируются кодеком сразу при добавлении
+template<typename T, typename Codec = raw_codec<T>>
+class sender
+{
+public:
+    // Сколько сообщений гарантированно помещается в кадр (компактный кодек обычно вмещает больше)
+    static constexpr size_t  MAX_PAYLOAD = MAX_FRAME_SIZE - HEADER_SIZE - Codec::PREFIX_SIZE - Codec::MAX_TRAILER_SIZE;
+    static constexpr uint8_t CAPACITY = static_cast<uint8_t>(MAX_PAYLOAD / Codec::MAX_RECORD_SIZE < 255 ? MAX_PAYLOAD / Codec::MAX_RECORD_SIZE : 255);
+    static_assert(CAPACITY > 0, "espnow_batch: сообщение не помещается в кадр");
+
+    sender() = default;
+    sender(send_fn send, void* context, policy_t policy = {}) { begin(send, context, policy); }
+
+    void begin(send_fn send, void* context, policy_t policy = {})
+    {
+        send_ = send;
+        context_ = context;
+        set_policy(policy);
+    }
+
+    // Проверка готовности транспорта перед отправкой кадра (тот же context), nullptr - всегда готов
+    void set_ready(ready_fn ready) { ready_ = ready; }
+
+    void set_policy(policy_t policy)
+    {
+        policy_ = policy;
+        if(policy_.max_messages == 0) policy_.max_messages = 255;
+        if(policy_.max_frame_size > MAX_FRAME_SIZE) policy_.max_frame_size = MAX_FRAME_SIZE;
+    }
+
+    // Добавить сообщение, now - текущее время для контроля задержки (мс)
+    // return: false - кадр заполнен, а транспорт не готов: сообщение не принято
+    bool push(const T& message, uint32_t now)
+    {
+        if(full() && !flush()) {
+            ++stats_.rejected;
+            return false;
+        }
+        if(count_ == 0) {
+            first_time_ = now;
+            length_ = HEADER_SIZE;
+            length_ += codec_.begin(frame_ + length_, message);
+        }
+        length_ += codec_.encode(frame_ + length_, message);
+        ++count_;
+        ++stats_.messages;
+        if(full()) flush();
+        return true;
+    }
+
+    // Проверка задержки и отложенного кадра, вызывать периодически
+    void tick(uint32_t now)
+    {
+        if(count_ > 0 && (held_ || (policy_.max_latency_ms > 0 && now - first_time_ >= policy_.max_latency_ms))) flush();
+    }
+
+    // Отправить накопленное. return: false - транспорт не готов (кадр остается и уйдет из tick()) или ошибка отправки
+    bool flush()
+    {
+        if(count_ == 0) return true;
+        if(ready_ && !ready_(context_)) {
+            if(!held_) ++stats_.held;
+            held_ = true;
+            return false;
+        }
+        held_ = false;
+        length_ += codec_.finish(frame_ + length_, length_);
+        write_header(frame_, Codec::VERSION, sequence_++, count_);
+        count_ = 0;
+        ++stats_.frames;
+        bool ok = send_ && send_(context_, frame_, length_);
+        if(!ok) ++stats_.failed;
+        return ok;
+    }
+
+    // Время до вынужденной отправки по задержке, мс (UINT32_MAX - ждать нечего или готовности транспорта)
+    uint32_t time_to_flush(uint32_t now) const
+    {
+        if(held_) return ready_(context_) ? 0 : UINT32_MAX;
+        if(count_ == 0 || policy_.max_latency_ms == 0) return UINT32_MAX;
+        uint32_t waited = now - first_time_;
+        return waited >= policy_.max_latency_ms ? 0 : policy_.max_latency_ms - waited;
+    }
+
+    uint8_t pending() const { return count_; }
+    const sender_stats_t& stats() const { return stats_; }
+
+private:
+    bool full() const
+    {
+        size_t limit = policy_.max_frame_size ? policy_.max_frame_size : MAX_FRAME_SIZE;
+        return count_ > 0 && (count_ >= policy_.max_messages || limit - length_ < Codec::MAX_RECORD_SIZE + Codec::MAX_TRAILER_SIZE);
+    }
+
+    send_fn  send_    = nullptr;
+    ready_fn ready_   = nullptr;
+    void*    context_ = nullptr;
+    policy_t policy_;
+    Codec    codec_;
+    uint8_t  frame_[MAX_FRAME_SIZE] {};
+    size_t   length_ = 0;       // занято в frame_
+    uint8_t  count_ = 0;
+    uint16_t sequence_ = 0;
+    uint32_t first_time_ = 0;   // время первого сообщения в кадре
+    bool     held_ = false;     // кадр ждет готовности транспорта
+    sender_stats_t stats_;
+};
+
+// Разборщик кадров: сообщения декодируются прямо из буфера приема, без промежуточной копии кадра
+// Номера кадров - по MAC отправителя, до Peers отправителей одновременно
+template<typename T, typename Codec = raw_codec<T>, size_t Peers = 4>
+class receiver
+{
+    static_assert(Peers >= 1, "espnow_batch: хотя бы один отправитель");
+public:
+    // Разобрать кадр отправителя mac (nullptr - единственный отправитель), now - время приема (мс)
+    // и передать сообщения по порядку в on_message(const T&). return: количество сообщений
+    template<typename Callback>
+    size_t unpack(const uint8_t* mac, uint32_t now, const uint8_t* data, size_t length, Callback on_message)
+    {
+        uint8_t count = (frame_version(data, length) == Codec::VERSION) ? data[4] : 0;
+        if(count == 0 || !validate(data, length, count)) {
+            ++stats_.invalid;
+            return 0;
+        }
+        uint16_t sequence = static_cast<uint16_t>(data[2] | (data[3] << 8));
+
+        peer_t& peer = find(mac, now);
+        if(peer.started)
+        {
+            int16_t delta = static_cast<int16_t>(sequence - peer.expected);
+            if(delta < 0 && (delta < -static_cast<int16_t>(RESYNC_GAP) || now - peer.last_time > RESYNC_SILENCE_MS)) ++stats_.resyncs;
+            else if(delta < 0) {
+                ++stats_.duplicate;
+                return 0;
+            }
+            else stats_.lost += static_cast<uint16_t>(delta);
+        }
+        peer.started = true;
+        peer.expected = static_cast<uint16_t>(sequence + 1);
+        peer.last_time = now;
+        ++stats_.frames;
+
+        Codec codec;
+        const uint8_t* it = data + HEADER_SIZE;
+        const uint8_t* end = data + length;
+        codec.begin_read(it, end);
+        T message;
+        for(uint8_t i = 0; i < count; ++i)
+        {
+            codec.decode(it, end, message);
+            on_message(message);
+        }
+        stats_.messages += count;
+        return count;
+    }
+
+    // Единственный отправитель, без учета времени
+    template<typename Callback>
+    size_t unpack(const uint8_t* data, size_t length, Callback on_message) { return unpack(nullptr, 0, data, length, on_message); }
+
+    void reset() { for(peer_t& peer : peers_) peer = peer_t{}; stats_ = receiver_stats_t{}; }
+    const receiver_stats_t& stats() const { return stats_; }
+
+private:
+    struct peer_t {
+        uint8_t  mac[MAC_SIZE] {};
+        bool     used      = false;
+        bool     started   = false;
+        uint16_t expected  = 0;
+        uint32_t last_time = 0;     // прием последнего кадра, мс
+    };
+
+    // Запись отправителя; новый занимает свободную или самую давно молчащую
+    peer_t& find(const uint8_t* mac, uint32_t now)
+    {
+        static const uint8_t ANY[MAC_SIZE] = {};
+        if(!mac) mac = ANY;
+        peer_t* oldest = &peers_[0];
+        for(peer_t& peer : peers_) {
+            if(peer.used && memcmp(peer.mac, mac, MAC_SIZE) == 0) return peer;
+            if(!peer.used) {
+                if(oldest->used) oldest = &peer;
+            }
+            else if(oldest->used && now - peer.last_time > now - oldest->last_time) oldest = &peer;
+        }
+        if(oldest->used) ++stats_.evicted;
+        *oldest = peer_t{};
+        oldest->used = true;
+        memcpy(oldest->mac, mac, MAC_SIZE);
+        oldest->last_time = now;
+        return *oldest;
+    }
+
+    // Проверочный проход: кадр целиком разбирается и ровно заканчивается, до выдачи первого сообщения
+    static bool validate(const uint8_t* data, size_t length, uint8_t count)
+    {
+        Codec codec;
+        const uint8_t* it = data + HEADER_SIZE;
+        const uint8_t* end = data + length;
+        if(!codec.begin_read(it, end)) return false;
+        T message;
+        for(uint8_t i = 0; i < count; ++i) {
+            if(!codec.decode(it, end, message)) return false;
+        }
+        return codec.end_read(it, end);
+    }
+
+    peer_t peers_[Peers];
+    receiver_stats_t stats_;
+};
+
+}// namespace espnow_batch
@@ -0,0 +1,486 @@
+#pragma once
+// Надежная доставка кадров ESP-NOW: скользящее окно, подтверждения, повтор по адаптивному таймауту
+// Обертка над кадрами espnow_batch. Отправитель держит до Window кадров без подтверждения
+// (а не один, как при ожидании ответа на каждый кадр), получатель отдает кадры строго по порядку, пришедшие
+// раньше очередного ждут в окне. Подтверждение - номер очередного ожидаемого кадра (все до него приняты)
+// и битовая маска принятых после него. Таймаут повтора - по измеренному rtt (RFC 6298, только по кадрам
+// без повторов), при повторе удваивается; дыра, о которой сообщили dup_acks подтверждений, повторяется сразу.
+// После max_retries кадр снимается, а получатель пропускает его по номеру base из заголовка данных.
+// Номер сеанса (случайный после загрузки) отличает перезапуск отправителя: получатель с чужим сеансом
+// начинает прием с base, подтверждения чужого сеанса отправитель не слушает.
+// Все по таймерам: tick(now) повторяет просроченное и возвращает мс до следующего срока, ожиданий нет.
+// sender и receiver - половины узла; link - пара узлов, receiver_table - сервер с окном приема на каждого клиента.
+//
+// Формат (little endian):
+//   данные:        [0] 0xB9 | [1] kData | [2] сеанс | [3..4] номер кадра | [5..6] base - самый старый кадр,
+//                  который отправитель еще повторяет | [7..] кадр espnow_batch
+//   подтверждение: [0] 0xB9 | [1] kAck  | [2] сеанс отправителя | [3..4] next - кадры до next приняты
+//                  | [5..8] бит i - принят next + 1 + i
+//
+// Узлы без надежного режима такие кадры не разбирают (другой magic): включать на всех узлах группы.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "espnow_batch.h"
+
+namespace espnow_reliable {
+
+constexpr uint8_t MAGIC       = 0xB9;
+constexpr size_t  DATA_HEADER = 7;
+constexpr size_t  ACK_SIZE    = 9;
+constexpr size_t  MAX_PAYLOAD = espnow_batch::MAX_FRAME_SIZE - DATA_HEADER;   // policy_t::max_frame_size кадров espnow_batch
+
+enum kind_t : uint8_t { kData = 1, kAck = 2 };
+
+struct config_t {
+    uint32_t initial_rto_ms = 250;  // до первого замера rtt
+    uint32_t min_rto_ms     = 30;
+    uint32_t max_rto_ms     = 3000;
+    uint8_t  max_retries    = 6;    // затем кадр снимается
+    uint8_t  dup_acks       = 2;    // быстрый повтор дыры после стольких подтверждений с ней
+};
+
+struct stats_t {
+    uint32_t sent             = 0;  // новых кадров
+    uint32_t retransmits      = 0;  // повторов по таймауту
+    uint32_t fast_retransmits = 0;  // повторов по подтверждениям с дырой
+    uint32_t acked            = 0;
+    uint32_t given_up         = 0;  // снято после max_retries
+    uint32_t window_full      = 0;  // send() отказал: окно занято
+    uint32_t acks_sent        = 0;
+    uint32_t delivered        = 0;  // принятых кадров отдано по порядку
+    uint32_t duplicates       = 0;
+    uint32_t reordered        = 0;  // пришли раньше очередного и ждали в окне
+    uint32_t skipped          = 0;  // на приеме пропущено по base отправителя
+    uint32_t resyncs          = 0;  // отправитель перезапустился, нумерация с его base
+    uint32_t stale_acks       = 0;  // подтверждения другого сеанса или вне окна
+    uint32_t evicted          = 0;  // таблица получателей полна, забыт самый давно молчащий отправитель
+};
+
+inline bool is_frame(const uint8_t* data, size_t length) { return length >= DATA_HEADER && data[0] == MAGIC; }
+
+inline void put16(uint8_t* p, uint16_t v) { p[0] = static_cast<uint8_t>(v); p[1] = static_cast<uint8_t>(v >> 8); }
+inline uint16_t get16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+inline uint32_t get32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+
+// Отправляющая половина: окно неподтвержденных кадров, повторы по rto, быстрый повтор дыры.
+// stats - общие счетчики узла (link или таблица получателей пишут в те же)
+template<size_t Window = 8>
+class sender
+{
+    static_assert(Window >= 1 && Window <= 32, "espnow_reliable: маска подтверждения - 32 бита");
+    static_assert((Window & (Window - 1)) == 0, "espnow_reliable: окно - степень двойки, иначе seq % Window ломается на переполнении uint16");
+public:
+    static constexpr uint32_t NEVER = UINT32_MAX;
+
+    void begin(espnow_batch::send_fn send, void* context, config_t config, stats_t* stats)
+    {
+        send_ = send;
+        context_ = context;
+        config_ = config;
+        stats_ = stats;
+        rto_ = config_.initial_rto_ms;
+    }
+
+    // Сеанс отправителя: новый после каждой загрузки, до первого send()
+    void set_session(uint8_t session) { session_ = session; }
+    uint8_t session() const { return session_; }
+
+    bool can_send() const { return in_flight() < Window; }
+    size_t in_flight() const { return static_cast<uint16_t>(next_ - base_); }
+
+    // Отправить кадр espnow_batch. return: false - окно занято или кадр длиннее MAX_PAYLOAD
+    bool send(const uint8_t* payload, size_t length, uint32_t now)
+    {
+        if(!can_send() || length > MAX_PAYLOAD) {
+            ++stats_->window_full;
+            return false;
+        }
+        out_slot_t& slot = out_[next_ % Window];
+        slot.seq = next_++;
+        slot.length = static_cast<uint8_t>(DATA_HEADER + length);
+        slot.data[0] = MAGIC;
+        slot.data[1] = kData;
+        slot.data[2] = session_;
+        put16(slot.data + 3, slot.seq);
+        memcpy(slot.data + DATA_HEADER, payload, length);
+        slot.retries = 0;
+        slot.rto = rto_;
+        slot.active = true;
+        slot.acked = false;
+        ++stats_->sent;
+        transmit(slot, now);
+        return true;
+    }
+
+    // Подтверждение. return: false - не подтверждение надежного режима
+    bool on_ack(const uint8_t* data, size_t length, uint32_t now)
+    {
+        if(!is_frame(data, length) || data[1] != kAck || length < ACK_SIZE) return false;
+        on_ack(data[2], get16(data + 3), get32(data + 5), now);
+        return true;
+    }
+
+    // Повторы по таймауту. return: мс до следующего срока, NEVER - все подтверждено
+    uint32_t tick(uint32_t now)
+    {
+        for(out_slot_t& slot : out_) {
+            if(!slot.active || slot.acked || now - slot.sent_at < slot.rto) continue;
+            if(slot.retries >= config_.max_retries) {
+                slot.acked = true;
+                ++stats_->given_up;
+                continue;
+            }
+            ++slot.retries;
+            ++stats_->retransmits;
+            slot.rto = slot.rto * 2 < config_.max_rto_ms ? slot.rto * 2 : config_.max_rto_ms;
+            transmit(slot, now);
+        }
+        advance();
+        return time_to_next(now);
+    }
+
+    uint32_t time_to_next(uint32_t now) const
+    {
+        uint32_t next = NEVER;
+        for(const out_slot_t& slot : out_) {
+            if(!slot.active || slot.acked) continue;
+            uint32_t waited = now - slot.sent_at;
+            uint32_t left = waited >= slot.rto ? 0 : slot.rto - waited;
+            if(left < next) next = left;
+        }
+        return next;
+    }
+
+    uint32_t rto() const { return rto_; }
+    uint32_t srtt() const { return srtt8_ >> 3; }
+    const stats_t& stats() const { return *stats_; }
+
+private:
+    struct out_slot_t {
+        uint8_t  data[espnow_batch::MAX_FRAME_SIZE];
+        uint8_t  length  = 0;
+        uint16_t seq     = 0;
+        uint32_t sent_at = 0;
+        uint32_t rto     = 0;
+        uint8_t  retries = 0;
+        bool     active  = false;
+        bool     acked   = false;
+    };
+
+    // base в заголовке - на момент отправки: повтор несет свежий
+    void transmit(out_slot_t& slot, uint32_t now)
+    {
+        put16(slot.data + 5, base_);
+        slot.sent_at = now;
+        if(send_) send_(context_, slot.data, slot.length);
+    }
+
+    void on_ack(uint8_t session, uint16_t next, uint32_t sack, uint32_t now)
+    {
+        int16_t advance_by = static_cast<int16_t>(next - base_);
+        if(session != session_ || advance_by < 0 || static_cast<size_t>(advance_by) > in_flight()) {
+            ++stats_->stale_acks;       // прошлый сеанс, устаревшее или чужое
+            return;
+        }
+        for(uint16_t seq = base_; seq != next; ++seq) ack(seq, now);
+        for(size_t i = 0; i + 1 < Window; ++i) {
+            uint16_t seq = static_cast<uint16_t>(next + 1 + i);
+            if((sack >> i) & 1 && static_cast<int16_t>(seq - next_) < 0) ack(seq, now);
+        }
+        advance();
+        // Дыра: подтверждения идут, а next стоит - кадр потерян, повторить не дожидаясь таймаута
+        if(!sack || base_ == next_) return;
+        if(hole_ != next) {
+            hole_ = next;
+            hole_acks_ = 0;
+        }
+        out_slot_t& slot = out_[next % Window];
+        if(++hole_acks_ == config_.dup_acks && slot.active && !slot.acked && slot.seq == next) {
+            ++slot.retries;
+            ++stats_->fast_retransmits;
+            transmit(slot, now);
+        }
+    }
+
+    void ack(uint16_t seq, uint32_t now)
+    {
+        out_slot_t& slot = out_[seq % Window];
+        if(!slot.active || slot.acked || slot.seq != seq) return;
+        slot.acked = true;
+        ++stats_->acked;
+        if(slot.retries == 0) rtt_sample(now - slot.sent_at);  // по повторенным неизвестно, на какой ответ
+    }
+
+    void rtt_sample(uint32_t rtt)
+    {
+        if(!have_rtt_) {
+            have_rtt_ = true;
+            srtt8_ = rtt << 3;
+            rttvar4_ = rtt << 1;
+        }
+        else {
+            int32_t delta = static_cast<int32_t>(rtt) - static_cast<int32_t>(srtt8_ >> 3);
+            srtt8_ += delta;                                                    // srtt += delta / 8
+            rttvar4_ += (delta < 0 ? -delta : delta) - static_cast<int32_t>(rttvar4_ >> 2); // rttvar += (|delta| - rttvar) / 4
+        }
+        uint32_t rto = (srtt8_ >> 3) + (rttvar4_ > 0 ? rttvar4_ : 1);          // srtt + 4 * rttvar
+        rto_ = rto < config_.min_rto_ms ? config_.min_rto_ms : rto > config_.max_rto_ms ? config_.max_rto_ms : rto;
+    }
+
+    void advance()
+    {
+        while(base_ != next_) {
+            out_slot_t& slot = out_[base_ % Window];
+            if(slot.active && !slot.acked) break;
+            slot.active = false;
+            ++base_;
+        }
+    }
+
+    espnow_batch::send_fn send_ = nullptr;
+    void*     context_ = nullptr;
+    config_t  config_;
+    stats_t*  stats_ = nullptr;
+    out_slot_t out_[Window];
+    uint8_t   session_ = 0;
+    uint16_t  base_ = 0;                // самый старый неподтвержденный
+    uint16_t  next_ = 0;                // номер следующего нового кадра
+    uint32_t  rto_ = 250;
+    bool      have_rtt_ = false;
+    uint32_t  srtt8_ = 0;               // srtt * 8, мс
+    int32_t   rttvar4_ = 0;             // rttvar * 4, мс
+    uint16_t  hole_ = 0;
+    uint8_t   hole_acks_ = 0;
+};
+
+// Принимающая половина для одного отправителя: окно пришедших раньше очередного, подтверждения
+template<size_t Window = 8>
+class receiver
+{
+    static_assert(Window >= 1 && Window <= 32, "espnow_reliable: маска подтверждения - 32 бита");
+    static_assert((Window & (Window - 1)) == 0, "espnow_reliable: окно - степень двойки, иначе seq % Window ломается на переполнении uint16");
+public:
+    void begin(espnow_batch::send_fn send, void* context, stats_t* stats)
+    {
+        send_ = send;
+        context_ = context;
+        stats_ = stats;
+    }
+
+    // Забыть отправителя: следующий кадр начинает прием с его base
+    void reset()
+    {
+        for(in_slot_t& slot : in_) slot.present = false;
+        started_ = false;
+    }
+
+    // Кадр данных: по порядку - в deliver(payload, length). return: false - не данные надежного режима
+    template<typename Deliver>
+    bool on_data(const uint8_t* data, size_t length, Deliver deliver)
+    {
+        if(!is_frame(data, length) || data[1] != kData) return false;
+        on_data(data[2], get16(data + 3), get16(data + 5), data + DATA_HEADER, length - DATA_HEADER, deliver);
+        return true;
+    }
+
+private:
+    struct in_slot_t {
+        uint8_t  data[MAX_PAYLOAD];
+        uint8_t  length  = 0;
+        uint16_t seq     = 0;
+        bool     present = false;
+    };
+
+    template<typename Deliver>
+    void on_data(uint8_t session, uint16_t seq, uint16_t base, const uint8_t* payload, size_t length, Deliver& deliver)
+    {
+        if(!started_) {
+            started_ = true;
+            peer_session_ = session;
+            expected_ = base;
+        }
+        int16_t behind = static_cast<int16_t>(base - expected_);
+        if(session != peer_session_ || behind < -static_cast<int16_t>(2 * Window)) {
+            // Отправитель начал нумерацию заново: новый сеанс (или тот же номер сеанса случайно, но base далеко позади)
+            for(in_slot_t& slot : in_) slot.present = false;
+            peer_session_ = session;
+            expected_ = base;
+            ++stats_->resyncs;
+        }
+        else if(behind > 0) {
+            // Отправитель снял кадры до base: ждать их бесполезно, принятые после дыры - по порядку
+            for(size_t i = 0; i < Window && expected_ != base; ++i, ++expected_) {
+                in_slot_t& slot = in_[expected_ % Window];
+                if(slot.present && slot.seq == expected_) {
+                    slot.present = false;
+                    pass(slot.data, slot.length, deliver);
+                }
+                else ++stats_->skipped;
+            }
+            stats_->skipped += static_cast<uint16_t>(base - expected_);
+            expected_ = base;
+            drain(deliver);
+        }
+        int16_t ahead = static_cast<int16_t>(seq - expected_);
+        if(ahead == 0) {
+            ++expected_;
+            pass(payload, length, deliver);
+            drain(deliver);
+        }
+        else if(ahead < 0 || (ahead < static_cast<int16_t>(Window) && in_[seq % Window].present)) ++stats_->duplicates;
+        else if(ahead < static_cast<int16_t>(Window)) {
+            in_slot_t& slot = in_[seq % Window];
+            memcpy(slot.data, payload, length);
+            slot.length = static_cast<uint8_t>(length);
+            slot.seq = seq;
+            slot.present = true;
+            ++stats_->reordered;
+        }
+        send_ack();
+    }
+
+    template<typename Deliver>
+    void pass(const uint8_t* payload, size_t length, Deliver& deliver)
+    {
+        ++stats_->delivered;
+        deliver(payload, length);
+    }
+
+    template<typename Deliver>
+    void drain(Deliver& deliver)
+    {
+        for(;;) {
+            in_slot_t& slot = in_[expected_ % Window];
+            if(!slot.present || slot.seq != expected_) return;
+            slot.present = false;
+            ++expected_;
+            pass(slot.data, slot.length, deliver);
+        }
+    }
+
+    // Подтверждение уходит всем пирам, но с сеансом этого отправителя: остальные его не примут
+    void send_ack()
+    {
+        uint8_t frame[ACK_SIZE] = {MAGIC, kAck, peer_session_};
+        put16(frame + 3, expected_);
+        uint32_t sack = 0;
+        for(size_t i = 0; i + 1 < Window; ++i) {
+            uint16_t seq = static_cast<uint16_t>(expected_ + 1 + i);
+            const in_slot_t& slot = in_[seq % Window];
+            if(slot.present && slot.seq == seq) sack |= 1u << i;
+        }
+        for(int i = 0; i < 4; ++i) frame[5 + i] = static_cast<uint8_t>(sack >> (8 * i));
+        ++stats_->acks_sent;
+        if(send_) send_(context_, frame, sizeof(frame));
+    }
+
+    espnow_batch::send_fn send_ = nullptr;
+    void*     context_ = nullptr;
+    stats_t*  stats_ = nullptr;
+    in_slot_t in_[Window];
+    bool      started_ = false;
+    uint8_t   peer_session_ = 0;
+    uint16_t  expected_ = 0;
+};
+
+// Получатели по MAC отправителя: у сервера несколько клиентов, у каждого свой сеанс и своя нумерация.
+// Общий получатель на всех пересинхронизировался бы на каждом кадре другого клиента и терял бы кадры из окна.
+// Peers - отправителей одновременно, новый сверх них вытесняет самого давно молчащего
+template<size_t Window = 8, size_t Peers = 4>
+class receiver_table
+{
+    static_assert(Peers >= 1, "espnow_reliable: хотя бы один отправитель");
+public:
+    void begin(espnow_batch::send_fn send, void* context, stats_t* stats)
+    {
+        stats_ = stats;
+        for(peer_t& peer : peers_) peer.rx.begin(send, context, stats);
+    }
+
+    // Кадр данных от mac, now - время приема (мс). return: false - не данные надежного режима
+    template<typename Deliver>
+    bool on_data(const uint8_t* mac, uint32_t now, const uint8_t* data, size_t length, Deliver deliver)
+    {
+        if(!is_frame(data, length) || data[1] != kData) return false;
+        return find(mac, now).rx.on_data(data, length, deliver);
+    }
+
+private:
+    struct peer_t {
+        uint8_t  mac[espnow_batch::MAC_SIZE] {};
+        bool     used      = false;
+        uint32_t last_time = 0;
+        receiver<Window> rx;
+    };
+
+    peer_t& find(const uint8_t* mac, uint32_t now)
+    {
+        peer_t* oldest = &peers_[0];
+        for(peer_t& peer : peers_) {
+            if(peer.used && memcmp(peer.mac, mac, espnow_batch::MAC_SIZE) == 0) {
+                peer.last_time = now;
+                return peer;
+            }
+            if(!peer.used) {
+                if(oldest->used) oldest = &peer;
+            }
+            else if(oldest->used && now - peer.last_time > now - oldest->last_time) oldest = &peer;
+        }
+        if(oldest->used) ++stats_->evicted;
+        oldest->rx.reset();
+        oldest->used = true;
+        memcpy(oldest->mac, mac, espnow_batch::MAC_SIZE);
+        oldest->last_time = now;
+        return *oldest;
+    }
+
+    stats_t* stats_ = nullptr;
+    peer_t   peers_[Peers];
+};
+
+// Отправитель и получатель одного узла пары
+template<size_t Window = 8>
+class link
+{
+public:
+    static constexpr uint32_t NEVER = UINT32_MAX;
+
+    void begin(espnow_batch::send_fn send, void* context, config_t config = {})
+    {
+        tx_.begin(send, context, config, &stats_);
+        rx_.begin(send, context, &stats_);
+    }
+
+    void set_session(uint8_t session) { tx_.set_session(session); }
+    uint8_t session() const { return tx_.session(); }
+
+    bool can_send() const { return tx_.can_send(); }
+    size_t in_flight() const { return tx_.in_flight(); }
+    bool send(const uint8_t* payload, size_t length, uint32_t now) { return tx_.send(payload, length, now); }
+
+    // Принятый кадр: подтверждение или данные. Данные по порядку - в deliver(payload, length).
+    // return: false - не кадр надежного режима
+    template<typename Deliver>
+    bool on_frame(const uint8_t* data, size_t length, uint32_t now, Deliver deliver)
+    {
+        if(!is_frame(data, length)) return false;
+        if(!tx_.on_ack(data, length, now)) rx_.on_data(data, length, deliver);
+        return true;
+    }
+
+    uint32_t tick(uint32_t now) { return tx_.tick(now); }
+    uint32_t time_to_next(uint32_t now) const { return tx_.time_to_next(now); }
+
+    uint32_t rto() const { return tx_.rto(); }
+    uint32_t srtt() const { return tx_.srtt(); }
+    const stats_t& stats() const { return stats_; }
+
+private:
+    stats_t          stats_;
+    sender<Window>   tx_;
+    receiver<Window> rx_;
+};
+
+}// namespace espnow_reliable
@@ -0,0 +1,139 @@
+#pragma once
+// Счетчики кучи для длительных прогонов: свободно, самый большой свободный блок, фрагментация в процентах.
+// monitor копит минимумы/максимумы за все время и кольцо последних выборок; выборка - раз в несколько минут
+// задачей loop(), выгрузка CSV командой консоли /heap. Рост фрагментации при стабильном free - признак того,
+// что кто-то выделяет и освобождает блоки разного размера (String, etl::vector в цикле).
+//
+//   heap_stats::monitor<16> heap;
+//   heap.sample(millis());                              // задача "heap"
+//   heap.write_csv([](const char* line) { Serial.println(line); });
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "Arduino.h"
+#if defined(ESP32)
+  #include <esp_heap_caps.h>
+#endif
+
+namespace heap_stats {
+
+struct reading_t {
+    uint32_t free          = 0;     // байт
+    uint32_t max_block     = 0;     // самый большой блок, который можно выделить
+    uint8_t  fragmentation = 0;     // 100 - max_block * 100 / free, %
+};
+
+inline uint8_t fragmentation(uint32_t free, uint32_t max_block)
+{
+    if(!free || max_block >= free) return 0;
+    return static_cast<uint8_t>(100 - static_cast<uint64_t>(max_block) * 100 / free);
+}
+
+#if !defined(ESP8266) && !defined(ESP32)
+// [env:native]: куча компьютера не ограничена, счетчики ведет тест, заменяющий operator new/delete
+struct host_heap_t {
+    uint32_t size        = 80 * 1024;   // размер модели кучи, как у ESP8266
+    uint32_t in_use      = 0;
+    uint32_t allocations = 0;           // вызовов operator new
+};
+inline host_heap_t& host_heap()
+{
+    static host_heap_t heap;
+    return heap;
+}
+#endif
+
+inline reading_t read()
+{
+    reading_t r;
+#if defined(ESP8266)
+    r.free = ESP.getFreeHeap();
+    r.max_block = ESP.getMaxFreeBlockSize();
+    r.fragmentation = ESP.getHeapFragmentation();
+#elif defined(ESP32)
+    r.free = static_cast<uint32_t>(heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    r.max_block = static_cast<uint32_t>(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    r.fragmentation = fragmentation(r.free, r.max_block);
+#else
+    const host_heap_t& heap = host_heap();
+    r.free = heap.in_use < heap.size ? heap.size - heap.in_use : 0;
+    r.max_block = r.free;
+#endif
+    return r;
+}
+
+// History - последних выборок в кольце
+template<size_t History = 16>
+class monitor
+{
+public:
+    struct sample_t {
+        uint32_t  time = 0;         // millis()
+        reading_t heap;
+    };
+
+    void sample(uint32_t now) { add(now, read()); }
+
+    // Выборка из готовых значений: тесты и источник, отличный от read()
+    void add(uint32_t now, const reading_t& heap)
+    {
+        if(!count_) first_ = {now, heap};
+        last_ = {now, heap};
+        if(!count_ || heap.free < min_free_) min_free_ = heap.free;
+        if(!count_ || heap.max_block < min_block_) min_block_ = heap.max_block;
+        if(heap.fragmentation > max_fragmentation_) max_fragmentation_ = heap.fragmentation;
+        history_[count_ % History] = last_;
+        ++count_;
+    }
+
+    void reset() { *this = monitor(); }
+
+    uint32_t samples() const { return count_; }
+    const sample_t& first() const { return first_; }
+    const sample_t& last() const { return last_; }
+    uint32_t min_free() const { return min_free_; }     // наибольшее заполнение кучи
+    uint32_t min_block() const { return min_block_; }
+    uint8_t  max_fragmentation() const { return max_fragmentation_; }
+
+    // Потеря свободной памяти от первой выборки до последней, байт в час; > 0 - утечка или рост фрагментов
+    int32_t free_loss_per_hour() const
+    {
+        uint32_t span = last_.time - first_.time;
+        if(span < 60000) return 0;
+        int64_t loss = static_cast<int64_t>(first_.heap.free) - last_.heap.free;
+        return static_cast<int32_t>(loss * 3600000 / span);
+    }
+
+    // Построчная выгрузка CSV: write_line(const char*) без перевода строки
+    template<typename WriteLine>
+    void write_csv(WriteLine write_line) const
+    {
+        char line[96];
+        write_line("heap,samples,free,max_block,frag,min_free,min_block,max_frag,loss_per_hour");
+        snprintf(line, sizeof(line), "heap,%lu,%lu,%lu,%u,%lu,%lu,%u,%ld", ul(count_), ul(last_.heap.free), ul(last_.heap.max_block),
+                 unsigned(last_.heap.fragmentation), ul(min_free_), ul(min_block_), unsigned(max_fragmentation_),
+                 static_cast<long>(free_loss_per_hour()));
+        write_line(line);
+        write_line("heap_sample,time_ms,free,max_block,frag");
+        uint32_t n = count_ < History ? count_ : History;
+        for(uint32_t i = count_ - n; i < count_; ++i) {
+            const sample_t& s = history_[i % History];
+            snprintf(line, sizeof(line), "heap_sample,%lu,%lu,%lu,%u", ul(s.time), ul(s.heap.free), ul(s.heap.max_block), unsigned(s.heap.fragmentation));
+            write_line(line);
+        }
+    }
+
+private:
+    static unsigned long ul(uint32_t value) { return static_cast<unsigned long>(value); }
+
+    sample_t history_[History];
+    sample_t first_;
+    sample_t last_;
+    uint32_t count_ = 0;
+    uint32_t min_free_ = 0;
+    uint32_t min_block_ = 0;
+    uint8_t  max_fragmentation_ = 0;
+};
+
+}// namespace heap_stats
@@ -0,0 +1,281 @@
+#pragma once
+// Плавное затемнение светодиодов по таблице гамма-коррекции
+// Яркость задается линейно для глаза (0..MAX_LEVEL), таблица переводит ее в скважность ШИМ 8..12 бит.
+// Таблицы строятся при компиляции (constexpr), в tick() только целочисленные умножения и сдвиги:
+// ни плавающей точки, ни деления, поэтому стоимость одинакова на ESP8266 без FPU и на ESP32.
+// Несколько каналов затемняются одновременно, в ШИМ пишется только изменившаяся скважность.
+//
+//   led_fade::fader<2, led_fade::pwm_write> fader(led_fade::gamma_10bit);
+//   fader.fade_to(0, led_fade::MAX_LEVEL, 3000, led_fade::easing_t::kSmoothstep, millis());
+//   uint32_t task_fade(void*, uint32_t now) { fader.tick(now); return fader.time_to_next(now); }
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ESP8266) || defined(ESP32)
+  #include "Arduino.h"
+#endif
+
+namespace led_fade {
+
+constexpr uint16_t MAX_LEVEL = 0xFFFF;     // полная яркость, линейная для глаза шкала
+
+// Математика только для constexpr-таблиц, во время работы не вызывается
+namespace detail {
+
+constexpr double ln(double x)
+{
+    // x = m * 2^k, m в [0.5, 1): ln(m) = 2 * atanh((m - 1) / (m + 1)), ряд быстро сходится
+    int k = 0;
+    while(x < 0.5) { x *= 2; --k; }
+    while(x >= 1.0) { x /= 2; ++k; }
+    double z = (x - 1) / (x + 1), z2 = z * z, term = z, sum = 0;
+    for(int n = 1; n < 60; n += 2) { sum += term / n; term *= z2; }
+    return 2 * sum + k * 0.69314718055994530942;
+}
+
+constexpr double exp(double x)
+{
+    // exp(x) = exp(x / 2^n)^(2^n), ряд Тейлора для малого аргумента
+    int halvings = 0;
+    while(x > 0.5 || x < -0.5) { x /= 2; ++halvings; }
+    double sum = 1, term = 1;
+    for(int n = 1; n < 20; ++n) { term *= x / n; sum += term; }
+    while(halvings--) sum *= sum;
+    return sum;
+}
+
+constexpr double pow(double x, double y) { return x <= 0 ? 0 : exp(y * ln(x)); }
+
+}// namespace detail
+
+// Таблица 257 точек по старшему байту яркости, значения - скважность с 4 дробными битами для интерполяции
+struct gamma_table
+{
+    static constexpr size_t SIZE = 257;
+    static constexpr int FRACTION = 4;
+
+    uint16_t value[SIZE] = {};
+    uint8_t  bits = 0;
+
+    constexpr uint16_t max_duty() const { return static_cast<uint16_t>((1u << bits) - 1); }
+
+    // Яркость 0..MAX_LEVEL -> скважность 0..max_duty(), линейная интерполяция между точками таблицы
+    uint16_t apply(uint16_t level) const
+    {
+        uint32_t index = level >> 8;
+        uint32_t a = value[index], b = value[index + 1];
+        uint32_t q = a + (((b - a) * (level & 0xFF)) >> 8);     // таблица монотонна, b >= a
+        return static_cast<uint16_t>((q + (1u << (FRACTION - 1))) >> FRACTION);
+    }
+};
+
+// gamma_x10: показатель степени, умноженный на 10 (22 - гамма 2.2, 10 - без коррекции)
+template<uint8_t Bits, uint16_t GammaX10 = 22>
+constexpr gamma_table make_gamma_table()
+{
+    static_assert(Bits >= 8 && Bits <= 12, "led_fade: поддерживается ШИМ 8..12 бит");
+    gamma_table table;
+    table.bits = Bits;
+    const double top = static_cast<double>(((1u << Bits) - 1) << gamma_table::FRACTION);
+    for(size_t i = 0; i < gamma_table::SIZE; ++i) {
+        double x = i < gamma_table::SIZE - 1 ? static_cast<double>(i) / 256 : 1.0;
+        table.value[i] = static_cast<uint16_t>(detail::pow(x, GammaX10 / 10.0) * top + 0.5);
+    }
+    table.value[gamma_table::SIZE - 1] = static_cast<uint16_t>(top);
+    return table;
+}
+
+inline constexpr gamma_table gamma_8bit  = make_gamma_table<8>();
+inline constexpr gamma_table gamma_10bit = make_gamma_table<10>();
+inline constexpr gamma_table gamma_12bit = make_gamma_table<12>();
+
+// Кривые изменения яркости во времени, прогресс 0..0xFFFF
+enum class easing_t : uint8_t {
+    kLinear,
+    kInQuad,        // медленный старт
+    kOutQuad,       // медленное окончание
+    kInOutQuad,
+    kSmoothstep,    // 3p^2 - 2p^3, мягкие оба конца
+};
+
+inline uint16_t ease(easing_t easing, uint16_t progress)
+{
+    // x * (x + 1) вместо x * x: концы 0 и 0xFFFF переходят сами в себя, без переполнения uint32_t
+    auto square = [](uint32_t x, int shift) { return (x * (x + 1)) >> shift; };
+    uint32_t p = progress;
+    uint32_t q = MAX_LEVEL - p;
+    switch(easing)
+    {
+    case easing_t::kLinear:     return static_cast<uint16_t>(p);
+    case easing_t::kInQuad:     return static_cast<uint16_t>(square(p, 16));
+    case easing_t::kOutQuad:    return static_cast<uint16_t>(MAX_LEVEL - square(q, 16));
+    case easing_t::kInOutQuad:  return static_cast<uint16_t>(p < 0x8000 ? square(p, 15) : MAX_LEVEL - square(q, 15));
+    case easing_t::kSmoothstep: {
+        uint64_t value = (static_cast<uint64_t>(square(p, 16)) * (3 * 0x10000u - 2 * p)) >> 16;
+        return static_cast<uint16_t>(value < MAX_LEVEL ? value : MAX_LEVEL);
+    }
+    }
+    return static_cast<uint16_t>(p);
+}
+
+// Каналы затемнения. Write(channel, duty) - запись скважности в ШИМ, как clock у deadline_scheduler
+template<size_t N, void (*Write)(uint8_t channel, uint16_t duty)>
+class fader
+{
+    static_assert(N >= 1 && N <= 32, "led_fade: каналов 1..32, маска завершения в uint32_t");
+
+public:
+    static constexpr uint32_t NEVER = UINT32_MAX;
+    static constexpr uint32_t FRAME_INTERVAL = 10;     // шаг обновления яркости во время затемнения, мс
+
+    explicit fader(const gamma_table& table) : table_(table) {}
+
+    // Сразу установить яркость, текущее затемнение канала прекращается
+    void set(size_t channel, uint16_t level)
+    {
+        if(channel >= N) return;
+        channels_[channel].active = false;
+        output(channel, level);
+    }
+
+    // Плавно перейти от текущей яркости к level за duration мс. Деление - только здесь, один раз на запуск
+    void fade_to(size_t channel, uint16_t level, uint32_t duration_ms, easing_t easing, uint32_t now)
+    {
+        if(channel >= N) return;
+        if(duration_ms == 0) { set(channel, level); return; }
+        channel_t& c = channels_[channel];
+        c.from = c.level;
+        c.to = level;
+        c.start = now;
+        c.duration = duration_ms;
+        c.inverse = UINT32_MAX / duration_ms;
+        c.easing = easing;
+        c.active = true;
+    }
+
+    // Обновить яркость всех затемняемых каналов. return: маска каналов, закончивших затемнение на этом вызове
+    uint32_t tick(uint32_t now)
+    {
+        uint32_t finished = 0;
+        for(size_t i = 0; i < N; ++i)
+        {
+            channel_t& c = channels_[i];
+            if(!c.active) continue;
+            uint32_t elapsed = now - c.start;
+            if(elapsed >= c.duration) {
+                c.active = false;
+                output(i, c.to);
+                finished |= 1u << i;
+                continue;
+            }
+            uint16_t progress = static_cast<uint16_t>((static_cast<uint64_t>(elapsed) * c.inverse) >> 16);
+            int32_t delta = static_cast<int32_t>(c.to) - static_cast<int32_t>(c.from);
+            int32_t step = (delta * static_cast<int32_t>(ease(c.easing, progress) >> 1)) >> 15;
+            output(i, static_cast<uint16_t>(c.from + step));
+        }
+        return finished;
+    }
+
+    // Время до следующего вызова tick(), мс (для deadline_scheduler)
+    uint32_t time_to_next(uint32_t now) const
+    {
+        uint32_t next = NEVER;
+        for(const channel_t& c : channels_) {
+            if(!c.active) continue;
+            uint32_t elapsed = now - c.start;
+            if(elapsed >= c.duration) return 0;
+            uint32_t left = c.duration - elapsed;
+            if(left < next) next = left;
+        }
+        return next < FRAME_INTERVAL ? next : (next == NEVER ? NEVER : FRAME_INTERVAL);
+    }
+
+    bool is_active(size_t channel) const { return channel < N && channels_[channel].active; }
+    uint16_t level(size_t channel) const { return channel < N ? channels_[channel].level : 0; }
+    uint16_t duty(size_t channel) const { return channel < N ? channels_[channel].duty : 0; }
+
+private:
+    struct channel_t {
+        uint16_t level = 0;         // текущая яркость
+        uint16_t from = 0;
+        uint16_t to = 0;
+        uint16_t duty = 0;          // последняя записанная скважность
+        uint32_t start = 0;
+        uint32_t duration = 0;
+        uint32_t inverse = 0;       // UINT32_MAX / duration: прогресс умножением вместо деления
+        easing_t easing = easing_t::kLinear;
+        bool     active = false;
+        bool     written = false;   // скважность еще ни разу не записана
+    };
+
+    void output(size_t channel, uint16_t level)
+    {
+        channel_t& c = channels_[channel];
+        c.level = level;
+        uint16_t duty = table_.apply(level);
+        if(c.written && duty == c.duty) return;
+        c.duty = duty;
+        c.written = true;
+        Write(static_cast<uint8_t>(channel), duty);
+    }
+
+    const gamma_table& table_;
+    channel_t channels_[N];
+};
+
+// ШИМ платформы: канал LEDC на ESP32, analogWrite() по выводу на ESP8266
+constexpr size_t PWM_CHANNELS = 8;
+
+#if defined(ESP8266)
+inline int pwm_pins[PWM_CHANNELS] = {-1, -1, -1, -1, -1, -1, -1, -1};
+
+inline bool pwm_attach(uint8_t channel, int pin, uint32_t frequency, uint8_t bits)
+{
+    if(channel >= PWM_CHANNELS) return false;
+    pwm_pins[channel] = pin;
+    pinMode(pin, OUTPUT);
+    analogWriteRange((1u << bits) - 1);
+    analogWriteFreq(frequency);
+    analogWrite(pin, 0);
+    return true;
+}
+
+inline void pwm_write(uint8_t channel, uint16_t duty)
+{
+    if(channel < PWM_CHANNELS && pwm_pins[channel] >= 0) analogWrite(pwm_pins[channel], duty);
+}
+#elif defined(ESP32)
+inline int pwm_pins[PWM_CHANNELS] = {-1, -1, -1, -1, -1, -1, -1, -1};
+
+inline bool pwm_attach(uint8_t channel, int pin, uint32_t frequency, uint8_t bits)
+{
+    if(channel >= PWM_CHANNELS) return false;
+    pwm_pins[channel] = pin;
+  #if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    return ledcAttachChannel(pin, frequency, bits, channel);
+  #else
+    ledcSetup(channel, frequency, bits);
+    ledcAttachPin(pin, channel);
+    return true;
+  #endif
+}
+
+inline void pwm_write(uint8_t channel, uint16_t duty)
+{
+    if(channel >= PWM_CHANNELS || pwm_pins[channel] < 0) return;
+  #if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcWrite(pwm_pins[channel], duty);
+  #else
+    ledcWrite(channel, duty);
+  #endif
+}
+#else
+// На компьютере скважность просто запоминается
+inline uint16_t pwm_duty[PWM_CHANNELS] = {};
+
+inline bool pwm_attach(uint8_t channel, int, uint32_t, uint8_t) { return channel < PWM_CHANNELS; }
+inline void pwm_write(uint8_t channel, uint16_t duty) { if(channel < PWM_CHANNELS) pwm_duty[channel] = duty; }
+#endif
+
+}// namespace led_fade
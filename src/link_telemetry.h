@@ -0,0 +1,259 @@
+#pragma once
+// Телеметрия канала ESP-NOW для замеров дальности
+// Клиент отмечает время каждого kCount, сервер возвращает его метку в ответном kBlink - получается время кругового пути.
+// Потери считаются по пропускам номеров кадров espnow_batch и по запросам без ответа, RSSI - по каждому принятому сообщению.
+// Вся память статическая: гистограммы с логарифмическими корзинами и кольцо последних замеров.
+// Выгрузка по запросу: CSV построчно (строка начинается с имени таблицы) или двоичный снимок.
+//
+//   rtt_ms,<нижняя граница корзины>,<количество>
+//   sample,<время>,<reply|timeout|loss>,<rtt или потеряно кадров>,<rssi>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "log_histogram.h"
+
+namespace link_telemetry {
+
+constexpr int8_t RSSI_UNKNOWN = 0;      // плата не сообщает RSSI (ESP8266)
+
+// RSSI по корзинам 5 дБм от -100 до -25
+class rssi_histogram
+{
+public:
+    static constexpr size_t BUCKETS = 16;
+    static constexpr int    FLOOR = -100;
+    static constexpr int    STEP = 5;
+
+    static size_t bucket_of(int8_t rssi)
+    {
+        int index = (rssi - FLOOR) / STEP;
+        return index < 0 ? 0 : (index >= static_cast<int>(BUCKETS) ? BUCKETS - 1 : static_cast<size_t>(index));
+    }
+    static int lower_bound(size_t index) { return FLOOR + static_cast<int>(index) * STEP; }
+
+    void add(int8_t rssi) { ++buckets_[bucket_of(rssi)]; ++count_; }
+    void reset() { *this = rssi_histogram(); }
+
+    uint32_t count() const { return count_; }
+    uint32_t bucket(size_t index) const { return buckets_[index]; }
+
+private:
+    uint32_t buckets_[BUCKETS] {};
+    uint32_t count_ = 0;
+};
+
+enum class sample_kind_t : uint8_t {
+    kReply = 0,     // value - время кругового пути, мс
+    kTimeout,       // запрос без ответа
+    kLoss           // value - пропущено кадров по номерам
+};
+
+struct sample_t {
+    uint32_t      time = 0;     // millis() события
+    uint16_t      value = 0;
+    int8_t        rssi = RSSI_UNKNOWN;
+    sample_kind_t kind = sample_kind_t::kReply;
+};
+
+struct counters_t {
+    uint32_t requests  = 0;     // отправлено kCount
+    uint32_t replies   = 0;     // получено ответов на свои kCount
+    uint32_t timeouts  = 0;     // kCount без ответа за REPLY_TIMEOUT
+    uint32_t unmatched = 0;     // kBlink с чужой меткой: опоздал или старый сервер
+    uint32_t received  = 0;     // принято сообщений
+    uint32_t frames    = 0;     // принято кадров espnow_batch
+    uint32_t lost      = 0;     // пропущено кадров по номерам
+};
+
+class telemetry
+{
+public:
+    static constexpr size_t   SAMPLES = 64;            // кольцо последних событий
+    static constexpr size_t   PENDING = 4;             // запросов в ожидании ответа
+    static constexpr uint32_t REPLY_TIMEOUT = 1000;    // мс
+    static constexpr uint8_t  BINARY_VERSION = 1;
+
+    using rtt_histogram_t = log_histogram<32>;          // до ~65 с
+
+    // Отправлен запрос, timestamp - его метка времени, которую вернет сервер
+    void on_request(uint32_t timestamp)
+    {
+        ++counters_.requests;
+        pending_t& slot = pending_[pending_next_++ % PENDING];
+        if(slot.active) expire(slot);     // вытесняется самый старый
+        slot.timestamp = timestamp;
+        slot.active = true;
+    }
+
+    // Принят ответ с меткой запроса echo в момент now
+    void on_reply(uint32_t echo, uint32_t now, int8_t rssi)
+    {
+        for(auto& slot : pending_)
+        {
+            if(!slot.active || slot.timestamp != echo) continue;
+            slot.active = false;
+            uint32_t rtt = now - echo;
+            ++counters_.replies;
+            rtt_.add(rtt);
+            push_sample(now, sample_kind_t::kReply, rtt, rssi);
+            return;
+        }
+        ++counters_.unmatched;
+    }
+
+    // Любое принятое сообщение
+    void on_receive(int8_t rssi)
+    {
+        ++counters_.received;
+        if(rssi != RSSI_UNKNOWN) {
+            rssi_.add(rssi);
+            last_rssi_ = rssi;
+        }
+    }
+
+    // Счетчики приемника кадров с момента старта: приращение потерь попадает в кольцо
+    void on_frames(uint32_t frames, uint32_t lost, uint32_t now)
+    {
+        if(lost > counters_.lost) push_sample(now, sample_kind_t::kLoss, lost - counters_.lost, last_rssi_);
+        counters_.frames = frames;
+        counters_.lost = lost;
+    }
+
+    // Истечение ожидания ответов, вызывать периодически
+    void tick(uint32_t now)
+    {
+        for(auto& slot : pending_) {
+            if(slot.active && now - slot.timestamp >= REPLY_TIMEOUT) expire(slot);
+        }
+    }
+
+    void reset()
+    {
+        // Итоги приемника накопительные, после сброса считаются от текущих значений
+        uint32_t frames = counters_.frames, lost = counters_.lost;
+        *this = telemetry();
+        frames_base_ = frames;
+        lost_base_ = lost;
+        counters_.frames = frames;
+        counters_.lost = lost;
+    }
+
+    const counters_t& counters() const { return counters_; }
+    const rtt_histogram_t& rtt() const { return rtt_; }
+    const rssi_histogram& rssi() const { return rssi_; }
+    int8_t last_rssi() const { return last_rssi_; }
+
+    size_t samples() const { return sample_count_; }
+    // i = 0 - самое старое из сохраненных
+    const sample_t& sample(size_t i) const { return samples_[(sample_next_ + SAMPLES - sample_count_ + i) % SAMPLES]; }
+
+    // Построчная выгрузка CSV: write_line(const char*) без перевода строки
+    template<typename WriteLine>
+    void write_csv(uint32_t now, WriteLine write_line) const
+    {
+        char line[96];
+        write_line("counters,uptime_ms,requests,replies,timeouts,unmatched,received,frames,lost,rssi_last");
+        snprintf(line, sizeof(line), "counters,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%d",
+                 ul(now), ul(counters_.requests), ul(counters_.replies), ul(counters_.timeouts), ul(counters_.unmatched),
+                 ul(counters_.received), ul(counters_.frames - frames_base_), ul(counters_.lost - lost_base_), last_rssi_);
+        write_line(line);
+
+        snprintf(line, sizeof(line), "rtt_summary,%lu,%lu,%lu,%lu,%lu",
+                 ul(rtt_.min()), ul(rtt_.percentile(50)), ul(rtt_.percentile(90)), ul(rtt_.percentile(99)), ul(rtt_.max()));
+        write_line("rtt_summary,min,p50,p90,p99,max");
+        write_line(line);
+
+        write_line("rtt_ms,lower,count");
+        for(size_t i = 0; i < rtt_histogram_t::BUCKETS; ++i) {
+            if(!rtt_.bucket(i)) continue;
+            snprintf(line, sizeof(line), "rtt_ms,%lu,%lu", ul(rtt_histogram_t::lower_bound(i)), ul(rtt_.bucket(i)));
+            write_line(line);
+        }
+        write_line("rssi_dbm,lower,count");
+        for(size_t i = 0; i < rssi_histogram::BUCKETS; ++i) {
+            if(!rssi_.bucket(i)) continue;
+            snprintf(line, sizeof(line), "rssi_dbm,%d,%lu", rssi_histogram::lower_bound(i), ul(rssi_.bucket(i)));
+            write_line(line);
+        }
+        static const char* const KINDS[] = {"reply", "timeout", "loss"};
+        write_line("sample,time_ms,kind,value,rssi");
+        for(size_t i = 0; i < sample_count_; ++i) {
+            const sample_t& s = sample(i);
+            snprintf(line, sizeof(line), "sample,%lu,%s,%u,%d", ul(s.time), KINDS[static_cast<uint8_t>(s.kind)], s.value, s.rssi);
+            write_line(line);
+        }
+    }
+
+    // Двоичный снимок little endian: "LT", версия, счетчики, корзины, кольцо. write(const uint8_t*, size_t) порциями
+    template<typename Write>
+    void write_binary(uint32_t now, Write write) const
+    {
+        uint8_t chunk[32];
+        size_t length = 0;
+        auto flush = [&]() { if(length) write(chunk, length); length = 0; };
+        auto put8 = [&](uint8_t v) { if(length == sizeof(chunk)) flush(); chunk[length++] = v; };
+        auto put16 = [&](uint16_t v) { put8(static_cast<uint8_t>(v)); put8(static_cast<uint8_t>(v >> 8)); };
+        auto put32 = [&](uint32_t v) { put16(static_cast<uint16_t>(v)); put16(static_cast<uint16_t>(v >> 16)); };
+
+        put8('L'); put8('T'); put8(BINARY_VERSION);
+        put8(static_cast<uint8_t>(rtt_histogram_t::BUCKETS));
+        put8(static_cast<uint8_t>(rssi_histogram::BUCKETS));
+        put8(static_cast<uint8_t>(sample_count_));
+        put32(now);
+        put32(counters_.requests); put32(counters_.replies); put32(counters_.timeouts); put32(counters_.unmatched);
+        put32(counters_.received); put32(counters_.frames - frames_base_); put32(counters_.lost - lost_base_);
+        for(size_t i = 0; i < rtt_histogram_t::BUCKETS; ++i) put32(rtt_.bucket(i));
+        for(size_t i = 0; i < rssi_histogram::BUCKETS; ++i) put32(rssi_.bucket(i));
+        for(size_t i = 0; i < sample_count_; ++i) {
+            const sample_t& s = sample(i);
+            put32(s.time); put16(s.value); put8(static_cast<uint8_t>(s.rssi)); put8(static_cast<uint8_t>(s.kind));
+        }
+        flush();
+    }
+
+    static constexpr size_t binary_size(size_t samples)
+    {
+        return 6 + 4 * 8 + 4 * (rtt_histogram_t::BUCKETS + rssi_histogram::BUCKETS) + 8 * samples;
+    }
+
+private:
+    struct pending_t {
+        uint32_t timestamp = 0;
+        bool     active = false;
+    };
+
+    static unsigned long ul(uint32_t value) { return static_cast<unsigned long>(value); }
+
+    void expire(pending_t& slot)
+    {
+        slot.active = false;
+        ++counters_.timeouts;
+        push_sample(slot.timestamp + REPLY_TIMEOUT, sample_kind_t::kTimeout, 0, last_rssi_);
+    }
+
+    void push_sample(uint32_t time, sample_kind_t kind, uint32_t value, int8_t rssi)
+    {
+        sample_t& s = samples_[sample_next_];
+        s.time = time;
+        s.value = static_cast<uint16_t>(value < UINT16_MAX ? value : UINT16_MAX);
+        s.rssi = rssi;
+        s.kind = kind;
+        sample_next_ = (sample_next_ + 1) % SAMPLES;
+        if(sample_count_ < SAMPLES) ++sample_count_;
+    }
+
+    counters_t      counters_;
+    rtt_histogram_t rtt_;
+    rssi_histogram  rssi_;
+    int8_t          last_rssi_ = RSSI_UNKNOWN;
+    uint32_t        frames_base_ = 0;     // итоги приемника на момент reset()
+    uint32_t        lost_base_ = 0;
+    pending_t       pending_[PENDING];
+    uint8_t         pending_next_ = 0;
+    sample_t        samples_[SAMPLES];
+    size_t          sample_next_ = 0;
+    size_t          sample_count_ = 0;
+};
+
+}// namespace link_telemetry
@@ -0,0 +1,65 @@
+#pragma once
+// Гистограмма фиксированного размера с логарифмическими корзинами: телеметрия канала, профилировщик loop()
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Гистограмма с двумя корзинами на октаву: 0, 1, 2, 3, 4, 6, 8, 12, 16, 24 ... относительная ошибка не больше 50%
+template<size_t Buckets>
+class log_histogram
+{
+public:
+    static constexpr size_t BUCKETS = Buckets;
+
+    static size_t bucket_of(uint32_t value)
+    {
+        if(value < 2) return value;
+        size_t exponent = 31 - static_cast<size_t>(__builtin_clz(value));
+        size_t index = 2 * exponent + ((value >> (exponent - 1)) & 1);
+        return index < Buckets ? index : Buckets - 1;
+    }
+
+    static uint32_t lower_bound(size_t index)
+    {
+        if(index < 2) return static_cast<uint32_t>(index);
+        size_t exponent = index / 2;
+        return static_cast<uint32_t>((2 | (index & 1)) << (exponent - 1));
+    }
+
+    void add(uint32_t value)
+    {
+        ++buckets_[bucket_of(value)];
+        if(count_ == 0 || value < min_) min_ = value;
+        if(value > max_) max_ = value;
+        sum_ += value;
+        ++count_;
+    }
+
+    // Оценка процентиля по нижней границе корзины, p от 0 до 100
+    uint32_t percentile(uint32_t p) const
+    {
+        if(count_ == 0) return 0;
+        uint32_t rank = static_cast<uint32_t>((static_cast<uint64_t>(count_) * p + 99) / 100);
+        uint32_t seen = 0;
+        for(size_t i = 0; i < Buckets; ++i) {
+            seen += buckets_[i];
+            if(seen >= rank && buckets_[i] > 0) return lower_bound(i) > min_ ? lower_bound(i) : min_;
+        }
+        return max_;
+    }
+
+    void reset() { *this = log_histogram(); }
+
+    uint32_t count() const { return count_; }
+    uint32_t bucket(size_t index) const { return buckets_[index]; }
+    uint32_t min() const { return min_; }
+    uint32_t max() const { return max_; }
+    uint32_t mean() const { return count_ ? static_cast<uint32_t>(sum_ / count_) : 0; }
+
+private:
+    uint32_t buckets_[Buckets] {};
+    uint32_t count_ = 0;
+    uint32_t min_ = 0;
+    uint32_t max_ = 0;
+    uint64_t sum_ = 0;
+};
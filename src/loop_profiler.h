@@ -0,0 +1,202 @@
+#pragma once
+// Профилировщик loop() по подсистемам
+// Именованные таймеры областей считают время по счетчику тактов процессора (ESP8266/ESP32), иначе по micros().
+// Для каждой области в статической памяти: количество, min, max, среднее и гистограмма в микросекундах.
+// Отдельно - самый длинный промежуток между выходом из loop() и следующим входом (WiFi, системные задачи).
+// Области сверх LOOP_PROFILER_SCOPES не теряются молча: их время копится в общей строке "(overflow)".
+// Выгрузка командой консоли /prof. При LOOP_PROFILER=0 макросы ничего не генерируют.
+//
+//   void loop() {
+//       PROFILE_LOOP();
+//       { PROFILE_SCOPE("morse"); morse->tick(); }
+//   }
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "Arduino.h"
+#include "log_histogram.h"
+
+#ifndef LOOP_PROFILER
+#define LOOP_PROFILER 1             // 0 - таймеры областей компилируются в пустоту
+#endif
+#ifndef LOOP_PROFILER_SCOPES
+#define LOOP_PROFILER_SCOPES 24     // максимальное количество именованных областей; main.cpp задает по числу задач
+#endif
+
+namespace loop_profiler {
+
+using histogram_t = log_histogram<36>;      // до ~200 мс с шагом полоктавы, дальше - в последней корзине
+
+// Часы профилировщика: такты процессора там, где есть счетчик, иначе микросекунды
+#if defined(ESP8266) || defined(ESP32)
+inline uint32_t ticks() { return ESP.getCycleCount(); }
+constexpr uint32_t TICKS_PER_US = F_CPU / 1000000;
+#else
+inline uint32_t ticks() { return static_cast<uint32_t>(micros()); }
+constexpr uint32_t TICKS_PER_US = 1;
+#endif
+inline uint32_t time_us() { return static_cast<uint32_t>(micros()); }
+
+struct scope_t {
+    const char* name = nullptr;
+    histogram_t us;                 // длительность области, мкс
+};
+
+// Clock - такты с частотой TicksPerUs в микросекунду, Micros - время для промежутков между loop()
+template<size_t N, uint32_t (*Clock)(), uint32_t TicksPerUs, uint32_t (*Micros)()>
+class profiler
+{
+public:
+    static constexpr int INVALID = -1;
+    static constexpr const char* OVERFLOW_NAME = "(overflow)";  // области, не поместившиеся в N
+
+    // Идентификатор области по имени: повторный вызов с тем же именем возвращает ту же область
+    int add(const char* name)
+    {
+        for(size_t i = 0; i < count_; ++i) {
+            if(scopes_[i].name == name || strcmp(scopes_[i].name, name) == 0) return static_cast<int>(i);
+        }
+        if(count_ >= N) {
+            ++dropped_;
+            return INVALID;
+        }
+        scopes_[count_].name = name;
+        return static_cast<int>(count_++);
+    }
+
+    static uint32_t now() { return Clock(); }
+
+    void record(int id, uint32_t start_ticks)
+    {
+        uint32_t elapsed = Clock() - start_ticks;
+        (id >= 0 ? scopes_[id].us : overflow_).add(TicksPerUs > 1 ? elapsed / TicksPerUs : elapsed);
+    }
+
+    // Вход в loop(): промежуток с прошлого выхода
+    void loop_enter()
+    {
+        uint32_t now = Micros();
+        if(loop_started_) {
+            uint32_t gap = now - loop_exit_;
+            gap_.add(gap);
+        }
+        loop_enter_ = now;
+    }
+
+    // Выход из loop(): длительность итерации
+    void loop_exit()
+    {
+        uint32_t now = Micros();
+        loop_.add(now - loop_enter_);
+        loop_exit_ = now;
+        loop_started_ = true;
+    }
+
+    void reset()
+    {
+        for(size_t i = 0; i < count_; ++i) scopes_[i].us.reset();
+        overflow_.reset();
+        loop_.reset();
+        gap_.reset();
+        loop_started_ = false;
+    }
+
+    size_t size() const { return count_; }
+    const scope_t& scope(size_t i) const { return scopes_[i]; }
+    const histogram_t& loop() const { return loop_; }
+    const histogram_t& gap() const { return gap_; }
+    const histogram_t& overflow() const { return overflow_; }
+    size_t dropped() const { return dropped_; }     // имен областей, не получивших своей строки
+
+    // Построчная выгрузка CSV: write_line(const char*) без перевода строки
+    template<typename WriteLine>
+    void write_csv(WriteLine write_line) const
+    {
+        char line[96];
+        write_line("scope,name,count,min_us,mean_us,p50_us,p99_us,max_us");
+        auto summary = [&](const char* name, const histogram_t& h) {
+            snprintf(line, sizeof(line), "scope,%s,%lu,%lu,%lu,%lu,%lu,%lu", name, ul(h.count()), ul(h.min()), ul(h.mean()),
+                     ul(h.percentile(50)), ul(h.percentile(99)), ul(h.max()));
+            write_line(line);
+        };
+        summary("loop", loop_);
+        summary("loop_gap", gap_);
+        for(size_t i = 0; i < count_; ++i) summary(scopes_[i].name, scopes_[i].us);
+        if(dropped_) summary(OVERFLOW_NAME, overflow_);
+
+        write_line("hist,name,lower_us,count");
+        auto buckets = [&](const char* name, const histogram_t& h) {
+            for(size_t b = 0; b < histogram_t::BUCKETS; ++b) {
+                if(!h.bucket(b)) continue;
+                snprintf(line, sizeof(line), "hist,%s,%lu,%lu", name, ul(histogram_t::lower_bound(b)), ul(h.bucket(b)));
+                write_line(line);
+            }
+        };
+        buckets("loop", loop_);
+        buckets("loop_gap", gap_);
+        for(size_t i = 0; i < count_; ++i) buckets(scopes_[i].name, scopes_[i].us);
+        if(dropped_) buckets(OVERFLOW_NAME, overflow_);
+    }
+
+private:
+    static unsigned long ul(uint32_t value) { return static_cast<unsigned long>(value); }
+
+    scope_t     scopes_[N];
+    size_t      count_ = 0;
+    size_t      dropped_ = 0;
+    histogram_t overflow_;      // все области сверх N вместе, мкс
+    histogram_t loop_;          // длительность итерации loop(), мкс
+    histogram_t gap_;           // промежуток между итерациями, мкс
+    uint32_t    loop_enter_ = 0;
+    uint32_t    loop_exit_ = 0;
+    bool        loop_started_ = false;
+};
+
+// Замер области до конца блока
+template<typename Profiler>
+class scoped_timer
+{
+public:
+    scoped_timer(Profiler& profiler, int id) : profiler_(profiler), id_(id), start_(Profiler::now()) {}
+    ~scoped_timer() { profiler_.record(id_, start_); }
+
+private:
+    Profiler& profiler_;
+    int       id_;
+    uint32_t  start_;
+};
+
+template<typename Profiler>
+class loop_timer
+{
+public:
+    explicit loop_timer(Profiler& profiler) : profiler_(profiler) { profiler_.loop_enter(); }
+    ~loop_timer() { profiler_.loop_exit(); }
+
+private:
+    Profiler& profiler_;
+};
+
+using profiler_t = profiler<LOOP_PROFILER_SCOPES, ticks, TICKS_PER_US, time_us>;
+
+#if LOOP_PROFILER
+inline profiler_t instance;
+#endif
+
+}// namespace loop_profiler
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if LOOP_PROFILER
+  // Идентификатор области ищется один раз, при первом проходе
+  #define PROFILE_SCOPE(name) \
+      static const int PROFILE_CONCAT(profile_id_, __LINE__) = loop_profiler::instance.add(name); \
+      loop_profiler::scoped_timer<loop_profiler::profiler_t> PROFILE_CONCAT(profile_scope_, __LINE__)(loop_profiler::instance, PROFILE_CONCAT(profile_id_, __LINE__))
+  #define PROFILE_LOOP() loop_profiler::loop_timer<loop_profiler::profiler_t> PROFILE_CONCAT(profile_loop_, __LINE__)(loop_profiler::instance)
+#else
+  #define PROFILE_SCOPE(name) do {} while(0)
+  #define PROFILE_LOOP() do {} while(0)
+#endif
@@ -9,14 +9,36 @@
 
 #include "etl/etl_led.h"
 etl::shared_ptr<etl::led> blinkLED = etl::make_shared<etl::led>(LED_MORSE, false, INVERSE_BUILTING_LED);
-etl::shared_ptr<etl::led> fadeLED;// = etl::make_shared<etl::led>(LED_FADE, false);
-
-#include "morse_espnow.h"
-morse_relay_mgr morse_relay(true); // Передатчик данных по ESPNOW
 
 #include "morse.h"
+#include "morse_timed.h"
+#ifndef MORSE_TIMED_OUTPUT
+#define MORSE_TIMED_OUTPUT 1    // 1 - фронты по аппаратному таймеру, 0 - MorseCode::tick() из loop()
+#endif
+#ifndef MORSE_STATIC
+#define MORSE_STATIC 0          // 1 - morse_code::static_morse: после запуска без кучи, tick() из loop() (для сравнения в долгих прогонах)
+#endif
+#ifndef MORSE_STATIC_ELEMENTS
+#define MORSE_STATIC_ELEMENTS 256   // элементов в сообщении static_morse: MORSE_MESSAGE_SIZE символов по 8
+#endif
 const uint32_t MORSE_DIT = 50;  // длительность единичного интервала (dit), для новичков 50-150 мс.
+#if MORSE_STATIC
+#include "morse_static.h"
+using morse_t = morse_code::static_morse<MORSE_STATIC_ELEMENTS>;
+etl::unique_ptr<morse_t> morse = etl::make_unique<morse_t>(*blinkLED, MORSE_DIT);
+#elif MORSE_TIMED_OUTPUT
+using morse_t = MorseTimedCode;
+etl::unique_ptr<morse_t> morse = etl::make_unique<morse_t>(blinkLED, MORSE_DIT, LED_MORSE, INVERSE_BUILTING_LED);
+#else
+using morse_t = MorseCode;
 etl::unique_ptr<MorseCode> morse = etl::make_unique<MorseCode>(blinkLED, MORSE_DIT); // светодиод и длительность единичного интервала (dit)
+#endif
+
+#include "morse_espnow.h"
+morse_relay_mgr morse_relay(IS_MORSE_SERVER); // Передатчик данных по ESPNOW
+#ifndef SYNC_BLINK
+#define SYNC_BLINK 0            // 1 - сервер и клиенты мигают blinkLED в момент из kBlink по часам сервера, 0 - не мигать
+#endif
 
 #ifdef MORSE_CLIENT
 etl::unique_ptr<MorseCode> morse_client;// = etl::make_unique<MorseCode>(&blinkLED, MORSE_DIT); 
@@ -24,17 +46,81 @@ etl::unique_ptr<MorseCode> morse_client;// = etl::make_unique<MorseCode>(&blinkL
 etl::unique_ptr<MorseCode> morse_server;// = etl::make_unique<MorseCode>(&blinkLED, MORSE_DIT); 
 #endif
 const uint32_t MORSE_INTERVAL = 5000;
-GTimer<millis> timer_Morse;               // создать миллисекундный таймер
+
+// Маяки: несколько выводов от одного многоканального передатчика, например -D MORSE_BEACON_PINS="{12,14}"
+#ifdef MORSE_BEACON_PINS
+#include "morse_multi.h"
+const uint8_t morse_beacon_pins[] = MORSE_BEACON_PINS;
+constexpr size_t MORSE_BEACONS = sizeof(morse_beacon_pins);
+etl::unique_ptr<morse_code::gpio_output> morse_beacon_output;      // pinMode() - в setup()
+etl::unique_ptr<morse_code::morse_transmitter<MORSE_BEACONS, morse_code::gpio_output>> morse_beacons;
+#endif
+
+// Профилировщик loop(): время задач по подсистемам, выгрузка командой /prof
+// Областей - по одной на задачу планировщика и еще столько же для областей внутри задач и самого loop()
+constexpr size_t SCHEDULER_TASKS = 14;
+#ifndef LOOP_PROFILER_SCOPES
+#define LOOP_PROFILER_SCOPES (2 * SCHEDULER_TASKS)
+#endif
+#include "loop_profiler.h"
+
+// Трассировка TRACE() в кольцо, выгрузка в Serial только когда loop() простаивает: /trace text|bin|off
+#include "trace_log.h"
+#ifndef TRACE_OUTPUT
+#define TRACE_OUTPUT kText      // kBinary - для trace_decode.py, kOff - только копить
+#endif
+trace_log::output_t trace_output = trace_log::output_t::TRACE_OUTPUT;
+
+// Планировщик задач loop() по ближайшему сроку
+#include "deadline_scheduler.h"
+deadline_scheduler<SCHEDULER_TASKS, millis> scheduler;
+int task_morse_id = -1;
+const uint32_t POLL_INTERVAL = 20;      // опрос принятых ESP-NOW сообщений и консоли, мс
+const uint32_t LOOP_IDLE_MAX = 100;     // максимальный сон loop() между задачами, мс
+
+// Журнал загрузки: критичные этапы в setup(), остальное - отложенными этапами задачи "boot", выгрузка /boot
+#include "boot_stages.h"
+#ifndef BOOT_DIAGNOSTICS
+#define BOOT_DIAGNOSTICS 1      // 1 - самотесты и проверка выводов фоном после загрузки, 0 - только командой /diag
+#endif
+uint32_t boot_micros() { return static_cast<uint32_t>(micros()); }
+boot_stages::sequence<20, boot_micros> boot;
+int task_boot_id = -1;
+struct {
+    bool promiscuous = false;
+    int  settings = -1;         // settings_store::source_t, -1 - LittleFS не смонтирован
+    bool web_assets = false;
+} boot_info;                    // результаты этапов для отчета
+void boot_diagnostics();
+
+// Свободная память, самый большой блок и фрагментация кучи: выборка раз в HEAP_SAMPLE_INTERVAL, выгрузка /heap
+#ifndef HEAP_STATS
+#define HEAP_STATS 1
+#endif
+#if HEAP_STATS
+#include "heap_stats.h"
+heap_stats::monitor<16> heap_monitor;
+const uint32_t HEAP_SAMPLE_INTERVAL = 60000;
+#endif
 
 // Запуск по интервалу
 GTimer<millis> timer_LED;
 uint32_t BLINK_INTERVAL = 2000;
 uint32_t BLINK_DURATION = 10;
 
+// Плавное включение и выключение светодиода LED_FADE, в выключенном положении пауза - проверить затемнение на мерцание
+#ifndef FADE_OUTPUT
+#define FADE_OUTPUT 0           // 1 - задача "fade" на ШИМ FADE_CHANNEL
+#endif
+#if defined(ESP8266) && FADE_OUTPUT && MORSE_TIMED_OUTPUT && !MORSE_STATIC
+#error "ESP8266: analogWrite() для FADE_OUTPUT и MorseTimedCode делят timer1 - задайте MORSE_TIMED_OUTPUT=0 или FADE_OUTPUT=0"
+#endif
+#include "led_fade.h"
 uint32_t FADE_INTERVAL = 3000;
 uint32_t FADE_PAUSE = 3000;
-bool fade_direction = true;
-etl::unique_ptr<GTimer<millis>> time_fade_pause;
+led_fade::fader<1, led_fade::pwm_write> fadeLED(led_fade::gamma_10bit);     // ШИМ 10 бит, гамма 2.2
+bool fade_manual = false;       // яркость задана из веб-интерфейса, цикл не крутится
+int task_fade_id = -1;
 
 /////////////////////////////////////////
 // etl - отладка функционала
@@ -43,69 +129,507 @@ etl::unique_ptr<GTimer<millis>> time_fade_pause;
 /////////////////////////////////////////
 #include "etl/etl_espwifi.h"
 
-void setup() {
-    Serial.begin(115200);
-    if(SERIAL_INIT_DELAY > 0) delay(SERIAL_INIT_DELAY);  // для ESP32 C3 supermini нуждо сделать задержку, чтобы выводилась отладочная информация
-    
-    if(blinkLED)
+// Веб-интерфейс из LittleFS (assets.bin: pio run -t uploadfs), станция подключается к WIFI_SSID
+#ifndef WEB_UI
+#define WEB_UI 0
+#endif
+#if WEB_UI
+#include "web_ui.h"
+#endif
+
+// Настройки из двоичного снимка config/settings.bin; settings.json разбирается, только когда изменился
+#ifndef SETTINGS_STORE
+#define SETTINGS_STORE WEB_UI
+#endif
+#if SETTINGS_STORE
+#include "settings_fs.h"
+settings_store::littlefs_storage settings_fs;
+settings_store::store<settings_store::littlefs_storage> settings(settings_fs);
+int task_settings_id = -1;
+#endif
+
+// Журнал сообщений на LittleFS: Морзе, отправленные и принятые по ESP-NOW, переживает перезагрузку (замеры дальности)
+#ifndef MESSAGE_JOURNAL
+#define MESSAGE_JOURNAL 0
+#endif
+#if MESSAGE_JOURNAL
+#include <LittleFS.h>
+#include "message_journal.h"
+message_journal::journal<fs::FS> journal(LittleFS);
+bool journal_ready = false;
+
+void journal_relay_log(void* context, bool received, const morse_message_t& msg, int8_t rssi)
+{
+    if(journal_ready) journal.append_message(received ? message_journal::kReceived : message_journal::kSent, msg, rssi, millis());
+}
+
+uint32_t task_journal(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("journal");
+    uint32_t next = journal.tick(now);
+    return next < LOOP_IDLE_MAX ? next : LOOP_IDLE_MAX;      // новые записи появляются из других задач
+}
+#endif
+
+// Текст ушел в очередь азбуки Морзе
+void journal_morse(const char* text, size_t length)
+{
+#if MESSAGE_JOURNAL
+    if(journal_ready) journal.append_text(text, length, millis());
+#endif
+}
+
+// Команды консоли начинаются с '/':
+//   /stats      - телеметрия канала в CSV
+//   /stats bin  - то же двоичным снимком (link_telemetry::telemetry::write_binary)
+//   /reset      - сбросить телеметрию перед новым замером
+//   /prof       - профиль loop() по подсистемам в CSV, /prof reset - сбросить
+//   /boot       - журнал загрузки в CSV
+//   /diag       - запустить самотесты и проверку выводов
+//   /log        - последние 20 записей журнала сообщений в CSV
+//   /sync       - смещение и уход часов относительно сервера
+//   /heap       - свободная память и фрагментация кучи в CSV
+//   /trace      - счетчики трассировки, /trace text|bin|off - вид выгрузки
+void serial_console_command(const char* line, size_t length)
+{
+    auto is = [&](const char* command) { return length == strlen(command) && strncmp(line, command, length) == 0; };
+    if(is("/stats")) {
+      morse_relay.telemetry().write_csv(millis(), [](const char* text) { Serial.println(text); });
+    #if ESPNOW_RELIABLE
+      const auto& r = morse_relay.reliable().stats();
+      char text[128];
+      snprintf(text, sizeof(text), "reliable,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu", static_cast<unsigned long>(r.sent),
+               static_cast<unsigned long>(r.retransmits), static_cast<unsigned long>(r.fast_retransmits), static_cast<unsigned long>(r.given_up),
+               static_cast<unsigned long>(r.window_full), static_cast<unsigned long>(r.delivered), static_cast<unsigned long>(r.duplicates),
+               static_cast<unsigned long>(r.skipped), static_cast<unsigned long>(r.resyncs), static_cast<unsigned long>(r.evicted),
+               static_cast<unsigned long>(morse_relay.reliable().rto()));
+      Serial.println("reliable,sent,retransmits,fast_retransmits,given_up,window_full,delivered,duplicates,skipped,resyncs,evicted,rto_ms");
+      Serial.println(text);
+    #endif
+    }
+    else if(is("/stats bin")) {
+      morse_relay.telemetry().write_binary(millis(), [](const uint8_t* data, size_t size) { Serial.write(data, size); });
+    }
+    else if(is("/reset")) {
+      morse_relay.reset_telemetry();
+      Serial.println("telemetry: reset");
+    }
+#if LOOP_PROFILER
+    else if(is("/prof")) {
+      loop_profiler::instance.write_csv([](const char* text) { Serial.println(text); });
+    }
+    else if(is("/prof reset")) {
+      loop_profiler::instance.reset();
+      Serial.println("profiler: reset");
+    }
+#endif
+    else if(is("/sync")) {
+      const auto& sync = morse_relay.sync();
+      char text[96];
+      snprintf(text, sizeof(text), "sync,%u,%ld,%.1f,%lu", unsigned(sync.samples()), static_cast<long>(sync.offset(millis())),
+               sync.drift() * 1e6f, static_cast<unsigned long>(sync.error_bound()));
+      Serial.println("sync,samples,offset_ms,drift_ppm,error_ms");
+      Serial.println(text);
+    }
+    else if(is("/boot")) {
+      boot.write_csv([](const char* text) { Serial.println(text); });
+    }
+    else if(is("/diag")) {
+      boot_diagnostics();
+      scheduler.wake(task_boot_id);
+    }
+#if TRACE_LOG
+    else if(is("/trace")) {
+      auto t = trace_log::instance.stats();
+      char text[96];
+      snprintf(text, sizeof(text), "trace,%lu,%lu,%lu,%lu,%u", static_cast<unsigned long>(t.logged), static_cast<unsigned long>(t.dropped),
+               static_cast<unsigned long>(t.drained), static_cast<unsigned long>(t.max_depth), unsigned(trace_output));
+      Serial.println("trace,logged,dropped,drained,max_depth,output");
+      Serial.println(text);
+    }
+    else if(is("/trace text")) trace_output = trace_log::output_t::kText;
+    else if(is("/trace bin"))  trace_output = trace_log::output_t::kBinary;
+    else if(is("/trace off"))  trace_output = trace_log::output_t::kOff;
+#endif
+#if HEAP_STATS
+    else if(is("/heap")) {
+      heap_monitor.sample(millis());
+      heap_monitor.write_csv([](const char* text) { Serial.println(text); });
+    }
+#endif
+#if MESSAGE_JOURNAL
+    else if(is("/log")) {
+      Serial.println(message_journal::CSV_HEADER);
+      journal.tail(20, [](const message_journal::record_t& r) {
+        char text[96];
+        message_journal::format_csv(r, text, sizeof(text));
+        Serial.println(text);
+      });
+    }
+#endif
+    else {
+      Serial.println("команды: /stats, /stats bin, /reset, /prof, /prof reset, /sync, /heap, /trace, /boot, /diag, /log");
+    }
+}
+
+// Консоль: строка из Serial ставится в очередь на передачу азбукой Морзе, строка с '/' - команда
+void serial_console_tick()
+{
+    static char line[MORSE_MESSAGE_SIZE];
+    static size_t length = 0;
+    while(Serial.available() > 0)
+    {
+      char ch = static_cast<char>(Serial.read());
+      if(ch == '\r' || ch == '\n')
+      {
+        if(length > 0 && line[0] == '/') serial_console_command(line, length);
+        else if(length > 0 && morse) {
+          if(morse->enqueue(line, length)) journal_morse(line, length);
+          else Serial.println("morse: очередь переполнена");
+        }
+        length = 0;
+      }
+      else if(length < sizeof(line))
+      {
+        line[length++] = ch;
+      }
+    }
+}
+
+/////////////////////////////////////////
+// Задачи планировщика: выполняют работу и возвращают время до следующего запуска, мс
+
+template<typename Morse>
+uint32_t task_morse(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("morse");
+    auto code = static_cast<Morse*>(context);
+    code->tick();
+    return code->time_to_next(millis());
+}
+
+// В очередь передатчика добавили сообщение - разбудить его, если он простаивает
+void wake_morse()
+{
+    if(morse && morse->time_to_next(millis()) == 0) scheduler.wake(task_morse_id);
+}
+
+uint32_t task_morse_message(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("morse_message");
+    static bool first = true;
+    if(first) boot.mark("first_beacon");
+    first = false;
+    // Текст в стеке: String(now) на каждое сообщение дробит кучу за дни работы
+    char text[12];
+    size_t length = static_cast<size_t>(snprintf(text, sizeof(text), "%lu", static_cast<unsigned long>(now)));
+    morse->enqueue(text, length);
+    journal_morse(text, length);
+    wake_morse();
+    if(IS_MORSE_CLIENT) morse_relay.send_count(now);   // сервер ответит командой мигать
+    // пауза между сообщениями отсчитывается от конца передачи
+    return MORSE_INTERVAL + morse->get_duration(text, length);
+}
+
+#if HEAP_STATS
+uint32_t task_heap(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("heap");
+    heap_monitor.sample(now);
+    return HEAP_SAMPLE_INTERVAL;
+}
+#endif
+
+uint32_t task_blink(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("blink");
+    if(blinkLED) blinkLED->tick(); // если не используется morse нужно вызывать тут для обновления внутреннего таймера
+    return POLL_INTERVAL;
+}
+
+#ifdef MORSE_BEACON_PINS
+uint32_t task_beacons(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("beacons");
+    return morse_beacons->tick(now);
+}
+#endif
+
+#if FADE_OUTPUT
+// Цикл: плавно включить, плавно выключить, пауза FADE_PAUSE в выключенном положении
+uint32_t task_fade(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("fade");
+    if(fade_manual) {
+      fadeLED.tick(now);
+      return fadeLED.time_to_next(now);
+    }
+    if(!fadeLED.is_active(0)) {
+      fadeLED.fade_to(0, led_fade::MAX_LEVEL, FADE_INTERVAL, led_fade::easing_t::kSmoothstep, now);
+    }
+    else if(fadeLED.tick(now)) {
+      if(fadeLED.level(0) == 0) return FADE_PAUSE;  // На новом цикле делаем паузу в выключенном состоянии, чтобы посмотреть, не мигает ли лента
+      fadeLED.fade_to(0, 0, FADE_INTERVAL, led_fade::easing_t::kSmoothstep, now);
+    }
+    return fadeLED.time_to_next(now);
+}
+#endif
+
+uint32_t task_relay(void* context, uint32_t now)
+{
     {
-      blinkLED->off();
-      blinkLED->blink(BLINK_DURATION);
-      timer_LED.start(BLINK_INTERVAL, GTMode::Timeout);   // настроить интервал
-    }
-  
-    // morse.debug_trace("123");
-    // morse.debug_trace("123 123");
-    // morse.debug_trace("123.123,098");
-    // morse.debug_trace("pirat123.123 dde");
-   if(morse)
-     timer_Morse.start(MORSE_INTERVAL, GTMode::Timeout);
+      PROFILE_SCOPE("espnow");
+      morse_relay.tick();
+    }
+    {
+      PROFILE_SCOPE("console");
+      serial_console_tick();
+    }
+    wake_morse();
+    uint32_t next = morse_relay.batch_tx().time_to_flush(millis());
+    uint32_t blink = morse_relay.time_to_next(millis());      // запланированное моргание - точно в срок
+    if(blink < next) next = blink;
+    return next < POLL_INTERVAL ? next : POLL_INTERVAL;
+}
+
+#if SETTINGS_STORE
+uint32_t task_settings(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("settings");
+    return settings.tick(now);
+}
+#endif
+
+#if WEB_UI
+// Команда света из веб-интерфейса: ползунок 0..255 плавно за 150 мс, без ШИМ только хранится в статусе
+void web_apply_command(const web_status::command_t& command)
+{
+  #if FADE_OUTPUT
+    fade_manual = true;
+    uint16_t level = web_ui::status.light ? web_ui::status.brightness * (led_fade::MAX_LEVEL / 255) : 0;
+    fadeLED.fade_to(0, level, 150, led_fade::easing_t::kOutQuad, millis());
+    if(task_fade_id >= 0) scheduler.wake(task_fade_id);
+  #endif
+  #if SETTINGS_STORE
+    // Яркость запоминается: движение ползунка - одна запись снимка через write_delay_ms
+    if(command.fields & web_status::kBrightness) {
+      settings.edit(millis()).default_brightness = command.brightness;
+      scheduler.wake(task_settings_id, settings.time_to_next(millis()));
+    }
+  #endif
+}
+
+uint32_t task_web(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("web");
+    uint32_t next = web_ui::tick(now);
+    return next < POLL_INTERVAL ? next : POLL_INTERVAL;   // handleClient() опрашивается не реже POLL_INTERVAL
+}
+#endif
 
+// Отложенный этап: отчет о загрузке, когда USB CDC уже успел подключиться (SERIAL_INIT_DELAY)
+uint32_t boot_report(uint32_t now)
+{
+    if(now < static_cast<uint32_t>(SERIAL_INIT_DELAY)) return SERIAL_INIT_DELAY - now;
     Serial.println("start...");
+    Serial.println("-----------WIFI----------");
+    Serial.print("MAC : ");  Serial.println(etl::espnow::board::get_mac_address());
+    Serial.print("RSSI: ");  Serial.println(boot_info.promiscuous ? "promiscuous" : "нет");
+  #if SETTINGS_STORE
+    static const char* settings_sources[] = {"defaults", "settings.bin", "settings.json"};
+    Serial.print("CONF: ");  Serial.print(boot_info.settings < 0 ? "нет LittleFS" : settings_sources[boot_info.settings]);
+    Serial.print(", ");      Serial.println(settings.get().device_name);
+  #endif
+  #if WEB_UI
+    Serial.print("WEB : ");  Serial.println(boot_info.web_assets ? "assets.bin" : "нет assets.bin");
+  #endif
+    Serial.println("-------------------------");
+    boot.write_csv([](const char* text) { Serial.println(text); });
+    return boot_stages::DONE;
+}
 
+uint32_t boot_selftest(uint32_t now)
+{
     /////////////////////////////////////////
     // etl - отладка функционала
     //etl::settings::set_trace_mode(etl::settings::trace_mode_t::VERBOSE);
     etl::unittest::test_all(Serial);
     /////////////////////////////////////////
+    return boot_stages::DONE;
+}
 
-    Serial.println("-----------WIFI----------");
-  //  Serial.print("SSID: ");  Serial.println(WIFI_SSID);
-  //  Serial.print("PASS: ");  Serial.println(WIFI_PASS);
-  //  Serial.print("MODE: ");  Serial.println(MORSE_MODE);
-    Serial.print("MAC : ");  Serial.println(etl::espnow::board::get_mac_address());
-    Serial.println("-------------------------");
+#ifdef BOARD_ESP32_WROOM_32U
+// Выводы работающих выходов и приема консоли: проверка идет после загрузки и не должна их перехватывать
+bool pin_in_use(int pin)
+{
+    if(pin == LED_MORSE || pin == RX) return true;
+  #if FADE_OUTPUT
+    if(pin == LED_FADE) return true;
+  #endif
+  #ifdef MORSE_BEACON_PINS
+    for(uint8_t beacon : morse_beacon_pins) if(pin == beacon) return true;
+  #endif
+    return false;
+}
 
-    // Отладка работы с файловой системой
-    // etl::little_fs::show_partition_info();
-    
-    if(fadeLED) {
-      Serial.println("fade started...");
-      fadeLED->init_pwm(FADE_CHANNEL, 30000, 10); // Чтобы не было слышно пищания на низкой частоте - сделать 30КГц и максимально возможное разрешение 10 бит для плавности
-      if(fade_direction) fadeLED->fade_in(FADE_INTERVAL); else fadeLED->fade_out(FADE_INTERVAL);
+// Проверка выводов: по секунде на OUTPUT, HIGH и LOW каждого свободного вывода, шагами задачи вместо delay()
+uint32_t boot_pin_sweep(uint32_t now)
+{
+    static const int pins[] = {2,3,4, 13, 14,15,16,17,18,19,20,21,22,23,25,26,27,32,33};
+    static size_t index = 0;
+    static uint8_t phase = 0;
+    if(index >= sizeof(pins) / sizeof(pins[0])) {
+      index = 0;
+      return boot_stages::DONE;
+    }
+    int pin = pins[index];
+    if(phase == 0 && pin_in_use(pin)) {
+      Serial.print("Test Led pin:"); Serial.print(pin); Serial.println(" in use, skipped");
+      ++index;
+      return 0;
     }
+    switch(phase++) {
+      case 0:
+        Serial.print("Test Led pin:"); Serial.print(pin);
+        Serial.print(" set OUTPUT mode... ");
+        break;
+      case 1:
+        pinMode(pin, OUTPUT); // Инициализация пина как выход
+        Serial.print(" set HIGH... ");
+        digitalWrite(pin, HIGH);
+        break;
+      case 2:
+        Serial.print(" set LOW... ");
+        digitalWrite(pin, LOW);
+        break;
+      default:
+        Serial.println(" OK");
+        phase = 0;
+        ++index;
+        return 0;
+    }
+    return 1000;
+}
+#endif//BOARD_ESP32_WROOM_32U
 
-    // Проверка встроенного светодиода
+// Самотесты etl и проверка выводов: фоном после загрузки (BOOT_DIAGNOSTICS=1) или командой /diag
+void boot_diagnostics()
+{
+    boot.defer("selftest", boot_selftest);
   #ifdef BOARD_ESP32_WROOM_32U
-    int pin_output_esp32wroom32u[] = {2,3,4, 13, 14,15,16,17,18,19,20,21,22,23,25,26,27,32,33};
-    etl::array pins = pin_output_esp32wroom32u;
-    for(auto pin : pins)
-    {
-      Serial.print("Test Led pin:"); Serial.print(pin);
-      Serial.print(" set OUTPUT mode... ");
-      delay(1000);
-      pinMode(pin, OUTPUT); // Инициализация пина как выход
-      Serial.print(" set HIGH... ");
-      digitalWrite(pin, HIGH);
-      delay(1000);
-      Serial.print(" set LOW... ");
-      digitalWrite(pin, LOW);
-      delay(1000);
-      Serial.println(" OK");
-    }
+    boot.defer("pin_sweep", boot_pin_sweep);
+  #endif
+}
 
-    blinkLED.reset(); // Пока не работает, нужно разбираться
-  #endif//BOARD_ESP32_WROOM_32U
+uint32_t task_boot(void* context, uint32_t now)
+{
+    PROFILE_SCOPE("boot");
+    return boot.tick(now);
+}
+
+void setup() {
+    // Критичные этапы - до первого маяка; печать и диагностика - отложенными этапами задачи "boot"
+    boot.run("serial", [] { Serial.begin(115200); });
+    boot.run("led", [] {
+      if(blinkLED)
+      {
+        blinkLED->off();
+        blinkLED->blink(BLINK_DURATION);
+        timer_LED.start(BLINK_INTERVAL, GTMode::Timeout);   // настроить интервал
+      }
+    });
+    boot.run("morse", [] {
+      if(morse)
+      {
+        morse->queue().set_policy(morse_code::overflow_t::kDropOldest); // при переполнении передаем самые свежие сообщения
+      #if MORSE_TIMED_OUTPUT && !MORSE_STATIC
+        morse->begin();         // таймер - здесь, а не в конструкторе глобального объекта
+      #endif
+        morse_relay.set_morse(morse.get());
+      }
+    #if SYNC_BLINK
+      if(blinkLED) morse_relay.set_led(blinkLED);     // менеджер сам гасит светодиод после BLINK_DURATION
+    #endif
+      morse_relay.set_transport(espnow_send_all, nullptr);
+    });
+    boot.run("espnow", [] { boot_info.promiscuous = espnow_rssi::begin(); });
+  #ifdef MORSE_BEACON_PINS
+    boot.run("beacons", [] {
+      // Канал i передает свой номер, скорость у каналов немного разная, повтор через MORSE_INTERVAL
+      morse_beacon_output = etl::make_unique<morse_code::gpio_output>(morse_beacon_pins, MORSE_BEACONS);
+      morse_beacons = etl::make_unique<morse_code::morse_transmitter<MORSE_BEACONS, morse_code::gpio_output>>(*morse_beacon_output);
+      for(size_t i = 0; i < MORSE_BEACONS; ++i) {
+        morse_beacons->send(i, String(i + 1).c_str(), MORSE_DIT + 10 * i, millis(), MORSE_INTERVAL);
+      }
+    });
+  #endif
+  #if SETTINGS_STORE
+    boot.run("settings", [] {
+      boot_info.settings = LittleFS.begin() ? static_cast<int>(settings.load(millis())) : -1;
+    });
+  #endif
+  #if MESSAGE_JOURNAL
+    boot.run("journal", [] {
+      journal_ready = LittleFS.begin() && journal.begin();
+      morse_relay.set_log(journal_relay_log, nullptr);
+    });
+  #endif
+  #if WEB_UI
+    boot.run("web", [] {
+    #if SETTINGS_STORE
+      web_ui::status.brightness = settings.get().default_brightness;
+    #endif
+      boot_info.web_assets = web_ui::begin(web_apply_command);
+    });
+  #endif
+  #if FADE_OUTPUT
+    boot.run("fade", [] {
+      // Чтобы не было слышно пищания на низкой частоте - сделать 30КГц и максимально возможное разрешение 10 бит для плавности
+      if(led_fade::pwm_attach(FADE_CHANNEL, LED_FADE, 30000, led_fade::gamma_10bit.bits)) {
+        task_fade_id = scheduler.add("fade", task_fade, nullptr);
+      }
+    });
+  #endif
+
+    // Задачи loop(): первое сообщение Морзе сразу, дальше через MORSE_INTERVAL
+    boot.run("tasks", [] {
+      if(morse) {
+        task_morse_id = scheduler.add("morse", task_morse<morse_t>, morse.get());
+        scheduler.add("morse_message", task_morse_message, nullptr);
+      }
+      else {
+        scheduler.add("blink", task_blink, nullptr);
+      }
+      scheduler.add("relay", task_relay, nullptr);
+    #if HEAP_STATS
+      scheduler.add("heap", task_heap, nullptr);
+    #endif
+    #if SETTINGS_STORE
+      task_settings_id = scheduler.add("settings", task_settings, nullptr);   // после загрузки из JSON сразу пишет снимок
+    #endif
+    #if WEB_UI
+      scheduler.add("web", task_web, nullptr);
+    #endif
+    #if MESSAGE_JOURNAL
+      if(journal_ready) scheduler.add("journal", task_journal, nullptr);
+    #endif
+    #ifdef MORSE_BEACON_PINS
+      scheduler.add("beacons", task_beacons, nullptr);
+    #endif
+    #ifdef MORSE_CLIENT
+      if(morse_client) scheduler.add("morse_client", task_morse<MorseCode>, morse_client.get());
+    #elif MORSE_SERVER
+      if(morse_server) scheduler.add("morse_server", task_morse<MorseCode>, morse_server.get());
+    #endif
+    });
+
+    boot.defer("report", boot_report);
+  #if BOOT_DIAGNOSTICS
+    boot_diagnostics();
+  #endif
+    task_boot_id = scheduler.add("boot", task_boot, nullptr);
+    boot.mark("ready");
+    TRACE(kBootReady, micros(), scheduler.size());
 }
 
 void loop() 
@@ -124,52 +648,19 @@ void loop()
     // }
 
     ///////////////////////////////////////////////////
-    // Проверка моргания светодиодом по таймеру
-    if(morse) {
-      morse->tick();
-      if (timer_Morse.tick()) 
+    // Выполняются только задачи с наступившим сроком: передатчик Морзе, сообщения по таймеру, ESP-NOW и консоль.
+    // До следующего срока loop() спит: delay() на ESP8266 отдает время WiFi и разрешает modem sleep,
+    // на ESP32 - задаче idle, которая при включенном power management уходит в light sleep
+    PROFILE_LOOP();
+    uint32_t idle = scheduler.dispatch();
+    if(idle > 0) {
+    #if TRACE_LOG
       {
-          // String text = "ntcn 123.123,098";
-          String text = String(millis());
-          uint32_t transmittion_duration_ms = morse->send(text);
-          timer_Morse.start(MORSE_INTERVAL + transmittion_duration_ms, GTMode::Timeout);
+        PROFILE_SCOPE("trace");
+        trace_log::instance.drain(Serial, trace_output);  // только то, что влезает в буфер UART без ожидания
       }
+    #endif
+      PROFILE_SCOPE("idle");
+      delay(idle < LOOP_IDLE_MAX ? idle : LOOP_IDLE_MAX);
     }
-    else {
-      blinkLED->tick(); // если не используется morse нужно вызывать тут для обновления внутреннего таймера
-    }
-
-    // плавное включение и выключение LED, в выключенном положении пауза, чтобы оценить правильность затемнения без мерцания
-    // if(time_fade_pause && time_fade_pause->tick())
-    // {
-    //   // start new cycle
-    //   time_fade_pause.reset();
-    //   fade_direction = true;
-    //   if(fadeLED) fadeLED->fade_in(FADE_INTERVAL); 
-    // }
-    // else
-    // {
-    //   if(fadeLED && fadeLED->tick()) // 
-    //   {
-    //     fade_direction = !fade_direction;
-    //     if(fade_direction)
-    //     {
-    //       // На новом цикле делаем паузу в выключенном состоянии, чтобы посмотреть, не мигает ли лента
-    //       time_fade_pause = etl::make_unique<GTimer<millis>>(FADE_PAUSE, true, GTMode::Interval);
-    //     }
-    //     else
-    //     {
-    //   //  Serial.printf("main: fade %s\n", fade_direction ? "in" : "out");
-    //       fadeLED->fade_out(FADE_INTERVAL);
-    //     }
-    //   }
-    // }
-
-    ///////////////////////////////////////////////////
-    // Проверка коммуникации esp-now
-#ifdef MORSE_CLIENT
-    if(morse_client) morse_client->tick();
-#elif MORSE_SERVER
-    if(morse_server) morse_server->tick();
-#endif
 }
\ No newline at end of file
@@ -0,0 +1,353 @@
+#pragma once
+// Журнал сообщений на LittleFS: каждое переданное азбукой Морзе и каждое отправленное/принятое по ESP-NOW
+// сообщение - запись фиксированного размера 32 байта с порядковым номером seq.
+// Записи копятся в RAM-буфере страницы LittleFS (256 байт = 8 записей) и уходят на флеш целой страницей,
+// а если страница не набралась за flush_ms - тем, что есть (буфер при этом остается выровненным по странице
+// файла, следующая запись дописывает ту же страницу). Файлы-сегменты /journal0.bin.. идут по кругу:
+// заполненный сегмент закрывается, самый старый стирается и пишется заново.
+// Индекс - первый seq и количество записей каждого сегмента в RAM (восстанавливается в begin() чтением
+// первой записи каждого сегмента): запись по seq читается одним seek, хвост журнала - без просмотра всего файла.
+//
+// Fs - LittleFS или замена (test/shim/dir_fs.h): open(path, "r"/"w"/"a"), exists(path); File - write, read,
+// seek, size, flush, close.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+#include "crc32.h"
+
+// Размеры под самый маленький раздел spiffs в littlefs/*.csv (ESP32-C3, 0x50000 = 320 КБ):
+// 4 x 32 КБ = 128 КБ журнала, остальное - assets.bin и настройки. Для больших разделов - флагами сборки
+#ifndef JOURNAL_SEGMENTS
+#define JOURNAL_SEGMENTS        4
+#endif
+#ifndef JOURNAL_SEGMENT_SIZE
+#define JOURNAL_SEGMENT_SIZE    (32 * 1024)     // кратно странице
+#endif
+#ifndef JOURNAL_PAGE_SIZE
+#define JOURNAL_PAGE_SIZE       256             // CONFIG_LITTLEFS_PAGE_SIZE
+#endif
+
+namespace message_journal {
+
+enum kind_t : uint8_t { kMorse = 1, kSent, kReceived };
+
+constexpr size_t RECORD_SIZE = 32;
+constexpr size_t TEXT_SIZE   = 10;
+constexpr size_t RECORDS_PER_PAGE    = JOURNAL_PAGE_SIZE / RECORD_SIZE;
+constexpr uint32_t RECORDS_PER_SEGMENT = JOURNAL_SEGMENT_SIZE / RECORD_SIZE;
+static_assert(JOURNAL_PAGE_SIZE % RECORD_SIZE == 0 && JOURNAL_SEGMENT_SIZE % JOURNAL_PAGE_SIZE == 0, "journal sizes");
+static_assert(JOURNAL_SEGMENTS >= 2 && JOURNAL_SEGMENTS <= 10, "journal segments: /journal0.bin../journal9.bin");
+
+struct record_t {
+    uint32_t seq       = 0;
+    uint32_t time      = 0;         // millis() записи
+    uint8_t  kind      = 0;         // kind_t
+    uint8_t  type      = 0;         // morse_message_t::type_t
+    int8_t   rssi      = 0;         // принятые, link_telemetry::RSSI_UNKNOWN - нет
+    uint8_t  length    = 0;         // символов в text (kMorse), текст длиннее TEXT_SIZE обрезается
+    uint32_t timestamp = 0;         // morse_message_t
+    uint32_t value     = 0;
+    char     text[TEXT_SIZE] = {};
+};
+
+// Запись на флеше: поля little-endian, в конце 16 бит CRC32 от первых 30 байт
+inline void encode(const record_t& r, uint8_t* out)
+{
+    auto put32 = [](uint8_t* p, uint32_t v) { for(int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i)); };
+    put32(out, r.seq);
+    put32(out + 4, r.time);
+    out[8]  = r.kind;
+    out[9]  = r.type;
+    out[10] = static_cast<uint8_t>(r.rssi);
+    out[11] = r.length;
+    put32(out + 12, r.timestamp);
+    put32(out + 16, r.value);
+    memcpy(out + 20, r.text, TEXT_SIZE);
+    uint32_t crc = checksum::crc32(out, RECORD_SIZE - 2);
+    out[30] = static_cast<uint8_t>(crc);
+    out[31] = static_cast<uint8_t>(crc >> 8);
+}
+
+// return: false - запись повреждена (оборванная запись при отключении питания)
+inline bool decode(const uint8_t* in, record_t& r)
+{
+    uint32_t crc = checksum::crc32(in, RECORD_SIZE - 2);
+    if(in[30] != static_cast<uint8_t>(crc) || in[31] != static_cast<uint8_t>(crc >> 8)) return false;
+    auto get32 = [](const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); };
+    r.seq       = get32(in);
+    r.time      = get32(in + 4);
+    r.kind      = in[8];
+    r.type      = in[9];
+    r.rssi      = static_cast<int8_t>(in[10]);
+    r.length    = in[11] < TEXT_SIZE ? in[11] : TEXT_SIZE;
+    r.timestamp = get32(in + 12);
+    r.value     = get32(in + 16);
+    memcpy(r.text, in + 20, TEXT_SIZE);
+    return true;
+}
+
+// Строка CSV записи: log,seq,time,kind,type,rssi,timestamp,value,text
+constexpr const char* CSV_HEADER = "log,seq,time,kind,type,rssi,timestamp,value,text";
+inline int format_csv(const record_t& r, char* out, size_t size)
+{
+    static const char* kinds[] = {"?", "morse", "sent", "received"};
+    return snprintf(out, size, "log,%lu,%lu,%s,%u,%d,%lu,%lu,%.*s", static_cast<unsigned long>(r.seq),
+                    static_cast<unsigned long>(r.time), kinds[r.kind <= kReceived ? r.kind : 0], unsigned(r.type), int(r.rssi),
+                    static_cast<unsigned long>(r.timestamp), static_cast<unsigned long>(r.value), int(r.length), r.text);
+}
+
+template<typename Fs>
+class journal
+{
+public:
+    using file_t = decltype(std::declval<Fs&>().open("", ""));
+    static constexpr uint32_t NEVER = UINT32_MAX;
+
+    explicit journal(Fs& fs, uint32_t flush_ms = 2000) : fs_(fs), flush_ms_(flush_ms) {}
+
+    // Восстановить индекс по сегментам и открыть текущий на дозапись. return: false - файл не открылся
+    bool begin()
+    {
+        int newest = -1;
+        bool torn = false;
+        for(size_t k = 0; k < JOURNAL_SEGMENTS; ++k) {
+            segments_[k] = segment_t();
+            char name[24];
+            path(k, name);
+            if(!fs_.exists(name)) continue;
+            file_t file = fs_.open(name, "r");
+            if(!file) continue;
+            size_t size = file.size();
+            uint8_t raw[RECORD_SIZE];
+            record_t first;
+            if(size < RECORD_SIZE || file.read(raw, RECORD_SIZE) != RECORD_SIZE || !decode(raw, first)) continue;
+            segments_[k].first_seq = first.seq;
+            segments_[k].records = static_cast<uint32_t>(size / RECORD_SIZE);
+            if(newest < 0 || static_cast<int32_t>(first.seq - segments_[newest].first_seq) > 0) {
+                newest = static_cast<int>(k);
+                torn = size % RECORD_SIZE != 0;
+            }
+        }
+        if(newest < 0) {
+            next_seq_ = 0;
+            return open_segment(0, 0);
+        }
+        const segment_t& last = segments_[newest];
+        next_seq_ = last.first_seq + last.records;
+        persisted_ = next_seq_;
+        // Оборванная запись в конце - дописывать после нее нельзя, начинается следующий сегмент
+        if(torn || last.records >= RECORDS_PER_SEGMENT) return open_segment((newest + 1) % JOURNAL_SEGMENTS, next_seq_);
+        current_ = static_cast<size_t>(newest);
+        char name[24];
+        path(current_, name);
+        file_ = fs_.open(name, "a");
+        buffered_ = flushed_ = last.records % RECORDS_PER_PAGE;
+        return static_cast<bool>(file_);
+    }
+
+    // Добавить запись, seq назначается здесь. Полная страница сразу уходит на флеш.
+    // return: seq, NEVER - флеш не принимает запись и буфер полон
+    uint32_t append(record_t record, uint32_t now)
+    {
+        if(buffered_ == RECORDS_PER_PAGE && !flush()) {     // прошлая запись страницы не удалась, места нет
+            ++dropped_;
+            return NEVER;
+        }
+        record.seq = next_seq_++;
+        record.time = now;
+        if(buffered_ == flushed_) buffered_since_ = now;
+        encode(record, page_ + buffered_ * RECORD_SIZE);
+        ++buffered_;
+        ++appended_;
+        if(buffered_ == RECORDS_PER_PAGE) flush();
+        return record.seq;
+    }
+
+    uint32_t append_text(const char* text, size_t length, uint32_t now)
+    {
+        record_t r;
+        r.kind = kMorse;
+        r.length = static_cast<uint8_t>(length < TEXT_SIZE ? length : TEXT_SIZE);
+        memcpy(r.text, text, r.length);
+        r.value = static_cast<uint32_t>(length);
+        return append(r, now);
+    }
+
+    template<typename Message>
+    uint32_t append_message(kind_t kind, const Message& msg, int8_t rssi, uint32_t now)
+    {
+        record_t r;
+        r.kind = kind;
+        r.type = static_cast<uint8_t>(msg.id);
+        r.rssi = rssi;
+        r.timestamp = msg.timestamp;
+        r.value = msg.value;
+        return append(r, now);
+    }
+
+    // Сброс по времени. return: мс до сброса, NEVER - буфер пуст
+    uint32_t tick(uint32_t now)
+    {
+        if(buffered_ > flushed_ && now - buffered_since_ >= flush_ms_) flush();
+        return time_to_next(now);
+    }
+
+    uint32_t time_to_next(uint32_t now) const
+    {
+        if(buffered_ == flushed_) return NEVER;
+        uint32_t elapsed = now - buffered_since_;
+        return elapsed >= flush_ms_ ? 0 : flush_ms_ - elapsed;
+    }
+
+    // Дописать несохраненные записи текущей страницы. return: false - ошибка записи, записи остаются в буфере
+    bool flush()
+    {
+        if(buffered_ == flushed_) return true;
+        if(!file_) return false;
+        size_t count = buffered_ - flushed_;
+        size_t written = file_.write(page_ + flushed_ * RECORD_SIZE, count * RECORD_SIZE);
+        file_.flush();
+        ++page_writes_;
+        if(written != count * RECORD_SIZE) {
+            ++write_errors_;
+            return false;
+        }
+        segments_[current_].records += static_cast<uint32_t>(count);
+        persisted_ += static_cast<uint32_t>(count);
+        flushed_ = buffered_;
+        if(buffered_ == RECORDS_PER_PAGE) buffered_ = flushed_ = 0;
+        if(segments_[current_].records >= RECORDS_PER_SEGMENT) return open_segment((current_ + 1) % JOURNAL_SEGMENTS, persisted_);
+        return true;
+    }
+
+    // Самая старая запись в журнале (включая буфер)
+    uint32_t first_seq() const
+    {
+        uint32_t first = persisted_;        // на флеше ничего нет - журнал начинается с буфера
+        for(const segment_t& s : segments_) {
+            if(s.records && static_cast<int32_t>(s.first_seq - first) < 0) first = s.first_seq;
+        }
+        return first;
+    }
+    uint32_t next_seq() const { return next_seq_; }
+    size_t   size() const { return next_seq_ - first_seq(); }
+
+    // Запись по seq: из буфера или одним seek в сегменте. return: false - нет в журнале или повреждена
+    bool read(uint32_t seq, record_t& out)
+    {
+        if(static_cast<int32_t>(seq - persisted_) >= 0) {
+            if(static_cast<int32_t>(seq - next_seq_) >= 0) return false;
+            return decode(page_ + (flushed_ + (seq - persisted_)) * RECORD_SIZE, out);
+        }
+        for(size_t k = 0; k < JOURNAL_SEGMENTS; ++k) {
+            const segment_t& s = segments_[k];
+            if(!s.records || seq - s.first_seq >= s.records) continue;
+            char name[24];
+            path(k, name);
+            file_t file = fs_.open(name, "r");
+            uint8_t raw[RECORD_SIZE];
+            if(!file || !file.seek((seq - s.first_seq) * RECORD_SIZE) || file.read(raw, RECORD_SIZE) != RECORD_SIZE) return false;
+            return decode(raw, out) && out.seq == seq;
+        }
+        return false;
+    }
+
+    // Все записи начиная с from по порядку: страницами по JOURNAL_PAGE_SIZE, один open на сегмент.
+    // Поврежденные записи пропускаются. return: передано записей
+    template<typename Visit>
+    size_t for_each(uint32_t from, Visit visit)
+    {
+        uint32_t first = first_seq();
+        if(static_cast<int32_t>(from - first) < 0) from = first;
+        size_t visited = 0;
+        record_t r;
+        while(static_cast<int32_t>(from - persisted_) < 0) {
+            int k = segment_of(from);
+            if(k < 0) break;
+            const segment_t& s = segments_[k];
+            char name[24];
+            path(static_cast<size_t>(k), name);
+            file_t file = fs_.open(name, "r");
+            if(!file || !file.seek((from - s.first_seq) * RECORD_SIZE)) break;
+            uint32_t end = s.first_seq + s.records;
+            if(static_cast<int32_t>(end - persisted_) > 0) end = persisted_;
+            uint8_t chunk[JOURNAL_PAGE_SIZE];
+            while(from != end) {
+                uint32_t want = end - from < RECORDS_PER_PAGE ? end - from : RECORDS_PER_PAGE;
+                size_t got = file.read(chunk, want * RECORD_SIZE) / RECORD_SIZE;
+                if(got == 0) { from = end; break; }
+                for(size_t i = 0; i < got; ++i) {
+                    if(decode(chunk + i * RECORD_SIZE, r)) { visit(static_cast<const record_t&>(r)); ++visited; }
+                }
+                from += static_cast<uint32_t>(got);
+            }
+        }
+        for(; static_cast<int32_t>(from - next_seq_) < 0; ++from) {
+            if(read(from, r)) { visit(static_cast<const record_t&>(r)); ++visited; }
+        }
+        return visited;
+    }
+
+    // Последние count записей
+    template<typename Visit>
+    size_t tail(size_t count, Visit visit)
+    {
+        uint32_t from = count < size() ? next_seq_ - static_cast<uint32_t>(count) : first_seq();
+        return for_each(from, visit);
+    }
+
+    uint32_t appended() const { return appended_; }
+    uint32_t page_writes() const { return page_writes_; }
+    uint32_t write_errors() const { return write_errors_; }
+    uint32_t dropped() const { return dropped_; }
+
+private:
+    struct segment_t {
+        uint32_t first_seq = 0;
+        uint32_t records   = 0;
+    };
+
+    static void path(size_t k, char (&out)[24]) { snprintf(out, sizeof(out), "/journal%u.bin", unsigned(k)); }
+
+    int segment_of(uint32_t seq) const
+    {
+        for(size_t k = 0; k < JOURNAL_SEGMENTS; ++k) {
+            if(segments_[k].records && seq - segments_[k].first_seq < segments_[k].records) return static_cast<int>(k);
+        }
+        return -1;
+    }
+
+    // Новый сегмент поверх самого старого
+    bool open_segment(size_t k, uint32_t first_seq)
+    {
+        file_.close();
+        current_ = k;
+        segments_[k].first_seq = first_seq;
+        segments_[k].records = 0;
+        char name[24];
+        path(k, name);
+        file_ = fs_.open(name, "w");
+        return static_cast<bool>(file_);
+    }
+
+    Fs&       fs_;
+    file_t    file_;
+    segment_t segments_[JOURNAL_SEGMENTS];
+    size_t    current_ = 0;
+    uint8_t   page_[JOURNAL_PAGE_SIZE];
+    size_t    buffered_ = 0;            // записей в page_
+    size_t    flushed_ = 0;             // из них уже на флеше
+    uint32_t  buffered_since_ = 0;
+    uint32_t  flush_ms_;
+    uint32_t  next_seq_ = 0;
+    uint32_t  persisted_ = 0;           // seq первой записи, которой еще нет на флеше
+    uint32_t  appended_ = 0;
+    uint32_t  page_writes_ = 0;
+    uint32_t  write_errors_ = 0;
+    uint32_t  dropped_ = 0;
+};
+
+}// namespace message_journal
@@ -1,4 +1,5 @@
 #include "morse.h"
+#include "trace_log.h"
 
 MorseCode::MorseCode(etl::weak_ptr<etl::led> led, uint32_t dit_duration_ms /*= 100*/)  
 : led_(led)
@@ -10,159 +11,141 @@ MorseCode::MorseCode(etl::weak_ptr<etl::led> led, uint32_t dit_duration_ms /*= 1
 uint32_t MorseCode::send(const String& text)
 {
     reset();
-    uint32_t duration_ms = 0;
-    dit_code_ = message_to_code(text);
-    if(!dit_code_.empty())
+    uint32_t duration_ms = get_duration(text);
+    if(duration_ms > 0)
     {
-        duration_ms = get_dit_code_duration(dit_code_);
-    //    debug_trace(text);        
-        transmitting_ = true;     // идет процесс передачи
-        is_completed_ = false;     // завершено
-        dit_pos_ = 0;
-        timer_next_.start(interval_t::pulse * dit_duration_, GTMode::Timeout);
+        text_ = text;
+        text_source_ = morse_code::string_source(text_.c_str(), text_.length());
+        TRACE(kMorseStart, duration_ms, dit_duration_);
+        start(&text_source_);
     }
     
     return duration_ms;
 }
 
+void MorseCode::send(morse_code::source_t& source)
+{
+    reset();
+    start(&source);
+}
+
+bool MorseCode::enqueue(const char* text, size_t length)
+{
+    return queue_.push(message_t(text, length));
+}
+
+void MorseCode::start(morse_code::source_t* source)
+{
+    encoder_.start(source);
+    transmitting_ = true;     // идет процесс передачи
+    is_completed_ = false;     // завершено
+    schedule_next(interval_t::pulse * dit_duration_, 0);
+}
+
+void MorseCode::schedule_next(uint32_t interval_ms, uint32_t led_on_ms)
+{
+    uint32_t now = millis();
+    next_at_ = now + interval_ms;
+    led_off_at_ = led_on_ms ? now + led_on_ms + 1 : now;    // +1 мс: таймер светодиода запущен чуть раньше, к этому сроку он точно истек
+    timer_next_.start(interval_ms, GTMode::Timeout);
+}
+
+uint32_t MorseCode::time_to_next(uint32_t now) const
+{
+    if(!transmitting_) return (queue_.empty() || !led_.lock()) ? NEVER : 0;     // без светодиода очередь ждет
+    auto left = [now](uint32_t at) -> uint32_t { return static_cast<int32_t>(at - now) > 0 ? at - now : 0; };
+    uint32_t next = left(next_at_);
+    uint32_t led_off = left(led_off_at_);
+    return (led_off > 0 && led_off < next) ? led_off : next;
+}
+
 void MorseCode::reset()
 {
     if(auto led = led_.lock(); led) led->off();
     transmitting_ = false;     // идет процесс передачи
     is_completed_ = false;     // завершено
-    dit_code_.clear();        // последовательность точек-тире для текущего символа      
-    dit_pos_   = -1;        // указатель на текущий элемент
+    encoder_.reset();
+    text_source_ = morse_code::string_source();
 }
 
-String MorseCode::get_char_code(char ch)
+morse_code::symbol_t MorseCode::get_char_code(char ch)
 {
-    for(auto item : table_digits_)
-    {
-        if(item.symbol == ch)
-        {
-            return item.value;
-        }
-    }
-
-    return String("");
+    return morse_code::get_ascii_code(ch);
 }
 
-etl::vector<char> MorseCode::message_to_code(const String& text)
+void MorseCode::tick()
 {
-    static String separators = " ,.|!?-/\\";
-    etl::vector<char> codes;
-    for(char ch : text)
+    auto led = led_.lock();
+    if(!led)
     {
-        auto code = get_char_code(ch); 
-        if(!code.isEmpty())
-        {
-            for(auto dit : code) codes.push_back(dit);        // последовательность точек-тире для текущего символа      
-            codes.push_back(code_t::PAUSE);        
-        }
-        else
-        {
-            for(auto sep : separators)
-            {
-                if(ch == sep)
-                {
-                    // Добавить раздилитель
-                    if(!codes.empty() && codes.back() == code_t::PAUSE) {
-                        codes.back() = code_t::WDBR; 
-                    }
-                    else {
-                        codes.push_back(code_t::WDBR);
-                    }
-                    break;
-                }
-                else
-                {
-                    // Игнорируем неизвестные символы, если нужно, потом добавить в справочник нужные коды
-                    // :TODO: skiping symbols
-                }
-            }            
-        }        
+        // Светодиод удален: передача стоит, а time_to_next() без остановки вечно отдавал бы 0 и loop() крутился
+        if(transmitting_) reset();
+        return;
     }
 
-    return codes;    
-}
+    if(!transmitting_ && queue_.pop(current_))
+    {
+        text_source_ = morse_code::string_source(current_.text, current_.length);
+        start(&text_source_);
+    }
 
-void MorseCode::tick()
-{
-    if(auto led = led_.lock(); led)
+    led->tick();
+    if(transmitting_ && timer_next_.tick())
     {
-        led->tick();
-        if(timer_next_.tick())
+        code_t dit;
+        if(encoder_.next(dit))
         {
-            if(dit_pos_ < static_cast<int>(dit_code_.size()))
-            {
-                // Передать текущий символ
-                switch(dit_code_[dit_pos_])
-                {
-                case code_t::DOT:
-                    led->blink(interval_t::dot * dit_duration_);
-                    timer_next_.start((interval_t::dot + interval_t::pulse) * dit_duration_, GTMode::Timeout);
-                //    debug_trace_dit(code_t::DOT, interval_t::dot, interval_t::pulse);
-                    break;        
-                case code_t::DASH:
-                    led->blink(interval_t::dash * dit_duration_);
-                    timer_next_.start((interval_t::dash + interval_t::pulse) * dit_duration_, GTMode::Timeout);
-                //    debug_trace_dit(code_t::DASH, interval_t::dash, interval_t::pulse);
-                    break;        
-                case code_t::PAUSE:
-                    led->off();
-                    timer_next_.start(interval_t::symbol * dit_duration_, GTMode::Timeout);
-                //    debug_trace_dit(code_t::PAUSE, 0, interval_t::symbol);
-                    break;        
-                case code_t::WDBR:
-                    led->off();
-                    timer_next_.start(interval_t::word * dit_duration_, GTMode::Timeout);
-                //    debug_trace_dit(code_t::WDBR, 0, interval_t::word);
-                    break;        
-                default:
-                    Serial.println("ERROR: Неизвестный символ!");
-                    break;
-                }
-
-                // Переместить указатель к следующему
-                dit_pos_++;
-            }
-            else
+            // Передать текущий символ
+            switch(dit)
             {
-                // стоп, все данные переданы
-                transmitting_ = false;    // идет процесс передачи
-                is_completed_ = true;     // завершено
+            case code_t::DOT:
+                led->blink(interval_t::dot * dit_duration_);
+                schedule_next((interval_t::dot + interval_t::pulse) * dit_duration_, interval_t::dot * dit_duration_);
+                TRACE(kMorseElement, code_t::DOT, interval_t::dot, interval_t::pulse);
+                break;        
+            case code_t::DASH:
+                led->blink(interval_t::dash * dit_duration_);
+                schedule_next((interval_t::dash + interval_t::pulse) * dit_duration_, interval_t::dash * dit_duration_);
+                TRACE(kMorseElement, code_t::DASH, interval_t::dash, interval_t::pulse);
+                break;        
+            case code_t::PAUSE:
+                led->off();
+                schedule_next(interval_t::symbol * dit_duration_, 0);
+                TRACE(kMorseElement, code_t::PAUSE, 0, interval_t::symbol);
+                break;        
+            case code_t::WDBR:
+                led->off();
+                schedule_next(interval_t::word * dit_duration_, 0);
+                TRACE(kMorseElement, code_t::WDBR, 0, interval_t::word);
+                break;        
+            default:
+                TRACE(kMorseError, dit);     // Serial.println() здесь остановил бы передачу до опустошения FIFO
+                break;
             }
         }
+        else if(encoder_.waiting())
+        {
+            // источник пока пуст: спросить через dit, светодиод погашен
+            schedule_next(dit_duration_, 0);
+        }
+        else
+        {
+            // стоп, все данные переданы
+            transmitting_ = false;    // идет процесс передачи
+            is_completed_ = true;     // завершено
+            TRACE(kMorseDone);
+        }
     }
 }
 
-uint32_t MorseCode::get_dit_code_duration(const etl::vector<char>& dit_code)
+uint32_t MorseCode::get_duration(const String& text)
 {
-    int dit_count = 0;
-
-    for(auto item : dit_code)
-    {
-        // Передать текущий символ
-        switch(item)
-        {
-        case code_t::DOT:
-            dit_count += (interval_t::dot + interval_t::pulse);
-            break;        
-        case code_t::DASH:
-            dit_count += (interval_t::dash + interval_t::pulse);
-            break;        
-        case code_t::PAUSE:
-            dit_count += interval_t::symbol;
-            break;        
-        case code_t::WDBR:
-            dit_count += interval_t::word;
-            break;        
-        default:
-            break;
-        }
-    }
+    return get_duration(text.c_str(), text.length());
+}
 
-    return dit_count * dit_duration_;
+uint32_t MorseCode::get_duration(const char* text, size_t length)
+{
+    return morse_code::duration_units(text, length) * dit_duration_;
 }
 
 void MorseCode::debug_trace(const String& value)
@@ -170,13 +153,11 @@ void MorseCode::debug_trace(const String& value)
     Serial.print(millis()); Serial.print(" ms| send: ");
     Serial.print(value);
     Serial.print(" : ");
-    String str_message;
-    auto message = message_to_code(value); 
-    if(!message.empty())
-    {
-        for(auto dit : message) str_message += String(dit);
-        Serial.println(str_message);
-    }   
+    morse_code::string_source source(value.c_str(), value.length());
+    morse_code::encoder message(&source);
+    code_t dit;
+    while(message.next(dit)) Serial.print(static_cast<char>(dit));
+    Serial.println();
 }
 
 void MorseCode::debug_trace_dit(code_t dit, int on_count, int off_count)
@@ -4,8 +4,16 @@
 
 #include "GTimer.h"
 #include "etl/etl_led.h"
-#include "etl/etl_vector.h"
 #include "etl/etl_memory.h"
+#include "morse_encoder.h"
+#include "morse_queue.h"
+
+#ifndef MORSE_QUEUE_SIZE
+#define MORSE_QUEUE_SIZE    8       // сообщений в очереди на передачу, степень двойки
+#endif
+#ifndef MORSE_MESSAGE_SIZE
+#define MORSE_MESSAGE_SIZE  32      // максимальная длина сообщения в очереди, байт
+#endif
 
 class MorseCode
 {
@@ -17,34 +25,43 @@ class MorseCode
         word    = 7     // Интервал между словами	7 единиц времени
     };
 
-    enum code_t : char {
-        DOT = '.',
-        DASH = '-',
-        PAUSE = ' ',
-        WDBR = '|'
-    };
+    using code_t = morse_code::element_t;
 
 public: 
+    using message_t = morse_code::text_t<MORSE_MESSAGE_SIZE>;
+    using queue_t   = morse_code::spsc_queue<message_t, MORSE_QUEUE_SIZE>;
+
     MorseCode(etl::weak_ptr<etl::led> led, uint32_t dit_duration_ms = 50);   // светодиод для моргания и стандартная длительность точки
     virtual ~MorseCode() = default;
 
-    struct table_t
-    {
-        char    symbol;
-        String  value;
-    };
-
-    void tick();    
+    virtual void tick();    
     uint32_t send(const String& text);  // return: tramsmitting duration in ms 
-    void reset();
+    void send(morse_code::source_t& source); // потоковая передача, источник должен жить до конца передачи, длительность заранее неизвестна
+    virtual void reset();
+
+    // Очередь на передачу: сообщение уходит после завершения текущего, send() не прерывается.
+    // Один писатель - код в контексте loop() (таймер, консоль, morse_relay_mgr::tick()), читатель - tick()
+    bool enqueue(const char* text, size_t length);
+    bool enqueue(const String& text) { return enqueue(text.c_str(), text.length()); }
+    queue_t& queue() { return queue_; }
+
+    uint32_t get_duration(const String& text);  // длительность передачи за один проход без выделения памяти
+    uint32_t get_duration(const char* text, size_t length);
+
+    // Время до следующего действия в tick(), мс: конец точки/тире или следующий элемент. NEVER - передавать нечего
+    static constexpr uint32_t NEVER = UINT32_MAX;
+    virtual uint32_t time_to_next(uint32_t now) const;
+
+    bool is_transmitting() const { return transmitting_; }
+    bool is_completed() const { return is_completed_; }
 
     void debug_trace(const String& value);  
     void debug_trace_dit(code_t dit, int on_count, int off_count);  
 
 protected:
-    etl::vector<char> message_to_code(const String& text);
-    String get_char_code(char ch);
-    uint32_t get_dit_code_duration(const etl::vector<char>& dit_code);
+    morse_code::symbol_t get_char_code(char ch);    // код ASCII символа из таблицы во flash, O(1)
+    virtual void start(morse_code::source_t* source);
+    void schedule_next(uint32_t interval_ms, uint32_t led_on_ms);
 
 protected:
     etl::weak_ptr<etl::led> led_;        // светодиод для передачи кода
@@ -52,21 +69,13 @@ protected:
 
     bool     transmitting_  = false;     // идет процесс передачи
     bool     is_completed_  = false;     // завершено
-    etl::vector<char> dit_code_;         // последовательность точек-тире для текущей передачи
-    int      dit_pos_       = -1;        // указатель на текущий элемент
+    String   text_;                      // копия текста для передачи из send(String)
+    morse_code::string_source text_source_; // курсор по text_
+    morse_code::encoder encoder_;        // выдает следующий элемент передачи
+    queue_t  queue_;                     // сообщения, ожидающие передачи
+    message_t current_;                  // сообщение из очереди, которое передается сейчас
 
     GTimer<millis>  timer_next_;        // миллисекундный таймер для передачи следующего символа
-    
-    table_t table_digits_ [10] {
-        {'1', ".----"},
-        {'2', "..---"},
-        {'3', "...--"},
-        {'4', "....-"},
-        {'5', "....."},
-        {'6', "-...."},
-        {'7', "--..."},
-        {'8', "---.."},
-        {'9', "----."},
-        {'0', "-----"}
-    };
+    uint32_t next_at_      = 0;         // срок timer_next_, для планировщика
+    uint32_t led_off_at_   = 0;         // конец текущей точки/тире
 };
@@ -0,0 +1,213 @@
+#pragma once
+// Декодер азбуки Морзе по времени фронтов
+// На вход - фронты включения/выключения с отметкой времени (фотодиод на GPIO, события моргания по ESP-NOW),
+// на выходе - символы. Длительность точки оценивается на лету: длительности импульсов делятся на два кластера
+// (точки и тире), центры кластеров сдвигаются к новым значениям, поэтому декодер подстраивается под скорость
+// передающего, даже если она уходит от MORSE_DIT.
+// O(1) на фронт, без выделения памяти. Единицы времени любые (мс, мкс), главное - одинаковые для всех фронтов.
+//
+// Из прерывания фронты складываются в edge_queue_t, в loop() разбираются через on_edge():
+//   morse_code::edge_queue_t edges;                     // ISR: edges.push({micros(), digitalRead(PIN)});
+//   morse_code::edge_t edge;
+//   while(edges.pop(edge)) decoder.on_edge(edge.level, edge.time);
+
+#include "morse_table.h"
+#include "morse_queue.h"
+
+namespace morse_code {
+
+// Фронт сигнала
+struct edge_t {
+    uint32_t time  = 0;     // время фронта
+    uint8_t  level = 0;     // уровень после фронта: 1 - включено, 0 - выключено
+
+    bool operator==(const edge_t& other) const { return time == other.time && level == other.level; }
+};
+
+using edge_queue_t = spsc_queue<edge_t, 32>;
+
+// Счетчики декодера
+struct decoder_stats_t {
+    uint32_t edges     = 0;     // принято фронтов
+    uint32_t symbols   = 0;     // распознано символов
+    uint32_t unknown   = 0;     // кодов без символа в таблице
+    uint32_t glitches  = 0;     // отброшено коротких импульсов и повторов уровня
+    uint32_t overflows = 0;     // символов потеряно из-за переполнения выходного буфера
+};
+
+class decoder
+{
+public:
+    static constexpr char UNKNOWN = '*';    // символ для нераспознанного кода
+    static constexpr size_t OUTPUT_SIZE = 16;
+
+    explicit decoder(uint32_t dit = 50) { reset(dit); }
+
+    void reset(uint32_t dit)
+    {
+        dot_  = static_cast<int32_t>(dit);
+        dash_ = static_cast<int32_t>(dit * 3);
+        symbol_ = symbol_t{};
+        overflow_ = false;
+        started_ = false;
+        level_ = 0;
+        last_time_ = 0;
+        out_head_ = out_tail_ = 0;
+        stats_ = decoder_stats_t{};
+    }
+
+    // Фронт сигнала: level - новый уровень, time - время фронта
+    void on_edge(bool level, uint32_t time)
+    {
+        ++stats_.edges;
+        if(!started_) {
+            started_ = true;
+            level_ = level;
+            last_time_ = time;
+            return;
+        }
+        if(level == level_) {
+            ++stats_.glitches;
+            return;
+        }
+
+        uint32_t duration = time - last_time_;
+        if(duration < static_cast<uint32_t>(dot_ / 4)) {
+            // Дребезг: слишком короткий интервал склеиваем с предыдущим, фронт игнорируем
+            ++stats_.glitches;
+            return;
+        }
+
+        last_time_ = time;
+        level_ = level;
+        if(level) on_space(duration);   // закончилась пауза
+        else      on_mark(duration);    // закончился импульс
+    }
+
+    // Вызывать периодически: если линия молчит дольше межсимвольного интервала - выдать последний символ
+    void poll(uint32_t now)
+    {
+        if(started_ && !level_ && symbol_.length > 0 && now - last_time_ >= 2 * dit()) {
+            finish_symbol();
+        }
+    }
+
+    // Очередной распознанный символ, false - нет новых
+    bool read(char& ch)
+    {
+        if(out_head_ == out_tail_) return false;
+        ch = out_[out_head_ % OUTPUT_SIZE];
+        ++out_head_;
+        return true;
+    }
+
+    // Текущая оценка длительности точки
+    uint32_t dit() const
+    {
+        // Среднее по двум кластерам: точка и треть тире
+        return static_cast<uint32_t>((dot_ + dash_ / 3) / 2);
+    }
+
+    // Скорость в словах в минуту (PARIS = 50 единиц), units_per_second - единиц времени в секунде
+    uint32_t wpm(uint32_t units_per_second = 1000) const
+    {
+        uint32_t d = dit();
+        return d ? (units_per_second * 6 / 5) / d : 0;
+    }
+
+    const decoder_stats_t& stats() const { return stats_; }
+
+private:
+    void on_mark(uint32_t duration)
+    {
+        int32_t d = static_cast<int32_t>(duration);
+        if(d > 2 * dash_) {
+            // Передающий намного медленнее оценки - перезапуск кластеров от этого тире
+            dash_ = d;
+            dot_  = d / 3;
+        }
+        else if(2 * d < dot_) {
+            // Намного быстрее - перезапуск от этой точки
+            dot_  = d;
+            dash_ = d * 3;
+        }
+        bool is_dash = d >= (dot_ + dash_) / 2;
+        if(is_dash) {
+            dash_ += (d - dash_) / 4;
+            dot_  += (dash_ / 3 - dot_) / 16;   // слабая связь кластеров: при дрейфе скорости второй тоже сдвигается
+        }
+        else {
+            dot_  += (d - dot_) / 4;
+            dash_ += (dot_ * 3 - dash_) / 16;
+        }
+        if(dot_ < 1) dot_ = 1;
+        if(dash_ < 2 * dot_) dash_ = 2 * dot_;   // кластеры не должны слипаться
+
+        if(symbol_.length < MAX_SYMBOL_LENGTH) {
+            if(is_dash) symbol_.pattern |= static_cast<uint8_t>(1u << symbol_.length);
+            ++symbol_.length;
+        }
+        else {
+            overflow_ = true;
+        }
+    }
+
+    void on_space(uint32_t duration)
+    {
+        uint32_t unit = dit();
+        if(duration < 2 * unit) {
+            // Интервал между точкой/тире - тоже одна единица времени
+            dot_ += (static_cast<int32_t>(duration) - dot_) / 8;
+        }
+        else if(duration < 5 * unit) {
+            finish_symbol();
+        }
+        else {
+            finish_symbol();
+            emit(' ');
+        }
+    }
+
+    void finish_symbol()
+    {
+        if(symbol_.length == 0) return;
+        char ch = overflow_ ? 0 : get_symbol(symbol_);
+        if(ch) {
+            ++stats_.symbols;
+        }
+        else {
+            ch = UNKNOWN;
+            ++stats_.unknown;
+        }
+        emit(ch);
+        symbol_ = symbol_t{};
+        overflow_ = false;
+    }
+
+    void emit(char ch)
+    {
+        if(static_cast<uint8_t>(out_tail_ - out_head_) >= OUTPUT_SIZE) {
+            ++stats_.overflows;
+            return;
+        }
+        out_[out_tail_ % OUTPUT_SIZE] = ch;
+        ++out_tail_;
+    }
+
+private:
+    int32_t  dot_  = 0;             // центр кластера точек
+    int32_t  dash_ = 0;             // центр кластера тире
+    symbol_t symbol_;               // принимаемый символ
+    bool     overflow_ = false;     // код длиннее MAX_SYMBOL_LENGTH
+    bool     started_  = false;     // был первый фронт
+    bool     level_    = false;     // текущий уровень линии
+    uint32_t last_time_ = 0;        // время последнего фронта
+
+    char     out_[OUTPUT_SIZE] {};  // распознанные символы
+    uint8_t  out_head_ = 0;         // счетчики по модулю 256, OUTPUT_SIZE - делитель 256
+    uint8_t  out_tail_ = 0;
+
+    decoder_stats_t stats_;
+};
+
+}// namespace morse_code
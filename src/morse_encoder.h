@@ -0,0 +1,202 @@
+#pragma once
+// Потоковый кодировщик азбуки Морзе
+// Не строит последовательность точек-тире целиком: по запросу next() читает из источника очередной символ
+// и выдает следующий элемент. Память постоянная и не зависит от длины сообщения.
+
+#include "morse_table.h"
+
+namespace morse_code {
+
+// Элементы передачи
+enum element_t : char {
+    DOT   = '.',
+    DASH  = '-',
+    PAUSE = ' ',    // интервал между символами
+    WDBR  = '|'     // интервал между словами
+};
+
+// Длительность элемента в единицах dit, вместе с интервалом после него
+constexpr uint32_t element_units(element_t element)
+{
+    switch(element) {
+    case DOT:   return 1 + 1;   // точка + интервал между точкой/тире
+    case DASH:  return 3 + 1;   // тире + интервал между точкой/тире
+    case PAUSE: return 3;       // интервал между символами
+    case WDBR:  return 7;       // интервал между словами
+    }
+    return 0;
+}
+
+// Источник текста для передачи
+class source_t
+{
+public:
+    virtual ~source_t() = default;
+    static constexpr int END   = -1;    // данные закончились
+    static constexpr int AGAIN = -2;    // данных пока нет, поток не закончен: encoder::next() спросит позже
+
+    virtual int read() = 0;     // очередной байт, END или AGAIN
+};
+
+// Источник из строки в памяти, строка должна жить до конца передачи
+class string_source : public source_t
+{
+    const char* it_  = nullptr;
+    const char* end_ = nullptr;
+public:
+    string_source() = default;
+    string_source(const char* text, size_t length) : it_(text), end_(text + length) {}
+
+    int read() override { return it_ < end_ ? static_cast<uint8_t>(*it_++) : END; }
+};
+
+#if defined(ARDUINO)
+// Источник из Arduino Stream: Serial, File LittleFS и т.д.
+// Передача заканчивается на байте terminator (он не передается) или когда данных нет дольше timeout_ms.
+// Пока данных нет - AGAIN: Serial, в который еще печатают, не обрывает передачу. Для File timeout_ms = 0:
+// конец файла сразу конец передачи
+class stream_source : public source_t
+{
+    Stream*  stream_     = nullptr;
+    uint32_t timeout_ms_ = 0;
+    int      terminator_ = END;
+    uint32_t last_       = 0;       // когда пришел последний байт
+public:
+    explicit stream_source(Stream& stream, uint32_t timeout_ms = 0, int terminator = END)
+    : stream_(&stream), timeout_ms_(timeout_ms), terminator_(terminator), last_(millis()) {}
+
+    int read() override
+    {
+        uint32_t now = millis();
+        if(stream_->available() <= 0) return now - last_ < timeout_ms_ ? AGAIN : END;
+        last_ = now;
+        int ch = stream_->read();
+        return ch == terminator_ ? END : ch;
+    }
+};
+#endif
+
+// Кодировщик: курсор по источнику
+class encoder
+{
+    source_t* source_       = nullptr;
+    symbol_t  symbol_;                  // текущий символ
+    uint8_t   pos_          = 0;        // следующий элемент текущего символа
+    bool      pending_pause_ = false;   // после символа еще не выдан интервал, может стать разделителем слов
+    bool      waiting_      = false;    // источник вернул AGAIN
+    uint16_t  codepoint_    = 0;        // UTF-8 символ, прочитанный не до конца
+    uint8_t   utf8_left_    = 0;        // сколько его байтов еще не пришло
+    uint8_t   utf8_length_  = 0;
+
+public:
+    encoder() = default;
+    explicit encoder(source_t* source) { start(source); }
+
+    void start(source_t* source)
+    {
+        source_ = source;
+        symbol_ = symbol_t{};
+        pos_ = 0;
+        pending_pause_ = false;
+        waiting_ = false;
+        utf8_left_ = 0;
+    }
+
+    void reset() { start(nullptr); }
+
+    // Источник пока пуст (AGAIN): next() вернул false, но передача не закончена - вызвать next() позже
+    bool waiting() const { return waiting_; }
+
+    // Следующий элемент передачи, false - передача закончена или waiting()
+    bool next(element_t& element)
+    {
+        while(true)
+        {
+            if(pos_ < symbol_.length)
+            {
+                element = symbol_.is_dash(pos_) ? DASH : DOT;
+                if(++pos_ == symbol_.length) pending_pause_ = true;
+                return true;
+            }
+
+            symbol_t code;
+            switch(read_token(code))
+            {
+            case token_t::kEnd:
+                if(waiting_) return false;      // интервал после символа ждет: следующим может быть пробел
+                symbol_ = symbol_t{};
+                if(!pending_pause_) return false;
+                pending_pause_ = false;
+                element = PAUSE;
+                return true;
+            case token_t::kWordBreak:
+                pending_pause_ = false;     // интервал между символами заменяется интервалом между словами
+                element = WDBR;
+                return true;
+            case token_t::kSymbol:
+                symbol_ = code;
+                pos_ = 0;
+                if(pending_pause_) {
+                    pending_pause_ = false;
+                    element = PAUSE;
+                    return true;
+                }
+                break;
+            case token_t::kSkip:
+                break;
+            }
+        }
+    }
+
+private:
+    // Чтение UTF-8 символа из источника. На AGAIN посреди символа прочитанные байты сохраняются до следующего вызова
+    token_t read_token(symbol_t& code)
+    {
+        waiting_ = false;
+        if(!source_) return token_t::kEnd;
+        if(!utf8_left_)
+        {
+            int lead = source_->read();
+            if(lead == source_t::AGAIN) waiting_ = true;
+            if(lead < 0) return token_t::kEnd;
+            utf8_length_ = utf8_length(static_cast<uint8_t>(lead));
+            utf8_left_ = utf8_length_ - 1;
+            codepoint_ = static_cast<uint8_t>(lead);
+        }
+        for(; utf8_left_ > 0; --utf8_left_)
+        {
+            int next = source_->read();
+            if(next == source_t::AGAIN) {
+                waiting_ = true;
+                return token_t::kEnd;
+            }
+            if(next < 0) {
+                utf8_left_ = 0;
+                return token_t::kEnd;
+            }
+            codepoint_ = static_cast<uint16_t>((codepoint_ << 6) | (next & 0x3F));
+        }
+
+        if(utf8_length_ == 2) return get_token(static_cast<uint16_t>(codepoint_ & 0x07FF), code);
+        if(utf8_length_ > 2)  return token_t::kSkip;
+        return get_token(codepoint_, code);
+    }
+};
+
+// Длительность передачи в единицах dit за один проход, без выделения памяти. Источник без AGAIN
+inline uint32_t duration_units(source_t& source)
+{
+    encoder enc(&source);
+    uint32_t units = 0;
+    element_t element;
+    while(enc.next(element)) units += element_units(element);
+    return units;
+}
+
+inline uint32_t duration_units(const char* text, size_t length)
+{
+    string_source source(text, length);
+    return duration_units(source);
+}
+
+}// namespace morse_code
@@ -9,6 +9,14 @@
 // чтобы следующее измерение счетчика происходило либо по интервалу, если сервер не отвечает, либо через интервал после последнего ответа от сервера.
 // Сервер ставит таймаут на интервала обновления счетчика, и, если новые данные не приходят, сбрасывает изображение на дисплее
 // 
+// Синхронное мигание: сервер отвечает на kCount сообщением kTime (метка запроса и свое время), по нему клиент
+// оценивает смещение своих часов (clock_sync.h). kBlink несет момент начала по часам сервера (сейчас + BLINK_LEAD):
+// сервер и все клиенты группы мигают в этот момент, а не когда дошел кадр. Сервер старой прошивки kTime не шлет,
+// его kBlink несет метку запроса - клиент мигает сразу, как раньше.
+// Мигает светодиод из set_led(). В main.cpp это blinkLED - тот же LED_MORSE, которым передается азбука Морзе:
+// при SYNC_BLINK=1 моргание попадает в середину точек и тире и может погасить их раньше срока. Поэтому
+// по умолчанию SYNC_BLINK=0, а для проверки синхронности - отдельная сборка или свой светодиод.
+//
 // Будет использоваться для проверки дальности работы по ESPNOW. Запускаем клиент и сервер, видим, что счетчик растет и принимается на сервере,
 // отправляем клиента и следим, чтобы светодиод мигал. Замеряем точки, где трансляция нарушается.
 
@@ -16,6 +24,20 @@
 //#include "espnow/esp_manager.h"
 #include "etl/etl_espnow.h"
 #include "etl/etl_led.h"
+#include "morse.h"
+#include "espnow_batch.h"
+#include "morse_wire.h"
+#include "link_telemetry.h"
+#include "clock_sync.h"
+#include "espnow_reliable.h"
+#include "trace_log.h"
+
+#if defined(ESP8266)
+  #include <espnow.h>
+#elif defined(ESP32)
+  #include <esp_now.h>
+  #include <esp_wifi.h>
+#endif
 
 // Мои модули для отладки
 namespace esp_board {
@@ -24,41 +46,385 @@ namespace esp_board {
     const etl::espnow::endpoint_t ESP32_C3_ProMini_s003 {"0C:4E:A0:68:5A:E4"};    // ESP32 C3 Pro Mini с гнездом 
 }// namespace esp_board
 
-// Структура для сообщений
-struct morse_message_t {
-    enum type_t : uint8_t {
-        kEmpty = 0,
-        kBlink,
-        kCount
-    };
-    uint32_t timestamp = 0 ;
-    type_t id = type_t::kEmpty;
-    uint32_t value = 0;
-};
+// Формат передачи: 2 - компактные кадры morse_wire (по умолчанию),
+// 0 - одиночная структура morse_message_t, пока в сети остаются узлы на старой прошивке
+#ifndef MORSE_WIRE_FORMAT
+  #define MORSE_WIRE_FORMAT 2
+#endif
+
+// Надежная доставка кадров (espnow_reliable.h): 1 - окно, подтверждения и повторы, включать на обоих узлах пары.
+// Только с MORSE_WIRE_FORMAT 2. Память: окно отправки и по окну приема на каждого из MAX_CLIENTS отправителей,
+// ESPNOW_RELIABLE_WINDOW кадров в каждом, + очередь приема: ~22 КБ при окне 8 - на ESP8266 уменьшить окно.
+// Сервер отправляет в надежном режиме одним окном всем клиентам сразу: кадр считается доставленным
+// по первому подтверждению (его kTime и kBlink все равно идут без подтверждения)
+// kTime и kBlink и в этом режиме уходят обычными кадрами: их метки времени не переживают повтора
+#ifndef ESPNOW_RELIABLE
+  #define ESPNOW_RELIABLE 0
+#endif
+#ifndef ESPNOW_RELIABLE_WINDOW
+  #define ESPNOW_RELIABLE_WINDOW 8
+#endif
+
+// Отправка кадра всем зарегистрированным пирам напрямую через ESP-NOW (адрес nullptr)
+inline bool espnow_send_all(void* /*context*/, const uint8_t* data, size_t length)
+{
+#if defined(ESP8266)
+    return esp_now_send(nullptr, const_cast<uint8_t*>(data), static_cast<int>(length)) == 0;
+#elif defined(ESP32)
+    return esp_now_send(nullptr, data, length) == ESP_OK;
+#else
+    (void)data; (void)length;
+    return false;
+#endif
+}
+
+// Случайный номер сеанса надежного режима: по нему пара замечает перезагрузку отправителя
+inline uint8_t espnow_session()
+{
+#if defined(ESP8266)
+    return static_cast<uint8_t>(RANDOM_REG32);
+#elif defined(ESP32)
+    return static_cast<uint8_t>(esp_random());
+#else
+    return static_cast<uint8_t>(rand());
+#endif
+}
+
+// RSSI принятых кадров ESP-NOW: callback приема его не сообщает, поэтому на ESP32 кадры подслушиваются
+// в режиме promiscuous (ESP-NOW - action frame, категория vendor specific 127). ESP8266 RSSI не дает.
+namespace espnow_rssi {
+#if defined(ESP32)
+    inline volatile int8_t last = link_telemetry::RSSI_UNKNOWN;
+
+    inline void on_packet(void* buffer, wifi_promiscuous_pkt_type_t type)
+    {
+        if(type != WIFI_PKT_MGMT) return;
+        auto packet = static_cast<const wifi_promiscuous_pkt_t*>(buffer);
+        if(packet->rx_ctrl.sig_len < 25 || packet->payload[0] != 0xD0 || packet->payload[24] != 127) return;
+        last = static_cast<int8_t>(packet->rx_ctrl.rssi);
+    }
+
+    inline bool begin()
+    {
+        wifi_promiscuous_filter_t filter = {};
+        filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+        return esp_wifi_set_promiscuous_filter(&filter) == ESP_OK
+            && esp_wifi_set_promiscuous_rx_cb(on_packet) == ESP_OK
+            && esp_wifi_set_promiscuous(true) == ESP_OK;
+    }
+    inline int8_t read() { return last; }
+#else
+    inline bool begin() { return false; }
+    inline int8_t read() { return link_telemetry::RSSI_UNKNOWN; }
+#endif
+}// namespace espnow_rssi
 
 class morse_relay_mgr : public etl::espnow::manager<morse_message_t>
 {
 private:
-    etl::led* _led = nullptr;
+    etl::weak_ptr<etl::led> _led;   // светодиод моргания может быть освобожден раньше менеджера
+    // Принятый счетчик ставится в очередь на передачу азбукой Морзе: MorseCode или morse_code::static_morse
+    using enqueue_fn = bool (*)(void* morse, const char* text, size_t length);
+    enqueue_fn _enqueue = nullptr;
+    void* _morse = nullptr;
+    bool _server = false;           // сервер отвечает на счетчик командой мигать
+public:
+    // Принятое сообщение с отметкой времени приема и RSSI кадра
+    struct received_t {
+        morse_message_t msg;
+        uint32_t time = 0;
+        int8_t   rssi = link_telemetry::RSSI_UNKNOWN;
+
+        bool operator==(const received_t& other) const { return msg == other.msg; }     // повтор схлопывается
+    };
+    using rx_queue_t = morse_code::spsc_queue<received_t, 8>;
+private:
+    // Принятые сообщения: пишет WiFi callback, читает tick() в loop()
+    rx_queue_t _rx_queue {morse_code::overflow_t::kCoalesce};
+    link_telemetry::telemetry _telemetry;               // меняется только в loop()
+    // Пакетная передача: несколько сообщений в одном кадре ESP-NOW, компактный формат morse_wire
+    using batch_sender_t   = espnow_batch::sender<morse_message_t, morse_wire::compact_codec>;
+    // Клиентов, которых сервер различает по MAC: больше - таблица номеров кадров вытесняет записи по кругу
+    static constexpr size_t MAX_CLIENTS = 8;
+    using batch_receiver_t = espnow_batch::receiver<morse_message_t, morse_wire::compact_codec, MAX_CLIENTS>;
+    batch_sender_t   _batch_tx;
+    batch_receiver_t _batch_rx;                         // номера кадров по MAC: у сервера несколько клиентов
+    espnow_batch::receiver<morse_message_t, espnow_batch::raw_codec<morse_message_t>, MAX_CLIENTS> _raw_rx;    // кадры версии 1 от узлов предыдущей прошивки
+    espnow_batch::send_fn _transport = nullptr;
+    void* _transport_context = nullptr;
+#if ESPNOW_RELIABLE
+    // Кадры надежного режима: пишет WiFi callback, подтверждения, повторы и порядок - в tick()
+    struct frame_t {
+        uint8_t  data[espnow_batch::MAX_FRAME_SIZE];
+        uint8_t  length = 0;
+        uint8_t  mac[espnow_batch::MAC_SIZE] {};
+        uint32_t time = 0;
+        int8_t   rssi = link_telemetry::RSSI_UNKNOWN;
+
+        bool operator==(const frame_t&) const { return false; }
+    };
+    morse_code::spsc_queue<frame_t, 8> _frames;
+    espnow_reliable::stats_t _reliable_stats;           // отправка и прием по всем пирам
+    espnow_reliable::sender<ESPNOW_RELIABLE_WINDOW> _reliable;
+    // Окно приема и сеанс - у каждого клиента свои: общее окно пересинхронизировалось бы на каждом чужом кадре
+    espnow_reliable::receiver_table<ESPNOW_RELIABLE_WINDOW, MAX_CLIENTS> _reliable_in;
+    batch_receiver_t _reliable_rx;      // кадры из _reliable_in: своя нумерация отправителя, не путать с _batch_rx
+    // kTime и kBlink несут время: повтор через rto пришел бы с устаревшей меткой, такие сообщения - без подтверждения
+    batch_sender_t   _urgent_tx;
+
+    static bool reliable_send(void* context, const uint8_t* data, size_t length) {
+        return static_cast<morse_relay_mgr*>(context)->_reliable.send(data, length, millis());
+    }
+    // Окно занято: кадр ждет в _batch_tx до подтверждения, а не теряется в reliable_send
+    static bool reliable_ready(void* context) {
+        return static_cast<morse_relay_mgr*>(context)->_reliable.can_send();
+    }
+#endif
+public:
+    // Журнал сообщений: received = false - отправлено, true - принято (rssi кадра)
+    using log_fn = void (*)(void* context, bool received, const morse_message_t& msg, int8_t rssi);
+private:
+    log_fn _log = nullptr;
+    void* _log_context = nullptr;
+    // Часы сервера у клиента и запланированное моргание
+    clock_sync::estimator<> _sync;
+    bool _peer_sync = false;            // сервер шлет kTime - в kBlink момент начала, а не метка запроса
+    bool _blink_pending = false;
+    uint32_t _blink_at = 0;
+    uint32_t _blink_duration = 0;
+    bool _blink_on = false;             // светодиод горит, tick() погасит его в _blink_off_at
+    uint32_t _blink_off_at = 0;
 public: 
-    morse_relay_mgr(bool server){}
-    void send_blink(uint32_t duration) {
+    static constexpr uint32_t BLINK_DURATION = 50;  // длительность моргания клиента по команде сервера, мс
+    static constexpr uint32_t BLINK_LEAD = 100;     // запас до начала моргания: кадр успевает дойти до всех клиентов, мс
+    static constexpr uint32_t NEVER = UINT32_MAX;
+
+    morse_relay_mgr(bool server) : _server(server) {}
+    template<typename Morse>
+    void set_morse(Morse* morse) {
+        _morse = morse;
+        _enqueue = [](void* context, const char* text, size_t length) { return static_cast<Morse*>(context)->enqueue(text, length); };
+    }
+    // Моргание по kBlink: tick() зажигает и гасит светодиод сам, отдельная задача для led->tick() не нужна.
+    // Не тот светодиод, что у MorseCode: менеджер не знает о передаче Морзе и вмешается в нее
+    void set_led(etl::weak_ptr<etl::led> led) { _led = led; }
+    const clock_sync::estimator<>& sync() const { return _sync; }
+    const rx_queue_t& rx_queue() const { return _rx_queue; }
+    const link_telemetry::telemetry& telemetry() const { return _telemetry; }
+    void reset_telemetry() { _telemetry.reset(); }
+
+    // Отправка кадров: espnow_send_all на плате, loopback в тестах
+    void set_transport(espnow_batch::send_fn send, void* context, espnow_batch::policy_t policy = {}) {
+        _transport = send;
+        _transport_context = context;
+#if ESPNOW_RELIABLE
+        _reliable.begin(send, context, espnow_reliable::config_t{}, &_reliable_stats);
+        _reliable.set_session(espnow_session());
+        _reliable_in.begin(send, context, &_reliable_stats);
+        policy.max_frame_size = espnow_reliable::MAX_PAYLOAD;
+        _batch_tx.begin(reliable_send, this, policy);
+        _batch_tx.set_ready(reliable_ready);
+        _urgent_tx.begin(send, context, policy);
+#else
+        _batch_tx.begin(send, context, policy);
+#endif
+    }
+    void set_log(log_fn log, void* context) {
+        _log = log;
+        _log_context = context;
+    }
+    const batch_sender_t& batch_tx() const { return _batch_tx; }
+    const batch_receiver_t& batch_rx() const { return _batch_rx; }
+#if ESPNOW_RELIABLE
+    const espnow_reliable::sender<ESPNOW_RELIABLE_WINDOW>& reliable() const { return _reliable; }
+#endif
+
+    // Обработка принятых сообщений и отправка накопленного по задержке в контексте loop()
+    void tick() {
+        received_t item;
+        while(_rx_queue.pop(item)) handle(item);
+#if ESPNOW_RELIABLE
+        frame_t frame;
+        while(_frames.pop(frame)) {
+            // Подтверждение - своему окну отправки. Данные - окну приема клиента по MAC, по порядку: сообщения
+            // сразу в обработку, мимо очереди - после дыры их приходит сразу несколько
+            if(_reliable.on_ack(frame.data, frame.length, millis())) continue;
+            _reliable_in.on_data(frame.mac, frame.time, frame.data, frame.length, [this, &frame](const uint8_t* data, size_t length) {
+                received_t item;
+                item.time = frame.time;
+                item.rssi = frame.rssi;
+                _reliable_rx.unpack(frame.mac, frame.time, data, length, [this, &item](const morse_message_t& msg) { item.msg = msg; handle(item); });
+            });
+        }
+#endif
+        uint32_t now = millis();
+        if(_blink_pending && static_cast<int32_t>(now - _blink_at) >= 0) {
+            _blink_pending = false;
+            TRACE(kRelayBlink, _blink_duration, static_cast<int32_t>(now - _blink_at));
+            if(auto led = _led.lock(); led) {
+                led->blink(_blink_duration);
+                _blink_on = true;
+                _blink_off_at = now + _blink_duration;
+            }
+        }
+        if(_blink_on && static_cast<int32_t>(now - _blink_off_at) >= 0) {
+            _blink_on = false;
+            if(auto led = _led.lock(); led) led->tick();      // таймер светодиода истек - погасит
+        }
+        uint32_t frames = _batch_rx.stats().frames + _raw_rx.stats().frames;
+#if ESPNOW_RELIABLE
+        frames += _reliable_rx.stats().frames;
+#endif
+        _telemetry.on_frames(frames, _batch_rx.stats().lost + _raw_rx.stats().lost, now);
+        _telemetry.tick(now);
+        _batch_tx.tick(now);
+#if ESPNOW_RELIABLE
+        _urgent_tx.tick(now);
+        _reliable.tick(now);
+#endif
+    }
+
+    void send(const morse_message_t& msg) {
+        if(_log) _log(_log_context, false, msg, link_telemetry::RSSI_UNKNOWN);
+        TRACE(kRelaySend, msg.id, msg.value);
+#if MORSE_WIRE_FORMAT == 0
+        uint8_t data[morse_wire::LEGACY_SIZE];
+        morse_wire::write_legacy(data, msg);
+        if(_transport) _transport(_transport_context, data, sizeof(data));
+#elif ESPNOW_RELIABLE
+        bool urgent = msg.id == morse_message_t::type_t::kTime || msg.id == morse_message_t::type_t::kBlink;
+        (urgent ? _urgent_tx : _batch_tx).push(msg, millis());
+#else
+        _batch_tx.push(msg, millis());
+#endif
+    }
+    void flush() {
+        _batch_tx.flush();
+#if ESPNOW_RELIABLE
+        _urgent_tx.flush();
+#endif
+    }
+
+    // Мс до запланированного моргания, его конца или повтора кадра, NEVER - ждать нечего
+    uint32_t time_to_next(uint32_t now) const {
+        uint32_t next = NEVER;
+#if ESPNOW_RELIABLE
+        next = _reliable.time_to_next(now);                 // повтор неподтвержденного кадра
+        if(_urgent_tx.time_to_flush(now) < next) next = _urgent_tx.time_to_flush(now);
+#endif
+        auto left = [now](uint32_t at) -> uint32_t { return static_cast<int32_t>(at - now) > 0 ? at - now : 0; };
+        if(_blink_pending && left(_blink_at) < next) next = left(_blink_at);
+        if(_blink_on && left(_blink_off_at) < next) next = left(_blink_off_at);
+        return next;
+    }
+
+    void send_blink(uint32_t duration) { send_blink(duration, millis()); }
+
+    // timestamp - момент начала по часам сервера; у сервера старой прошивки - метка kCount, на который он отвечает
+    void send_blink(uint32_t duration, uint32_t timestamp) {
         morse_message_t msg;
+        msg.timestamp = timestamp;
         msg.id = morse_message_t::type_t::kBlink;
         msg.value = duration;
+        send(msg);
     }
 
-protected:
-    virtual void on_data_recieve(const etl::espnow::endpoint_t& from, const uint8_t *incomingData, int len) override {
-        // Базовая реализация - можно переопределить
-        manager::on_data_recieve(from, incomingData, len);
-        if(auto msg = get_last_received_message(); msg)
+    void send_count(uint32_t count) {
+        morse_message_t msg;
+        msg.timestamp = millis();
+        msg.id = morse_message_t::type_t::kCount;
+        msg.value = count;
+        _telemetry.on_request(msg.timestamp);
+        _sync.on_request(msg.timestamp);
+        send(msg);
+    }
+
+private:
+    // Сервер: kTime с серединой интервала прием..ответ (received - время приема kCount в callback), затем kBlink
+    // с началом через BLINK_LEAD. Кадр уходит сразу: задержка пакетной отправки исказила бы время сервера
+    void reply_count(uint32_t echo, uint32_t received) {
+        uint32_t now = millis();
+        morse_message_t time;
+        time.timestamp = echo;
+        time.id = morse_message_t::type_t::kTime;
+        time.value = received + (now - received) / 2;
+        send(time);
+        uint32_t start = now + BLINK_LEAD;
+        send_blink(BLINK_DURATION, start);
+        flush();
+        schedule_blink(start, BLINK_DURATION);
+    }
+
+    void handle(const received_t& item) {
+        const morse_message_t& msg = item.msg;
+        _telemetry.on_receive(item.rssi);
+        if(_log) _log(_log_context, true, msg, item.rssi);
+        TRACE(kRelayReceive, msg.id, msg.value, item.rssi);
+        if(msg.id == morse_message_t::type_t::kBlink && msg.value > 0)
+        {
+            // do blink in reciever
+            if(_server || !_peer_sync) {
+                if(!_server) _telemetry.on_reply(msg.timestamp, item.time, item.rssi);
+                schedule_blink(item.time, msg.value);
+            }
+            else schedule_blink(_sync.valid() ? _sync.to_local(msg.timestamp) : item.time, msg.value);
+        }
+        else if(msg.id == morse_message_t::type_t::kTime && !_server)
         {
-            if(msg && msg->id == morse_message_t::type_t::kBlink && msg->value > 0)
+            _peer_sync = true;
+            _telemetry.on_reply(msg.timestamp, item.time, item.rssi);
+            _sync.on_reply(msg.timestamp, msg.value, item.time);
+        }
+        else if(msg.id == morse_message_t::type_t::kCount)
+        {
+            if(_morse)
             {
-                // do blink in reciever
-                if(_led) _led->blink(msg->value);       
+                char text[12];
+                int length = snprintf(text, sizeof(text), "%lu", static_cast<unsigned long>(msg.value));
+                if(length > 0) _enqueue(_morse, text, static_cast<size_t>(length));
             }
+            if(_server) reply_count(msg.timestamp, item.time);
+        }
+    }
+
+    void schedule_blink(uint32_t at, uint32_t duration) {
+        _blink_pending = true;
+        _blink_at = at;
+        _blink_duration = duration;
+    }
+
+protected:
+    virtual void on_data_recieve(const etl::espnow::endpoint_t& from, const uint8_t *incomingData, int len) override {
+        // Контекст WiFi callback: поля читаются прямо из incomingData в очередь без блокировок, обработка в tick()
+        // Одиночная структура старых узлов узнается по длине: кадр версии 2 не бывает длиной 12 байт
+        if(!incomingData || len <= 0) return;
+        size_t length = static_cast<size_t>(len);
+        TRACE(kRelayFrame, length, espnow_rssi::read());      // кольцо трассировки допускает несколько писателей
+#if ESPNOW_RELIABLE
+        if(espnow_reliable::is_frame(incomingData, length) && length <= espnow_batch::MAX_FRAME_SIZE) {
+            frame_t frame;
+            memcpy(frame.data, incomingData, length);
+            frame.length = static_cast<uint8_t>(length);
+            memcpy(frame.mac, from.mac, sizeof(frame.mac));
+            frame.time = millis();
+            frame.rssi = espnow_rssi::read();
+            _frames.push(frame);
+            return;
+        }
+#endif
+        received_t item;
+        item.time = millis();
+        item.rssi = espnow_rssi::read();
+        auto push = [this, &item](const morse_message_t& msg) { item.msg = msg; _rx_queue.push(item); };
+        if(length == morse_wire::LEGACY_SIZE) {
+            push(morse_wire::read_legacy(incomingData));
+            return;
+        }
+        switch(espnow_batch::frame_version(incomingData, length))
+        {
+        case morse_wire::compact_codec::VERSION: _batch_rx.unpack(from.mac, item.time, incomingData, length, push); break;
+        case espnow_batch::raw_codec<morse_message_t>::VERSION: _raw_rx.unpack(from.mac, item.time, incomingData, length, push); break;
+        default: break;
         }
     }
 };
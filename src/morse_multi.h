@@ -0,0 +1,277 @@
+#pragma once
+// Многоканальный передатчик азбуки Морзе: N выходов от одного планировщика
+// Вместо N объектов MorseCode со своими GTimer и tick() состояние каналов лежит в массивах (structure of arrays):
+// горячие данные - сроки и уровни - отдельно от холодных (текст, кодировщик). Каналы упорядочены в min-heap по сроку
+// следующего фронта, поэтому tick() без наступивших сроков стоит O(1), а каждый фронт - O(log N), независимо от
+// количества каналов. Расписание фронтов канала - schedule_generator, сроки накапливаются без дрейфа.
+// Выход - любой класс с set(channel, level) и flush(): выводы GPIO или сдвиговые регистры 74HC595.
+//
+//   const uint8_t pins[] = {12, 13, 14};
+//   morse_code::gpio_output output(pins, 3);
+//   morse_code::morse_transmitter<3, morse_code::gpio_output> beacons(output);
+//   beacons.send(0, "VVV", 60, millis(), 5000);      // повтор каждые 5 с
+//   uint32_t task(void*, uint32_t now) { return beacons.tick(now); }
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Arduino.h"
+#include "morse_schedule.h"
+#include "morse_queue.h"
+
+#ifndef MORSE_MESSAGE_SIZE
+#define MORSE_MESSAGE_SIZE  32      // максимальная длина сообщения, байт
+#endif
+
+namespace morse_code {
+
+// Выводы GPIO, по одному на канал
+class gpio_output
+{
+public:
+    gpio_output(const uint8_t* pins, size_t count, bool inverse = false) : pins_(pins), count_(count), inverse_(inverse)
+    {
+        for(size_t i = 0; i < count_; ++i) {
+            pinMode(pins_[i], OUTPUT);
+            digitalWrite(pins_[i], inverse_ ? HIGH : LOW);
+        }
+    }
+
+    void set(size_t channel, bool level) { if(channel < count_) digitalWrite(pins_[channel], (level != inverse_) ? HIGH : LOW); }
+    void flush() {}
+
+private:
+    const uint8_t* pins_;
+    size_t count_;
+    bool   inverse_;
+};
+
+// Цепочка сдвиговых регистров 74HC595: каналы - биты, flush() выдвигает все байты один раз за tick()
+template<size_t Bits>
+class shift_register_output
+{
+public:
+    static constexpr size_t BYTES = (Bits + 7) / 8;
+
+    shift_register_output(uint8_t data_pin, uint8_t clock_pin, uint8_t latch_pin)
+    : data_(data_pin), clock_(clock_pin), latch_(latch_pin)
+    {
+        pinMode(data_, OUTPUT);
+        pinMode(clock_, OUTPUT);
+        pinMode(latch_, OUTPUT);
+        dirty_ = true;
+        flush();
+    }
+
+    void set(size_t channel, bool level)
+    {
+        if(channel >= Bits) return;
+        uint8_t mask = static_cast<uint8_t>(1u << (channel & 7));
+        uint8_t& byte = bytes_[channel >> 3];
+        uint8_t value = level ? (byte | mask) : (byte & ~mask);
+        dirty_ |= value != byte;
+        byte = value;
+    }
+
+    void flush()
+    {
+        if(!dirty_) return;
+        digitalWrite(latch_, LOW);
+        for(size_t i = BYTES; i-- > 0;) {       // первым выдвигается байт дальнего регистра цепочки
+            for(int bit = 7; bit >= 0; --bit) {
+                digitalWrite(data_, (bytes_[i] >> bit) & 1);
+                digitalWrite(clock_, HIGH);
+                digitalWrite(clock_, LOW);
+            }
+        }
+        digitalWrite(latch_, HIGH);
+        dirty_ = false;
+    }
+
+    const uint8_t* bytes() const { return bytes_; }
+
+private:
+    uint8_t data_, clock_, latch_;
+    uint8_t bytes_[BYTES] {};
+    bool    dirty_ = false;
+};
+
+template<size_t N, typename Output>
+class morse_transmitter
+{
+    static_assert(N >= 1 && N < 255, "morse_transmitter: каналов 1..254");
+
+public:
+    static constexpr uint32_t NEVER = UINT32_MAX;
+    static constexpr size_t MAX_EDGES_PER_TICK = 4 * N;     // защита от бесконечного цикла при отставании
+
+    using message_t = text_t<MORSE_MESSAGE_SIZE>;
+
+    explicit morse_transmitter(Output& output) : output_(output) { memset(pos_, NONE, sizeof(pos_)); }
+
+    // Начать передачу на канале, текущая прерывается. repeat_ms > 0 - повторять через паузу repeat_ms после конца
+    bool send(size_t channel, const char* text, uint32_t dit_ms, uint32_t now, uint32_t repeat_ms = 0)
+    {
+        if(channel >= N || dit_ms == 0 || !text) return false;
+        stop(channel);
+        channel_t& c = channels_[channel];
+        c.message.assign(text, strlen(text));
+        c.dit = dit_ms;
+        c.repeat = repeat_ms;
+        restart(channel);
+        deadline_[channel] = now;
+        push(channel);
+        return true;
+    }
+
+    // Остановить канал и погасить выход
+    void stop(size_t channel)
+    {
+        if(channel >= N) return;
+        remove(channel);
+        channels_[channel].generator.reset();
+        channels_[channel].idle = 0;
+        write(channel, false);
+        output_.flush();
+    }
+
+    // Выдать все наступившие фронты. return: время до следующего фронта, мс (NEVER - все каналы молчат)
+    uint32_t tick(uint32_t now)
+    {
+        for(size_t edges = 0; size_ > 0 && edges < MAX_EDGES_PER_TICK; ++edges)
+        {
+            uint8_t channel = heap_[0];
+            if(static_cast<int32_t>(now - deadline_[channel]) < 0) break;
+            run_t run;
+            if(next_run(channel, run)) {
+                write(channel, run.level());
+                deadline_[channel] += run.duration();
+                sift_down(0);
+            }
+            else {
+                write(channel, false);
+                pop_top();
+            }
+        }
+        output_.flush();
+        return time_to_next(now);
+    }
+
+    uint32_t time_to_next(uint32_t now) const
+    {
+        if(size_ == 0) return NEVER;
+        uint32_t deadline = deadline_[heap_[0]];
+        return static_cast<int32_t>(deadline - now) > 0 ? deadline - now : 0;
+    }
+
+    bool is_transmitting(size_t channel) const { return channel < N && pos_[channel] != NONE; }
+    bool level(size_t channel) const { return channel < N && (levels_[channel >> 5] >> (channel & 31)) & 1; }
+    size_t active() const { return size_; }
+
+private:
+    static constexpr uint8_t NONE = 0xFF;
+
+    // Холодные данные канала: нужны только на фронте
+    struct channel_t {
+        message_t          message;
+        string_source      source;
+        schedule_generator generator;
+        uint32_t           dit = 0;
+        uint32_t           repeat = 0;      // пауза перед повтором, мс, 0 - без повтора
+        uint32_t           idle = 0;        // остаток паузы повтора, мс
+    };
+
+    void restart(size_t channel)
+    {
+        channel_t& c = channels_[channel];
+        c.source = string_source(c.message.text, c.message.length);
+        c.generator.start(&c.source, c.dit);
+    }
+
+    // Следующий отрезок канала. false - передача закончена
+    bool next_run(size_t channel, run_t& run)
+    {
+        channel_t& c = channels_[channel];
+        if(!c.idle && c.generator.generate(&run, 1)) return true;
+        if(!c.idle) {
+            if(!c.repeat || !c.message.length) return false;
+            restart(channel);
+            c.idle = c.repeat;              // пауза повтора, дальше - пауза 1 dit перед первым элементом
+        }
+        uint32_t chunk = c.idle < schedule_generator::MAX_RUN_MS ? c.idle : schedule_generator::MAX_RUN_MS;
+        c.idle -= chunk;
+        run = run_t(false, chunk);
+        return true;
+    }
+
+    void write(size_t channel, bool level)
+    {
+        uint32_t& word = levels_[channel >> 5];
+        uint32_t mask = 1u << (channel & 31);
+        if(((word & mask) != 0) == level) return;
+        word ^= mask;
+        output_.set(channel, level);
+    }
+
+    // min-heap по deadline_
+    bool before(uint8_t a, uint8_t b) const { return static_cast<int32_t>(deadline_[a] - deadline_[b]) < 0; }
+
+    void place(size_t index, uint8_t channel) { heap_[index] = channel; pos_[channel] = static_cast<uint8_t>(index); }
+
+    void push(size_t channel)
+    {
+        place(size_, static_cast<uint8_t>(channel));
+        sift_up(size_++);
+    }
+
+    void remove(size_t channel)
+    {
+        uint8_t index = pos_[channel];
+        if(index == NONE) return;
+        pos_[channel] = NONE;
+        if(--size_ == index) return;
+        uint8_t moved = heap_[size_];       // последний элемент кучи встает на место удаленного
+        place(index, moved);
+        sift_up(index);
+        sift_down(pos_[moved]);
+    }
+
+    void pop_top() { remove(heap_[0]); }
+
+    void sift_up(size_t index)
+    {
+        uint8_t channel = heap_[index];
+        while(index > 0) {
+            size_t parent = (index - 1) / 2;
+            if(!before(channel, heap_[parent])) break;
+            place(index, heap_[parent]);
+            index = parent;
+        }
+        place(index, channel);
+    }
+
+    void sift_down(size_t index)
+    {
+        uint8_t channel = heap_[index];
+        for(;;) {
+            size_t child = 2 * index + 1;
+            if(child >= size_ || child >= N) break;
+            if(child + 1 < size_ && child + 1 < N && before(heap_[child + 1], heap_[child])) ++child;
+            if(!before(heap_[child], channel)) break;
+            place(index, heap_[child]);
+            index = child;
+        }
+        place(index, channel);
+    }
+
+    Output&   output_;
+    // Горячие данные: срок следующего фронта, уровни битами, куча
+    uint32_t  deadline_[N] {};
+    uint32_t  levels_[(N + 31) / 32] {};
+    uint8_t   heap_[N] {};
+    uint8_t   pos_[N];                  // место канала в куче, NONE - канал молчит
+    size_t    size_ = 0;
+    channel_t channels_[N];
+};
+
+}// namespace morse_code
@@ -0,0 +1,147 @@
+#pragma once
+// Очередь сообщений фиксированного размера без блокировок: один писатель, один читатель (SPSC)
+// Писатель - callback ESP-NOW, консоль или таймер, читатель - loop() через MorseCode::tick().
+// Память выделяется статически, push() можно вызывать из контекста WiFi callback.
+// При переполнении работает выбранная политика: отбросить новое, отбросить самое старое или схлопнуть одинаковые.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+namespace morse_code {
+
+enum class overflow_t : uint8_t {
+    kDropNewest = 0,    // очередь полна - новое сообщение отбрасывается
+    kDropOldest,        // очередь полна - вытесняется самое старое непереданное сообщение
+    kCoalesce           // повтор последнего ожидающего сообщения не добавляется, при переполнении как kDropNewest
+};
+
+// Счетчики очереди
+struct queue_stats_t {
+    uint32_t pushed     = 0;    // принято в очередь
+    uint32_t dropped    = 0;    // потеряно при переполнении
+    uint32_t coalesced  = 0;    // схлопнуто с ожидающим сообщением
+    uint32_t max_depth  = 0;    // максимальная глубина очереди
+};
+
+// T - копируемая структура без указателей (сообщение копируется в слот), N - степень двойки
+template<typename T, size_t N>
+class spsc_queue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "spsc_queue: размер должен быть степенью двойки");
+
+    T slots_[N] {};
+    std::atomic<uint32_t> head_ {0};    // читатель, при kDropOldest сдвигается и писателем через CAS
+    std::atomic<uint32_t> tail_ {0};    // писатель
+    overflow_t policy_;
+
+    // Счетчики меняет только писатель, читать можно из любого контекста
+    std::atomic<uint32_t> pushed_    {0};
+    std::atomic<uint32_t> dropped_   {0};
+    std::atomic<uint32_t> coalesced_ {0};
+    std::atomic<uint32_t> max_depth_ {0};
+
+public:
+    explicit spsc_queue(overflow_t policy = overflow_t::kDropNewest) : policy_(policy) {}
+
+    void set_policy(overflow_t policy) { policy_ = policy; }
+    overflow_t policy() const { return policy_; }
+
+    static constexpr size_t capacity() { return N; }
+
+    size_t depth() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    bool empty() const { return depth() == 0; }
+
+    queue_stats_t stats() const
+    {
+        queue_stats_t result;
+        result.pushed    = pushed_.load(std::memory_order_relaxed);
+        result.dropped   = dropped_.load(std::memory_order_relaxed);
+        result.coalesced = coalesced_.load(std::memory_order_relaxed);
+        result.max_depth = max_depth_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    // Только писатель. return: false - сообщение не добавлено (отброшено или схлопнуто)
+    bool push(const T& item)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+
+        // Слоты пишет только писатель, поэтому последний записанный можно читать без синхронизации
+        if(policy_ == overflow_t::kCoalesce && tail != head && slots_[(tail - 1) & (N - 1)] == item)
+        {
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if(tail - head >= N)
+        {
+            if(policy_ != overflow_t::kDropOldest) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            // Вытеснить самое старое. Если читатель успел забрать его сам - CAS не пройдет, место уже есть
+            if(head_.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        slots_[tail & (N - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+
+        pushed_.fetch_add(1, std::memory_order_relaxed);
+        uint32_t depth = tail + 1 - head_.load(std::memory_order_relaxed);
+        if(depth > max_depth_.load(std::memory_order_relaxed)) max_depth_.store(depth, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Только читатель. return: false - очередь пуста
+    bool pop(T& item)
+    {
+        uint32_t head = head_.load(std::memory_order_acquire);
+        while(head != tail_.load(std::memory_order_acquire))
+        {
+            item = slots_[head & (N - 1)];
+            // При kDropOldest писатель мог вытеснить и перезаписать слот во время копирования - тогда повторить
+            if(head_.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) return true;
+        }
+        return false;
+    }
+
+    // Только читатель
+    void clear()
+    {
+        T item;
+        while(pop(item)) {}
+    }
+};
+
+// Текст сообщения фиксированной длины для очереди
+template<size_t N>
+struct text_t {
+    char    text[N] {};
+    uint8_t length = 0;
+
+    static_assert(N <= 255, "text_t: длина хранится в uint8_t");
+
+    text_t() = default;
+    text_t(const char* value, size_t size) { assign(value, size); }
+    explicit text_t(const char* value) { assign(value, strlen(value)); }
+
+    // Длинный текст обрезается, UTF-8 символ не разрывается
+    void assign(const char* value, size_t size)
+    {
+        if(size > N) {
+            size = N;
+            while(size > 0 && (static_cast<uint8_t>(value[size]) & 0xC0) == 0x80) --size;
+        }
+        memcpy(text, value, size);
+        length = static_cast<uint8_t>(size);
+    }
+
+    bool operator==(const text_t& other) const { return length == other.length && memcmp(text, other.text, length) == 0; }
+};
+
+}// namespace morse_code
@@ -0,0 +1,148 @@
+#pragma once
+// Расписание фронтов передачи азбуки Морзе
+// Сообщение заранее превращается в последовательность отрезков (уровень, длительность) с теми же интервалами,
+// что у MorseCode::tick(): пауза 1 dit перед первым элементом, после точки/тире 1 dit, пауза символа +3, слова 7.
+// Соседние паузы сливаются в один отрезок. Отрезки проигрывает прерывание таймера (MorseTimedCode),
+// loop() только дописывает следующие отрезки в кольцо, поэтому задержки loop() не растягивают точки и тире.
+
+#include <stdint.h>
+#include <stddef.h>
+#include "morse_encoder.h"
+
+#if !defined(IRAM_ATTR)
+#define IRAM_ATTR
+#endif
+
+namespace morse_code {
+
+// Отрезок: бит 15 - уровень светодиода, биты 0..14 - длительность, мс
+struct run_t {
+    static constexpr uint16_t MAX_DURATION = 0x7FFF;
+
+    uint16_t value = 0;
+
+    run_t() = default;
+    constexpr run_t(bool level, uint32_t duration_ms)
+        : value(static_cast<uint16_t>((level ? 0x8000 : 0) | (duration_ms < MAX_DURATION ? duration_ms : MAX_DURATION))) {}
+
+    constexpr bool level() const { return value & 0x8000; }
+    constexpr uint16_t duration() const { return value & MAX_DURATION; }
+    bool operator==(const run_t& other) const { return value == other.value; }
+};
+
+// Генератор отрезков из потокового кодировщика, выдает порциями по мере освобождения кольца
+class schedule_generator
+{
+public:
+    static constexpr uint32_t MAX_RUN_MS = 16000;     // одно срабатывание таймера ESP8266 timer1 - до ~26 с
+
+    void start(source_t* source, uint32_t dit_ms)
+    {
+        encoder_.start(source);
+        dit_ = dit_ms;
+        off_ = dit_ms;           // пауза перед первым элементом, как в MorseCode::start()
+        on_ = 0;
+        after_on_ = 0;
+        finished_ = false;
+    }
+
+    void reset()
+    {
+        encoder_.reset();
+        off_ = on_ = after_on_ = 0;
+        finished_ = true;
+    }
+
+    bool done() const { return finished_ && on_ == 0 && off_ == 0; }
+
+    // Записать до capacity следующих отрезков. return: записано
+    size_t generate(run_t* out, size_t capacity)
+    {
+        size_t count = 0;
+        while(count < capacity)
+        {
+            if(on_ || finished_)
+            {
+                // Перед включением и в конце передачи - накопленная пауза, длинная режется на части
+                if(off_) {
+                    uint32_t chunk = off_ < MAX_RUN_MS ? off_ : MAX_RUN_MS;
+                    out[count++] = run_t(false, chunk);
+                    off_ -= chunk;
+                    continue;
+                }
+                if(!on_) break;
+                out[count++] = run_t(true, on_);
+                on_ = 0;
+                off_ = after_on_;
+                after_on_ = 0;
+                continue;
+            }
+
+            element_t element;
+            if(!encoder_.next(element)) {
+                if(encoder_.waiting()) break;      // источник пока пуст: пауза тянется, пока не придут данные
+                finished_ = true;
+                continue;
+            }
+            switch(element)
+            {
+            case DOT:   on_ = dit_;     after_on_ = dit_; break;
+            case DASH:  on_ = 3 * dit_; after_on_ = dit_; break;
+            case PAUSE: off_ += 3 * dit_; break;
+            case WDBR:  off_ += 7 * dit_; break;
+            }
+        }
+        return count;
+    }
+
+private:
+    encoder  encoder_;
+    uint32_t dit_ = 0;
+    uint32_t off_ = 0;          // пауза, которая выйдет перед следующим включением
+    uint32_t on_ = 0;           // следующее включение, ждет выдачи паузы
+    uint32_t after_on_ = 0;     // пауза после включения
+    bool     finished_ = true;  // кодировщик закончил сообщение
+};
+
+// Кольцо отрезков: пишет loop(), читает прерывание таймера. N - степень двойки.
+// pop() раскрывается прямо в обработчике прерывания, чтобы весь код обработчика был в IRAM
+template<size_t N>
+class run_ring
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "run_ring: размер должен быть степенью двойки");
+
+public:
+    size_t space() const { return N - (tail_ - head_); }
+    bool empty() const { return tail_ == head_; }
+
+    // Только loop()
+    bool push(run_t run)
+    {
+        uint16_t tail = tail_;
+        if(static_cast<uint16_t>(tail - head_) >= N) return false;
+        runs_[tail & (N - 1)] = run;
+        __atomic_signal_fence(__ATOMIC_RELEASE);
+        tail_ = static_cast<uint16_t>(tail + 1);
+        return true;
+    }
+
+    // Только прерывание или когда таймер остановлен
+    __attribute__((always_inline)) inline bool pop(run_t& run)
+    {
+        uint16_t head = head_;
+        if(head == tail_) return false;
+        __atomic_signal_fence(__ATOMIC_ACQUIRE);
+        run = runs_[head & (N - 1)];
+        head_ = static_cast<uint16_t>(head + 1);
+        return true;
+    }
+
+    void clear() { head_ = tail_; }
+
+private:
+    run_t runs_[N];
+    volatile uint16_t head_ = 0;
+    volatile uint16_t tail_ = 0;
+};
+
+}// namespace morse_code
@@ -0,0 +1,185 @@
+#pragma once
+// Передатчик Морзе без динамической памяти: тот же интерфейс и те же длительности, что у MorseCode,
+// но после конструктора куча не используется.
+//   - текст разбирается в send()/из очереди сразу в элементы, элементы лежат внутри объекта по 2 бита,
+//     поэтому строка вызывающего может умереть сразу после send();
+//   - светодиод - обычная ссылка, без etl::weak_ptr::lock() на каждый tick();
+//   - сроки - millis() в полях объекта, без GTimer.
+// MaxElements - точек, тире и интервалов в одном сообщении; на символ до 8 (7 элементов '$' + интервал).
+// Длинное сообщение обрезается по границе символа.
+//
+//   morse_code::static_morse<256> morse(led, 50);
+//   morse.enqueue("SOS", 3);            // или send(): прервать текущее
+//   for(;;) { morse.tick(); sleep(morse.time_to_next(millis())); }
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Arduino.h"
+#include "etl/etl_led.h"
+#include "morse_encoder.h"
+#include "morse_queue.h"
+
+#ifndef MORSE_QUEUE_SIZE
+#define MORSE_QUEUE_SIZE    8       // сообщений в очереди на передачу, степень двойки
+#endif
+#ifndef MORSE_MESSAGE_SIZE
+#define MORSE_MESSAGE_SIZE  32      // максимальная длина сообщения в очереди, байт
+#endif
+
+namespace morse_code {
+
+template<size_t MaxElements>
+class static_morse
+{
+    static_assert(MaxElements > 0 && MaxElements <= UINT16_MAX, "static_morse: номер элемента хранится в uint16_t");
+
+public:
+    using message_t = text_t<MORSE_MESSAGE_SIZE>;
+    using queue_t   = spsc_queue<message_t, MORSE_QUEUE_SIZE>;
+
+    static constexpr size_t   CAPACITY = MaxElements;
+    static constexpr uint32_t NEVER = UINT32_MAX;
+
+    static_morse(etl::led& led, uint32_t dit_duration_ms = 50) : led_(led), dit_duration_(dit_duration_ms) {}
+
+    // return: длительность передачи, мс; 0 - передавать нечего
+    uint32_t send(const char* text, size_t length)
+    {
+        reset();
+        uint32_t units = load(text, length);
+        if(units > 0) start();
+        return units * dit_duration_;
+    }
+    uint32_t send(const char* text) { return send(text, strlen(text)); }
+
+    // Очередь на передачу: сообщение уходит после завершения текущего, как MorseCode::enqueue()
+    bool enqueue(const char* text, size_t length) { return queue_.push(message_t(text, length)); }
+    queue_t& queue() { return queue_; }
+
+    uint32_t get_duration(const char* text, size_t length) const { return duration_units(text, length) * dit_duration_; }
+
+    void tick()
+    {
+        uint32_t now = millis();
+        if(!transmitting_ && queue_.pop(current_)) {
+            if(load(current_.text, current_.length) > 0) start();
+        }
+        led_.tick();
+        if(!transmitting_ || static_cast<int32_t>(now - next_at_) < 0) return;
+        if(pos_ == count_) {
+            // стоп, все данные переданы
+            transmitting_ = false;
+            is_completed_ = true;
+            return;
+        }
+        switch(element(pos_++)) {
+        case DOT:
+            led_.blink(dit_duration_);
+            schedule_next(now, 2 * dit_duration_, dit_duration_);
+            break;
+        case DASH:
+            led_.blink(3 * dit_duration_);
+            schedule_next(now, 4 * dit_duration_, 3 * dit_duration_);
+            break;
+        case PAUSE:
+            led_.off();
+            schedule_next(now, 3 * dit_duration_, 0);
+            break;
+        case WDBR:
+            led_.off();
+            schedule_next(now, 7 * dit_duration_, 0);
+            break;
+        }
+    }
+
+    // Время до следующего действия в tick(), мс, как MorseCode::time_to_next()
+    uint32_t time_to_next(uint32_t now) const
+    {
+        if(!transmitting_) return queue_.empty() ? NEVER : 0;
+        auto left = [now](uint32_t at) -> uint32_t { return static_cast<int32_t>(at - now) > 0 ? at - now : 0; };
+        uint32_t next = left(next_at_);
+        uint32_t led_off = left(led_off_at_);
+        return (led_off > 0 && led_off < next) ? led_off : next;
+    }
+
+    void reset()
+    {
+        led_.off();
+        transmitting_ = false;
+        is_completed_ = false;
+        count_ = pos_ = 0;
+    }
+
+    bool is_transmitting() const { return transmitting_; }
+    bool is_completed() const { return is_completed_; }
+    size_t size() const { return count_; }              // элементов в текущем сообщении
+    uint32_t truncated() const { return truncated_; }   // сообщений, не поместившихся в MaxElements
+
+private:
+    // Разбор текста в элементы, return: длительность в единицах dit
+    uint32_t load(const char* text, size_t length)
+    {
+        string_source source(text, length);
+        encoder enc(&source);
+        element_t item;
+        uint32_t units = 0, boundary_units = 0;
+        uint16_t boundary = 0;          // конец последнего целого символа
+        count_ = pos_ = 0;
+        while(enc.next(item)) {
+            if(count_ == MaxElements) {
+                ++truncated_;
+                count_ = boundary;
+                return boundary_units;
+            }
+            set_element(count_++, item);
+            units += element_units(item);
+            if(item == PAUSE || item == WDBR) {
+                boundary = count_;
+                boundary_units = units;
+            }
+        }
+        return units;
+    }
+
+    void start()
+    {
+        transmitting_ = true;
+        is_completed_ = false;
+        schedule_next(millis(), dit_duration_, 0);      // первый элемент после паузы в 1 dit
+    }
+
+    void schedule_next(uint32_t now, uint32_t interval_ms, uint32_t led_on_ms)
+    {
+        next_at_ = now + interval_ms;
+        led_off_at_ = led_on_ms ? now + led_on_ms + 1 : now;
+    }
+
+    // 2 бита на элемент: 0 - точка, 1 - тире, 2 - интервал символа, 3 - интервал слов
+    void set_element(size_t index, element_t item)
+    {
+        uint8_t code = item == DOT ? 0 : item == DASH ? 1 : item == PAUSE ? 2 : 3;
+        uint8_t shift = static_cast<uint8_t>((index & 3) * 2);
+        elements_[index >> 2] = static_cast<uint8_t>((elements_[index >> 2] & ~(3u << shift)) | (code << shift));
+    }
+    element_t element(size_t index) const
+    {
+        static constexpr element_t codes[] = {DOT, DASH, PAUSE, WDBR};
+        return codes[(elements_[index >> 2] >> ((index & 3) * 2)) & 3];
+    }
+
+    etl::led& led_;
+    uint32_t  dit_duration_;
+    uint8_t   elements_[(MaxElements + 3) / 4] {};
+    uint16_t  count_ = 0;
+    uint16_t  pos_   = 0;
+    bool      transmitting_ = false;
+    bool      is_completed_ = false;
+    uint32_t  next_at_    = 0;
+    uint32_t  led_off_at_ = 0;
+    uint32_t  truncated_  = 0;
+    queue_t   queue_;
+    message_t current_;
+};
+
+}// namespace morse_code
@@ -0,0 +1,116 @@
+#include "morse_table.h"
+
+namespace morse_code {
+
+namespace {
+
+struct entry_t {
+    char        symbol;
+    const char* code;
+};
+
+// Латиница, цифры и знаки препинания ITU
+constexpr entry_t ascii_codes[] = {
+    {'A', ".-"},    {'B', "-..."},  {'C', "-.-."},  {'D', "-.."},   {'E', "."},
+    {'F', "..-."},  {'G', "--."},   {'H', "...."},  {'I', ".."},    {'J', ".---"},
+    {'K', "-.-"},   {'L', ".-.."},  {'M', "--"},    {'N', "-."},    {'O', "---"},
+    {'P', ".--."},  {'Q', "--.-"},  {'R', ".-."},   {'S', "..."},   {'T', "-"},
+    {'U', "..-"},   {'V', "...-"},  {'W', ".--"},   {'X', "-..-"},  {'Y', "-.--"},
+    {'Z', "--.."},
+    {'1', ".----"}, {'2', "..---"}, {'3', "...--"}, {'4', "....-"}, {'5', "....."},
+    {'6', "-...."}, {'7', "--..."}, {'8', "---.."}, {'9', "----."}, {'0', "-----"},
+    {'.', ".-.-.-"},  {',', "--..--"},  {'?', "..--.."},  {'\'', ".----."},
+    {'!', "-.-.--"},  {'/', "-..-."},   {'(', "-.--."},   {')', "-.--.-"},
+    {'&', ".-..."},   {':', "---..."},  {';', "-.-.-."},  {'=', "-...-"},
+    {'+', ".-.-."},   {'-', "-....-"},  {'_', "..--.-"},  {'"', ".-..-."},
+    {'$', "...-..-"}, {'@', ".--.-."}
+};
+
+// Кириллица в порядке unicode от 'А', последняя - 'Ё'
+constexpr const char* cyrillic_codes[CYRILLIC_TABLE_SIZE] = {
+    ".-",   "-...", ".--",  "--.",  "-..",  ".",    "...-", "--..",     // А Б В Г Д Е Ж З
+    "..",   ".---", "-.-",  ".-..", "--",   "-.",   "---",  ".--.",     // И Й К Л М Н О П
+    ".-.",  "...",  "-",    "..-",  "..-.", "....", "-.-.", "---.",     // Р С Т У Ф Х Ц Ч
+    "----", "--.-", "--.--", "-.--", "-..-", "..-..", "..--", ".-.-",   // Ш Щ Ъ Ы Ь Э Ю Я
+    "."                                                                 // Ё
+};
+
+constexpr table_t make_table()
+{
+    table_t table{};
+    for(const auto& item : ascii_codes) {
+        auto code = make_symbol(item.code);
+        auto index = static_cast<uint8_t>(item.symbol);
+        table.ascii[index] = code;
+        if(item.symbol >= 'A' && item.symbol <= 'Z') {
+            table.ascii[index - 'A' + 'a'] = code;
+        }
+    }
+    for(size_t i = 0; i < CYRILLIC_TABLE_SIZE; ++i) {
+        table.cyrillic[i] = make_symbol(cyrillic_codes[i]);
+    }
+    return table;
+}
+
+constexpr decode_table_t make_decode_table()
+{
+    decode_table_t table{};
+    for(const auto& item : ascii_codes) {
+        auto code = make_symbol(item.code);
+        table.symbol[(1u << code.length) | code.pattern] = item.symbol;
+    }
+    return table;
+}
+
+}// namespace
+
+const table_t code_table PROGMEM = make_table();
+const decode_table_t decode_table PROGMEM = make_decode_table();
+
+symbol_t get_cyrillic_code(uint16_t codepoint)
+{
+    if(codepoint >= 0x0410 && codepoint <= 0x042F) return read_symbol(&code_table.cyrillic[codepoint - 0x0410]);  // А..Я
+    if(codepoint >= 0x0430 && codepoint <= 0x044F) return read_symbol(&code_table.cyrillic[codepoint - 0x0430]);  // а..я
+    if(codepoint == 0x0401 || codepoint == 0x0451) return read_symbol(&code_table.cyrillic[CYRILLIC_YO_INDEX]);    // Ё, ё
+    return symbol_t{};
+}
+
+token_t get_token(uint16_t codepoint, symbol_t& code)
+{
+    if(codepoint < ASCII_TABLE_SIZE)
+    {
+        if(is_word_break(static_cast<char>(codepoint))) return token_t::kWordBreak;
+        code = get_ascii_code(static_cast<char>(codepoint));
+    }
+    else
+    {
+        code = get_cyrillic_code(codepoint);
+    }
+    return code.empty() ? token_t::kSkip : token_t::kSymbol;
+}
+
+token_t next_token(const char*& it, const char* end, symbol_t& code)
+{
+    if(it >= end) return token_t::kEnd;
+
+    auto lead = static_cast<uint8_t>(*it);
+    uint8_t length = utf8_length(lead);
+    if(end - it < length) {
+        it = end;
+        return token_t::kSkip;
+    }
+
+    uint16_t codepoint = lead;
+    if(length == 2) {
+        codepoint = static_cast<uint16_t>(((lead & 0x1F) << 6) | (static_cast<uint8_t>(it[1]) & 0x3F));
+    }
+    else if(length > 2) {
+        it += length;
+        return token_t::kSkip;
+    }
+
+    it += length;
+    return get_token(codepoint, code);
+}
+
+}// namespace morse_code
@@ -0,0 +1,123 @@
+#pragma once
+// Таблица кодов азбуки Морзе (ITU + кириллица), собирается на этапе компиляции и лежит во flash.
+// Каждый код упакован в два байта: длина (количество точек/тире) и битовая маска,
+// младший бит - первый элемент, 1 - тире, 0 - точка.
+// Поиск по символу - прямая индексация O(1), без сканирования и без выделения памяти.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ARDUINO)
+  #include <Arduino.h>    // PROGMEM, pgm_read_byte
+#else
+  #ifndef PROGMEM
+    #define PROGMEM
+  #endif
+  #ifndef pgm_read_byte
+    #define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+  #endif
+#endif
+
+namespace morse_code {
+
+// Упакованный код одного символа
+struct symbol_t {
+    uint8_t length  = 0;    // количество элементов, 0 - символ не поддерживается
+    uint8_t pattern = 0;    // элементы, начиная с младшего бита: 1 - тире, 0 - точка
+
+    constexpr bool empty() const { return length == 0; }
+    constexpr bool is_dash(uint8_t index) const { return (pattern >> index) & 1; }
+};
+
+constexpr uint8_t MAX_SYMBOL_LENGTH = 7;   // самый длинный код ITU: '$' ...-..-
+
+// Разбор строки вида ".-.." в упакованный код, только для constexpr инициализации
+constexpr symbol_t make_symbol(const char* code)
+{
+    symbol_t sym;
+    for(; code[sym.length] != '\0' && sym.length < MAX_SYMBOL_LENGTH; ++sym.length) {
+        if(code[sym.length] == '-') sym.pattern |= static_cast<uint8_t>(1u << sym.length);
+    }
+    return sym;
+}
+
+// Таблицы во flash: ASCII по коду символа, кириллица по номеру буквы от 'А' (U+0410)
+constexpr size_t ASCII_TABLE_SIZE    = 128;
+constexpr size_t CYRILLIC_TABLE_SIZE = 33;      // А..Я + Ё (последняя)
+constexpr size_t CYRILLIC_YO_INDEX   = 32;
+
+struct table_t {
+    symbol_t ascii[ASCII_TABLE_SIZE];
+    symbol_t cyrillic[CYRILLIC_TABLE_SIZE];
+};
+
+extern const table_t code_table;    // PROGMEM
+
+// Обратная таблица для декодирования: индекс - код с единичным битом-маркером перед элементами (1 << length | pattern)
+constexpr size_t DECODE_TABLE_SIZE = 1u << (MAX_SYMBOL_LENGTH + 1);
+
+struct decode_table_t {
+    char symbol[DECODE_TABLE_SIZE];
+};
+
+extern const decode_table_t decode_table;   // PROGMEM
+
+// Чтение упакованного кода из flash
+inline symbol_t read_symbol(const symbol_t* sym)
+{
+    symbol_t result;
+    result.length  = pgm_read_byte(&sym->length);
+    result.pattern = pgm_read_byte(&sym->pattern);
+    return result;
+}
+
+// Код ASCII символа, для строчных и заглавных букв одинаковый
+inline symbol_t get_ascii_code(char ch)
+{
+    auto index = static_cast<uint8_t>(ch);
+    if(index >= ASCII_TABLE_SIZE) return symbol_t{};
+    return read_symbol(&code_table.ascii[index]);
+}
+
+// Символ по коду (латиница в верхнем регистре, цифры, знаки), 0 - код неизвестен
+inline char get_symbol(symbol_t code)
+{
+    if(code.empty() || code.length > MAX_SYMBOL_LENGTH) return 0;
+    size_t index = (1u << code.length) | code.pattern;
+    return static_cast<char>(pgm_read_byte(&decode_table.symbol[index]));
+}
+
+// Код кириллической буквы по unicode (U+0410..U+044F, Ё/ё)
+symbol_t get_cyrillic_code(uint16_t codepoint);
+
+// Разделители слов - интервал 7 единиц
+inline bool is_word_break(char ch)
+{
+    return ch == ' ' || ch == '|' || ch == '\\' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+// Результат разбора очередного символа текста
+enum class token_t : uint8_t {
+    kEnd = 0,       // текст закончился
+    kSymbol,        // символ с кодом
+    kWordBreak,     // разделитель слов
+    kSkip           // неизвестный символ, пропускается
+};
+
+// Длина UTF-8 последовательности по первому байту
+inline uint8_t utf8_length(uint8_t lead)
+{
+    if(lead < 0x80) return 1;
+    if((lead & 0xE0) == 0xC0) return 2;
+    if((lead & 0xF0) == 0xE0) return 3;
+    if((lead & 0xF8) == 0xF0) return 4;
+    return 1;   // оборванная последовательность, пропускаем байт
+}
+
+// Разбор символа по unicode (только ASCII и двухбайтовые UTF-8 коды имеют код Морзе)
+token_t get_token(uint16_t codepoint, symbol_t& code);
+
+// Разбор очередного символа UTF-8 строки [it, end), it сдвигается за прочитанный символ
+token_t next_token(const char*& it, const char* end, symbol_t& code);
+
+}// namespace morse_code
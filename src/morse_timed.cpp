@@ -0,0 +1,171 @@
+#include "morse_timed.h"
+
+MorseTimedCode* MorseTimedCode::active_ = nullptr;
+
+MorseTimedCode::MorseTimedCode(etl::weak_ptr<etl::led> led, uint32_t dit_duration_ms, int pin, bool inverse)
+: MorseCode(led, dit_duration_ms)
+, pin_(pin)
+, inverse_(inverse)
+{
+}
+
+MorseTimedCode::~MorseTimedCode()
+{
+    if(!begun_) return;
+    reset();
+#if defined(ESP8266)
+    timer1_detachInterrupt();
+#elif defined(ESP32)
+    if(timer_) esp_timer_delete(timer_);
+#endif
+    if(active_ == this) active_ = nullptr;
+}
+
+void MorseTimedCode::begin()
+{
+    if(begun_) return;
+    begun_ = true;
+    active_ = this;
+    pinMode(pin_, OUTPUT);
+    write_level(false);
+#if defined(ESP8266)
+    timer1_attachInterrupt(on_timer);
+#elif defined(ESP32)
+    esp_timer_create_args_t args = {};
+    args.callback = [](void*) { on_timer(); };
+    args.name = "morse";
+    esp_timer_create(&args, &timer_);
+#endif
+}
+
+void MorseTimedCode::start(morse_code::source_t* source)
+{
+    begin();
+    generator_.start(source, dit_duration_);
+    transmitting_ = true;
+    is_completed_ = false;
+    refill();
+}
+
+void MorseTimedCode::reset()
+{
+    // Сначала остановить таймер, потом трогать кольцо. До begin() таймера и вывода еще нет
+    if(!begun_) {
+        MorseCode::reset();
+        return;
+    }
+    // esp_timer_stop() не ждет уже идущего обработчика (ESP32 - задача esp_timer, может быть на другом ядре):
+    // под замком обработчик либо закончил pop() и arm(), либо еще не начал и увидит playing_ == false
+    lock();
+    playing_ = false;
+#if defined(ESP8266)
+    timer1_disable();
+#elif defined(ESP32)
+    if(timer_) esp_timer_stop(timer_);
+#endif
+    runs_.clear();
+    unlock();
+    generator_.reset();
+    MorseCode::reset();
+    write_level(false);
+}
+
+void MorseTimedCode::refill()
+{
+    morse_code::run_t batch[8];
+    while(runs_.space() > 0 && !generator_.done())
+    {
+        size_t space = runs_.space();
+        size_t count = generator_.generate(batch, space < 8 ? space : 8);
+        for(size_t i = 0; i < count; ++i) runs_.push(batch[i]);
+        if(count == 0) break;
+    }
+    lock();
+    if(!playing_ && !runs_.empty())
+    {
+        // Первый отрезок или таймер остановился на пустом кольце, пока loop() не успел дописать
+        playing_ = true;
+        arm(0);
+    }
+    unlock();
+}
+
+void MorseTimedCode::tick()
+{
+    if(!led_.lock())
+    {
+        // Светодиод удален - вывод мог получить другой владелец, таймер его больше не трогает
+        if(transmitting_) reset();
+        return;
+    }
+    if(!transmitting_ && queue_.pop(current_))
+    {
+        text_source_ = morse_code::string_source(current_.text, current_.length);
+        start(&text_source_);
+    }
+    if(!transmitting_) return;
+
+    refill();
+#if !defined(ESP8266) && !defined(ESP32)
+    poll_timer();
+#endif
+    if(!playing_ && runs_.empty() && generator_.done())
+    {
+        transmitting_ = false;
+        is_completed_ = true;
+    }
+}
+
+uint32_t MorseTimedCode::time_to_next(uint32_t now) const
+{
+    if(!transmitting_) return (queue_.empty() || !led_.lock()) ? NEVER : 0;
+#if !defined(ESP8266) && !defined(ESP32)
+    uint32_t left = static_cast<int32_t>(run_end_ - now) > 0 ? run_end_ - now : 0;
+    return left < REFILL_INTERVAL ? left : REFILL_INTERVAL;
+#else
+    (void)now;
+    return REFILL_INTERVAL;
+#endif
+}
+
+void IRAM_ATTR MorseTimedCode::write_level(bool on)
+{
+    digitalWrite(pin_, (on != inverse_) ? HIGH : LOW);
+}
+
+void IRAM_ATTR MorseTimedCode::arm(uint32_t delay_ms)
+{
+#if defined(ESP8266)
+    // 80 МГц / 256 = 312.5 тика на мс, счетчик 23 бита - до ~26 с
+    uint32_t ticks = delay_ms * 625 / 2;
+    timer1_enable(TIM_DIV256, TIM_EDGE, TIM_SINGLE);
+    timer1_write(ticks > 10 ? ticks : 10);
+#elif defined(ESP32)
+    esp_timer_start_once(timer_, delay_ms ? delay_ms * 1000ull : 50);
+#else
+    run_end_ = delay_ms ? run_end_ + delay_ms : static_cast<uint32_t>(millis());     // без накопления ошибки
+#endif
+}
+
+void IRAM_ATTR MorseTimedCode::on_timer()
+{
+    MorseTimedCode* self = active_;
+    if(!self) return;
+    self->lock();
+    morse_code::run_t run;
+    if(!self->playing_)
+    {
+        // reset() успел раньше: кольцо уже не наше, таймер не взводить
+    }
+    else if(self->runs_.pop(run))
+    {
+        self->write_level(run.level());
+        self->arm(run.duration());
+    }
+    else
+    {
+        self->write_level(false);
+        self->playing_ = false;
+    }
+    self->unlock();
+}
@@ -0,0 +1,78 @@
+// Передача азбуки Морзе по аппаратному таймеру
+// Тот же интерфейс, что у MorseCode (очередь, send, планировщик), но светодиод переключает таймер по
+// заранее рассчитанному расписанию отрезков (morse_schedule.h). tick() в loop() только дописывает отрезки,
+// поэтому Serial, LittleFS и другие блокировки loop() не искажают длительности точек и тире.
+// ESP8266 - прерывание timer1, ESP32 - esp_timer. На других платформах отрезки проигрывает tick() по millis().
+// Таймер один на всю программу: одновременно работает только один экземпляр. На ESP8266 timer1 занят
+// целиком - analogWrite() и tone() ядра тоже работают на нем, вместе с ними MorseTimedCode не использовать.
+// Конструктор ничего не трогает (экземпляр может быть глобальным), вывод и таймер настраивает begin() в setup().
+#pragma once
+
+#include "morse.h"
+#include "morse_schedule.h"
+
+#if defined(ESP32)
+  #include <esp_timer.h>
+#endif
+
+#ifndef MORSE_RUN_BUFFER
+#define MORSE_RUN_BUFFER    32      // отрезков в кольце, степень двойки: при dit 50 мс это не меньше 1.6 с передачи
+#endif
+
+class MorseTimedCode : public MorseCode
+{
+public:
+    static constexpr uint32_t REFILL_INTERVAL = 100;   // как часто loop() дописывает кольцо во время передачи, мс
+
+    // pin и inverse - тот же светодиод, что у led: таймер управляет выводом напрямую
+    MorseTimedCode(etl::weak_ptr<etl::led> led, uint32_t dit_duration_ms, int pin, bool inverse);
+    ~MorseTimedCode() override;
+
+    // Настроить вывод и создать таймер; повторный вызов ничего не делает, start() вызывает сам
+    void begin();
+
+    void tick() override;
+    void reset() override;
+    uint32_t time_to_next(uint32_t now) const override;
+
+    bool is_playing() const { return playing_; }
+
+#if !defined(ESP8266) && !defined(ESP32)
+    // Программный таймер: проиграть отрезки, срок которых наступил. tick() вызывает сам, тест - еще и посреди
+    // блокировки loop(), как сработало бы прерывание
+    void poll_timer() { while(playing_ && static_cast<int32_t>(millis() - run_end_) >= 0) on_timer(); }
+#endif
+
+protected:
+    void start(morse_code::source_t* source) override;
+
+private:
+    void refill();
+    void write_level(bool on);
+    void arm(uint32_t delay_ms);
+    static void IRAM_ATTR on_timer();
+    // Кольцо и playing_ между loop() и обработчиком таймера. ESP32: обработчик в задаче esp_timer, возможно
+    // на другом ядре - spinlock. ESP8266: прерывание timer1 на том же ядре, его отключает сам reset()
+#if defined(ESP32)
+    void lock() { portENTER_CRITICAL(&mux_); }
+    void unlock() { portEXIT_CRITICAL(&mux_); }
+#else
+    void lock() {}
+    void unlock() {}
+#endif
+
+    static MorseTimedCode* active_;     // обработчик timer1 ESP8266 не принимает аргумент
+
+    morse_code::schedule_generator generator_;
+    morse_code::run_ring<MORSE_RUN_BUFFER> runs_;
+    int  pin_;
+    bool inverse_;
+    bool begun_ = false;
+    volatile bool playing_ = false;     // таймер взведен, отрезки проигрываются
+#if defined(ESP32)
+    esp_timer_handle_t timer_ = nullptr;
+    portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+#elif !defined(ESP8266)
+    uint32_t run_end_ = 0;              // программное проигрывание: конец текущего отрезка, millis()
+#endif
+};
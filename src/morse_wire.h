@@ -0,0 +1,157 @@
+#pragma once
+// Компактный формат сообщений реле по ESP-NOW
+// morse_message_t в памяти занимает 12 байт, из них 3 байта выравнивания, а счетчик и метка времени
+// обычно укладываются в 1-3 байта. Формат версии 2 для кадров espnow_batch:
+//   [5..8]  базовая метка времени кадра, uint32 little endian (метка первого сообщения)
+//   записи: [тип] [varint zigzag(timestamp - timestamp предыдущей записи)] [varint value]
+// varint - 7 бит на байт, старший бит - продолжение (LEB128), не больше 5 байт на uint32.
+// Разбор идет прямо по буферу приема, без копирования кадра и без выравнивания полей.
+//
+// Совместимость при обновлении: узлы на старой прошивке шлют и понимают только одиночную структуру (12 байт),
+// узлы предыдущей версии - еще и кадры версии 1 (структуры подряд). Прием поддерживает все три варианта,
+// отправка выбирается MORSE_WIRE_FORMAT, см. morse_espnow.h. Кадр версии 2 никогда не бывает длиной 12 байт:
+// такой кадр дополняется нулевым байтом, чтобы не путаться с одиночной структурой.
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Структура для сообщений
+struct morse_message_t {
+    enum type_t : uint8_t {
+        kEmpty = 0,
+        kBlink,
+        kCount,
+        kTime       // ответ сервера на kCount: timestamp - метка запроса, value - время сервера, см. clock_sync.h
+    };
+    uint32_t timestamp = 0 ;
+    type_t id = type_t::kEmpty;
+    uint32_t value = 0;
+
+    bool operator==(const morse_message_t& other) const { return id == other.id && value == other.value && timestamp == other.timestamp; }
+};
+
+namespace morse_wire {
+
+constexpr size_t LEGACY_SIZE = 12;          // одиночная структура старых узлов: timestamp, id + 3 байта выравнивания, value
+constexpr size_t MAX_VARINT_SIZE = 5;
+static_assert(sizeof(morse_message_t) == LEGACY_SIZE, "morse_wire: раскладка morse_message_t изменилась, старые узлы ее не поймут");
+
+inline uint32_t read_le32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void write_le32(uint8_t* p, uint32_t value)
+{
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+    p[2] = static_cast<uint8_t>(value >> 16);
+    p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+// Знаковая разность в беззнаковую: 0, -1, 1, -2 ... -> 0, 1, 2, 3 ...
+inline uint32_t zigzag(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+inline int32_t unzigzag(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1); }
+
+// return: записано байт
+inline size_t write_varint(uint8_t* out, uint32_t value)
+{
+    size_t length = 0;
+    while(value >= 0x80) {
+        out[length++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = static_cast<uint8_t>(value);
+    return length;
+}
+
+// return: false, если буфер кончился или число длиннее 5 байт
+inline bool read_varint(const uint8_t*& it, const uint8_t* end, uint32_t& value)
+{
+    value = 0;
+    for(size_t i = 0; i < MAX_VARINT_SIZE && it < end; ++i)
+    {
+        uint8_t byte = *it++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << (7 * i);
+        if(!(byte & 0x80)) return i < MAX_VARINT_SIZE - 1 || byte <= 0x0F;
+    }
+    return false;
+}
+
+// Одиночная структура старых узлов: поля читаются по смещениям, раскладка одинакова на ESP8266 и ESP32
+inline morse_message_t read_legacy(const uint8_t* data)
+{
+    morse_message_t message;
+    message.timestamp = read_le32(data);
+    message.id = static_cast<morse_message_t::type_t>(data[4]);
+    message.value = read_le32(data + 8);
+    return message;
+}
+
+inline void write_legacy(uint8_t* out, const morse_message_t& message)
+{
+    write_le32(out, message.timestamp);
+    out[4] = message.id;
+    out[5] = out[6] = out[7] = 0;
+    write_le32(out + 8, message.value);
+}
+
+// Кодек версии 2 для espnow_batch::sender / receiver
+struct compact_codec {
+    static constexpr uint8_t VERSION = 2;
+    static constexpr size_t  PREFIX_SIZE = 4;
+    static constexpr size_t  MAX_RECORD_SIZE = 1 + 2 * MAX_VARINT_SIZE;
+    static constexpr size_t  MAX_TRAILER_SIZE = 1;
+
+    size_t begin(uint8_t* out, const morse_message_t& first)
+    {
+        write_le32(out, first.timestamp);
+        previous_ = first.timestamp;
+        return PREFIX_SIZE;
+    }
+
+    size_t encode(uint8_t* out, const morse_message_t& message)
+    {
+        size_t length = 0;
+        out[length++] = message.id;
+        length += write_varint(out + length, zigzag(static_cast<int32_t>(message.timestamp - previous_)));
+        length += write_varint(out + length, message.value);
+        previous_ = message.timestamp;
+        return length;
+    }
+
+    size_t finish(uint8_t* out, size_t length)
+    {
+        if(length != LEGACY_SIZE) return 0;
+        *out = 0;
+        return 1;
+    }
+
+    bool begin_read(const uint8_t*& it, const uint8_t* end)
+    {
+        if(end - it < static_cast<ptrdiff_t>(PREFIX_SIZE)) return false;
+        previous_ = read_le32(it);
+        it += PREFIX_SIZE;
+        return true;
+    }
+
+    bool decode(const uint8_t*& it, const uint8_t* end, morse_message_t& message)
+    {
+        if(it >= end) return false;
+        uint8_t id = *it++;
+        uint32_t delta, value;
+        if(!read_varint(it, end, delta) || !read_varint(it, end, value)) return false;
+        previous_ += static_cast<uint32_t>(unzigzag(delta));
+        message.timestamp = previous_;
+        message.id = static_cast<morse_message_t::type_t>(id);     // неизвестные типы пропускает обработчик
+        message.value = value;
+        return true;
+    }
+
+    bool end_read(const uint8_t* it, const uint8_t* end) { return it == end || (end - it == 1 && *it == 0); }
+
+private:
+    uint32_t previous_ = 0;     // метка времени предыдущей записи
+};
+
+}// namespace morse_wire
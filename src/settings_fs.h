@@ -0,0 +1,95 @@
+#pragma once
+// Хранилище settings_store на LittleFS: JSON разбирает ArduinoJson, снимок пишется через временный файл
+// и rename - оборванная запись оставляет прежний снимок.
+//   settings_store::littlefs_storage settings_fs;
+//   settings_store::store<settings_store::littlefs_storage> settings(settings_fs);
+//   LittleFS.begin(); settings.load(millis());          // в loop(): settings.tick(millis())
+
+#include "Arduino.h"
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include "settings_store.h"
+
+namespace settings_store {
+
+class littlefs_storage
+{
+public:
+    static constexpr const char* SETTINGS_JSON = "/config/settings.json";
+    static constexpr const char* VERSION_JSON  = "/config/version.json";
+    static constexpr const char* SNAPSHOT      = "/config/settings.bin";
+    static constexpr const char* SNAPSHOT_TMP  = "/config/settings.tmp";
+
+    // Размер и CRC32 содержимого обоих файлов. Время изменения не годится: без часов при сборке образа
+    // getLastWrite() дает 0, и правка той же длины не сменила бы отпечаток. Файлы - сотни байт, чтение
+    // по 64 байта все равно намного дешевле разбора ArduinoJson
+    uint32_t json_stamp()
+    {
+        uint32_t stamp = 0;
+        uint8_t buffer[64];
+        for(const char* path : {SETTINGS_JSON, VERSION_JSON}) {
+            File file = LittleFS.open(path, "r");
+            if(!file) continue;
+            uint32_t crc = 0;
+            for(size_t n; (n = file.read(buffer, sizeof(buffer))) > 0; ) crc = checksum::crc32(buffer, n, crc);
+            stamp = mix(stamp, static_cast<uint32_t>(file.size()));
+            stamp = mix(stamp, crc);
+        }
+        return stamp;
+    }
+
+    size_t read_snapshot(uint8_t* out, size_t size)
+    {
+        File file = LittleFS.open(SNAPSHOT, "r");
+        if(!file) return 0;
+        if(file.size() != size) return 0;
+        return file.read(out, size);
+    }
+
+    bool write_snapshot(const uint8_t* data, size_t size)
+    {
+        File file = LittleFS.open(SNAPSHOT_TMP, "w");
+        if(!file) return false;
+        bool written = file.write(data, size) == size;
+        file.close();
+        if(!written) return false;
+        return LittleFS.rename(SNAPSHOT_TMP, SNAPSHOT);     // lfs_rename заменяет SNAPSHOT атомарно
+    }
+
+    bool parse_json(settings_t& out)
+    {
+        bool parsed = false;
+        JsonDocument doc;
+        File file = LittleFS.open(SETTINGS_JSON, "r");
+        if(file && !deserializeJson(doc, file)) {
+            copy(out.device_name, doc["device_name"].as<const char*>());     // nullptr - поля нет, остается прежнее
+            copy(out.version, doc["version"].as<const char*>());
+            out.default_brightness = doc["default_brightness"] | out.default_brightness;
+            const char* mode = doc["wifi_mode"] | "";
+            if(strcmp(mode, "STA") == 0)         out.wifi_mode = kSta;
+            else if(strcmp(mode, "AP") == 0)     out.wifi_mode = kAp;
+            else if(strcmp(mode, "AP+STA") == 0) out.wifi_mode = kApSta;
+            parsed = true;
+        }
+        file.close();
+        doc.clear();
+        file = LittleFS.open(VERSION_JSON, "r");
+        if(file && !deserializeJson(doc, file)) {
+            copy(out.build_time, doc["build_time"].as<const char*>());
+            copy(out.board, doc["board"].as<const char*>());
+            parsed = true;
+        }
+        return parsed;
+    }
+
+private:
+    static uint32_t mix(uint32_t stamp, uint32_t value)
+    {
+        // FNV-1a по байтам value; 0 зарезервирован под "файлов нет"
+        if(stamp == 0) stamp = 0x811C9DC5;
+        for(int i = 0; i < 4; ++i) stamp = (stamp ^ ((value >> (8 * i)) & 0xFF)) * 0x01000193;
+        return stamp;
+    }
+};
+
+}// namespace settings_store
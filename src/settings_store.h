@@ -0,0 +1,167 @@
+#pragma once
+// Настройки устройства: двоичный снимок с CRC, при загрузке - одно чтение вместо разбора JSON.
+// Источник правды - config/settings.json и config/version.json. Снимок хранит их отпечаток (stamp:
+// размер и CRC32 содержимого файлов); пока отпечаток совпадает, JSON не разбирается.
+// JSON изменился (uploadfs, правка) или снимок поврежден - разобрать JSON и записать новый снимок.
+// Изменения из прошивки (edit) пишутся только в снимок, отложенно: все правки за write_delay_ms
+// уходят одной записью - меньше износ LittleFS.
+//
+// Storage - доступ к файлам (settings_fs.h для LittleFS, в тестах замена):
+//   uint32_t json_stamp()                            - отпечаток JSON, 0 - файлов нет
+//   size_t   read_snapshot(uint8_t* out, size_t size) - прочитано байт, 0 - снимка нет
+//   bool     write_snapshot(const uint8_t* data, size_t size)
+//   bool     parse_json(settings_t& out)             - заполнить поля, которые есть в JSON
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
+
+namespace settings_store {
+
+enum wifi_mode_t : uint8_t { kSta, kAp, kApSta };
+
+// Хранится в снимке как есть: при изменении полей увеличить LAYOUT
+struct settings_t {
+    char    device_name[32]    = "ESP Web Server";
+    char    version[12]        = "1.0.0";
+    uint8_t wifi_mode          = kApSta;
+    uint8_t default_brightness = 100;
+    char    build_time[32]     = "";         // version.json
+    char    board[24]          = "";
+};
+
+constexpr uint16_t LAYOUT = 1;
+constexpr size_t HEADER_SIZE = 16;
+constexpr size_t SNAPSHOT_SIZE = HEADER_SIZE + sizeof(settings_t);
+
+inline void put32(uint8_t* p, uint32_t v) { for(int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i)); }
+inline uint32_t get32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+
+// Снимок: "STG1", LAYOUT u16, размер settings_t u16, stamp u32, CRC32 (stamp + settings) u32, settings_t
+inline void encode(const settings_t& settings, uint32_t stamp, uint8_t (&out)[SNAPSHOT_SIZE])
+{
+    memcpy(out, "STG1", 4);
+    out[4] = static_cast<uint8_t>(LAYOUT);
+    out[5] = static_cast<uint8_t>(LAYOUT >> 8);
+    out[6] = static_cast<uint8_t>(sizeof(settings_t));
+    out[7] = static_cast<uint8_t>(sizeof(settings_t) >> 8);
+    put32(out + 8, stamp);
+    memcpy(out + HEADER_SIZE, &settings, sizeof(settings_t));
+    uint32_t crc = checksum::crc32(out + 8, 4);
+    put32(out + 12, checksum::crc32(out + HEADER_SIZE, sizeof(settings_t), crc));
+}
+
+// return: false - не снимок, другая раскладка, CRC не сошелся или JSON с тех пор изменился
+inline bool decode(const uint8_t* data, size_t size, uint32_t stamp, settings_t& out)
+{
+    if(size != SNAPSHOT_SIZE || memcmp(data, "STG1", 4) != 0) return false;
+    if((data[4] | (data[5] << 8)) != LAYOUT || (data[6] | (data[7] << 8)) != sizeof(settings_t)) return false;
+    if(get32(data + 8) != stamp) return false;
+    uint32_t crc = checksum::crc32(data + 8, 4);
+    if(checksum::crc32(data + HEADER_SIZE, sizeof(settings_t), crc) != get32(data + 12)) return false;
+    memcpy(&out, data + HEADER_SIZE, sizeof(settings_t));
+    out.device_name[sizeof(out.device_name) - 1] = '\0';
+    out.version[sizeof(out.version) - 1] = '\0';
+    out.build_time[sizeof(out.build_time) - 1] = '\0';
+    out.board[sizeof(out.board) - 1] = '\0';
+    return true;
+}
+
+// Копия строки с обрезкой под поле
+template<size_t N>
+void copy(char (&field)[N], const char* text)
+{
+    if(!text) return;
+    strncpy(field, text, N - 1);
+    field[N - 1] = '\0';
+}
+
+enum class source_t : uint8_t { kDefaults, kSnapshot, kJson };
+
+template<typename Storage>
+class store
+{
+public:
+    static constexpr uint32_t NEVER = UINT32_MAX;
+
+    explicit store(Storage& storage, uint32_t write_delay_ms = 5000)
+        : storage_(storage), write_delay_ms_(write_delay_ms) {}
+
+    // При загрузке: снимок, иначе JSON, иначе значения по умолчанию. Новый снимок пишет tick(), не setup()
+    source_t load(uint32_t now)
+    {
+        stamp_ = storage_.json_stamp();
+        uint8_t raw[SNAPSHOT_SIZE];
+        size_t size = storage_.read_snapshot(raw, sizeof(raw));
+        if(size && decode(raw, size, stamp_, settings_)) {
+            dirty_ = false;
+            return source_ = source_t::kSnapshot;
+        }
+        settings_ = settings_t();
+        source_ = stamp_ && storage_.parse_json(settings_) ? source_t::kJson : source_t::kDefaults;
+        mark_dirty(now, 0);
+        return source_;
+    }
+
+    const settings_t& get() const { return settings_; }
+
+    // Изменить настройки: запись не раньше чем через write_delay_ms после первой несохраненной правки
+    settings_t& edit(uint32_t now)
+    {
+        mark_dirty(now, write_delay_ms_);
+        return settings_;
+    }
+
+    // Отложенная запись. return: мс до записи, NEVER - все сохранено
+    uint32_t tick(uint32_t now)
+    {
+        if(dirty_ && static_cast<int32_t>(now - due_) >= 0) flush();
+        return time_to_next(now);
+    }
+
+    uint32_t time_to_next(uint32_t now) const
+    {
+        if(!dirty_) return NEVER;
+        int32_t left = static_cast<int32_t>(due_ - now);
+        return left > 0 ? static_cast<uint32_t>(left) : 0;
+    }
+
+    // Записать сразу (перед перезагрузкой). return: false - ошибка записи, повтор на следующем tick()
+    bool flush()
+    {
+        if(!dirty_) return true;
+        uint8_t raw[SNAPSHOT_SIZE];
+        encode(settings_, stamp_, raw);
+        ++writes_;
+        if(!storage_.write_snapshot(raw, sizeof(raw))) {
+            due_ += write_delay_ms_;
+            return false;
+        }
+        dirty_ = false;
+        return true;
+    }
+
+    bool     dirty() const { return dirty_; }
+    source_t source() const { return source_; }
+    uint32_t writes() const { return writes_; }
+
+private:
+    void mark_dirty(uint32_t now, uint32_t delay)
+    {
+        if(dirty_) return;          // срок считается от первой правки - частые правки не откладывают запись бесконечно
+        dirty_ = true;
+        due_ = now + delay;
+    }
+
+    Storage&   storage_;
+    settings_t settings_;
+    uint32_t   stamp_ = 0;
+    uint32_t   write_delay_ms_;
+    uint32_t   due_ = 0;
+    uint32_t   writes_ = 0;
+    bool       dirty_ = false;
+    source_t   source_ = source_t::kDefaults;
+};
+
+}// namespace settings_store
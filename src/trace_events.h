@@ -0,0 +1,17 @@
+#pragma once
+// События журнала трассировки (trace_log.h): имя и формат текста, аргументы - целые числа.
+// В формате только %d, %u, %x, %c и %%: текст собирается в свободное время loop() или на компьютере
+// скриптом trace_decode.py, который читает этот файл - одно событие X(имя, "формат") на строку.
+// Новые события - только в конец списка: номер события записан в уже снятых журналах.
+
+#define TRACE_EVENTS(X) \
+    X(kTraceDropped,    "trace: потеряно %u событий, кольцо было полно") \
+    X(kBootReady,       "boot: готово за %u мкс, задач %u") \
+    X(kMorseStart,      "morse: начало, %u мс, dit %u мс") \
+    X(kMorseElement,    "morse: '%c' свет %u dit, пауза %u dit") \
+    X(kMorseDone,       "morse: передача завершена") \
+    X(kMorseError,      "morse: неизвестный элемент %d") \
+    X(kRelayFrame,      "relay: кадр %u байт, rssi %d") \
+    X(kRelaySend,       "relay: отправлено id %u, value %u") \
+    X(kRelayReceive,    "relay: принято id %u, value %u, rssi %d") \
+    X(kRelayBlink,      "relay: моргание %u мс, опоздание %d мс")
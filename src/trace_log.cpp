@@ -0,0 +1,85 @@
+#include "trace_log.h"
+#include <stdio.h>
+
+namespace trace_log {
+
+namespace {
+
+// Форматы событий во flash: строка на событие и таблица указателей на них
+#define TRACE_FORMAT_TEXT_(name, text) const char name##_format[] PROGMEM = text;
+TRACE_EVENTS(TRACE_FORMAT_TEXT_)
+#undef TRACE_FORMAT_TEXT_
+
+const char* const formats[] PROGMEM = {
+#define TRACE_FORMAT_POINTER_(name, text) name##_format,
+    TRACE_EVENTS(TRACE_FORMAT_POINTER_)
+#undef TRACE_FORMAT_POINTER_
+};
+
+static_assert(sizeof(formats) / sizeof(formats[0]) == kEventCount, "trace_log: формат на каждое событие");
+
+}// namespace
+
+const char* format_of(uint16_t id)
+{
+    if(id >= kEventCount) return nullptr;
+    return static_cast<const char*>(pgm_read_ptr(&formats[id]));
+}
+
+size_t format(const record_t& r, char* out, size_t size)
+{
+    if(size == 0) return 0;
+    size_t n = 0;
+    auto append = [&](const char* text) {
+        while(*text && n + 1 < size) out[n++] = *text++;
+    };
+    char number[16];
+    snprintf(number, sizeof(number), "%lu ", static_cast<unsigned long>(r.time_us));
+    append(number);
+
+    const char* fmt = format_of(r.id);
+    if(!fmt) {
+        snprintf(number, sizeof(number), "event %u", unsigned(r.id));
+        append(number);
+        for(uint8_t i = 0; i < r.argc && i < MAX_ARGS; ++i) {
+            snprintf(number, sizeof(number), " %ld", static_cast<long>(r.args[i]));
+            append(number);
+        }
+        out[n] = '\0';
+        return n;
+    }
+
+    // Только целые аргументы: %d, %u, %x, %c; лишние спецификаторы без аргумента печатаются как есть
+    uint8_t arg = 0;
+    for(;; ++fmt) {
+        char ch = static_cast<char>(pgm_read_byte(fmt));
+        if(ch == '\0' || n + 1 >= size) break;
+        if(ch != '%') {
+            out[n++] = ch;
+            continue;
+        }
+        char spec = static_cast<char>(pgm_read_byte(fmt + 1));
+        if(spec == '%') {
+            out[n++] = '%';
+            ++fmt;
+            continue;
+        }
+        if(arg >= r.argc || (spec != 'd' && spec != 'u' && spec != 'x' && spec != 'c')) {
+            out[n++] = '%';
+            continue;
+        }
+        ++fmt;
+        int32_t value = r.args[arg++];
+        switch(spec) {
+        case 'd': snprintf(number, sizeof(number), "%ld", static_cast<long>(value)); break;
+        case 'u': snprintf(number, sizeof(number), "%lu", static_cast<unsigned long>(static_cast<uint32_t>(value))); break;
+        case 'x': snprintf(number, sizeof(number), "%lx", static_cast<unsigned long>(static_cast<uint32_t>(value))); break;
+        default:  number[0] = static_cast<char>(value); number[1] = '\0'; break;
+        }
+        append(number);
+    }
+    out[n] = '\0';
+    return n;
+}
+
+}// namespace trace_log
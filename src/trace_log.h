@@ -0,0 +1,254 @@
+#pragma once
+// Журнал трассировки без блокировок: событие - метка micros(), номер из trace_events.h и до трех целых.
+// TRACE() только кладет событие в кольцо (несколько писателей: loop() и callback WiFi), ничего не форматирует
+// и не ждет Serial. Слот кольца - 24 байта: запись события 20 байт и счетчик хода turn 4 байта.
+// Выгрузка - drain() в свободное время loop(): пишет, пока в буфере передачи UART есть место
+// (availableForWrite), и никогда не блокирует. При переполнении кольца новые события отбрасываются и считаются,
+// в выгрузке на их месте событие kTraceDropped.
+//
+// Выгрузка двоичная (кадры ниже, разбирает trace_decode.py вместе с обычным текстом консоли) или текстовая:
+// форматы лежат во flash (trace_log.cpp), текст собирается при выгрузке в буфере на стеке.
+//
+//   TRACE(kRelaySend, msg.id, msg.value);
+//   trace_log::instance.drain(Serial, trace_log::output_t::kBinary);    // когда loop() простаивает
+//
+// Кадр (little-endian): 0xA5 0x5A, id u16, argc u8, time_us u32, args i32 * argc, сумма байт id..args (u8).
+// При TRACE_LOG=0 макрос ничего не генерирует.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include "Arduino.h"
+#include "trace_events.h"
+
+#if !defined(ARDUINO)
+  #ifndef PROGMEM
+    #define PROGMEM
+  #endif
+  #ifndef pgm_read_byte
+    #define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+  #endif
+  #ifndef pgm_read_ptr
+    #define pgm_read_ptr(addr) (*(const void* const*)(addr))
+  #endif
+#endif
+
+#ifndef TRACE_LOG
+#define TRACE_LOG 1                 // 0 - TRACE() компилируется в пустоту
+#endif
+#ifndef TRACE_LOG_SIZE
+#define TRACE_LOG_SIZE 64           // событий в кольце, степень двойки; слот 24 байта: запись 20 + turn 4
+#endif
+
+namespace trace_log {
+
+enum event_t : uint16_t {
+#define TRACE_EVENT_ID_(name, format) name,
+    TRACE_EVENTS(TRACE_EVENT_ID_)
+#undef TRACE_EVENT_ID_
+    kEventCount
+};
+
+constexpr size_t MAX_ARGS = 3;
+
+struct record_t {
+    uint32_t time_us = 0;
+    uint16_t id      = 0;
+    uint8_t  argc    = 0;
+    int32_t  args[MAX_ARGS] {};
+};
+static_assert(sizeof(record_t) == 20, "trace_log: запись события - 20 байт, с turn слот 24 байта");
+
+constexpr uint8_t SYNC[2] = {0xA5, 0x5A};
+constexpr size_t  FRAME_HEADER = 2 + 2 + 1 + 4;
+constexpr size_t  MAX_FRAME = FRAME_HEADER + 4 * MAX_ARGS + 1;
+
+// Двоичный кадр события, return: длина
+inline size_t encode(const record_t& r, uint8_t* out)
+{
+    size_t n = 0;
+    auto put = [&](uint32_t value, size_t bytes) {
+        for(size_t i = 0; i < bytes; ++i) out[n++] = static_cast<uint8_t>(value >> (8 * i));
+    };
+    out[n++] = SYNC[0];
+    out[n++] = SYNC[1];
+    put(r.id, 2);
+    put(r.argc, 1);
+    put(r.time_us, 4);
+    for(uint8_t i = 0; i < r.argc && i < MAX_ARGS; ++i) put(static_cast<uint32_t>(r.args[i]), 4);
+    uint8_t sum = 0;
+    for(size_t i = 2; i < n; ++i) sum = static_cast<uint8_t>(sum + out[i]);
+    out[n++] = sum;
+    return n;
+}
+
+// Формат события во flash (PROGMEM), nullptr - неизвестный номер
+const char* format_of(uint16_t id);
+
+// Текст события без перевода строки: "время_мкс текст", return: длина (обрезается по size - 1)
+size_t format(const record_t& r, char* out, size_t size);
+
+struct stats_t {
+    uint32_t logged    = 0;     // принято в кольцо
+    uint32_t dropped   = 0;     // отброшено: кольцо полно
+    uint32_t drained   = 0;     // выгружено
+    uint32_t max_depth = 0;
+};
+
+enum class output_t : uint8_t {
+    kOff = 0,       // события копятся и теряются при переполнении, выгрузки нет
+    kText,          // строки по форматам из flash
+    kBinary         // кадры для trace_decode.py
+};
+
+// Кольцо на N событий: несколько писателей, один читатель (ограниченная очередь с номером хода в ячейке).
+// Писатель занимает ячейку CAS-ом хвоста, заполняет и публикует номером; читатель берет только опубликованные.
+template<size_t N>
+class logger
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "trace_log: размер должен быть степенью двойки");
+
+public:
+    logger()
+    {
+        for(size_t i = 0; i < N; ++i) slots_[i].turn.store(static_cast<uint32_t>(i), std::memory_order_relaxed);
+    }
+
+    template<typename... Args>
+    bool event(event_t id, Args... args)
+    {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "trace_log: не больше MAX_ARGS аргументов");
+        const int32_t values[MAX_ARGS + 1] = {static_cast<int32_t>(args)...};
+        return log(id, static_cast<uint8_t>(sizeof...(Args)), values);
+    }
+
+    bool log(uint16_t id, uint8_t argc, const int32_t* args)
+    {
+        uint32_t time = static_cast<uint32_t>(micros());
+        uint32_t pos = tail_.load(std::memory_order_relaxed);
+        slot_t* slot;
+        for(;;) {
+            slot = &slots_[pos & (N - 1)];
+            int32_t diff = static_cast<int32_t>(slot->turn.load(std::memory_order_acquire) - pos);
+            if(diff == 0) {
+                if(tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if(diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else pos = tail_.load(std::memory_order_relaxed);
+        }
+        slot->record.time_us = time;
+        slot->record.id = id;
+        slot->record.argc = argc < MAX_ARGS ? argc : MAX_ARGS;
+        for(size_t i = 0; i < MAX_ARGS; ++i) slot->record.args[i] = i < argc ? args[i] : 0;
+        slot->turn.store(pos + 1, std::memory_order_release);
+
+        logged_.fetch_add(1, std::memory_order_relaxed);
+        uint32_t depth = pos + 1 - head_.load(std::memory_order_relaxed);
+        uint32_t max = max_depth_.load(std::memory_order_relaxed);
+        while(depth > max && !max_depth_.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {}
+        return true;
+    }
+
+    // Только читатель
+    bool pop(record_t& out)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        slot_t& slot = slots_[head & (N - 1)];
+        if(slot.turn.load(std::memory_order_acquire) != head + 1) return false;
+        out = slot.record;
+        slot.turn.store(head + N, std::memory_order_release);
+        head_.store(head + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Выгрузка в свободное время: не больше max_records событий и только пока out.availableForWrite() вмещает
+    // событие целиком. Событие, которому не хватило места, ждет следующего вызова. return: выгружено событий
+    // По умолчанию - все кольцо и сообщение о потерях
+    template<typename Output>
+    size_t drain(Output& out, output_t mode, size_t max_records = N + 1)
+    {
+        if(mode == output_t::kOff) return 0;
+        size_t count = 0;
+        while(count < max_records) {
+            if(!has_pending_) {
+                uint32_t dropped = dropped_.load(std::memory_order_relaxed);
+                if(dropped != reported_dropped_) {
+                    pending_ = record_t{};
+                    pending_.time_us = static_cast<uint32_t>(micros());
+                    pending_.id = kTraceDropped;
+                    pending_.argc = 1;
+                    pending_.args[0] = static_cast<int32_t>(dropped - reported_dropped_);
+                    reported_dropped_ = dropped;
+                }
+                else if(!pop(pending_)) break;
+                has_pending_ = true;
+            }
+            if(mode == output_t::kBinary) {
+                uint8_t frame[MAX_FRAME];
+                size_t length = encode(pending_, frame);
+                if(out.availableForWrite() < static_cast<int>(length)) break;
+                out.write(frame, length);
+            }
+            else {
+                char line[100];
+                size_t length = format(pending_, line, sizeof(line) - 2);
+                line[length++] = '\r';
+                line[length++] = '\n';
+                if(out.availableForWrite() < static_cast<int>(length)) break;
+                out.write(reinterpret_cast<const uint8_t*>(line), length);
+            }
+            has_pending_ = false;
+            ++drained_;
+            ++count;
+        }
+        return count;
+    }
+
+    size_t depth() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed); }
+
+    stats_t stats() const
+    {
+        stats_t result;
+        result.logged    = logged_.load(std::memory_order_relaxed);
+        result.dropped   = dropped_.load(std::memory_order_relaxed);
+        result.drained   = drained_;
+        result.max_depth = max_depth_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    struct slot_t {
+        std::atomic<uint32_t> turn {0};     // pos - свободна для записи хода pos, pos + 1 - опубликована
+        record_t record;
+    };
+
+    slot_t slots_[N];
+    std::atomic<uint32_t> tail_ {0};
+    std::atomic<uint32_t> head_ {0};        // пишет только читатель
+
+    std::atomic<uint32_t> logged_    {0};
+    std::atomic<uint32_t> dropped_   {0};
+    std::atomic<uint32_t> max_depth_ {0};
+    uint32_t drained_ = 0;
+    uint32_t reported_dropped_ = 0;
+    record_t pending_;
+    bool     has_pending_ = false;
+};
+
+using logger_t = logger<TRACE_LOG_SIZE>;
+
+#if TRACE_LOG
+inline logger_t instance;
+#endif
+
+}// namespace trace_log
+
+#if TRACE_LOG
+  #define TRACE(id, ...) trace_log::instance.event(trace_log::id, ##__VA_ARGS__)
+#else
+  #define TRACE(id, ...) do {} while(0)
+#endif
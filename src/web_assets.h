@@ -0,0 +1,192 @@
+#pragma once
+// Раздача веб-интерфейса из одного упакованного файла LittleFS (assets.bin, собирает asset_pack.py)
+// Манифест читается один раз в статический массив, путь ищется двоичным поиском по FNV-1a hash -
+// без обхода каталогов и открытия файлов. Тела уже сжаты gzip и отдаются кусками фиксированного размера
+// через буфер вызывающего кода, без выделения памяти. If-None-Match с текущим ETag - ответ 304 без тела.
+//
+// Reader - File LittleFS или замена: seek(uint32_t) и read(uint8_t*, size_t). Writer - WiFiClient или Print: write(buf, n).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef WEB_ASSETS_MAX
+#define WEB_ASSETS_MAX      32      // файлов в манифесте, 20 байт RAM на файл
+#endif
+#ifndef WEB_ASSETS_CHUNK
+#define WEB_ASSETS_CHUNK    512     // кусок при отдаче тела, байт
+#endif
+
+namespace web_assets {
+
+constexpr uint16_t VERSION     = 1;
+constexpr size_t HEADER_SIZE   = 16;
+constexpr size_t ENTRY_SIZE    = 20;
+constexpr uint8_t FLAG_GZIP    = 1;
+constexpr size_t ETAG_SIZE     = 11;     // "xxxxxxxx" в кавычках и '\0'
+
+// Индексы как в asset_pack.CONTENT_TYPES
+constexpr const char* CONTENT_TYPES[] = {
+    "application/octet-stream",
+    "text/html",
+    "text/css",
+    "application/javascript",
+    "application/json",
+    "image/png",
+    "image/jpeg",
+    "image/svg+xml",
+    "image/x-icon",
+    "text/plain",
+};
+constexpr size_t CONTENT_TYPE_COUNT = sizeof(CONTENT_TYPES) / sizeof(CONTENT_TYPES[0]);
+
+inline const char* content_type(uint8_t type) { return type < CONTENT_TYPE_COUNT ? CONTENT_TYPES[type] : CONTENT_TYPES[0]; }
+
+constexpr uint32_t fnv1a(const char* text, size_t length)
+{
+    uint32_t value = 0x811C9DC5;
+    for(size_t i = 0; i < length; ++i) value = (value ^ static_cast<uint8_t>(text[i])) * 0x01000193;
+    return value;
+}
+
+inline uint32_t read_le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+inline uint16_t read_le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+struct entry_t {
+    uint32_t hash   = 0;
+    uint32_t offset = 0;        // от начала assets.bin
+    uint32_t size   = 0;        // хранимый размер (сжатый, если gzip)
+    uint32_t etag   = 0;        // CRC32 исходного файла
+    uint8_t  type   = 0;
+    uint8_t  flags  = 0;
+
+    bool gzip() const { return flags & FLAG_GZIP; }
+};
+
+// ETag в виде "%08x" с кавычками
+inline void format_etag(uint32_t etag, char (&out)[ETAG_SIZE])
+{
+    snprintf(out, sizeof(out), "\"%08lx\"", static_cast<unsigned long>(etag));
+}
+
+// If-None-Match: "*", один или несколько ETag через запятую, возможно со слабым префиксом W/
+inline bool etag_matches(const char* if_none_match, uint32_t etag)
+{
+    if(!if_none_match || !*if_none_match) return false;
+    char own[ETAG_SIZE];
+    format_etag(etag, own);
+    for(const char* p = if_none_match; *p;)
+    {
+        while(*p == ' ' || *p == ',') ++p;
+        if(*p == '*') return true;
+        if(p[0] == 'W' && p[1] == '/') p += 2;
+        if(strncmp(p, own, ETAG_SIZE - 1) == 0) return true;
+        while(*p && *p != ',') ++p;
+    }
+    return false;
+}
+
+enum class status_t : uint16_t { kOk = 200, kNotModified = 304, kNotFound = 404 };
+
+struct response_t {
+    status_t       status = status_t::kNotFound;
+    const entry_t* entry = nullptr;
+};
+
+class manifest
+{
+public:
+    // Прочитать заголовок и записи. false - не assets.bin или записей больше WEB_ASSETS_MAX
+    template<typename Reader>
+    bool load(Reader& file)
+    {
+        count_ = 0;
+        uint8_t header[HEADER_SIZE];
+        if(!file.seek(0) || file.read(header, HEADER_SIZE) != HEADER_SIZE) return false;
+        if(memcmp(header, "WAST", 4) != 0 || read_le16(header + 4) != VERSION) return false;
+        size_t count = read_le16(header + 6);
+        if(count > WEB_ASSETS_MAX) return false;
+        for(size_t i = 0; i < count; ++i)
+        {
+            uint8_t raw[ENTRY_SIZE];
+            if(file.read(raw, ENTRY_SIZE) != ENTRY_SIZE) return false;
+            entry_t& e = entries_[i];
+            e.hash   = read_le32(raw);
+            e.offset = read_le32(raw + 4);
+            e.size   = read_le32(raw + 8);
+            e.etag   = read_le32(raw + 12);
+            e.type   = raw[16];
+            e.flags  = raw[17];
+            if(i > 0 && e.hash <= entries_[i - 1].hash) return false;     // упаковщик сортирует по hash
+        }
+        count_ = count;
+        return true;
+    }
+
+    // Путь запроса без строки запроса; "/" и каталоги с '/' в конце - index.html
+    const entry_t* find(const char* path, size_t length) const
+    {
+        for(size_t i = 0; i < length; ++i) if(path[i] == '?' || path[i] == '#') { length = i; break; }
+        if(length == 0 || path[length - 1] == '/') {
+            char index[64];
+            static const char name[] = "index.html";
+            if(length + sizeof(name) > sizeof(index)) return nullptr;
+            memcpy(index, path, length);
+            if(length == 0) index[length++] = '/';
+            memcpy(index + length, name, sizeof(name) - 1);
+            return find_hash(fnv1a(index, length + sizeof(name) - 1));
+        }
+        return find_hash(fnv1a(path, length));
+    }
+    const entry_t* find(const char* path) const { return find(path, strlen(path)); }
+
+    const entry_t* find_hash(uint32_t hash) const
+    {
+        size_t lo = 0, hi = count_;
+        while(lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if(entries_[mid].hash < hash) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < count_ && entries_[lo].hash == hash ? &entries_[lo] : nullptr;
+    }
+
+    // Ответ на GET path с заголовком If-None-Match (nullptr - заголовка нет)
+    response_t resolve(const char* path, const char* if_none_match) const
+    {
+        response_t response;
+        response.entry = find(path);
+        if(!response.entry) return response;
+        response.status = etag_matches(if_none_match, response.entry->etag) ? status_t::kNotModified : status_t::kOk;
+        return response;
+    }
+
+    size_t size() const { return count_; }
+    const entry_t& entry(size_t i) const { return entries_[i]; }
+
+private:
+    entry_t entries_[WEB_ASSETS_MAX];
+    size_t  count_ = 0;
+};
+
+// Отдать тело записи кусками через buffer. return: отправлено байт (меньше entry.size - обрыв чтения или записи)
+template<typename Reader, typename Writer>
+size_t stream_body(Reader& file, const entry_t& entry, Writer& out, uint8_t* buffer, size_t buffer_size)
+{
+    if(!file.seek(entry.offset)) return 0;
+    size_t sent = 0;
+    while(sent < entry.size)
+    {
+        size_t left = entry.size - sent;
+        size_t chunk = left < buffer_size ? left : buffer_size;
+        size_t n = file.read(buffer, chunk);
+        if(n == 0) break;
+        size_t written = out.write(buffer, n);
+        sent += written;
+        if(written != n) break;
+    }
+    return sent;
+}
+
+}// namespace web_assets
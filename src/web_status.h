@@ -0,0 +1,238 @@
+#pragma once
+// Статус устройства для веб-интерфейса потоком Server-Sent Events (/api/events) вместо опроса /api/status.
+// Клиент подключается один раз и получает полный снимок, дальше - только изменившиеся поля.
+// Изменения за окно coalesce_ms сливаются в одно событие. uptime изменений не вызывает: браузер считает
+// его сам, а точное значение приходит с каждым событием и с keepalive раз в keepalive_ms (он же держит
+// соединение открытым).
+// События форматируются в буфер на стеке - ни String, ни ArduinoJson, ни выделений памяти.
+//
+// Команды света (/api/cmd) приходят пачкой полей: light=on&brightness=120. Несколько запросов между
+// тиками сливаются в одну команду, применяется последнее значение каждого поля.
+//
+// Client - WiFiClient или замена: write(const uint8_t*, size_t), connected(), stop().
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace web_status {
+
+enum field_t : uint8_t {
+    kWifi       = 1 << 0,
+    kIp         = 1 << 1,
+    kUptime     = 1 << 2,
+    kLight      = 1 << 3,
+    kBrightness = 1 << 4,
+    kAll        = 0x1F,
+};
+
+struct status_t {
+    bool     wifi       = false;
+    uint32_t ip         = 0;        // IPv4 как uint32_t(IPAddress): младший байт - первый октет
+    uint32_t uptime     = 0;        // с
+    bool     light      = false;
+    uint8_t  brightness = 0;
+};
+
+// Изменившиеся поля, кроме uptime
+inline uint8_t diff(const status_t& a, const status_t& b)
+{
+    uint8_t fields = 0;
+    if(a.wifi != b.wifi)             fields |= kWifi;
+    if(a.ip != b.ip)                 fields |= kIp;
+    if(a.light != b.light)           fields |= kLight;
+    if(a.brightness != b.brightness) fields |= kBrightness;
+    return fields;
+}
+
+// JSON с выбранными полями: {"wifi":"connected","ip":"192.168.1.5","uptime":12,"light":1,"brightness":100}
+// return: длина без '\0', 0 - не поместилось
+inline size_t format_json(char* out, size_t size, const status_t& s, uint8_t fields)
+{
+    size_t length = 0;
+    auto put = [&](const char* format, auto... args) {
+        if(length >= size) return;
+        int n = snprintf(out + length, size - length, format, args...);
+        length = n < 0 ? size : length + static_cast<size_t>(n);
+    };
+    put("{");
+    const char* comma = "";
+    if(fields & kWifi)       { put("%s\"wifi\":\"%s\"", comma, s.wifi ? "connected" : "disconnected"); comma = ","; }
+    if(fields & kIp)         { put("%s\"ip\":\"%u.%u.%u.%u\"", comma, unsigned(s.ip & 0xFF), unsigned((s.ip >> 8) & 0xFF),
+                                   unsigned((s.ip >> 16) & 0xFF), unsigned(s.ip >> 24)); comma = ","; }
+    if(fields & kUptime)     { put("%s\"uptime\":%lu", comma, static_cast<unsigned long>(s.uptime)); comma = ","; }
+    if(fields & kLight)      { put("%s\"light\":%u", comma, s.light ? 1u : 0u); comma = ","; }
+    if(fields & kBrightness) { put("%s\"brightness\":%u", comma, unsigned(s.brightness)); }
+    put("}");
+    if(length >= size) return 0;
+    return length;
+}
+
+// Событие SSE: "data: {...}\n\n"
+inline size_t format_event(char* out, size_t size, const status_t& s, uint8_t fields)
+{
+    static const char prefix[] = "data: ";
+    constexpr size_t PREFIX = sizeof(prefix) - 1;
+    if(size < PREFIX + 3) return 0;
+    memcpy(out, prefix, PREFIX);
+    size_t length = format_json(out + PREFIX, size - PREFIX - 2, s, fields);
+    if(length == 0) return 0;
+    length += PREFIX;
+    out[length++] = '\n';
+    out[length++] = '\n';
+    out[length] = '\0';
+    return length;
+}
+
+struct command_t {
+    uint8_t fields     = 0;         // kLight, kBrightness
+    bool    light      = false;
+    uint8_t brightness = 0;
+};
+
+// Одно поле команды из запроса. return: false - неизвестное имя или значение
+inline bool apply_arg(command_t& command, const char* name, const char* value)
+{
+    if(strcmp(name, "light") == 0) {
+        if(strcmp(value, "on") == 0 || strcmp(value, "1") == 0)       command.light = true;
+        else if(strcmp(value, "off") == 0 || strcmp(value, "0") == 0) command.light = false;
+        else return false;
+        command.fields |= kLight;
+        return true;
+    }
+    if(strcmp(name, "brightness") == 0) {
+        char* end = nullptr;
+        long v = strtol(value, &end, 10);
+        if(end == value || *end || v < 0 || v > 255) return false;
+        command.brightness = static_cast<uint8_t>(v);
+        command.fields |= kBrightness;
+        return true;
+    }
+    return false;
+}
+
+// Слить команду в накопленную: поля из newer заменяют старые
+inline void merge(command_t& pending, const command_t& newer)
+{
+    if(newer.fields & kLight)      pending.light = newer.light;
+    if(newer.fields & kBrightness) pending.brightness = newer.brightness;
+    pending.fields |= newer.fields;
+}
+
+template<size_t MaxClients, typename Client>
+class event_stream
+{
+public:
+    static constexpr uint32_t NEVER = UINT32_MAX;
+    static constexpr size_t EVENT_SIZE = 128;
+
+    explicit event_stream(uint32_t coalesce_ms = 200, uint32_t keepalive_ms = 15000)
+        : coalesce_ms_(coalesce_ms), keepalive_ms_(keepalive_ms) {}
+
+    // Новый подписчик получит полный снимок на ближайшем tick(). return: false - нет свободного места
+    bool subscribe(const Client& client, uint32_t now)
+    {
+        for(subscriber_t& s : subscribers_) {
+            if(s.active) continue;
+            s.client  = client;
+            s.active  = true;
+            s.pending = kAll;
+            s.due     = now;
+            s.last    = now;
+            return true;
+        }
+        return false;
+    }
+
+    // Текущий статус: изменения попадут подписчикам не раньше чем через coalesce_ms после прошлого события
+    void publish(const status_t& status, uint32_t now)
+    {
+        uint8_t changed = diff(status_, status);
+        status_ = status;
+        if(!changed) return;
+        for(subscriber_t& s : subscribers_) {
+            if(!s.active) continue;
+            if(!s.pending) {
+                uint32_t earliest = s.last + coalesce_ms_;
+                s.due = static_cast<int32_t>(earliest - now) > 0 ? earliest : now;
+            }
+            s.pending |= changed;
+        }
+    }
+
+    // Отправить созревшие события и keepalive. return: мс до следующего события
+    uint32_t tick(uint32_t now)
+    {
+        for(subscriber_t& s : subscribers_) {
+            if(!s.active) continue;
+            if(!s.pending && now - s.last >= keepalive_ms_) {
+                s.pending = kUptime;
+                s.due = now;
+            }
+            if(!s.pending || static_cast<int32_t>(now - s.due) < 0) continue;
+            char event[EVENT_SIZE];
+            size_t length = format_event(event, sizeof(event), status_, s.pending | kUptime);
+            if(!s.client.connected() || s.client.write(reinterpret_cast<const uint8_t*>(event), length) != length) {
+                drop(s);
+                continue;
+            }
+            sent_bytes_ += length;
+            ++sent_events_;
+            s.pending = 0;
+            s.last = now;
+        }
+        return time_to_next(now);
+    }
+
+    uint32_t time_to_next(uint32_t now) const
+    {
+        uint32_t next = NEVER;
+        for(const subscriber_t& s : subscribers_) {
+            if(!s.active) continue;
+            uint32_t at = s.pending ? s.due : s.last + keepalive_ms_;
+            int32_t left = static_cast<int32_t>(at - now);
+            if(left <= 0) return 0;
+            if(static_cast<uint32_t>(left) < next) next = static_cast<uint32_t>(left);
+        }
+        return next;
+    }
+
+    size_t clients() const
+    {
+        size_t count = 0;
+        for(const subscriber_t& s : subscribers_) count += s.active;
+        return count;
+    }
+
+    const status_t& status() const { return status_; }
+    uint32_t sent_bytes() const { return sent_bytes_; }
+    uint32_t sent_events() const { return sent_events_; }
+
+private:
+    struct subscriber_t {
+        Client   client;
+        bool     active  = false;
+        uint8_t  pending = 0;       // поля, которые еще не отправлены
+        uint32_t due     = 0;       // когда отправить pending
+        uint32_t last    = 0;       // время последнего события
+    };
+
+    void drop(subscriber_t& s)
+    {
+        s.client.stop();
+        s.client = Client();
+        s.active = false;
+        s.pending = 0;
+    }
+
+    subscriber_t subscribers_[MaxClients];
+    status_t     status_;
+    uint32_t     coalesce_ms_;
+    uint32_t     keepalive_ms_;
+    uint32_t     sent_bytes_  = 0;
+    uint32_t     sent_events_ = 0;
+};
+
+}// namespace web_status
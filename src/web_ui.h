@@ -0,0 +1,145 @@
+#pragma once
+// Веб-интерфейс: HTTP-сервер платформы (ESP8266WebServer / WebServer) раздает assets.bin из LittleFS
+// Файл открыт постоянно, манифест в RAM: запрос не открывает файлов и не обходит каталоги.
+// Станция подключается к WIFI_SSID; ESP-NOW при этом работает на канале точки доступа.
+// Статус: /api/events (SSE, только изменения) и /api/status (полный JSON, для браузеров без EventSource).
+// Команды света: /api/cmd?light=on&brightness=120, применяются в tick() одной пачкой через apply_command.
+
+#include "Arduino.h"
+#include <LittleFS.h>
+#if defined(ESP8266)
+  #include <ESP8266WiFi.h>
+  #include <ESP8266WebServer.h>
+#else
+  #include <WiFi.h>
+  #include <WebServer.h>
+#endif
+#include "web_assets.h"
+#include "web_status.h"
+
+namespace web_ui {
+
+#if defined(ESP8266)
+using server_t = ESP8266WebServer;
+#else
+using server_t = WebServer;
+#endif
+
+constexpr const char* ASSETS_PATH = "/assets.bin";
+
+inline server_t server(80);
+inline web_assets::manifest assets;
+inline File assets_file;
+inline uint8_t chunk[WEB_ASSETS_CHUNK];     // общий буфер отдачи: запросы обрабатываются по одному
+
+#ifndef WEB_EVENT_CLIENTS
+#define WEB_EVENT_CLIENTS 4                 // открытых вкладок с потоком статуса
+#endif
+inline web_status::event_stream<WEB_EVENT_CLIENTS, WiFiClient> events;
+inline web_status::status_t status;
+inline web_status::command_t pending_command;
+inline void (*apply_command)(const web_status::command_t&) = nullptr;
+
+inline void handle_asset()
+{
+    String uri = server.uri();
+    String if_none_match = server.header("If-None-Match");
+    auto response = assets.resolve(uri.c_str(), if_none_match.c_str());
+    if(response.status == web_assets::status_t::kNotFound) {
+        server.send(404, "text/plain", "Not found");
+        return;
+    }
+
+    const web_assets::entry_t& entry = *response.entry;
+    char etag[web_assets::ETAG_SIZE];
+    web_assets::format_etag(entry.etag, etag);
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Cache-Control", "no-cache");     // браузер хранит копию, но каждый раз сверяет ETag
+    if(response.status == web_assets::status_t::kNotModified) {
+        server.send(304);
+        return;
+    }
+    if(entry.gzip()) server.sendHeader("Content-Encoding", "gzip");
+    server.setContentLength(entry.size);
+    server.send(200, web_assets::content_type(entry.type), "");
+    auto client = server.client();
+    web_assets::stream_body(assets_file, entry, client, chunk, sizeof(chunk));
+}
+
+// Подписка на поток: заголовки SSE без Content-Length, дальше соединение пишет events.tick().
+// Копия WiFiClient держит сокет открытым после возврата из обработчика (как в примере ServerSentEvents ESP8266)
+inline void handle_events()
+{
+    WiFiClient client = server.client();
+    if(!events.subscribe(client, millis())) {
+        server.send(503, "text/plain", "Too many clients");
+        return;
+    }
+    client.setNoDelay(true);
+    client.print(F("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                   "Connection: keep-alive\r\n\r\nretry: 3000\n\n"));
+}
+
+inline void handle_status()
+{
+    char json[128];
+    web_status::format_json(json, sizeof(json), status, web_status::kAll);
+    server.sendHeader("Cache-Control", "no-cache");
+    server.send(200, "application/json", json);
+}
+
+// Поля команды копятся до tick(): частые запросы ползунка применяются один раз
+inline void handle_command()
+{
+    web_status::command_t command;
+    for(int i = 0; i < server.args(); ++i) {
+        if(server.argName(i) == "plain") continue;      // тело POST целиком
+        if(!web_status::apply_arg(command, server.argName(i).c_str(), server.arg(i).c_str())) {
+            server.send(400, "text/plain", "Bad command");
+            return;
+        }
+    }
+    web_status::merge(pending_command, command);
+    server.send(204);
+}
+
+// return: false - нет assets.bin (загрузите файловую систему: pio run -t uploadfs)
+inline bool begin(void (*apply)(const web_status::command_t&) = nullptr)
+{
+    apply_command = apply;
+    bool loaded = false;
+    if(LittleFS.begin()) {
+        assets_file = LittleFS.open(ASSETS_PATH, "r");
+        loaded = assets_file && assets.load(assets_file);
+    }
+
+    if(WiFi.status() != WL_CONNECTED) WiFi.begin(WIFI_SSID, WIFI_PASS);
+
+    static const char* headers[] = {"If-None-Match"};
+    server.collectHeaders(headers, 1);
+    server.on("/api/events", HTTP_GET, handle_events);
+    server.on("/api/status", HTTP_GET, handle_status);
+    server.on("/api/cmd", handle_command);
+    server.onNotFound(handle_asset);
+    server.begin();
+    return loaded;
+}
+
+// Запросы, накопленные команды и события потока. return: мс до следующего события потока
+inline uint32_t tick(uint32_t now)
+{
+    server.handleClient();
+    if(pending_command.fields) {
+        if(pending_command.fields & web_status::kLight)      status.light = pending_command.light;
+        if(pending_command.fields & web_status::kBrightness) status.brightness = pending_command.brightness;
+        if(apply_command) apply_command(pending_command);
+        pending_command = web_status::command_t();
+    }
+    status.wifi   = WiFi.status() == WL_CONNECTED;
+    status.ip     = status.wifi ? static_cast<uint32_t>(WiFi.localIP()) : 0;
+    status.uptime = now / 1000;
+    events.publish(status, now);
+    return events.tick(now);
+}
+
+}// namespace web_ui
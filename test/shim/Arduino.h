@@ -0,0 +1,134 @@
+#pragma once
+// Минимальная замена Arduino для сборки на компьютере ([env:native])
+// Часы управляются тестом: millis() возвращает arduino_shim::now, delay() двигает их вперед.
+// Serial копит вывод в строку и отдает заранее подложенный ввод.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+
+#ifndef LED_BUILTIN
+#define LED_BUILTIN 2
+#endif
+
+namespace arduino_shim {
+    inline uint32_t now = 0;                // текущее время millis(), мс
+    inline uint8_t  pins[64] {};            // последнее значение digitalWrite()
+
+    inline void set_millis(uint32_t ms) { now = ms; }
+    inline void advance(uint32_t ms) { now += ms; }
+}// namespace arduino_shim
+
+inline unsigned long millis() { return arduino_shim::now; }
+inline unsigned long micros() { return arduino_shim::now * 1000ul; }
+inline void delay(unsigned long ms) { arduino_shim::advance(static_cast<uint32_t>(ms)); }
+inline void yield() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t value) { arduino_shim::pins[pin & 63] = value; }
+inline int  digitalRead(uint8_t pin) { return arduino_shim::pins[pin & 63]; }
+
+// String поверх std::string: только то, чем пользуется прошивка
+class String
+{
+public:
+    String() = default;
+    String(const char* text) : value_(text ? text : "") {}
+    String(const std::string& text) : value_(text) {}
+    String(char ch) : value_(1, ch) {}
+    String(int value) : value_(std::to_string(value)) {}
+    String(unsigned int value) : value_(std::to_string(value)) {}
+    String(long value) : value_(std::to_string(value)) {}
+    String(unsigned long value) : value_(std::to_string(value)) {}
+
+    const char* c_str() const { return value_.c_str(); }
+    unsigned int length() const { return static_cast<unsigned int>(value_.size()); }
+    char operator[](unsigned int index) const { return index < value_.size() ? value_[index] : 0; }
+
+    String& operator+=(const String& other) { value_ += other.value_; return *this; }
+    String& operator+=(const char* other) { value_ += other; return *this; }
+    String& operator+=(char ch) { value_ += ch; return *this; }
+    friend String operator+(String left, const String& right) { return left += right; }
+
+    bool operator==(const String& other) const { return value_ == other.value_; }
+    bool operator==(const char* other) const { return value_ == other; }
+    bool operator!=(const String& other) const { return !(*this == other); }
+
+    const std::string& str() const { return value_; }
+
+private:
+    std::string value_;
+};
+
+class Print
+{
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t ch) = 0;
+    virtual size_t write(const uint8_t* data, size_t size) { for(size_t i = 0; i < size; ++i) write(data[i]); return size; }
+
+    size_t print(const char* text) { return write(reinterpret_cast<const uint8_t*>(text), strlen(text)); }
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t print(char ch) { return write(static_cast<uint8_t>(ch)); }
+    size_t print(int value) { return printf_("%d", value); }
+    size_t print(unsigned int value) { return printf_("%u", value); }
+    size_t print(long value) { return printf_("%ld", value); }
+    size_t print(unsigned long value) { return printf_("%lu", value); }
+    size_t print(double value, int digits = 2) { return printf_("%.*f", digits, value); }
+
+    size_t println() { return print("\r\n"); }
+    template<typename T> size_t println(const T& value) { return print(value) + println(); }
+
+private:
+    template<typename... Args>
+    size_t printf_(const char* format, Args... args)
+    {
+        char buffer[32];
+        int length = snprintf(buffer, sizeof(buffer), format, args...);
+        return length > 0 ? print(buffer) : 0;
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+};
+
+// Serial: вывод копится в output, ввод берется из input
+class HardwareSerial : public Stream
+{
+public:
+    std::string output;
+    std::string input;
+
+    int tx_space = -1;          // свободно в буфере передачи, -1 - без ограничения; write() уменьшает
+
+    void begin(unsigned long) {}
+    size_t write(uint8_t ch) override {
+        output.push_back(static_cast<char>(ch));
+        if(tx_space > 0) --tx_space;
+        return 1;
+    }
+    int availableForWrite() { return tx_space < 0 ? 4096 : tx_space; }
+    using Print::write;
+    int available() override { return static_cast<int>(input.size() - read_pos_); }
+    int read() override { return read_pos_ < input.size() ? static_cast<uint8_t>(input[read_pos_++]) : -1; }
+
+    void feed(const std::string& text) { input.erase(0, read_pos_); read_pos_ = 0; input += text; }
+    std::string take() { std::string result; result.swap(output); return result; }
+
+private:
+    size_t read_pos_ = 0;
+};
+
+inline HardwareSerial Serial;
@@ -0,0 +1,49 @@
+#pragma once
+// Замена GTimer (GyverLibs) для [env:native]: тот же интерфейс, что использует прошивка
+
+#include <stdint.h>
+
+enum class GTMode : uint8_t {
+    Timeout,    // сработать один раз и остановиться
+    Interval    // срабатывать периодически
+};
+
+template<unsigned long (*clock)()>
+class GTimer
+{
+public:
+    GTimer() = default;
+    GTimer(uint32_t time, bool start_now = false, GTMode mode = GTMode::Interval) : time_(time), mode_(mode)
+    {
+        if(start_now) start();
+    }
+
+    void start(uint32_t time, GTMode mode = GTMode::Interval)
+    {
+        time_ = time;
+        mode_ = mode;
+        start();
+    }
+    void start()
+    {
+        begin_ = static_cast<uint32_t>(clock());
+        running_ = true;
+    }
+    void stop() { running_ = false; }
+    bool running() const { return running_; }
+
+    // return: true - время истекло
+    bool tick()
+    {
+        if(!running_ || static_cast<uint32_t>(clock()) - begin_ < time_) return false;
+        if(mode_ == GTMode::Timeout) running_ = false;
+        else begin_ += time_;
+        return true;
+    }
+
+private:
+    uint32_t begin_ = 0;
+    uint32_t time_ = 0;
+    GTMode   mode_ = GTMode::Interval;
+    bool     running_ = false;
+};
@@ -0,0 +1,79 @@
+#pragma once
+// Замена LittleFS для сборки на компьютере: файлы "/name" лежат в каталоге root на диске.
+// Интерфейс - подмножество fs::FS/fs::File Arduino, которым пользуются message_journal и settings_fs.
+// Счетчики open/write/bytes_written - для бенчмарков: сколько операций с флешем досталось бы LittleFS.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class dir_fs
+{
+public:
+    struct stats_t {
+        uint32_t opens = 0;
+        uint32_t writes = 0;
+        uint64_t bytes_written = 0;
+    };
+
+    class File
+    {
+    public:
+        File() = default;
+        File(FILE* f, stats_t* stats) : f_(f), stats_(stats) {}
+        File(File&& other) noexcept : f_(other.f_), stats_(other.stats_) { other.f_ = nullptr; }
+        File& operator=(File&& other) noexcept { close(); f_ = other.f_; stats_ = other.stats_; other.f_ = nullptr; return *this; }
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+        ~File() { close(); }
+
+        explicit operator bool() const { return f_ != nullptr; }
+        size_t write(const uint8_t* data, size_t size) {
+            if(!f_) return 0;
+            ++stats_->writes;
+            size_t n = fwrite(data, 1, size, f_);
+            stats_->bytes_written += n;
+            return n;
+        }
+        size_t read(uint8_t* out, size_t size) { return f_ ? fread(out, 1, size, f_) : 0; }
+        bool seek(uint32_t pos) { return f_ && fseek(f_, static_cast<long>(pos), SEEK_SET) == 0; }
+        size_t size() {
+            if(!f_) return 0;
+            long pos = ftell(f_);
+            fseek(f_, 0, SEEK_END);
+            long end = ftell(f_);
+            fseek(f_, pos, SEEK_SET);
+            return static_cast<size_t>(end);
+        }
+        void flush() { if(f_) fflush(f_); }
+        void close() { if(f_) fclose(f_); f_ = nullptr; }
+
+    private:
+        FILE*    f_ = nullptr;
+        stats_t* stats_ = nullptr;
+    };
+
+    explicit dir_fs(const std::string& root) : root_(root) { mkdir(root_.c_str(), 0755); }
+
+    // mode как у LittleFS: "r", "w" (с нуля), "a" (дописать)
+    File open(const char* path, const char* mode) {
+        ++stats_.opens;
+        std::string m = std::string(mode) + "b";
+        return File(fopen(full(path).c_str(), m.c_str()), &stats_);
+    }
+    bool exists(const char* path) const { struct stat st; return stat(full(path).c_str(), &st) == 0; }
+    bool remove(const char* path) { return unlink(full(path).c_str()) == 0; }
+    bool rename(const char* from, const char* to) { return ::rename(full(from).c_str(), full(to).c_str()) == 0; }
+
+    const stats_t& stats() const { return stats_; }
+    void reset_stats() { stats_ = stats_t(); }
+
+private:
+    std::string full(const char* path) const { return root_ + (path[0] == '/' ? "" : "/") + path; }
+
+    std::string root_;
+    stats_t     stats_;
+};
@@ -0,0 +1,183 @@
+#pragma once
+// Модель эфира ESP-NOW для [env:native]: узлы etl::espnow::manager<T> (замена) с MAC-адресами плат,
+// общий канал с битовой скоростью, задержка, разброс задержки (кадры обгоняют друг друга) и потери по
+// зерну генератора - один и тот же прогон дает одни и те же кадры в те же моменты.
+// Отправка - send_fn с контекстом узла (подставляется в morse_relay_mgr::set_transport вместо espnow_send_all),
+// прием - manager::deliver(), как из callback WiFi. Время callback-ов приема меряется (нс процессора).
+//
+//   espnow_medium::medium<morse_message_t> air(config);
+//   size_t a = air.attach(esp_board::WEMOS_D1_Mini_v4_s001, client), b = air.attach(..., server);
+//   air.add_peer(a, b); air.add_peer(b, a);                 // без пиров кадр слышат все узлы
+//   client.set_transport(air.transport(), air.port(a));
+//   air.deliver_until(now_us);                              // выдать кадры, дошедшие к моменту now_us
+//
+// Кадр занимает эфир (длина + overhead_bytes) * 8 / bitrate; пока эфир занят, следующий кадр ждет (CSMA).
+// У узла не больше tx_queue кадров в ожидании эфира, дальше send возвращает false (ESP_ERR_ESPNOW_NO_MEM).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <random>
+#include <vector>
+#include "etl/etl_espnow.h"
+
+namespace espnow_medium {
+
+using send_fn = bool (*)(void* context, const uint8_t* data, size_t length);
+
+struct link_t {
+    double   loss      = 0;         // доля потерянных кадров
+    uint32_t delay_us  = 1000;      // после окончания передачи
+    uint32_t jitter_us = 0;         // + равномерно 0..jitter_us
+};
+
+struct config_t {
+    uint32_t seed           = 1;
+    uint32_t bitrate        = 1000000;  // ESP-NOW по умолчанию 1 Мбит/с
+    uint32_t overhead_bytes = 50;       // заголовки 802.11, vendor action, преамбула
+    uint32_t tx_queue       = 8;        // кадров узла, ждущих эфира; 0 - без ограничения
+    link_t   link;                      // для всех пар, если не задано set_link()
+};
+
+struct stats_t {
+    uint32_t sent         = 0;          // кадров, переданных в эфир
+    uint32_t addressed    = 0;          // копий кадров адресатам: кадр сервера уходит всем его клиентам
+    uint32_t rejected     = 0;          // send вернул false: очередь узла полна
+    uint32_t delivered    = 0;          // кадров, выданных узлам
+    uint32_t lost         = 0;
+    uint32_t reordered    = 0;          // выдан раньше кадра, отправленного до него тем же узлом
+    uint64_t bytes        = 0;
+    uint64_t air_us       = 0;          // занятость эфира
+    uint64_t callback_ns  = 0;          // сумма времени callback-ов приема
+    uint64_t callback_max_ns = 0;
+};
+
+template<typename T>
+class medium
+{
+public:
+    using node_t = etl::espnow::manager<T>;
+
+    explicit medium(config_t config = {}) : config_(config), rng_(config.seed) {}
+
+    // return: номер узла
+    size_t attach(const etl::espnow::endpoint_t& mac, node_t& node)
+    {
+        ports_.push_back({this, ports_.size(), mac, &node, {}, {}});
+        return ports_.size() - 1;
+    }
+    void add_peer(size_t from, size_t to) { ports_[from].peers.push_back(to); }
+    void set_link(size_t from, size_t to, link_t link) { links_[{from, to}] = link; }
+
+    // Передача узла index: morse_relay_mgr::set_transport(air.transport(), air.port(index))
+    send_fn transport() const { return &medium::send; }
+    void* port(size_t index) { return &ports_[index]; }
+
+    // Текущее время модели: отправки в этот момент занимают эфир не раньше now_us
+    void set_time(uint64_t now_us) { now_us_ = now_us; }
+
+    // Выдать узлам кадры, дошедшие к now_us, по времени прихода
+    void deliver_until(uint64_t now_us)
+    {
+        now_us_ = now_us;
+        while(!queue_.empty()) {
+            auto it = std::min_element(queue_.begin(), queue_.end(),
+                                       [](const packet_t& a, const packet_t& b) { return a.at < b.at || (a.at == b.at && a.order < b.order); });
+            if(it->at > now_us) break;
+            packet_t packet = std::move(*it);
+            queue_.erase(it);
+            port_t& to = ports_[packet.to];
+            uint64_t& last = last_order_[{packet.from, packet.to}];
+            if(packet.order < last) ++stats_.reordered;
+            else last = packet.order;
+            ++stats_.delivered;
+            auto start = std::chrono::steady_clock::now();
+            to.node->deliver(ports_[packet.from].mac, packet.data.data(), static_cast<int>(packet.data.size()));
+            uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            stats_.callback_ns += ns;
+            stats_.callback_max_ns = std::max(stats_.callback_max_ns, ns);
+        }
+    }
+
+    size_t in_flight() const { return queue_.size(); }
+    uint64_t air_free_us() const { return air_free_us_; }
+    const stats_t& stats() const { return stats_; }
+
+private:
+    struct port_t {
+        medium*                   owner;
+        size_t                    index;
+        etl::espnow::endpoint_t   mac;
+        node_t*                   node;
+        std::vector<size_t>       peers;
+        std::deque<uint64_t>      backlog;      // окончания передачи кадров в очереди узла
+    };
+    struct packet_t {
+        uint64_t at;
+        uint64_t order;             // номер отправки: обгон считается по нему
+        size_t   from, to;
+        std::vector<uint8_t> data;
+    };
+
+    static bool send(void* context, const uint8_t* data, size_t length)
+    {
+        port_t& port = *static_cast<port_t*>(context);
+        return port.owner->transmit(port, data, length);
+    }
+
+    bool transmit(port_t& from, const uint8_t* data, size_t length)
+    {
+        while(!from.backlog.empty() && from.backlog.front() <= now_us_) from.backlog.pop_front();
+        if(config_.tx_queue && from.backlog.size() >= config_.tx_queue) {
+            ++stats_.rejected;
+            return false;
+        }
+        ++stats_.sent;
+        stats_.bytes += length;
+        uint64_t air = (static_cast<uint64_t>(length) + config_.overhead_bytes) * 8 * 1000000 / config_.bitrate;
+        uint64_t start = std::max(now_us_, air_free_us_);
+        air_free_us_ = start + air;
+        stats_.air_us += air;
+        from.backlog.push_back(air_free_us_);
+        uint64_t order = ++sent_order_;
+        auto to_peer = [&](size_t to) {
+            const link_t& link = link_for(from.index, to);
+            ++stats_.addressed;
+            if(uniform() < link.loss) {
+                ++stats_.lost;
+                return;
+            }
+            uint64_t at = air_free_us_ + link.delay_us + static_cast<uint64_t>(uniform() * link.jitter_us);
+            queue_.push_back({at, order, from.index, to, std::vector<uint8_t>(data, data + length)});
+        };
+        if(from.peers.empty()) {
+            for(size_t to = 0; to < ports_.size(); ++to) if(to != from.index) to_peer(to);
+        }
+        else for(size_t to : from.peers) to_peer(to);
+        return true;
+    }
+
+    const link_t& link_for(size_t from, size_t to) const
+    {
+        auto it = links_.find({from, to});
+        return it != links_.end() ? it->second : config_.link;
+    }
+
+    double uniform() { return std::uniform_real_distribution<double>(0, 1)(rng_); }
+
+    config_t                config_;
+    std::mt19937            rng_;
+    std::deque<port_t>      ports_;     // адреса портов не меняются при attach()
+    std::map<std::pair<size_t, size_t>, link_t>   links_;
+    std::map<std::pair<size_t, size_t>, uint64_t> last_order_;
+    std::vector<packet_t>   queue_;
+    uint64_t                now_us_ = 0;
+    uint64_t                air_free_us_ = 0;
+    uint64_t                sent_order_ = 0;
+    stats_t                 stats_;
+};
+
+}// namespace espnow_medium
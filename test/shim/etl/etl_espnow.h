@@ -0,0 +1,54 @@
+#pragma once
+// Замена etl::espnow для [env:native]: без радио, принятые данные подает тест через deliver()
+
+#include "Arduino.h"
+#include <string.h>
+
+namespace etl {
+namespace espnow {
+
+struct endpoint_t {
+    uint8_t mac[6] {};
+
+    endpoint_t() = default;
+    explicit endpoint_t(const char* text)
+    {
+        unsigned int bytes[6] {};
+        if(sscanf(text, "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5]) == 6) {
+            for(int i = 0; i < 6; ++i) mac[i] = static_cast<uint8_t>(bytes[i]);
+        }
+    }
+    bool operator==(const endpoint_t& other) const { return memcmp(mac, other.mac, sizeof(mac)) == 0; }
+};
+
+namespace board {
+    inline String get_mac_address() { return String("00:00:00:00:00:00"); }
+}// namespace board
+
+template<typename T>
+class manager
+{
+public:
+    virtual ~manager() = default;
+
+    const T* get_last_received_message() const { return has_last_ ? &last_ : nullptr; }
+
+    // Только в замене: принять данные, как из callback ESP-NOW
+    void deliver(const endpoint_t& from, const uint8_t* data, int len) { on_data_recieve(from, data, len); }
+
+protected:
+    // Базовая реализация: сообщение ровно размера T копируется как есть
+    virtual void on_data_recieve(const endpoint_t& from, const uint8_t* data, int len)
+    {
+        (void)from;
+        has_last_ = len == static_cast<int>(sizeof(T));
+        if(has_last_) memcpy(&last_, data, sizeof(T));
+    }
+
+private:
+    T    last_ {};
+    bool has_last_ = false;
+};
+
+}// namespace espnow
+}// namespace etl
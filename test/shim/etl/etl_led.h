@@ -0,0 +1,55 @@
+#pragma once
+// Замена etl::led для [env:native]: светодиод записывает состояние в arduino_shim::pins и считает вызовы
+
+#include "Arduino.h"
+#include "etl/etl_memory.h"
+
+namespace etl {
+
+class led
+{
+public:
+    led(int pin, bool on = false, bool inverse = false) : pin_(pin), inverse_(inverse) { set(on); }
+
+    void on()  { set(true); blink_until_ = 0; }
+    void off() { set(false); blink_until_ = 0; }
+    bool is_on() const { return on_; }
+
+    void blink(uint32_t duration)
+    {
+        ++blinks_;
+        set(true);
+        blink_until_ = millis() + duration;
+        if(blink_until_ == 0) blink_until_ = 1;
+    }
+
+    // return: true - моргание закончилось на этом вызове
+    bool tick()
+    {
+        if(!blink_until_ || static_cast<int32_t>(millis() - blink_until_) < 0) return false;
+        set(false);
+        blink_until_ = 0;
+        return true;
+    }
+
+    void init_pwm(int, uint32_t, int) {}
+    void fade_in(uint32_t) { set(true); }
+    void fade_out(uint32_t) { set(false); }
+
+    uint32_t blinks() const { return blinks_; }     // только в замене: сколько раз вызван blink()
+
+private:
+    void set(bool on)
+    {
+        on_ = on;
+        digitalWrite(static_cast<uint8_t>(pin_), (on != inverse_) ? HIGH : LOW);
+    }
+
+    int      pin_;
+    bool     inverse_;
+    bool     on_ = false;
+    uint32_t blink_until_ = 0;
+    uint32_t blinks_ = 0;
+};
+
+}// namespace etl
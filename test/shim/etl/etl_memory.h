@@ -0,0 +1,12 @@
+#pragma once
+// Замена умных указателей etl для [env:native]: поведение совпадает с std
+
+#include <memory>
+
+namespace etl {
+    using std::shared_ptr;
+    using std::weak_ptr;
+    using std::unique_ptr;
+    using std::make_shared;
+    using std::make_unique;
+}// namespace etl
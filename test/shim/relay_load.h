@@ -0,0 +1,172 @@
+#pragma once
+// Генератор нагрузки для morse_relay_mgr на модели эфира (espnow_medium.h): servers групп, в каждой сервер
+// и clients клиентов, у всех узлов свои MAC. Каждый клиент шлет kCount с частотой rate_hz, сервер отвечает
+// kTime + kBlink всем клиентам группы, как на платах (espnow_send_all по списку пиров).
+// tick() узлов вызывается как задачей "relay" в main.cpp: не реже poll_ms, раньше - к сроку пакетной
+// отправки, повтора или моргания. Часы одни на всех (arduino_shim), прогон детерминирован зерном эфира.
+//
+// Итог прогона: сообщений в секунду, задержка kCount от send_count() до обработки на сервере (перцентили),
+// доставка (общая и худшего клиента), занятость эфира, процессорное время callback приема и tick() на компьютере.
+// Сравнение протоколов: тот же сценарий до и после изменения (например, с -D ESPNOW_RELIABLE=1).
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "morse_espnow.h"
+#include "espnow_medium.h"
+
+namespace relay_load {
+
+struct scenario_t {
+    const char* name        = "";
+    size_t      servers     = 1;
+    size_t      clients     = 1;        // клиентов у каждого сервера
+    double      rate_hz     = 10;       // kCount в секунду от каждого клиента
+    uint32_t    duration_ms = 10000;
+    uint32_t    drain_ms    = 2000;     // после - без новых сообщений, дождаться ответов
+    uint32_t    poll_ms     = 20;       // POLL_INTERVAL в main.cpp
+    espnow_batch::policy_t  policy;
+    espnow_medium::config_t medium;
+};
+
+struct report_t {
+    uint32_t sent       = 0;            // kCount от клиентов
+    uint32_t received   = 0;            // kCount обработано серверами
+    uint32_t replies    = 0;            // kTime и kBlink обработано клиентами
+    double   msgs_per_s = 0;            // (received + replies) за duration_ms
+    double   p50_ms = 0, p90_ms = 0, p99_ms = 0, max_ms = 0;
+    double   delivered_pct = 0;         // received / sent
+    double   worst_client_pct = 0;      // доставка kCount клиента, у которого она хуже всех
+    double   air_pct = 0;               // занятость эфира за весь прогон
+    double   callback_ns = 0;           // среднее на кадр
+    double   callback_max_ns = 0;
+    double   tick_ns = 0;               // среднее на вызов tick()
+    size_t   in_flight = 0;             // кадров в эфире в конце прогона
+    espnow_medium::stats_t medium;
+    std::vector<uint32_t> latency_ms;   // все задержки по порядку приема, для сравнения прогонов
+    std::vector<uint32_t> client_sent, client_received;     // по клиентам
+    std::vector<size_t>   origin;       // номер клиента по значению kCount
+};
+
+namespace detail {
+    struct node_t {
+        morse_relay_mgr relay;
+        uint32_t next_tick = 0;
+        report_t* report = nullptr;
+        explicit node_t(bool server) : relay(server) {}
+    };
+
+    inline void on_log(void* context, bool received, const morse_message_t& msg, int8_t)
+    {
+        if(!received) return;
+        report_t& r = *static_cast<report_t*>(context);
+        if(msg.id == morse_message_t::type_t::kCount) {
+            ++r.received;
+            if(msg.value < r.origin.size()) ++r.client_received[r.origin[msg.value]];
+            r.latency_ms.push_back(static_cast<uint32_t>(millis()) - msg.timestamp);   // метка - millis() отправки
+        }
+        else ++r.replies;
+    }
+
+    inline double percentile(std::vector<uint32_t> v, double p)
+    {
+        if(v.empty()) return 0;
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, static_cast<size_t>(p / 100 * v.size()))];
+    }
+}// namespace detail
+
+inline report_t run(const scenario_t& s)
+{
+    report_t report;
+    espnow_medium::medium<morse_message_t> air(s.medium);
+    // Узлы группы g: сервер, затем его клиенты. MAC локально администрируемые: 02:4D:52:00:g:k, k = 0 - сервер
+    std::deque<detail::node_t> nodes;
+    std::vector<size_t> clients;                        // номера узлов-клиентов
+    for(size_t g = 0; g < s.servers; ++g) {
+        size_t server = nodes.size();
+        for(size_t k = 0; k <= s.clients; ++k) {
+            nodes.emplace_back(k == 0);
+            etl::espnow::endpoint_t mac;
+            const uint8_t address[6] = {0x02, 0x4D, 0x52, 0x00, static_cast<uint8_t>(g), static_cast<uint8_t>(k)};
+            memcpy(mac.mac, address, sizeof(address));
+            size_t node = air.attach(mac, nodes.back().relay);
+            nodes[node].relay.set_transport(air.transport(), air.port(node), s.policy);
+            nodes[node].relay.set_log(detail::on_log, &report);
+            if(k == 0) continue;
+            air.add_peer(node, server);
+            air.add_peer(server, node);
+            clients.push_back(node);
+        }
+    }
+
+    const uint32_t start = 1000;
+    const uint32_t interval = static_cast<uint32_t>(1000 / s.rate_hz);
+    std::vector<uint32_t> next_send(clients.size());
+    for(size_t i = 0; i < clients.size(); ++i) next_send[i] = start + static_cast<uint32_t>(interval * i / clients.size());
+    report.client_sent.assign(clients.size(), 0);
+    report.client_received.assign(clients.size(), 0);
+    report.origin.push_back(0);                         // kCount с 1
+    uint32_t count = 0;
+    uint64_t tick_ns = 0, ticks = 0;
+
+    for(uint32_t now = start; now < start + s.duration_ms + s.drain_ms; ++now) {
+        arduino_shim::set_millis(now);
+        air.set_time(uint64_t(now) * 1000);
+        for(size_t i = 0; i < clients.size(); ++i) {
+            if(now < start + s.duration_ms && now >= next_send[i]) {
+                report.origin.push_back(i);
+                nodes[clients[i]].relay.send_count(++count);
+                ++report.sent;
+                ++report.client_sent[i];
+                next_send[i] += interval;
+            }
+        }
+        for(auto& node : nodes) {
+            if(now < node.next_tick) continue;
+            auto t0 = std::chrono::steady_clock::now();
+            node.relay.tick();
+            tick_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count());
+            ++ticks;
+            uint32_t next = std::min(node.relay.batch_tx().time_to_flush(now), node.relay.time_to_next(now));
+            node.next_tick = now + std::max<uint32_t>(1, std::min(next, s.poll_ms));
+        }
+        air.deliver_until(uint64_t(now) * 1000 + 999);
+    }
+
+    const espnow_medium::stats_t& m = air.stats();
+    report.medium = m;
+    report.in_flight = air.in_flight();
+    report.msgs_per_s = (report.received + report.replies) * 1000.0 / s.duration_ms;
+    report.p50_ms = detail::percentile(report.latency_ms, 50);
+    report.p90_ms = detail::percentile(report.latency_ms, 90);
+    report.p99_ms = detail::percentile(report.latency_ms, 99);
+    report.max_ms = detail::percentile(report.latency_ms, 100);
+    report.delivered_pct = report.sent ? 100.0 * report.received / report.sent : 0;
+    report.worst_client_pct = clients.empty() ? 0 : 100;
+    for(size_t i = 0; i < clients.size(); ++i) {
+        double pct = report.client_sent[i] ? 100.0 * report.client_received[i] / report.client_sent[i] : 100;
+        report.worst_client_pct = std::min(report.worst_client_pct, pct);
+    }
+    report.air_pct = 100.0 * m.air_us / ((s.duration_ms + s.drain_ms) * 1000.0);
+    report.callback_ns = m.delivered ? double(m.callback_ns) / m.delivered : 0;
+    report.callback_max_ns = double(m.callback_max_ns);
+    report.tick_ns = ticks ? double(tick_ns) / ticks : 0;
+    return report;
+}
+
+// CSV: load,name,servers,clients,rate_hz,msgs_per_s,p50_ms,p90_ms,p99_ms,max_ms,delivered_pct,worst_client_pct,air_pct,frames,rejected,lost,reordered,callback_ns,callback_max_ns,tick_ns
+constexpr const char* CSV_HEADER = "load,name,servers,clients,rate_hz,msgs_per_s,p50_ms,p90_ms,p99_ms,max_ms,delivered_pct,worst_client_pct,air_pct,frames,rejected,lost,reordered,callback_ns,callback_max_ns,tick_ns";
+inline int format_csv(const scenario_t& s, const report_t& r, char* out, size_t size)
+{
+    return snprintf(out, size, "load,%s,%u,%u,%.0f,%.1f,%.0f,%.0f,%.0f,%.0f,%.1f,%.1f,%.1f,%lu,%lu,%lu,%lu,%.0f,%.0f,%.0f", s.name, unsigned(s.servers), unsigned(s.clients), s.rate_hz,
+                    r.msgs_per_s, r.p50_ms, r.p90_ms, r.p99_ms, r.max_ms, r.delivered_pct, r.worst_client_pct, r.air_pct, static_cast<unsigned long>(r.medium.sent),
+                    static_cast<unsigned long>(r.medium.rejected), static_cast<unsigned long>(r.medium.lost), static_cast<unsigned long>(r.medium.reordered),
+                    r.callback_ns, r.callback_max_ns, r.tick_ns);
+}
+
+}// namespace relay_load
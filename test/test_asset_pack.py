@@ -0,0 +1,82 @@
+# Тесты упаковщика веб-интерфейса: python -m unittest discover -s test -p "test_*.py"
+# Формат и hash должны совпадать с src/web_assets.h (см. test/test_web_assets)
+
+import gzip
+import os
+import sys
+import tempfile
+import unittest
+import zlib
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+import asset_pack
+
+
+class AssetPackTest(unittest.TestCase):
+    def test_fnv1a_matches_firmware(self):
+        self.assertEqual(0x457C5A71, asset_pack.fnv1a("/index.html"))
+        self.assertEqual(0x5731C89E, asset_pack.fnv1a("/js/app.js"))
+        self.assertEqual(0x811C9DC5, asset_pack.fnv1a(""))
+
+    def test_round_trip(self):
+        files = {
+            "/index.html": b"<html>" + b"hello " * 100 + b"</html>",
+            "/js/app.js": b"console.log(1);" * 50,
+            "/img/logo.png": b"\x89PNG" + bytes(range(200)),
+            "/a.bin": b"\x01",
+        }
+        blob = asset_pack.pack(files)
+        data_offset, entries = asset_pack.read_manifest(blob)
+        self.assertEqual(asset_pack.HEADER.size + asset_pack.ENTRY.size * len(files), data_offset)
+        hashes = [e[0] for e in entries]
+        self.assertEqual(sorted(hashes), hashes)
+
+        by_hash = {e[0]: e for e in entries}
+        for path, data in files.items():
+            hash_, offset, size, etag, type_, flags = by_hash[asset_pack.fnv1a(path)]
+            body = blob[offset:offset + size]
+            if flags & asset_pack.FLAG_GZIP:
+                body = gzip.decompress(body)
+            self.assertEqual(data, body, path)
+            self.assertEqual(zlib.crc32(data), etag)
+
+        self.assertEqual(asset_pack.FLAG_GZIP, by_hash[asset_pack.fnv1a("/index.html")][5])
+        self.assertEqual(0, by_hash[asset_pack.fnv1a("/img/logo.png")][5])     # png не сжимается
+        self.assertEqual(0, by_hash[asset_pack.fnv1a("/a.bin")][5])            # gzip больше исходного
+        self.assertEqual("text/html", asset_pack.CONTENT_TYPES[by_hash[asset_pack.fnv1a("/index.html")][4]][0])
+        self.assertEqual(0, by_hash[asset_pack.fnv1a("/a.bin")][4])
+
+    def test_deterministic(self):
+        files = {"/index.html": b"<html>same</html>" * 10}
+        self.assertEqual(asset_pack.pack(files), asset_pack.pack(dict(files)))
+
+    def test_hash_collision(self):
+        original = asset_pack.fnv1a
+        asset_pack.fnv1a = lambda path: 1
+        try:
+            with self.assertRaises(ValueError):
+                asset_pack.pack({"/a": b"a", "/b": b"b"})
+        finally:
+            asset_pack.fnv1a = original
+
+    def test_pack_dir(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            os.makedirs(os.path.join(tmp, "web", "css"))
+            with open(os.path.join(tmp, "web", "css", "style.css"), "wb") as f:
+                f.write(b"body { color: red; }\n" * 20)
+            out = os.path.join(tmp, "data", "assets.bin")
+            count, raw, packed = asset_pack.pack_dir(os.path.join(tmp, "web"), out, {"/config/version.json": b"{}"})
+            self.assertEqual(2, count)
+            with open(out, "rb") as f:
+                _, entries = asset_pack.read_manifest(f.read())
+            self.assertEqual({asset_pack.fnv1a("/css/style.css"), asset_pack.fnv1a("/config/version.json")},
+                             {e[0] for e in entries})
+            self.assertLess(packed, raw + 16 + 2 * 20)
+
+    def test_bad_magic(self):
+        with self.assertRaises(ValueError):
+            asset_pack.read_manifest(b"XXXX" + bytes(12))
+
+
+if __name__ == "__main__":
+    unittest.main()
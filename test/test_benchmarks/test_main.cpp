@@ -0,0 +1,134 @@
+// Микробенчмарки горячих путей прошивки на компьютере: pio test -e native -f test_benchmarks
+// Абсолютные числа зависят от машины, важно сравнение до/после изменения. Пороги заданы с большим запасом
+// и ловят только грубые регрессии (лишнее выделение памяти, квадратичный проход и т.п.).
+//   encode      - текст в элементы (бывший message_to_code)
+//   duration    - длительность передачи (бывший get_dit_code_duration)
+//   tick idle   - MorseCode::tick() без передачи, tick busy - во время передачи с шагом часов 1 мс
+//   relay       - разбор кадра в on_data_recieve и обработка в morse_relay_mgr::tick()
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "morse.h"
+#include "morse_espnow.h"
+
+static const char TEXT[] = "PARIS 12345 THE QUICK BROWN FOX 67890";
+
+// Время одного вызова в наносекундах
+template<typename Body>
+static double measure_ns(int iterations, Body body)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) body(i);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return double(ns) / iterations;
+}
+
+static void report(const char* name, double ns, const char* unit)
+{
+    char line[120];
+    snprintf(line, sizeof(line), "%-12s %9.1f ns/%s", name, ns, unit);
+    TEST_MESSAGE(line);
+}
+
+static bool sink(void*, const uint8_t*, size_t) { return true; }
+
+static volatile uint32_t guard = 0;    // чтобы компилятор не выбросил результат
+
+void bench_encode() {
+    size_t elements = 0;
+    double ns = measure_ns(20000, [&](int) {
+        morse_code::string_source source(TEXT, sizeof(TEXT) - 1);
+        morse_code::encoder encoder(&source);
+        morse_code::element_t element;
+        while(encoder.next(element)) ++elements;
+    });
+    elements /= 20000;
+    report("encode", ns / elements, "element");
+    TEST_ASSERT_LESS_THAN_FLOAT(200.0, ns / elements);
+}
+
+void bench_duration() {
+    auto led = etl::make_shared<etl::led>(LED_BUILTIN);
+    MorseCode morse(led, 50);
+    String text(TEXT);
+    double ns = measure_ns(20000, [&](int) { guard += morse.get_duration(text); });
+    report("duration", ns / (sizeof(TEXT) - 1), "char");
+    TEST_ASSERT_LESS_THAN_FLOAT(100.0, ns / (sizeof(TEXT) - 1));
+}
+
+void bench_tick_idle() {
+    auto led = etl::make_shared<etl::led>(LED_BUILTIN);
+    MorseCode morse(led, 50);
+    double ns = measure_ns(1000000, [&](int) { morse.tick(); });
+    report("tick idle", ns, "call");
+    TEST_ASSERT_LESS_THAN_FLOAT(500.0, ns);
+}
+
+void bench_tick_busy() {
+    auto led = etl::make_shared<etl::led>(LED_BUILTIN);
+    MorseCode morse(led, 5);
+    uint32_t sent = 0;
+    double ns = measure_ns(1000000, [&](int) {
+        if(!morse.is_transmitting() && morse.queue().empty()) { morse.enqueue(TEXT, sizeof(TEXT) - 1); ++sent; }
+        morse.tick();
+        arduino_shim::advance(1);
+    });
+    char line[80];
+    snprintf(line, sizeof(line), "tick busy: %u messages, %u blinks", unsigned(sent), unsigned(led->blinks()));
+    TEST_MESSAGE(line);
+    report("tick busy", ns, "call");
+    TEST_ASSERT_GREATER_THAN(1u, sent);
+    TEST_ASSERT_LESS_THAN_FLOAT(1000.0, ns);
+}
+
+void bench_relay() {
+    auto led = etl::make_shared<etl::led>(LED_BUILTIN);
+    MorseCode morse(led, 50);
+    morse_relay_mgr relay(true);
+    relay.set_morse(&morse);
+    relay.set_transport(sink, nullptr);
+
+    // Кадр с 8 сообщениями kCount, как от клиента
+    std::vector<uint8_t> frame;
+    espnow_batch::sender<morse_message_t, morse_wire::compact_codec> tx(
+        [](void* context, const uint8_t* data, size_t length) {
+            static_cast<std::vector<uint8_t>*>(context)->assign(data, data + length);
+            return true;
+        }, &frame);
+    for(uint32_t i = 0; i < 8; ++i) {
+        morse_message_t msg;
+        msg.timestamp = 100000 + i * 3000;
+        msg.id = morse_message_t::type_t::kCount;
+        msg.value = i;
+        tx.push(msg, 0);
+    }
+    tx.flush();
+
+    double ns = measure_ns(100000, [&](int i) {
+        frame[2] = static_cast<uint8_t>(i);        // новый номер кадра, иначе приемник отбросит повтор
+        frame[3] = static_cast<uint8_t>(i >> 8);
+        relay.deliver(esp_board::WEMOS_D1_Mini_v4_s001, frame.data(), static_cast<int>(frame.size()));
+        relay.tick();
+        morse.queue().clear();
+    });
+    report("relay", ns / 8, "message");
+    TEST_ASSERT_EQUAL_UINT32(0, relay.batch_rx().stats().invalid);
+    TEST_ASSERT_LESS_THAN_FLOAT(2000.0, ns / 8);
+}
+
+void setUp() { arduino_shim::set_millis(0); }
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(bench_encode);
+    RUN_TEST(bench_duration);
+    RUN_TEST(bench_tick_idle);
+    RUN_TEST(bench_tick_busy);
+    RUN_TEST(bench_relay);
+
+    return UNITY_END();
+}
@@ -0,0 +1,135 @@
+// Поэтапная загрузка и журнал: pio test -e native -f test_boot_stages
+// Часы - arduino_shim: delay() внутри этапа двигает millis()/micros()
+#include <unity.h>
+#include <cstdio>
+#include <string>
+#include "Arduino.h"
+#include "boot_stages.h"
+
+using namespace boot_stages;
+
+static uint32_t shim_micros() { return static_cast<uint32_t>(micros()); }
+
+using sequence_t = sequence<8, shim_micros>;
+
+static int steps = 0;
+
+static uint32_t three_steps(uint32_t)
+{
+    return ++steps < 3 ? 1000 : DONE;
+}
+
+static uint32_t instant(uint32_t) { return DONE; }
+
+void setUp() { arduino_shim::set_millis(0); steps = 0; }
+
+void tearDown() {}
+
+void test_run_records_time() {
+    sequence_t boot;
+    boot.run("serial", [] {});
+    boot.run("led", [] { delay(3); });
+    boot.mark("ready");
+    TEST_ASSERT_EQUAL_size_t(3, boot.size());
+    TEST_ASSERT_EQUAL_UINT32(3000, boot.find("led")->duration_us());
+    TEST_ASSERT_EQUAL_UINT32(3000, boot.find("ready")->start_us);
+    TEST_ASSERT_EQUAL_UINT32(0, boot.find("ready")->duration_us());
+    TEST_ASSERT_FALSE(boot.find("led")->deferred);
+    TEST_ASSERT_NULL(boot.find("missing"));
+}
+
+void test_deferred_steps() {
+    sequence_t boot;
+    TEST_ASSERT_EQUAL_UINT32(NEVER, boot.tick(0));
+    TEST_ASSERT_TRUE(boot.defer("sweep", three_steps));
+    TEST_ASSERT_TRUE(boot.defer("selftest", instant));
+    TEST_ASSERT_EQUAL_size_t(2, boot.pending());
+    TEST_ASSERT_EQUAL_size_t(0, boot.size());                   // в журнал - когда выполнится
+
+    arduino_shim::set_millis(10);
+    TEST_ASSERT_EQUAL_UINT32(1000, boot.tick(10));
+    arduino_shim::set_millis(1010);
+    TEST_ASSERT_EQUAL_UINT32(1000, boot.tick(1010));
+    arduino_shim::set_millis(2010);
+    TEST_ASSERT_EQUAL_UINT32(0, boot.tick(2010));                // sweep завершен, следующий этап - сразу
+    TEST_ASSERT_EQUAL_UINT32(NEVER, boot.tick(2010));
+    TEST_ASSERT_EQUAL_size_t(0, boot.pending());
+    TEST_ASSERT_EQUAL_size_t(2, boot.size());
+    TEST_ASSERT_EQUAL_UINT32(10000, boot.entry(0).start_us);
+    TEST_ASSERT_EQUAL_UINT32(2000000, boot.entry(0).duration_us());
+    TEST_ASSERT_TRUE(boot.entry(0).deferred);
+    TEST_ASSERT_EQUAL_STRING("selftest", boot.entry(1).name);
+
+    // /diag после загрузки: очередь снова принимает этапы
+    TEST_ASSERT_TRUE(boot.defer("selftest", instant));
+    TEST_ASSERT_EQUAL_UINT32(NEVER, boot.tick(3000));
+    TEST_ASSERT_EQUAL_size_t(3, boot.size());
+}
+
+void test_csv_and_overflow() {
+    sequence<2, shim_micros> boot;
+    boot.run("serial", [] { delay(1); });
+    boot.mark("ready");
+    boot.mark("first_beacon");
+    std::string out;
+    boot.write_csv([&](const char* line) { out += line; out += '\n'; });
+    TEST_ASSERT_EQUAL_STRING("boot,name,start_us,duration_us,deferred\n"
+                             "boot,serial,0,1000,0\n"
+                             "boot,ready,1000,0,0\n"
+                             "boot,dropped,1,0,0\n", out.c_str());
+    TEST_ASSERT_TRUE(boot.defer("a", instant));
+    TEST_ASSERT_TRUE(boot.defer("b", instant));
+    TEST_ASSERT_FALSE(boot.defer("c", instant));
+}
+
+// Прежний setup() на ESP32-WROOM-32U: ожидание Serial, самотесты, 19 выводов по 3 с - и только потом задачи.
+// Теперь критичные этапы, задачи и первый маяк, а диагностика - шагами задачи "boot"
+static uint32_t sweep_pins(uint32_t)
+{
+    static int phase = 0;
+    if(phase == 19 * 3) { phase = 0; return DONE; }
+    ++phase;
+    return 1000;
+}
+
+void test_time_to_first_beacon() {
+    const uint32_t SERIAL_INIT_DELAY = 1000, SELFTEST_MS = 150;
+
+    delay(SERIAL_INIT_DELAY);
+    delay(SELFTEST_MS);
+    delay(19 * 3 * 1000);
+    uint32_t legacy = static_cast<uint32_t>(millis());
+
+    arduino_shim::set_millis(0);
+    sequence_t boot;
+    boot.run("serial", [] {});
+    boot.run("led", [] { delay(1); });
+    boot.run("espnow", [] { delay(5); });
+    boot.defer("selftest", [](uint32_t) { delay(150); return DONE; });
+    boot.defer("pin_sweep", sweep_pins);
+    boot.mark("ready");
+    boot.mark("first_beacon");                                  // morse_message стоит первым со сроком 0
+    uint32_t staged = boot.find("first_beacon")->start_us / 1000;
+    TEST_ASSERT_LESS_THAN(100, staged);
+
+    // Диагностика все равно отрабатывает целиком
+    uint32_t now = static_cast<uint32_t>(millis());
+    for(uint32_t next = boot.tick(now); next != NEVER; next = boot.tick(now)) now += next;
+    TEST_ASSERT_NOT_NULL(boot.find("pin_sweep"));
+
+    char report[96];
+    snprintf(report, sizeof(report), "first beacon: legacy %lu ms, staged %lu ms", static_cast<unsigned long>(legacy),
+             static_cast<unsigned long>(staged));
+    TEST_MESSAGE(report);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_run_records_time);
+    RUN_TEST(test_deferred_steps);
+    RUN_TEST(test_csv_and_overflow);
+    RUN_TEST(test_time_to_first_beacon);
+
+    return UNITY_END();
+}
@@ -0,0 +1,258 @@
+// Синхронизация часов клиент-сервер: pio test -e native -f test_clock_sync
+// Модель: истинное время T (мс, double), у каждой платы свои часы millis() = offset + T * (1 + drift).
+// Канал: задержка base + равномерный jitter, изредка повтор кадра MAC-уровнем (+spike), потери.
+// Сервер и клиенты опрашивают очередь приема раз в POLL_INTERVAL, моргание будится планировщиком точно в срок.
+// Ошибка синхронизации - разница истинных моментов моргания клиента и сервера.
+// Группа через morse_relay_mgr: один сервер и несколько клиентов со своими MAC, кадры напрямую без задержки.
+#include <unity.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+#include "clock_sync.h"
+#include "morse_espnow.h"
+
+using estimator_t = clock_sync::estimator<>;
+
+void setUp() {}
+void tearDown() {}
+
+void test_offset_from_single_exchange() {
+    estimator_t sync;
+    TEST_ASSERT_FALSE(sync.valid());
+    sync.on_request(1000);
+    TEST_ASSERT_FALSE(sync.on_reply(999, 6010, 1020));         // чужой запрос
+    TEST_ASSERT_TRUE(sync.on_reply(1000, 6010, 1020));
+    TEST_ASSERT_FALSE(sync.on_reply(1000, 6010, 1020));        // повтор
+    TEST_ASSERT_TRUE(sync.valid());
+    TEST_ASSERT_EQUAL_INT32(5000, sync.offset(1020));
+    TEST_ASSERT_EQUAL_UINT32(10, sync.error_bound());
+    TEST_ASSERT_EQUAL_UINT32(1110, sync.to_local(6110));
+    TEST_ASSERT_EQUAL_UINT32(6110, sync.to_server(1110));
+}
+
+void test_slow_replies_filtered() {
+    estimator_t sync;
+    // Два быстрых ответа и один из очереди: смещение по быстрым
+    const uint32_t t1[] = {1000, 4000, 7000}, rtt[] = {4, 40, 4};
+    for(int i = 0; i < 3; ++i) {
+        sync.on_request(t1[i]);
+        sync.on_reply(t1[i], t1[i] + rtt[i] / 2 + 300 + (i == 1 ? 18 : 0), t1[i] + rtt[i]);
+    }
+    TEST_ASSERT_EQUAL_INT32(300, sync.offset(7002));
+    TEST_ASSERT_EQUAL_UINT32(2, sync.error_bound());
+}
+
+void test_drift_and_wrap() {
+    estimator_t sync;
+    // Часы клиента отстают на 50 ppm, сервер - около переполнения uint32
+    const double drift = 50e-6;
+    uint32_t server_base = 0xFFFF0000u;
+    for(uint32_t k = 0; k < 8; ++k) {
+        uint32_t t1 = 1000 + k * 20000;
+        sync.on_request(t1);
+        uint32_t server = server_base + static_cast<uint32_t>(std::lround((t1 + 1) * (1 + drift)));
+        sync.on_reply(t1, server, t1 + 2);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(5e-6f, drift, sync.drift());
+    // Через минуту без ответов
+    uint32_t later = 1000 + 7 * 20000 + 60000;
+    uint32_t expected = server_base + static_cast<uint32_t>(std::lround(later * (1 + drift)));
+    TEST_ASSERT_INT32_WITHIN(1, 0, static_cast<int32_t>(sync.to_server(later) - expected));
+}
+
+struct link_t {
+    const char* name;
+    double base_ms;         // задержка кадра
+    double jitter_ms;       // + равномерно 0..jitter
+    double spike_prob;      // повтор MAC-уровнем
+    double spike_ms;
+    double loss;
+};
+
+struct node_t {
+    double   offset;        // мс
+    double   drift;
+    estimator_t sync;
+    uint32_t local(double t) const { return static_cast<uint32_t>(static_cast<uint64_t>(std::floor(offset + t * (1 + drift)))); }
+    // Истинное время, когда часы покажут local (ближайшее к t_near)
+    double when(uint32_t local, double t_near) const {
+        double target = static_cast<double>(static_cast<int32_t>(local - this->local(t_near)));
+        return t_near + target / (1 + drift);
+    }
+};
+
+struct result_t {
+    std::vector<double> synced;     // |ошибка| с синхронизацией, мс
+    std::vector<double> naive;      // клиент мигает по приходу кадра
+};
+
+static double percentile(std::vector<double> v, double p)
+{
+    if(v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, static_cast<size_t>(p / 100 * v.size()))];
+}
+
+// clients клиентов, minutes минут; каждый клиент шлет kCount раз в 2..5 с
+static result_t simulate(const link_t& link, size_t clients, double minutes, uint32_t seed)
+{
+    const double POLL = 20, LEAD = 100;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uni(0, 1);
+    auto delay = [&] { return link.base_ms + link.jitter_ms * uni(rng) + (uni(rng) < link.spike_prob ? link.spike_ms : 0); };
+
+    node_t server{3600e3, 0, {}};
+    std::vector<node_t> nodes;
+    const double drifts[] = {35e-6, -20e-6, 10e-6, -40e-6};
+    for(size_t i = 0; i < clients; ++i) nodes.push_back({1000.0 + 12345.0 * i + 86400e3 * (i % 2), drifts[i % 4], {}});
+    std::vector<double> next(clients);
+    for(size_t i = 0; i < clients; ++i) next[i] = 1000 + 700.0 * i;
+
+    result_t result;
+    for(;;) {
+        size_t c = std::min_element(next.begin(), next.end()) - next.begin();
+        double t = next[c];
+        if(t > minutes * 60e3) break;
+        next[c] = t + 2000 + 3000 * uni(rng);
+
+        uint32_t t1 = nodes[c].local(t);
+        nodes[c].sync.on_request(t1);
+        if(uni(rng) < link.loss) continue;
+        double arrive = t + delay();
+        double process = arrive + POLL * uni(rng);
+        uint32_t t2 = server.local(arrive), t3 = server.local(process);
+        uint32_t mid = t2 + (t3 - t2) / 2;
+        uint32_t start = t3 + static_cast<uint32_t>(LEAD);
+        double server_fire = server.when(start, process);
+
+        // Ответ - всем клиентам группы одним кадром
+        for(size_t k = 0; k < clients; ++k) {
+            if(uni(rng) < link.loss) continue;
+            double rx = process + delay();
+            node_t& n = nodes[k];
+            n.sync.on_reply(t1, mid, n.local(rx));          // чужой запрос отбрасывается по метке
+            double poll = rx + POLL * uni(rng);
+            result.naive.push_back(std::fabs(poll - process));
+            if(!n.sync.valid() || n.sync.samples() < 2) continue;
+            double fire = std::max(poll, n.when(n.sync.to_local(start), poll));
+            result.synced.push_back(std::fabs(fire - server_fire));
+        }
+    }
+    return result;
+}
+
+static void report(const link_t& link, size_t clients, const result_t& r)
+{
+    char line[200];
+    snprintf(line, sizeof(line), "%s, %u clients: synced p50 %.1f p99 %.1f max %.1f ms; blink on arrival p50 %.1f p99 %.1f ms (%u blinks)",
+             link.name, unsigned(clients), percentile(r.synced, 50), percentile(r.synced, 99), percentile(r.synced, 100),
+             percentile(r.naive, 50), percentile(r.naive, 99), unsigned(r.synced.size()));
+    TEST_MESSAGE(line);
+}
+
+void test_simulated_sync_error() {
+    const link_t links[] = {
+        {"quiet (2+1 ms)",            2, 1, 0.00,  0, 0.00},
+        {"busy (3+8 ms, retries)",    3, 8, 0.05, 15, 0.05},
+        {"noisy (5+30 ms, retries)",  5, 30, 0.10, 25, 0.15},
+    };
+    for(const link_t& link : links) {
+        result_t pair = simulate(link, 1, 30, 1);
+        report(link, 1, pair);
+        result_t group = simulate(link, 4, 30, 2);
+        report(link, 4, group);
+        // Ошибка - половина асимметрии задержки, усредненная по окну, плюс округление миллисекунд
+        double bound = 2 + link.jitter_ms / 3;
+        TEST_ASSERT_TRUE(percentile(pair.synced, 99) <= bound);
+        TEST_ASSERT_TRUE(percentile(group.synced, 99) <= bound);
+        TEST_ASSERT_TRUE(percentile(group.synced, 50) < percentile(group.naive, 50));
+    }
+}
+
+// Узел группы: клиенты шлют кадры серверу, сервер - всем клиентам (как espnow_send_all по списку пиров)
+struct group_node_t {
+    morse_relay_mgr relay;
+    etl::espnow::endpoint_t mac;
+    etl::shared_ptr<etl::led> led;
+    std::deque<group_node_t>* group = nullptr;
+    uint32_t counts = 0;                    // принято kCount (сервер)
+
+    group_node_t(bool server, const char* address, int pin) : relay(server), mac(address), led(etl::make_shared<etl::led>(pin)) {}
+
+    static bool send(void* context, const uint8_t* data, size_t length) {
+        auto self = static_cast<group_node_t*>(context);
+        for(group_node_t& node : *self->group) {
+            if(&node != self && (self == &self->group->front()) != (&node == &self->group->front())) {
+                node.relay.deliver(self->mac, data, static_cast<int>(length));
+            }
+        }
+        return true;
+    }
+};
+
+void test_relay_group_syncs_every_client() {
+    const size_t CLIENTS = 3, ROUNDS = 4;
+    const char* macs[] = {"10:00:00:00:00:01", "20:00:00:00:00:02", "20:00:00:00:00:03", "20:00:00:00:00:04"};
+    arduino_shim::set_millis(10000);
+    std::deque<group_node_t> group;
+    for(size_t i = 0; i <= CLIENTS; ++i) group.emplace_back(i == 0, macs[i], static_cast<int>(10 + i));
+    for(group_node_t& node : group) {
+        node.group = &group;
+        node.relay.set_transport(group_node_t::send, &node);
+        node.relay.set_led(node.led);
+        node.relay.set_log([](void* context, bool received, const morse_message_t& msg, int8_t) {
+            if(received && msg.id == morse_message_t::type_t::kCount) ++static_cast<group_node_t*>(context)->counts;
+        }, &node);
+    }
+    group_node_t& server = group.front();
+
+    for(size_t round = 0; round < ROUNDS; ++round) {
+        // Ответ в ту же миллисекунду: смещение ровно 0. Метки запросов разные - чужой kTime клиент отбросит
+        for(size_t c = 1; c <= CLIENTS; ++c) {
+            group[c].relay.send_count(static_cast<uint32_t>(round * 10 + c));
+            group[c].relay.flush();
+            for(group_node_t& node : group) node.relay.tick();
+            delay(1);
+        }
+        TEST_ASSERT_FALSE(server.led->is_on());
+
+        // Все мигают в момент последнего kBlink сервера, клиенты - по своим часам
+        arduino_shim::set_millis(millis() + morse_relay_mgr::BLINK_LEAD);
+        for(group_node_t& node : group) {
+            node.relay.tick();
+            TEST_ASSERT_TRUE(node.led->is_on());
+        }
+        arduino_shim::set_millis(millis() + morse_relay_mgr::BLINK_DURATION);
+        for(group_node_t& node : group) {
+            node.relay.tick();
+            TEST_ASSERT_FALSE(node.led->is_on());
+        }
+        arduino_shim::set_millis(millis() + 2000);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(CLIENTS * ROUNDS, server.counts);
+    TEST_ASSERT_EQUAL_UINT32(0, server.relay.batch_rx().stats().duplicate);
+    for(size_t c = 1; c <= CLIENTS; ++c) {
+        const morse_relay_mgr& client = group[c].relay;
+        TEST_ASSERT_EQUAL_size_t(ROUNDS, client.sync().samples());
+        TEST_ASSERT_EQUAL_INT32(0, client.sync().offset(millis()));        // часы общие
+        // Следующий kBlink переносит моргание; до первого своего kTime клиент мигает по приходу чужих kBlink
+        TEST_ASSERT_EQUAL_UINT32(ROUNDS + c - 1, group[c].led->blinks());
+        TEST_ASSERT_EQUAL_UINT32(0, client.batch_rx().stats().duplicate);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_offset_from_single_exchange);
+    RUN_TEST(test_slow_replies_filtered);
+    RUN_TEST(test_drift_and_wrap);
+    RUN_TEST(test_simulated_sync_error);
+    RUN_TEST(test_relay_group_syncs_every_client);
+
+    return UNITY_END();
+}
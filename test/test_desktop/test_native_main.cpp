@@ -1,23 +1,238 @@
+// Прошивка на компьютере через замену Arduino (test/shim): pio test -e native -f test_desktop
+// MorseCode и morse_relay_mgr собираются как есть, время двигает тест.
 #include <unity.h>
-#include "add.h"
+#include <string>
+#include <vector>
 
+#define MORSE_MODE "server"
+#include "pinout.h"
+#include "morse.h"
+#include "morse_espnow.h"
 
-void test_addition() {
-    TEST_ASSERT_EQUAL(5, add(2, 3));
-    TEST_ASSERT_EQUAL(-1, add(-2, 1));
-    TEST_ASSERT_EQUAL(0, add(0, 0));
+// Отправленные реле кадры
+struct capture_t {
+    std::vector<std::vector<uint8_t>> frames;
+
+    static bool send(void* context, const uint8_t* data, size_t length) {
+        static_cast<capture_t*>(context)->frames.emplace_back(data, data + length);
+        return true;
+    }
+};
+
+// Прогон передатчика до конца с шагом 1 мс: моменты включения светодиода
+static std::vector<uint32_t> run_morse(MorseCode& morse, etl::led& led, uint32_t limit_ms = 10000)
+{
+    std::vector<uint32_t> on_times;
+    bool was_on = led.is_on();
+    for(uint32_t i = 0; i < limit_ms && (morse.is_transmitting() || !morse.queue().empty()); ++i) {
+        morse.tick();
+        if(led.is_on() && !was_on) on_times.push_back(millis());
+        was_on = led.is_on();
+        delay(1);
+    }
+    return on_times;
 }
 
-void setUp() {}
+void setUp() {
+    arduino_shim::set_millis(1000);
+    Serial.take();
+}
 
 void tearDown() {}
 
-int main() {
-    UNITY_BEGIN();  // Initialize Unity
+void test_pinout() {
+    TEST_ASSERT_TRUE(IS_MORSE_SERVER);
+    TEST_ASSERT_FALSE(IS_MORSE_CLIENT);
+    TEST_ASSERT_EQUAL_INT(LED_BUILTIN, LED_MORSE);
+}
 
-    RUN_TEST(test_addition);  // Run the test
+void test_clock_and_serial() {
+    TEST_ASSERT_EQUAL_UINT32(1000, millis());
+    delay(25);
+    TEST_ASSERT_EQUAL_UINT32(1025, millis());
+    Serial.print("t="); Serial.println(millis());
+    TEST_ASSERT_EQUAL_STRING("t=1025\r\n", Serial.take().c_str());
+    Serial.feed("ab");
+    TEST_ASSERT_EQUAL_INT('a', Serial.read());
+    TEST_ASSERT_EQUAL_INT(1, Serial.available());
+}
 
-    UNITY_END();  // End Unity
+void test_morse_timing() {
+    auto led = etl::make_shared<etl::led>(LED_MORSE);
+    MorseCode morse(led, 50);
+    uint32_t start = millis();
+    uint32_t duration = morse.send("AE");      // .- | .
+    auto on_times = run_morse(morse, *led);
+    TEST_ASSERT_EQUAL_size_t(3, on_times.size());
+    TEST_ASSERT_EQUAL_UINT32(3, led->blinks());
+    // Первый элемент после паузы в 1 dit, после точки/тире - 1 dit, пауза символа добавляет еще 3
+    TEST_ASSERT_EQUAL_UINT32(start + 50, on_times[0]);
+    TEST_ASSERT_EQUAL_UINT32(on_times[0] + 50 + 50, on_times[1]);
+    TEST_ASSERT_EQUAL_UINT32(on_times[1] + 150 + 50 + 150, on_times[2]);
+    TEST_ASSERT_TRUE(morse.is_completed());
+    TEST_ASSERT_UINT32_WITHIN(60, duration, millis() - start);
+}
 
-    return 0;
-}
\ No newline at end of file
+void test_morse_queue_and_time_to_next() {
+    auto led = etl::make_shared<etl::led>(LED_MORSE);
+    MorseCode morse(led, 20);
+    TEST_ASSERT_EQUAL_UINT32(MorseCode::NEVER, morse.time_to_next(millis()));
+    TEST_ASSERT_TRUE(morse.enqueue("E"));
+    TEST_ASSERT_TRUE(morse.enqueue("T"));
+    TEST_ASSERT_EQUAL_UINT32(0, morse.time_to_next(millis()));
+    morse.tick();
+    TEST_ASSERT_EQUAL_UINT32(20, morse.time_to_next(millis()));
+    auto on_times = run_morse(morse, *led);
+    TEST_ASSERT_EQUAL_size_t(2, on_times.size());
+    TEST_ASSERT_EQUAL_UINT32(MorseCode::NEVER, morse.time_to_next(millis()));
+}
+
+void test_morse_stops_when_led_expires() {
+    auto led = etl::make_shared<etl::led>(LED_MORSE);
+    MorseCode morse(led, 20);
+    morse.send("SOS");
+    morse.tick();
+    TEST_ASSERT_TRUE(morse.is_transmitting());
+    led.reset();
+    morse.tick();
+    TEST_ASSERT_FALSE(morse.is_transmitting());
+    TEST_ASSERT_EQUAL_UINT32(MorseCode::NEVER, morse.time_to_next(millis()));   // loop() не крутится впустую
+    TEST_ASSERT_TRUE(morse.enqueue("E"));
+    morse.tick();
+    TEST_ASSERT_FALSE(morse.is_transmitting());
+    TEST_ASSERT_EQUAL_UINT32(MorseCode::NEVER, morse.time_to_next(millis()));
+}
+
+void test_relay_server_round_trip() {
+    auto led = etl::make_shared<etl::led>(LED_MORSE);
+    MorseCode morse(led, 20);
+    capture_t capture;
+    morse_relay_mgr relay(true);
+    relay.set_morse(&morse);
+    espnow_batch::policy_t policy;
+    policy.max_latency_ms = 0;
+    relay.set_transport(capture_t::send, &capture, policy);
+    std::vector<std::pair<bool, morse_message_t>> log;
+    relay.set_log([](void* context, bool received, const morse_message_t& msg, int8_t) {
+        static_cast<std::vector<std::pair<bool, morse_message_t>>*>(context)->emplace_back(received, msg);
+    }, &log);
+
+    // Старый клиент: одиночная структура
+    morse_message_t request;
+    request.timestamp = 777;
+    request.id = morse_message_t::type_t::kCount;
+    request.value = 42;
+    uint8_t legacy[morse_wire::LEGACY_SIZE];
+    morse_wire::write_legacy(legacy, request);
+    relay.deliver(esp_board::WEMOS_D1_Mini_v4_s001, legacy, sizeof(legacy));
+    relay.tick();
+    relay.flush();
+
+    // Счетчик ушел в очередь азбуки Морзе, в одном кадре: kTime с меткой запроса и kBlink с моментом начала
+    TEST_ASSERT_EQUAL_size_t(1, morse.queue().depth());
+    TEST_ASSERT_EQUAL_size_t(1, capture.frames.size());
+    espnow_batch::receiver<morse_message_t, morse_wire::compact_codec> rx;
+    std::vector<morse_message_t> replies;
+    rx.unpack(capture.frames[0].data(), capture.frames[0].size(), [&](const morse_message_t& m) { replies.push_back(m); });
+    TEST_ASSERT_EQUAL_size_t(2, replies.size());
+    TEST_ASSERT_EQUAL_UINT8(morse_message_t::type_t::kTime, replies[0].id);
+    TEST_ASSERT_EQUAL_UINT32(777, replies[0].timestamp);
+    TEST_ASSERT_EQUAL_UINT32(millis(), replies[0].value);
+    TEST_ASSERT_EQUAL_UINT8(morse_message_t::type_t::kBlink, replies[1].id);
+    TEST_ASSERT_EQUAL_UINT32(millis() + morse_relay_mgr::BLINK_LEAD, replies[1].timestamp);
+    TEST_ASSERT_EQUAL_UINT32(1, relay.telemetry().counters().received);
+
+    // В журнал: принятый счетчик, затем отправленные ответы
+    TEST_ASSERT_EQUAL_size_t(3, log.size());
+    TEST_ASSERT_TRUE(log[0].first);
+    TEST_ASSERT_EQUAL_UINT32(42, log[0].second.value);
+    TEST_ASSERT_FALSE(log[2].first);
+    TEST_ASSERT_EQUAL_UINT8(morse_message_t::type_t::kBlink, log[2].second.id);
+}
+
+// Часы сервера на 5000 мс впереди, задержка кадра 10 мс: клиент мигает в момент, назначенный сервером
+void test_relay_client_blinks_on_schedule() {
+    auto led = etl::make_shared<etl::led>(LED_MORSE);
+    capture_t capture;
+    morse_relay_mgr client(false);
+    client.set_led(led);
+    client.set_transport(capture_t::send, &capture);
+    uint32_t sent_at = millis();
+    client.send_count(5);
+    delay(20);
+
+    morse_message_t time, blink;
+    time.id = morse_message_t::type_t::kTime;
+    time.timestamp = sent_at;
+    time.value = sent_at + 5000 + 10;
+    blink.id = morse_message_t::type_t::kBlink;
+    blink.timestamp = time.value + morse_relay_mgr::BLINK_LEAD;
+    blink.value = 50;
+    espnow_batch::sender<morse_message_t, morse_wire::compact_codec> tx(capture_t::send, &capture);
+    tx.push(time, millis());
+    tx.push(blink, millis());
+    tx.flush();
+    client.deliver(esp_board::ESP32_C3_ProMini_s003, capture.frames.back().data(), static_cast<int>(capture.frames.back().size()));
+    client.tick();
+    TEST_ASSERT_EQUAL_INT32(5000, client.sync().offset(millis()));
+    TEST_ASSERT_EQUAL_UINT32(1, client.telemetry().counters().replies);
+    TEST_ASSERT_EQUAL_UINT32(0, led->blinks());
+    TEST_ASSERT_EQUAL_UINT32(sent_at + 10 + morse_relay_mgr::BLINK_LEAD - millis(), client.time_to_next(millis()));
+
+    arduino_shim::set_millis(sent_at + 10 + morse_relay_mgr::BLINK_LEAD);
+    client.tick();
+    TEST_ASSERT_EQUAL_UINT32(1, led->blinks());
+    TEST_ASSERT_TRUE(led->is_on());
+
+    // Гасит сам менеджер: задачи "blink" при передатчике Морзе нет
+    TEST_ASSERT_EQUAL_UINT32(50, client.time_to_next(millis()));
+    delay(50);
+    client.tick();
+    TEST_ASSERT_FALSE(led->is_on());
+    TEST_ASSERT_EQUAL_UINT32(morse_relay_mgr::NEVER, client.time_to_next(millis()));
+
+    // Светодиод освобожден: моргание пропускается, без обращения к освобожденной памяти
+    blink.timestamp = client.sync().to_server(millis());
+    tx.push(blink, millis());
+    tx.flush();
+    client.deliver(esp_board::ESP32_C3_ProMini_s003, capture.frames.back().data(), static_cast<int>(capture.frames.back().size()));
+    led.reset();
+    client.tick();
+    TEST_ASSERT_EQUAL_UINT32(morse_relay_mgr::NEVER, client.time_to_next(millis()));
+}
+
+void test_relay_client_measures_rtt() {
+    capture_t capture;
+    morse_relay_mgr client(false);
+    client.set_transport(capture_t::send, &capture);
+    client.send_count(5);
+    uint32_t sent_at = millis();
+    delay(30);
+
+    morse_message_t reply;
+    reply.timestamp = sent_at;
+    reply.id = morse_message_t::type_t::kBlink;
+    reply.value = 50;
+    espnow_batch::sender<morse_message_t, morse_wire::compact_codec> tx(capture_t::send, &capture);
+    tx.push(reply, millis());
+    tx.flush();
+    client.deliver(esp_board::ESP32_C3_ProMini_s003, capture.frames.back().data(), static_cast<int>(capture.frames.back().size()));
+    client.tick();
+    TEST_ASSERT_EQUAL_UINT32(1, client.telemetry().counters().replies);
+    TEST_ASSERT_EQUAL_UINT32(30, client.telemetry().rtt().max());
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_pinout);
+    RUN_TEST(test_clock_and_serial);
+    RUN_TEST(test_morse_timing);
+    RUN_TEST(test_morse_queue_and_time_to_next);
+    RUN_TEST(test_morse_stops_when_led_expires);
+    RUN_TEST(test_relay_server_round_trip);
+    RUN_TEST(test_relay_client_measures_rtt);
+    RUN_TEST(test_relay_client_blinks_on_schedule);
+
+    return UNITY_END();
+}
@@ -0,0 +1,225 @@
+// Тесты пакетной передачи ESP-NOW через loopback: pio test -e native -f test_espnow_batch
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "espnow_batch.h"
+
+// Та же раскладка, что у morse_message_t
+struct message_t {
+    uint32_t timestamp = 0;
+    uint8_t  id = 0;
+    uint32_t value = 0;
+};
+
+// Loopback вместо радио: кадры копируются в список, можно терять и переставлять
+struct loopback_t {
+    std::vector<std::vector<uint8_t>> frames;
+    uint32_t airtime_us = 0;    // оценка эфирного времени: ~1 мс на кадр + 32 мкс на байт (1 Мбит/с)
+
+    static bool send(void* context, const uint8_t* data, size_t length) {
+        auto self = static_cast<loopback_t*>(context);
+        self->frames.emplace_back(data, data + length);
+        self->airtime_us += 1000 + 8 * static_cast<uint32_t>(length) * 4;
+        return true;
+    }
+};
+
+using sender_t   = espnow_batch::sender<message_t>;
+using receiver_t = espnow_batch::receiver<message_t>;
+
+static std::vector<message_t> deliver(loopback_t& link, receiver_t& rx)
+{
+    std::vector<message_t> result;
+    for(auto& frame : link.frames) rx.unpack(frame.data(), frame.size(), [&](const message_t& m) { result.push_back(m); });
+    link.frames.clear();
+    return result;
+}
+
+void test_capacity() {
+    TEST_ASSERT_EQUAL_UINT8((250 - 5) / sizeof(message_t), sender_t::CAPACITY);
+}
+
+void test_flush_by_size() {
+    loopback_t link;
+    espnow_batch::policy_t policy;
+    policy.max_messages = 4;
+    policy.max_latency_ms = 0;
+    sender_t tx(loopback_t::send, &link, policy);
+    receiver_t rx;
+    for(uint32_t i = 0; i < 10; ++i) tx.push({i, 2, i * 10}, 0);
+    TEST_ASSERT_EQUAL_size_t(2, link.frames.size());
+    TEST_ASSERT_EQUAL_UINT8(2, tx.pending());
+    tx.flush();
+    auto messages = deliver(link, rx);
+    TEST_ASSERT_EQUAL_size_t(10, messages.size());
+    for(uint32_t i = 0; i < 10; ++i) TEST_ASSERT_EQUAL_UINT32(i * 10, messages[i].value);
+}
+
+void test_flush_by_latency() {
+    loopback_t link;
+    espnow_batch::policy_t policy;
+    policy.max_latency_ms = 15;
+    sender_t tx(loopback_t::send, &link, policy);
+    tx.push({}, 100);
+    tx.push({}, 105);
+    TEST_ASSERT_EQUAL_UINT32(5, tx.time_to_flush(110));
+    tx.tick(110);
+    TEST_ASSERT_EQUAL_size_t(0, link.frames.size());
+    tx.tick(115);
+    TEST_ASSERT_EQUAL_size_t(1, link.frames.size());
+    TEST_ASSERT_EQUAL_size_t(5 + 2 * sizeof(message_t), link.frames[0].size());
+}
+
+void test_sequence_loss_and_duplicates() {
+    loopback_t link;
+    espnow_batch::policy_t policy;
+    policy.max_messages = 1;
+    sender_t tx(loopback_t::send, &link, policy);
+    receiver_t rx;
+    for(uint32_t i = 0; i < 5; ++i) tx.push({i, 1, i}, 0);
+    auto frames = link.frames;
+    link.frames = {frames[0], frames[2], frames[2], frames[1], frames[4]};     // потерян 3, повтор 2, 1 опоздал
+    auto messages = deliver(link, rx);
+    TEST_ASSERT_EQUAL_size_t(3, messages.size());
+    TEST_ASSERT_EQUAL_UINT32(2, rx.stats().lost);
+    TEST_ASSERT_EQUAL_UINT32(2, rx.stats().duplicate);
+}
+
+// Сервер и два клиента: номера кадров у каждого клиента свои, клиент 2 перезагружается и считает с нуля
+void test_senders_tracked_by_mac() {
+    const uint8_t mac1[6] = {1, 1, 1, 1, 1, 1}, mac2[6] = {2, 2, 2, 2, 2, 2};
+    espnow_batch::policy_t policy;
+    policy.max_messages = 1;
+    loopback_t link1, link2;
+    sender_t client1(loopback_t::send, &link1, policy);
+    receiver_t server;
+    std::vector<uint32_t> values;
+    auto collect = [&](const message_t& m) { values.push_back(m.value); };
+    auto deliver_from = [&](const uint8_t* mac, loopback_t& link, uint32_t now) {
+        for(auto& frame : link.frames) server.unpack(mac, now, frame.data(), frame.size(), collect);
+        link.frames.clear();
+    };
+
+    {
+        sender_t client2(loopback_t::send, &link2, policy);
+        for(uint32_t i = 0; i < 3; ++i) {
+            client1.push({0, 1, 100 + i}, 0);
+            client2.push({0, 1, 200 + i}, 0);
+        }
+        deliver_from(mac1, link1, 1000);
+        auto repeat = link2.frames[2];
+        deliver_from(mac2, link2, 1000);
+        server.unpack(mac2, 1005, repeat.data(), repeat.size(), collect);      // повтор MAC-уровня - сразу
+    }
+    TEST_ASSERT_EQUAL_size_t(6, values.size());
+    TEST_ASSERT_EQUAL_UINT32(1, server.stats().duplicate);
+    TEST_ASSERT_EQUAL_UINT32(0, server.stats().lost);
+
+    // Перезагрузка: новый отправитель с номера 0 после паузы, клиент 1 продолжает свою нумерацию
+    sender_t rebooted(loopback_t::send, &link2, policy);
+    rebooted.push({0, 1, 300}, 0);
+    client1.push({0, 1, 103}, 0);
+    deliver_from(mac2, link2, 4000);
+    deliver_from(mac1, link1, 4000);
+    TEST_ASSERT_EQUAL_size_t(8, values.size());
+    TEST_ASSERT_EQUAL_UINT32(300, values[6]);
+    TEST_ASSERT_EQUAL_UINT32(103, values[7]);
+    TEST_ASSERT_EQUAL_UINT32(1, server.stats().resyncs);
+    TEST_ASSERT_EQUAL_UINT32(1, server.stats().duplicate);
+    TEST_ASSERT_EQUAL_UINT32(0, server.stats().lost);
+}
+
+// Транспорт не готов: кадр ждет у отправителя, заполненный кадр новых сообщений не принимает
+void test_held_until_transport_ready() {
+    struct gated_t : loopback_t { bool ready = false; } link;
+    espnow_batch::policy_t policy;
+    policy.max_messages = 2;
+    policy.max_latency_ms = 10;
+    sender_t tx(loopback_t::send, &link, policy);
+    tx.set_ready([](void* context) { return static_cast<gated_t*>(context)->ready; });
+    TEST_ASSERT_TRUE(tx.push({0, 1, 1}, 0));
+    TEST_ASSERT_TRUE(tx.push({0, 1, 2}, 0));
+    TEST_ASSERT_FALSE(tx.push({0, 1, 3}, 1));
+    TEST_ASSERT_EQUAL_size_t(0, link.frames.size());
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, tx.time_to_flush(20));
+    TEST_ASSERT_EQUAL_UINT32(1, tx.stats().held);
+    TEST_ASSERT_EQUAL_UINT32(1, tx.stats().rejected);
+
+    link.ready = true;
+    TEST_ASSERT_EQUAL_UINT32(0, tx.time_to_flush(20));
+    tx.tick(20);
+    receiver_t rx;
+    auto messages = deliver(link, rx);
+    TEST_ASSERT_EQUAL_size_t(2, messages.size());
+    TEST_ASSERT_EQUAL_UINT32(0, tx.stats().failed);
+    TEST_ASSERT_EQUAL_UINT8(0, tx.pending());
+}
+
+void test_invalid_frames() {
+    receiver_t rx;
+    uint8_t single[sizeof(message_t)] = {};
+    uint8_t bad_length[] = {espnow_batch::FRAME_MAGIC, espnow_batch::raw_codec<message_t>::VERSION, 0, 0, 2, 1, 2, 3};
+    auto ignore = [](const message_t&) {};
+    TEST_ASSERT_EQUAL_size_t(0, rx.unpack(single, sizeof(single), ignore));
+    TEST_ASSERT_EQUAL_size_t(0, rx.unpack(bad_length, sizeof(bad_length), ignore));
+    TEST_ASSERT_EQUAL_UINT32(2, rx.stats().invalid);
+}
+
+// Поток сообщений каждые 2 мс в течение 10 с: кадров, эфирное время и задержка на сообщение
+void bench_loopback() {
+    for(uint32_t latency : {0u, 10u, 40u})
+    {
+        loopback_t link;
+        espnow_batch::policy_t policy;
+        policy.max_messages = latency ? 0 : 1;  // без задержки - кадр на каждое сообщение, как раньше
+        policy.max_latency_ms = latency;
+        sender_t tx(loopback_t::send, &link, policy);
+        receiver_t rx;
+        std::vector<uint32_t> delays;
+        const uint32_t duration_ms = 10000, period_ms = 2;
+        uint32_t frames = 0;
+        for(uint32_t now = 0; now < duration_ms; ++now)
+        {
+            if(now % period_ms == 0) tx.push({now, 2, now}, now);
+            tx.tick(now);
+            frames += static_cast<uint32_t>(link.frames.size());
+            for(auto& m : deliver(link, rx)) delays.push_back(now - m.timestamp);
+        }
+        std::sort(delays.begin(), delays.end());
+
+        auto start = std::chrono::steady_clock::now();
+        const int iterations = 200000;
+        loopback_t sink;
+        sender_t bench(loopback_t::send, &sink, policy);
+        for(int i = 0; i < iterations; ++i) { bench.push({}, 0); if(sink.frames.size() > 64) sink.frames.clear(); }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        char report[200];
+        snprintf(report, sizeof(report), "latency %2u ms: %u msgs in %u frames, airtime %.1f%%, delay p50 %u ms p99 %u ms, host %.1f M msgs/s",
+                 latency, static_cast<unsigned>(delays.size()), frames, link.airtime_us / (duration_ms * 10.0),
+                 delays[delays.size() / 2], delays[delays.size() * 99 / 100], 1e3 * iterations / ns);
+        TEST_MESSAGE(report);
+        TEST_ASSERT_EQUAL_UINT32(duration_ms / period_ms - tx.pending(), delays.size());
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_capacity);
+    RUN_TEST(test_flush_by_size);
+    RUN_TEST(test_flush_by_latency);
+    RUN_TEST(test_sequence_loss_and_duplicates);
+    RUN_TEST(test_senders_tracked_by_mac);
+    RUN_TEST(test_held_until_transport_ready);
+    RUN_TEST(test_invalid_frames);
+    RUN_TEST(bench_loopback);
+
+    return UNITY_END();
+}
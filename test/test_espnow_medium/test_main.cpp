@@ -0,0 +1,178 @@
+// Модель эфира ESP-NOW и нагрузка на morse_relay_mgr: pio test -e native -f test_espnow_medium
+// Первые тесты проверяют саму модель (потери, задержка, обгон, скорость канала, адресация),
+// последние - прогоняют группы сервер + клиенты и печатают строки CSV (relay_load::CSV_HEADER) для сравнения.
+#include <unity.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "espnow_medium.h"
+#include "relay_load.h"
+
+using medium_t = espnow_medium::medium<morse_message_t>;
+
+void setUp() {}
+void tearDown() {}
+
+// Узел, запоминающий принятые кадры и момент приема
+struct sink_t : etl::espnow::manager<morse_message_t> {
+    std::vector<std::vector<uint8_t>> frames;
+    void on_data_recieve(const etl::espnow::endpoint_t&, const uint8_t* data, int len) override {
+        frames.emplace_back(data, data + len);
+    }
+};
+
+static void send(medium_t& air, size_t from, uint8_t tag, size_t length = 20)
+{
+    std::vector<uint8_t> data(length, tag);
+    air.transport()(air.port(from), data.data(), data.size());
+}
+
+void test_delay_and_airtime() {
+    espnow_medium::config_t config;
+    config.link.delay_us = 1000;
+    medium_t air(config);
+    sink_t a, b;
+    size_t ia = air.attach(esp_board::WEMOS_D1_Mini_v4_s001, a);
+    air.attach(esp_board::WEMOS_D1_Mini_v3_s002, b);
+
+    air.set_time(0);
+    send(air, ia, 1, 200);                      // (200 + 50) * 8 = 2000 мкс эфира
+    send(air, ia, 2, 200);                      // ждет освобождения эфира
+    TEST_ASSERT_EQUAL_UINT32(4000, static_cast<uint32_t>(air.air_free_us()));
+    air.deliver_until(2999);
+    TEST_ASSERT_EQUAL(0, b.frames.size());
+    air.deliver_until(3000);
+    TEST_ASSERT_EQUAL(1, b.frames.size());
+    air.deliver_until(5000);
+    TEST_ASSERT_EQUAL(2, b.frames.size());
+    TEST_ASSERT_EQUAL_UINT8(2, b.frames[1][0]);
+    TEST_ASSERT_EQUAL(0, a.frames.size());      // свой кадр не слышен
+    TEST_ASSERT_EQUAL_UINT32(2, air.stats().delivered);
+    TEST_ASSERT_EQUAL_UINT32(4000, static_cast<uint32_t>(air.stats().air_us));
+}
+
+void test_peers_and_broadcast() {
+    medium_t air;
+    sink_t a, b, c;
+    size_t ia = air.attach(esp_board::WEMOS_D1_Mini_v4_s001, a);
+    size_t ib = air.attach(esp_board::WEMOS_D1_Mini_v3_s002, b);
+    air.attach(esp_board::ESP32_C3_ProMini_s003, c);
+    air.add_peer(ib, ia);
+
+    send(air, ia, 1);                           // без пиров - всем
+    send(air, ib, 2);                           // только пиру
+    air.deliver_until(1000000);
+    TEST_ASSERT_EQUAL(1, a.frames.size());
+    TEST_ASSERT_EQUAL(1, b.frames.size());
+    TEST_ASSERT_EQUAL(1, c.frames.size());
+    TEST_ASSERT_EQUAL_UINT8(1, c.frames[0][0]);
+}
+
+void test_loss_and_reorder_are_seeded() {
+    espnow_medium::config_t config;
+    config.seed = 7;
+    config.link = {0.2, 500, 5000};             // 20% потерь, разброс больше времени в эфире
+    config.tx_queue = 0;                        // все 200 кадров отправляются разом
+    auto run = [&](std::vector<uint8_t>& order) {
+        medium_t air(config);
+        sink_t a, b;
+        size_t ia = air.attach(esp_board::WEMOS_D1_Mini_v4_s001, a);
+        air.attach(esp_board::WEMOS_D1_Mini_v3_s002, b);
+        for(uint8_t i = 0; i < 200; ++i) send(air, ia, i);
+        air.deliver_until(UINT64_MAX);
+        for(auto& frame : b.frames) order.push_back(frame[0]);
+        return air.stats();
+    };
+    std::vector<uint8_t> first, second;
+    espnow_medium::stats_t s1 = run(first), s2 = run(second);
+    TEST_ASSERT_TRUE(first == second);
+    TEST_ASSERT_EQUAL_UINT32(s1.lost, s2.lost);
+    TEST_ASSERT_EQUAL_UINT32(200, s1.lost + s1.delivered);
+    TEST_ASSERT_TRUE(s1.lost > 20 && s1.lost < 60);
+    TEST_ASSERT_TRUE(s1.reordered > 0);
+}
+
+void test_relay_pair_over_medium() {
+    relay_load::scenario_t s;
+    s.name = "unit";
+    s.duration_ms = 2000;
+    relay_load::report_t r = relay_load::run(s);
+    TEST_ASSERT_EQUAL_UINT32(20, r.sent);
+    TEST_ASSERT_EQUAL_UINT32(r.sent, r.received);
+    TEST_ASSERT_EQUAL_UINT32(2 * r.sent, r.replies);         // kTime + kBlink на каждый kCount
+    TEST_ASSERT_TRUE(r.max_ms <= s.policy.max_latency_ms + s.poll_ms + 5);  // ожидание пакета + опрос сервера
+    TEST_ASSERT_TRUE(r.callback_ns > 0);
+}
+
+void test_load_is_reproducible() {
+    relay_load::scenario_t s;
+    s.servers = 3;
+    s.rate_hz = 25;
+    s.duration_ms = 3000;
+    s.medium.link = {0.1, 800, 4000};
+    relay_load::report_t a = relay_load::run(s), b = relay_load::run(s);
+    TEST_ASSERT_EQUAL_UINT32(a.received, b.received);
+    TEST_ASSERT_EQUAL_UINT32(a.replies, b.replies);
+    TEST_ASSERT_EQUAL_UINT32(a.medium.lost, b.medium.lost);
+    TEST_ASSERT_EQUAL_UINT32(a.medium.reordered, b.medium.reordered);
+    TEST_ASSERT_TRUE(a.latency_ms == b.latency_ms);
+    s.medium.seed = 2;
+    relay_load::report_t c = relay_load::run(s);
+    TEST_ASSERT_TRUE(a.latency_ms != c.latency_ms);
+}
+
+// Топология плат: один сервер и несколько клиентов с разными MAC, сервер отвечает всем сразу
+void test_one_server_many_clients() {
+    relay_load::scenario_t s;
+    s.name = "star";
+    s.clients = 4;
+    s.duration_ms = 2000;
+    relay_load::report_t r = relay_load::run(s);
+    TEST_ASSERT_EQUAL_UINT32(4 * 20, r.sent);
+    TEST_ASSERT_EQUAL_UINT32(r.sent, r.received);
+    TEST_ASSERT_TRUE(r.worst_client_pct == 100);            // номера пакетов у каждого клиента свои
+    TEST_ASSERT_EQUAL_UINT32(2 * r.sent * s.clients, r.replies);    // ответ получает каждый клиент группы
+}
+
+void test_load_scenarios() {
+    struct row_t { const char* name; size_t servers, clients; double rate_hz; espnow_medium::link_t link; uint32_t bitrate; };
+    const row_t rows[] = {
+        {"quiet",      1, 1,  10, {0.00, 1000,    0}, 1000000},
+        {"quiet",      4, 1,  50, {0.00, 1000,    0}, 1000000},
+        {"star",       1, 8,  10, {0.00, 1000,    0}, 1000000},
+        {"busy",       8, 1, 100, {0.02, 1000, 3000}, 1000000},
+        {"busy-star",  2, 6, 100, {0.02, 1000, 3000}, 1000000},
+        {"lossy",      4, 1,  50, {0.10, 2000, 8000}, 1000000},
+        {"saturated", 16, 1, 200, {0.00, 1000,    0},  250000},
+    };
+    TEST_MESSAGE(relay_load::CSV_HEADER);
+    for(const row_t& row : rows) {
+        relay_load::scenario_t s;
+        s.name = row.name;
+        s.servers = row.servers;
+        s.clients = row.clients;
+        s.rate_hz = row.rate_hz;
+        s.medium.link = row.link;
+        s.medium.bitrate = row.bitrate;
+        relay_load::report_t r = relay_load::run(s);
+        char line[256];
+        relay_load::format_csv(s, r, line, sizeof(line));
+        TEST_MESSAGE(line);
+        TEST_ASSERT_EQUAL_UINT32(r.medium.addressed - r.medium.lost, r.medium.delivered + r.in_flight);
+        if(row.link.loss == 0 && r.medium.rejected == 0) TEST_ASSERT_EQUAL_UINT32(r.sent, r.received);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_delay_and_airtime);
+    RUN_TEST(test_peers_and_broadcast);
+    RUN_TEST(test_loss_and_reorder_are_seeded);
+    RUN_TEST(test_relay_pair_over_medium);
+    RUN_TEST(test_load_is_reproducible);
+    RUN_TEST(test_one_server_many_clients);
+    RUN_TEST(test_load_scenarios);
+
+    return UNITY_END();
+}
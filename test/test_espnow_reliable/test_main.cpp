@@ -0,0 +1,444 @@
+// Надежная доставка кадров ESP-NOW: pio test -e native -f test_espnow_reliable
+// Бенчмарк - два узла на модели канала: общий эфир 1 Мбит/с, задержка 1..3 мс, независимые потери кадров.
+// Отправитель всегда держит окно полным; полезная скорость и задержка кадра от send() до выдачи по порядку.
+#define ESPNOW_RELIABLE 1
+#include <unity.h>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "morse.h"
+#include "morse_espnow.h"
+
+using namespace espnow_reliable;
+using frames_t = std::vector<std::vector<uint8_t>>;
+using link_t = link<8>;
+
+static bool capture(void* context, const uint8_t* data, size_t length)
+{
+    static_cast<frames_t*>(context)->emplace_back(data, data + length);
+    return true;
+}
+
+// Кадр с номером n в первом байте
+static std::vector<uint8_t> payload(uint8_t n) { return std::vector<uint8_t>{n, 0xAA, 0x55}; }
+
+struct node_t {
+    link_t   link;
+    frames_t out;
+    std::vector<uint8_t> got;       // номера выданных кадров
+
+    node_t() { link.begin(capture, &out); }
+    void receive(const std::vector<uint8_t>& frame, uint32_t now) {
+        link.on_frame(frame.data(), frame.size(), now, [this](const uint8_t* data, size_t) { got.push_back(data[0]); });
+    }
+    void send(uint8_t n, uint32_t now) { auto p = payload(n); link.send(p.data(), p.size(), now); }
+};
+
+void setUp() { arduino_shim::set_millis(1000); }
+void tearDown() {}
+
+void test_reordered_frames_delivered_in_order() {
+    node_t a, b;
+    for(uint8_t n = 0; n < 3; ++n) a.send(n, 0);
+    TEST_ASSERT_EQUAL_size_t(3, a.link.in_flight());
+    b.receive(a.out[0], 5);
+    b.receive(a.out[2], 5);
+    TEST_ASSERT_EQUAL_size_t(1, b.got.size());
+    // Подтверждение: сеанс отправителя, next = 1, бит 0 - принят кадр 2
+    const auto& ack = b.out.back();
+    TEST_ASSERT_EQUAL_size_t(ACK_SIZE, ack.size());
+    TEST_ASSERT_EQUAL_UINT8(a.link.session(), ack[2]);
+    TEST_ASSERT_EQUAL_UINT8(1, ack[3]);
+    TEST_ASSERT_EQUAL_UINT8(1, ack[5]);
+    b.receive(a.out[1], 6);
+    b.receive(a.out[1], 6);
+    TEST_ASSERT_EQUAL_size_t(3, b.got.size());
+    for(uint8_t n = 0; n < 3; ++n) TEST_ASSERT_EQUAL_UINT8(n, b.got[n]);
+    TEST_ASSERT_EQUAL_UINT32(1, b.link.stats().reordered);
+    TEST_ASSERT_EQUAL_UINT32(1, b.link.stats().duplicates);
+
+    for(auto& frame : b.out) a.receive(frame, 10);
+    TEST_ASSERT_EQUAL_size_t(0, a.link.in_flight());
+    TEST_ASSERT_EQUAL_UINT32(10, a.link.srtt());
+    TEST_ASSERT_EQUAL_UINT32(link_t::NEVER, a.link.tick(10));
+}
+
+void test_timeout_retransmit_and_rto() {
+    node_t a, b;
+    a.send(0, 0);
+    TEST_ASSERT_EQUAL_UINT32(250, a.link.time_to_next(0));     // до первого замера - initial_rto_ms
+    a.link.tick(249);
+    TEST_ASSERT_EQUAL_size_t(1, a.out.size());
+    a.link.tick(250);                                           // первый кадр потерян - повтор
+    TEST_ASSERT_EQUAL_size_t(2, a.out.size());
+    TEST_ASSERT_EQUAL_UINT32(500, a.link.time_to_next(250));    // удвоенный таймаут
+    b.receive(a.out[1], 254);
+    a.receive(b.out.back(), 258);
+    TEST_ASSERT_EQUAL_UINT32(1, a.link.stats().acked);
+    TEST_ASSERT_EQUAL_UINT32(0, a.link.srtt());                 // по повтору rtt не считается
+
+    // Ответы через 8 мс: таймаут сходится к srtt + 4 * rttvar, не меньше min_rto_ms
+    for(uint32_t i = 0; i < 20; ++i) {
+        uint32_t now = 1000 + i * 100;
+        a.send(static_cast<uint8_t>(i + 1), now);
+        b.receive(a.out.back(), now + 4);
+        a.receive(b.out.back(), now + 8);
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, a.link.srtt());
+    TEST_ASSERT_EQUAL_UINT32(30, a.link.rto());
+    TEST_ASSERT_EQUAL_size_t(21, b.got.size());
+}
+
+void test_fast_retransmit_and_give_up() {
+    node_t a, b;
+    config_t config;
+    config.max_retries = 1;
+    a.link.begin(capture, &a.out, config);
+    for(uint8_t n = 0; n < 4; ++n) a.send(n, 0);
+    // Кадр 0 потерян, подтверждения 1..3 сообщают о дыре: на втором - повтор без таймаута
+    for(int i = 1; i < 4; ++i) {
+        b.receive(a.out[i], 3);
+        a.receive(b.out.back(), 6);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, a.link.stats().fast_retransmits);
+    TEST_ASSERT_EQUAL_size_t(5, a.out.size());
+    TEST_ASSERT_EQUAL_UINT8(0, a.out[4][DATA_HEADER]);
+
+    // Повтор тоже потерян, попытки кончились: кадр снимается, получатель пропускает его по base
+    a.link.tick(2000);
+    TEST_ASSERT_EQUAL_UINT32(1, a.link.stats().given_up);
+    TEST_ASSERT_EQUAL_size_t(0, a.link.in_flight());
+    a.send(4, 2000);
+    b.receive(a.out.back(), 2003);
+    TEST_ASSERT_EQUAL_size_t(4, b.got.size());
+    TEST_ASSERT_EQUAL_UINT8(1, b.got[0]);
+    TEST_ASSERT_EQUAL_UINT8(4, b.got[3]);
+    TEST_ASSERT_EQUAL_UINT32(1, b.link.stats().skipped);
+}
+
+void test_sender_restart_resyncs() {
+    node_t a, b;
+    for(uint8_t n = 0; n < 40; ++n) {
+        a.send(n, n);
+        b.receive(a.out.back(), n);
+        a.receive(b.out.back(), n);
+    }
+    node_t restarted;
+    restarted.send(100, 50);
+    b.receive(restarted.out.back(), 51);
+    TEST_ASSERT_EQUAL_UINT32(1, b.link.stats().resyncs);
+    TEST_ASSERT_EQUAL_UINT8(100, b.got.back());
+}
+
+// Перезапуск вскоре после начала: номера нового сеанса совпадают с уже принятыми, но это не повторы
+void test_early_restart_resyncs_by_session() {
+    node_t a, b;
+    a.link.set_session(1);
+    for(uint8_t n = 0; n < 3; ++n) {
+        a.send(n, n);
+        b.receive(a.out.back(), n);
+        a.receive(b.out.back(), n);
+    }
+    node_t restarted;
+    restarted.link.set_session(2);
+    restarted.send(10, 100);
+    restarted.send(11, 100);
+    b.receive(restarted.out[0], 101);
+    b.receive(restarted.out[1], 101);
+    TEST_ASSERT_EQUAL_UINT32(1, b.link.stats().resyncs);
+    TEST_ASSERT_EQUAL_UINT32(0, b.link.stats().duplicates);
+    TEST_ASSERT_EQUAL_size_t(5, b.got.size());
+    TEST_ASSERT_EQUAL_UINT8(11, b.got.back());
+
+    // Подтверждения доходят до нового сеанса, окно свободно без повторов
+    for(size_t i = b.out.size() - 2; i < b.out.size(); ++i) restarted.receive(b.out[i], 102);
+    TEST_ASSERT_EQUAL_size_t(0, restarted.link.in_flight());
+    TEST_ASSERT_EQUAL_UINT32(0, restarted.link.stats().retransmits);
+    // Запоздавшее подтверждение старого сеанса отбрасывается
+    restarted.send(12, 103);
+    restarted.receive(b.out[0], 104);
+    TEST_ASSERT_EQUAL_size_t(1, restarted.link.in_flight());
+    TEST_ASSERT_EQUAL_UINT32(1, restarted.link.stats().stale_acks);
+}
+
+// Реле в надежном режиме: первый кадр клиента потерян, счетчик доходит повтором
+struct pair_t {
+    morse_relay_mgr* peer = nullptr;
+    size_t sent = 0;
+    size_t drop = SIZE_MAX;         // номер кадра, который теряется
+    static bool send(void* context, const uint8_t* data, size_t length) {
+        auto self = static_cast<pair_t*>(context);
+        if(self->sent++ != self->drop) self->peer->deliver(esp_board::WEMOS_D1_Mini_v4_s001, data, static_cast<int>(length));
+        return true;
+    }
+};
+
+void test_relay_reliable_mode() {
+    morse_relay_mgr client(false), server(true);
+    pair_t to_server, to_client;
+    to_server.peer = &server;
+    to_server.drop = 0;
+    to_client.peer = &client;
+    espnow_batch::policy_t policy;
+    policy.max_latency_ms = 0;
+    client.set_transport(pair_t::send, &to_server, policy);
+    server.set_transport(pair_t::send, &to_client, policy);
+
+    client.send_count(7);
+    client.flush();
+    server.tick();
+    TEST_ASSERT_EQUAL_UINT32(0, server.telemetry().counters().received);
+    uint32_t wait = client.time_to_next(millis());
+    TEST_ASSERT_EQUAL_UINT32(250, wait);
+    delay(wait);
+    client.tick();                                              // повтор
+    server.tick();                                              // kCount -> kTime + kBlink
+    client.tick();
+    server.tick();
+    TEST_ASSERT_EQUAL_UINT32(1, server.telemetry().counters().received);
+    TEST_ASSERT_EQUAL_UINT32(1, client.reliable().stats().retransmits);
+    TEST_ASSERT_EQUAL_UINT32(2, client.telemetry().counters().received);
+    // kTime и kBlink несут время и уходят без подтверждения: повтор через rto принес бы устаревшую метку
+    TEST_ASSERT_EQUAL_UINT32(0, server.reliable().stats().sent);
+    TEST_ASSERT_EQUAL_UINT32(morse_relay_mgr::NEVER, server.reliable().time_to_next(millis()));
+    TEST_ASSERT_EQUAL_size_t(1, client.sync().samples());
+    int32_t offset = client.sync().offset(millis());                // часы общие, kCount дошел повтором: rtt 250 мс
+    TEST_ASSERT_TRUE(static_cast<uint32_t>(offset < 0 ? -offset : offset) <= client.sync().error_bound());
+}
+
+// Окно занято: новые сообщения ждут в пакете отправителя, а не теряются, и уходят после подтверждений
+struct queued_t {
+    std::vector<std::vector<uint8_t>> frames;
+    static bool send(void* context, const uint8_t* data, size_t length) {
+        static_cast<queued_t*>(context)->frames.emplace_back(data, data + length);
+        return true;
+    }
+    void deliver_to(morse_relay_mgr& peer) {
+        auto pending = std::move(frames);
+        frames.clear();
+        for(auto& frame : pending) {
+            peer.deliver(esp_board::WEMOS_D1_Mini_v4_s001, frame.data(), static_cast<int>(frame.size()));
+            peer.tick();                    // очередь кадров приема короче окна
+        }
+    }
+};
+
+void test_relay_full_window_holds_messages() {
+    morse_relay_mgr client(false), server(true);
+    queued_t to_server, to_client;
+    espnow_batch::policy_t policy;
+    policy.max_latency_ms = 0;
+    client.set_transport(queued_t::send, &to_server, policy);
+    server.set_transport(queued_t::send, &to_client, policy);
+    std::vector<uint32_t> counts;
+    server.set_log([](void* context, bool received, const morse_message_t& msg, int8_t) {
+        if(received && msg.id == morse_message_t::type_t::kCount) static_cast<std::vector<uint32_t>*>(context)->push_back(msg.value);
+    }, &counts);
+
+    // Окно из ESPNOW_RELIABLE_WINDOW кадров, подтверждений пока нет
+    const uint32_t TOTAL = ESPNOW_RELIABLE_WINDOW + 5;
+    for(uint32_t i = 0; i < TOTAL; ++i) {
+        client.send_count(i);
+        client.flush();
+        delay(1);
+    }
+    TEST_ASSERT_EQUAL_size_t(ESPNOW_RELIABLE_WINDOW, client.reliable().in_flight());
+    TEST_ASSERT_EQUAL_UINT32(0, client.batch_tx().stats().failed);
+    TEST_ASSERT_EQUAL_UINT8(5, client.batch_tx().pending());
+    TEST_ASSERT_EQUAL_UINT32(0, client.reliable().stats().window_full);
+
+    // Подтверждения освобождают окно - отложенный кадр уходит из tick()
+    for(int round = 0; round < 4; ++round) {
+        to_server.deliver_to(server);
+        to_client.deliver_to(client);
+    }
+    TEST_ASSERT_EQUAL_size_t(TOTAL, counts.size());
+    for(uint32_t i = 0; i < TOTAL; ++i) TEST_ASSERT_EQUAL_UINT32(i, counts[i]);
+    TEST_ASSERT_EQUAL_UINT8(0, client.batch_tx().pending());
+    TEST_ASSERT_EQUAL_UINT32(0, client.batch_tx().stats().failed);
+    TEST_ASSERT_EQUAL_UINT32(0, client.batch_tx().stats().rejected);
+}
+
+// Модель канала: общий эфир, кадр занимает (длина + 50 байт служебных) * 8 мкс, потом задержка 1..3 мс
+struct wire_t {
+    struct packet_t { uint32_t at; int to; std::vector<uint8_t> data; int from; };
+    std::vector<packet_t> packets;
+    std::mt19937 rng{7};
+    double   loss = 0;
+    uint32_t now = 0;
+    uint32_t air_free = 0;
+    uint32_t frames = 0;
+};
+
+struct endpoint_t {
+    wire_t* wire;
+    int     to;
+    int     from = -1;
+    static bool send(void* context, const uint8_t* data, size_t length) {
+        auto self = static_cast<endpoint_t*>(context);
+        wire_t& w = *self->wire;
+        std::uniform_real_distribution<double> uni(0, 1);
+        uint32_t air = static_cast<uint32_t>(((length + 50) * 8 + 999) / 1000);
+        uint32_t start = std::max(w.now, w.air_free);
+        w.air_free = start + air;
+        ++w.frames;
+        if(uni(w.rng) >= w.loss) w.packets.push_back({w.air_free + 1 + static_cast<uint32_t>(uni(w.rng) * 3), self->to, {data, data + length}, self->from});
+        return true;
+    }
+};
+
+// Сервер подтверждает всем клиентам сразу, как espnow_send_all
+struct broadcast_t {
+    std::vector<endpoint_t> ends;
+    static bool send(void* context, const uint8_t* data, size_t length) {
+        for(endpoint_t& end : static_cast<broadcast_t*>(context)->ends) endpoint_t::send(&end, data, length);
+        return true;
+    }
+};
+
+// Один сервер и несколько клиентов с потерями: у каждого клиента свой сеанс, окно приема на сервере - свое.
+// С общим окном кадр другого клиента пересинхронизировал бы прием, а выброшенные из окна кадры уже подтверждены
+void test_star_with_loss_delivers_every_client() {
+    constexpr int CLIENTS = 3;
+    constexpr uint32_t COUNT = 300;
+    wire_t wire;
+    wire.loss = 0.1;
+    broadcast_t down;
+    for(int c = 0; c < CLIENTS; ++c) down.ends.push_back({&wire, c + 1, 0});
+    stats_t server_stats;
+    receiver_table<8, 4> server;
+    server.begin(broadcast_t::send, &down, &server_stats);
+    stats_t client_stats[CLIENTS];
+    sender<8> clients[CLIENTS];
+    endpoint_t ups[CLIENTS];
+    for(int c = 0; c < CLIENTS; ++c) {
+        ups[c] = {&wire, 0, c + 1};
+        clients[c].begin(endpoint_t::send, &ups[c], config_t{}, &client_stats[c]);
+        clients[c].set_session(static_cast<uint8_t>(0x40 + c));
+    }
+
+    std::vector<uint32_t> got[CLIENTS];
+    uint32_t next[CLIENTS] = {};
+    size_t done = 0;
+    auto busy = [&] {
+        for(const auto& client : clients) if(client.in_flight()) return true;
+        return done < CLIENTS * COUNT;
+    };
+    for(wire.now = 0; busy() && wire.now < 120000; ++wire.now) {
+        for(size_t i = 0; i < wire.packets.size();) {
+            if(wire.packets[i].at > wire.now) { ++i; continue; }
+            auto packet = std::move(wire.packets[i]);
+            wire.packets.erase(wire.packets.begin() + i);
+            if(packet.to == 0) {
+                const uint8_t mac[6] = {0x02, 0, 0, 0, 0, static_cast<uint8_t>(packet.from)};
+                server.on_data(mac, wire.now, packet.data.data(), packet.data.size(), [&](const uint8_t* data, size_t) {
+                    got[data[0]].push_back(data[1] | (data[2] << 8));
+                    ++done;
+                });
+            }
+            else clients[packet.to - 1].on_ack(packet.data.data(), packet.data.size(), wire.now);
+        }
+        for(int c = 0; c < CLIENTS; ++c) {
+            clients[c].tick(wire.now);
+            if(wire.now % 5 == 0 && next[c] < COUNT && clients[c].can_send()) {
+                const uint8_t frame[3] = {static_cast<uint8_t>(c), static_cast<uint8_t>(next[c]), static_cast<uint8_t>(next[c] >> 8)};
+                clients[c].send(frame, sizeof(frame), wire.now);
+                ++next[c];
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, server_stats.resyncs);
+    TEST_ASSERT_EQUAL_UINT32(0, server_stats.skipped);
+    for(int c = 0; c < CLIENTS; ++c) {
+        TEST_ASSERT_EQUAL_size_t(COUNT, got[c].size());
+        for(uint32_t i = 0; i < COUNT; ++i) TEST_ASSERT_EQUAL_UINT32(i, got[c][i]);
+        TEST_ASSERT_EQUAL_UINT32(COUNT, client_stats[c].acked);         // подтвержден - значит выдан
+        TEST_ASSERT_EQUAL_UINT32(0, client_stats[c].given_up);
+        TEST_ASSERT_TRUE(client_stats[c].stale_acks > 0);               // подтверждения соседям отброшены по сеансу
+    }
+}
+
+struct bench_t {
+    double   goodput;       // кадров в секунду
+    double   p50, p99, max; // мс от send() до выдачи по порядку
+    uint32_t retransmits;
+    uint32_t air_frames;
+    bool     in_order;
+};
+
+template<size_t Window>
+static bench_t run_bench(double loss, uint32_t count)
+{
+    wire_t wire;
+    wire.loss = loss;
+    link<Window> nodes[2];
+    endpoint_t ends[2] = {{&wire, 1}, {&wire, 0}};
+    nodes[0].begin(endpoint_t::send, &ends[0]);
+    nodes[1].begin(endpoint_t::send, &ends[1]);
+
+    std::vector<uint32_t> sent_at(count), latency;
+    uint32_t next = 0, expected = 0;
+    bool in_order = true;
+    uint8_t frame[120] = {};
+    auto deliver = [&](const uint8_t* data, size_t) {
+        uint32_t n = data[0] | (data[1] << 8) | (data[2] << 16);
+        in_order &= n == expected++;
+        latency.push_back(wire.now - sent_at[n]);
+    };
+    for(wire.now = 0; expected < count && wire.now < 600000; ++wire.now) {
+        for(size_t i = 0; i < wire.packets.size();) {
+            if(wire.packets[i].at > wire.now) { ++i; continue; }
+            auto packet = std::move(wire.packets[i]);
+            wire.packets.erase(wire.packets.begin() + i);
+            nodes[packet.to].on_frame(packet.data.data(), packet.data.size(), wire.now, deliver);
+        }
+        nodes[0].tick(wire.now);
+        while(next < count && nodes[0].can_send()) {
+            frame[0] = static_cast<uint8_t>(next);
+            frame[1] = static_cast<uint8_t>(next >> 8);
+            frame[2] = static_cast<uint8_t>(next >> 16);
+            sent_at[next] = wire.now;
+            nodes[0].send(frame, sizeof(frame), wire.now);
+            ++next;
+        }
+    }
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double p) { return latency.empty() ? 0.0 : double(latency[std::min(latency.size() - 1, size_t(p / 100 * latency.size()))]); };
+    return {latency.size() * 1000.0 / wire.now, pct(50), pct(99), latency.empty() ? 0.0 : double(latency.back()),
+            nodes[0].stats().retransmits + nodes[0].stats().fast_retransmits, wire.frames, in_order && expected == count};
+}
+
+void test_benchmark_goodput_and_latency() {
+    const uint32_t COUNT = 2000;
+    const double losses[] = {0.0, 0.05, 0.2};
+    char line[200];
+    for(double loss : losses) {
+        bench_t stop = run_bench<1>(loss, COUNT);
+        bench_t window = run_bench<8>(loss, COUNT);
+        snprintf(line, sizeof(line), "loss %2.0f%%: stop-and-wait %4.0f fr/s p99 %3.0f ms | window 8 %4.0f fr/s p50 %2.0f p99 %3.0f max %4.0f ms, %u retx, %u frames on air",
+                 loss * 100, stop.goodput, stop.p99, window.goodput, window.p50, window.p99, window.max, unsigned(window.retransmits), unsigned(window.air_frames));
+        TEST_MESSAGE(line);
+        TEST_ASSERT_TRUE(stop.in_order);
+        TEST_ASSERT_TRUE(window.in_order);
+        TEST_ASSERT_TRUE(window.goodput > 2 * stop.goodput);
+    }
+    snprintf(line, sizeof(line), "fire-and-forget at 20%% loss: ~%u of %u frames arrive, gaps never filled", unsigned(COUNT * 8 / 10), unsigned(COUNT));
+    TEST_MESSAGE(line);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_reordered_frames_delivered_in_order);
+    RUN_TEST(test_timeout_retransmit_and_rto);
+    RUN_TEST(test_fast_retransmit_and_give_up);
+    RUN_TEST(test_sender_restart_resyncs);
+    RUN_TEST(test_early_restart_resyncs_by_session);
+    RUN_TEST(test_relay_reliable_mode);
+    RUN_TEST(test_relay_full_window_holds_messages);
+    RUN_TEST(test_star_with_loss_delivers_every_client);
+    RUN_TEST(test_benchmark_goodput_and_latency);
+
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+// Тесты затемнения по таблице гамма-коррекции: pio test -e native -f test_led_fade
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "led_fade.h"
+
+using namespace led_fade;
+
+// Таблицы строятся при компиляции
+static_assert(gamma_10bit.value[0] == 0, "gamma: ноль");
+static_assert(gamma_10bit.max_duty() == 1023, "gamma: 10 бит");
+static_assert(gamma_12bit.value[gamma_table::SIZE - 1] == 4095 << gamma_table::FRACTION, "gamma: максимум");
+
+struct write_t { uint8_t channel; uint16_t duty; };
+static std::vector<write_t> writes;
+static void record_write(uint8_t channel, uint16_t duty) { writes.push_back({channel, duty}); }
+
+using test_fader_t = fader<3, record_write>;
+
+void setUp() { writes.clear(); }
+
+void tearDown() {}
+
+void test_gamma_tables() {
+    for(const gamma_table* table : {&gamma_8bit, &gamma_10bit, &gamma_12bit}) {
+        TEST_ASSERT_EQUAL_UINT16(0, table->apply(0));
+        TEST_ASSERT_EQUAL_UINT16(table->max_duty(), table->apply(MAX_LEVEL));
+        uint16_t previous = 0;
+        for(uint32_t level = 0; level <= MAX_LEVEL; level += 17) {
+            uint16_t duty = table->apply(static_cast<uint16_t>(level));
+            TEST_ASSERT_TRUE(duty >= previous);         // монотонно
+            // Не дальше 1 младшего разряда от точной кривой
+            double exact = std::pow(level / 65536.0, 2.2) * table->max_duty();
+            TEST_ASSERT_TRUE(std::fabs(duty - exact) <= 1.0);
+            previous = duty;
+        }
+    }
+}
+
+void test_linear_table() {
+    constexpr gamma_table linear = make_gamma_table<8, 10>();
+    TEST_ASSERT_EQUAL_UINT16(128, linear.apply(0x8000));
+    TEST_ASSERT_EQUAL_UINT16(64, linear.apply(0x4000));
+}
+
+void test_easing() {
+    for(easing_t easing : {easing_t::kLinear, easing_t::kInQuad, easing_t::kOutQuad, easing_t::kInOutQuad, easing_t::kSmoothstep}) {
+        TEST_ASSERT_EQUAL_UINT16(0, ease(easing, 0));
+        TEST_ASSERT_EQUAL_UINT16(MAX_LEVEL, ease(easing, MAX_LEVEL));
+        uint16_t previous = 0;
+        for(uint32_t p = 0; p <= MAX_LEVEL; p += 97) {
+            uint16_t value = ease(easing, static_cast<uint16_t>(p));
+            TEST_ASSERT_TRUE(value >= previous);
+            previous = value;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT16(0x4000, ease(easing_t::kInQuad, 0x8000));
+    TEST_ASSERT_EQUAL_UINT16(0xC000, ease(easing_t::kOutQuad, 0x8000));
+    TEST_ASSERT_UINT16_WITHIN(1, 0x8000, ease(easing_t::kSmoothstep, 0x8000));
+    TEST_ASSERT_UINT16_WITHIN(1, 0x8000, ease(easing_t::kInOutQuad, 0x8000));
+}
+
+void test_fade_channels() {
+    test_fader_t fader(gamma_10bit);
+    TEST_ASSERT_EQUAL_UINT32(test_fader_t::NEVER, fader.time_to_next(0));
+
+    fader.fade_to(0, MAX_LEVEL, 1000, easing_t::kLinear, 0);
+    fader.fade_to(2, MAX_LEVEL, 500, easing_t::kSmoothstep, 0);
+    TEST_ASSERT_EQUAL_UINT32(test_fader_t::FRAME_INTERVAL, fader.time_to_next(0));
+    TEST_ASSERT_EQUAL_UINT32(0, fader.tick(250));
+    TEST_ASSERT_UINT16_WITHIN(2, MAX_LEVEL / 4, fader.level(0));
+    TEST_ASSERT_EQUAL_UINT32(1u << 2, fader.tick(500));
+    TEST_ASSERT_EQUAL_UINT16(MAX_LEVEL, fader.level(2));
+    TEST_ASSERT_EQUAL_UINT16(1023, fader.duty(2));
+    TEST_ASSERT_FALSE(fader.is_active(2));
+    TEST_ASSERT_EQUAL_UINT32(5, fader.time_to_next(995));
+    TEST_ASSERT_EQUAL_UINT32(1u << 0, fader.tick(1000));
+    TEST_ASSERT_EQUAL_UINT32(test_fader_t::NEVER, fader.time_to_next(1000));
+
+    // Обратное затемнение начинается с текущей яркости
+    fader.fade_to(0, 0, 100, easing_t::kOutQuad, 2000);
+    fader.tick(2050);
+    TEST_ASSERT_TRUE(fader.level(0) < MAX_LEVEL);
+    fader.set(0, 0);
+    TEST_ASSERT_FALSE(fader.is_active(0));
+    TEST_ASSERT_EQUAL_UINT16(0, fader.duty(0));
+    TEST_ASSERT_EQUAL_UINT32(0, fader.tick(3000));
+}
+
+void test_writes_only_on_change() {
+    test_fader_t fader(gamma_8bit);
+    fader.fade_to(1, 0x1000, 10000, easing_t::kLinear, 0);     // медленно и тускло: скважность меняется редко
+    for(uint32_t now = 0; now <= 10000; now += 10) fader.tick(now);
+    TEST_ASSERT_TRUE(writes.size() < 10);
+    for(const auto& write : writes) TEST_ASSERT_EQUAL_UINT8(1, write.channel);
+    TEST_ASSERT_EQUAL_UINT16(gamma_8bit.apply(0x1000), writes.back().duty);
+
+    writes.clear();
+    fader.fade_to(1, 0x1000, 0, easing_t::kLinear, 10000);       // нулевая длительность - сразу, без записи той же скважности
+    TEST_ASSERT_EQUAL_size_t(0, writes.size());
+}
+
+// Стоимость tick() на канал на компьютере
+static void null_write(uint8_t, uint16_t) {}
+
+void bench_tick() {
+    fader<8, null_write> fader(gamma_12bit);
+    const uint32_t frames = 1000000;
+    for(size_t i = 0; i < 8; ++i) fader.fade_to(i, MAX_LEVEL, UINT32_MAX - 1, easing_t::kSmoothstep, 0);
+    auto start = std::chrono::steady_clock::now();
+    uint32_t finished = 0;
+    for(uint32_t now = 1; now <= frames; ++now) finished |= fader.tick(now * 1000);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    char report[80];
+    snprintf(report, sizeof(report), "fader tick: %.1f ns/channel", double(ns) / frames / 8);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_EQUAL_UINT32(0, finished);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_gamma_tables);
+    RUN_TEST(test_linear_table);
+    RUN_TEST(test_easing);
+    RUN_TEST(test_fade_channels);
+    RUN_TEST(test_writes_only_on_change);
+    RUN_TEST(bench_tick);
+
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+// Тесты телеметрии канала: pio test -e native -f test_link_telemetry
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "link_telemetry.h"
+
+using namespace link_telemetry;
+
+void test_log_buckets() {
+    using hist_t = log_histogram<32>;
+    const uint32_t values[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 11, 12, 16, 24, 100, 1000};
+    for(uint32_t value : values) {
+        size_t index = hist_t::bucket_of(value);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(value, hist_t::lower_bound(index));
+        if(index + 1 < hist_t::BUCKETS) TEST_ASSERT_GREATER_THAN_UINT32(value, hist_t::lower_bound(index + 1));
+    }
+    TEST_ASSERT_EQUAL_size_t(31, hist_t::bucket_of(UINT32_MAX));   // все большое - в последней корзине
+    TEST_ASSERT_EQUAL_size_t(7, log_histogram<8>::bucket_of(1000));
+}
+
+void test_percentiles() {
+    log_histogram<32> hist;
+    for(uint32_t i = 0; i < 90; ++i) hist.add(10);
+    for(uint32_t i = 0; i < 10; ++i) hist.add(200);
+    TEST_ASSERT_EQUAL_UINT32(100, hist.count());
+    TEST_ASSERT_EQUAL_UINT32(10, hist.min());
+    TEST_ASSERT_EQUAL_UINT32(200, hist.max());
+    TEST_ASSERT_EQUAL_UINT32(10, hist.percentile(50));
+    TEST_ASSERT_EQUAL_UINT32(10, hist.percentile(90));
+    TEST_ASSERT_UINT32_WITHIN(64, 200, hist.percentile(99));
+}
+
+void test_round_trip_and_timeouts() {
+    telemetry t;
+    t.on_request(1000);
+    t.on_request(3000);
+    t.on_reply(1000, 1025, -60);        // ответ на первый
+    t.on_reply(777, 1030, -60);         // чужая метка
+    t.tick(3000 + telemetry::REPLY_TIMEOUT);
+    TEST_ASSERT_EQUAL_UINT32(2, t.counters().requests);
+    TEST_ASSERT_EQUAL_UINT32(1, t.counters().replies);
+    TEST_ASSERT_EQUAL_UINT32(1, t.counters().unmatched);
+    TEST_ASSERT_EQUAL_UINT32(1, t.counters().timeouts);
+    TEST_ASSERT_EQUAL_UINT32(25, t.rtt().max());
+    TEST_ASSERT_EQUAL_size_t(2, t.samples());
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(sample_kind_t::kReply), static_cast<uint8_t>(t.sample(0).kind));
+    TEST_ASSERT_EQUAL_UINT16(25, t.sample(0).value);
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(sample_kind_t::kTimeout), static_cast<uint8_t>(t.sample(1).kind));
+
+    // Поздний ответ после таймаута уже не считается
+    t.on_reply(3000, 4500, -60);
+    TEST_ASSERT_EQUAL_UINT32(2, t.counters().unmatched);
+}
+
+void test_pending_overflow_counts_timeout() {
+    telemetry t;
+    for(uint32_t i = 0; i <= telemetry::PENDING; ++i) t.on_request(i);   // самый старый вытеснен
+    TEST_ASSERT_EQUAL_UINT32(1, t.counters().timeouts);
+    t.on_reply(0, 10, RSSI_UNKNOWN);
+    TEST_ASSERT_EQUAL_UINT32(1, t.counters().unmatched);
+}
+
+void test_loss_and_rssi() {
+    telemetry t;
+    t.on_receive(-70);
+    t.on_receive(-72);
+    t.on_receive(RSSI_UNKNOWN);         // не попадает в гистограмму
+    t.on_frames(10, 0, 100);
+    t.on_frames(15, 3, 200);
+    t.on_frames(16, 3, 300);
+    TEST_ASSERT_EQUAL_UINT32(3, t.counters().received);
+    TEST_ASSERT_EQUAL_UINT32(2, t.rssi().count());
+    TEST_ASSERT_EQUAL_INT8(-72, t.last_rssi());
+    TEST_ASSERT_EQUAL_UINT32(3, t.counters().lost);
+    TEST_ASSERT_EQUAL_size_t(1, t.samples());
+    TEST_ASSERT_EQUAL_UINT16(3, t.sample(0).value);
+    TEST_ASSERT_EQUAL_INT8(-72, t.sample(0).rssi);
+}
+
+void test_ring_keeps_latest() {
+    telemetry t;
+    for(uint32_t i = 0; i < telemetry::SAMPLES + 10; ++i) {
+        t.on_request(i * 10);
+        t.on_reply(i * 10, i * 10 + 5, -50);
+    }
+    TEST_ASSERT_EQUAL_size_t(telemetry::SAMPLES, t.samples());
+    TEST_ASSERT_EQUAL_UINT32(10 * 10 + 5, t.sample(0).time);
+    TEST_ASSERT_EQUAL_UINT32((telemetry::SAMPLES + 9) * 10 + 5, t.sample(telemetry::SAMPLES - 1).time);
+}
+
+void test_csv_and_binary_dump() {
+    telemetry t;
+    t.on_request(100);
+    t.on_reply(100, 112, -61);
+    t.on_receive(-61);
+    t.on_frames(5, 1, 120);
+
+    std::vector<std::string> lines;
+    t.write_csv(1000, [&](const char* line) { lines.push_back(line); });
+    TEST_ASSERT_EQUAL_STRING("counters,1000,1,1,0,0,1,5,1,-61", lines[1].c_str());
+    bool has_rtt = false, has_rssi = false;
+    for(auto& line : lines) {
+        has_rtt |= line == "rtt_ms,12,1";
+        has_rssi |= line == "rssi_dbm,-65,1";
+    }
+    TEST_ASSERT_TRUE(has_rtt);
+    TEST_ASSERT_TRUE(has_rssi);
+    TEST_ASSERT_EQUAL_STRING("sample,120,loss,1,-61", lines.back().c_str());
+
+    std::vector<uint8_t> binary;
+    t.write_binary(1000, [&](const uint8_t* data, size_t size) { binary.insert(binary.end(), data, data + size); });
+    TEST_ASSERT_EQUAL_size_t(telemetry::binary_size(2), binary.size());
+    TEST_ASSERT_EQUAL_UINT8('L', binary[0]);
+    TEST_ASSERT_EQUAL_UINT8('T', binary[1]);
+    TEST_ASSERT_EQUAL_UINT8(telemetry::BINARY_VERSION, binary[2]);
+    TEST_ASSERT_EQUAL_UINT8(2, binary[5]);
+
+    // После сброса потери считаются заново от текущих итогов приемника
+    t.reset();
+    t.on_frames(7, 1, 2000);
+    lines.clear();
+    t.write_csv(2000, [&](const char* line) { lines.push_back(line); });
+    TEST_ASSERT_EQUAL_STRING("counters,2000,0,0,0,0,0,2,0,0", lines[1].c_str());
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_log_buckets);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_round_trip_and_timeouts);
+    RUN_TEST(test_pending_overflow_counts_timeout);
+    RUN_TEST(test_loss_and_rssi);
+    RUN_TEST(test_ring_keeps_latest);
+    RUN_TEST(test_csv_and_binary_dump);
+
+    return UNITY_END();
+}
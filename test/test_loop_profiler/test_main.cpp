@@ -0,0 +1,124 @@
+// Тесты профилировщика loop() с управляемыми часами: pio test -e native -f test_loop_profiler
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "loop_profiler.h"
+
+static volatile uint32_t fake_ticks = 0;    // 80 тактов на микросекунду, как ESP8266 на 80 МГц
+static uint32_t fake_us = 0;
+static uint32_t ticks_clock() { return fake_ticks; }
+static uint32_t us_clock() { return fake_us; }
+
+using test_profiler_t = loop_profiler::profiler<4, ticks_clock, 80, us_clock>;
+
+void setUp() { fake_ticks = 0; fake_us = 0; }
+
+void tearDown() {}
+
+void test_scope_stats() {
+    test_profiler_t profiler;
+    int id = profiler.add("morse");
+    TEST_ASSERT_EQUAL_INT(id, profiler.add("morse"));
+    for(uint32_t us : {10u, 20u, 30u, 1000u}) {
+        loop_profiler::scoped_timer<test_profiler_t> timer(profiler, id);
+        fake_ticks += us * 80;
+    }
+    const auto& h = profiler.scope(id).us;
+    TEST_ASSERT_EQUAL_UINT32(4, h.count());
+    TEST_ASSERT_EQUAL_UINT32(10, h.min());
+    TEST_ASSERT_EQUAL_UINT32(1000, h.max());
+    TEST_ASSERT_EQUAL_UINT32(265, h.mean());
+}
+
+void test_scope_limit() {
+    test_profiler_t profiler;
+    for(const char* name : {"a", "b", "c", "d"}) TEST_ASSERT_NOT_EQUAL(test_profiler_t::INVALID, profiler.add(name));
+    TEST_ASSERT_EQUAL_INT(test_profiler_t::INVALID, profiler.add("e"));
+    TEST_ASSERT_EQUAL_size_t(1, profiler.dropped());
+    // Время лишней области копится в общей строке, выгрузка показывает переполнение
+    uint32_t start = test_profiler_t::now();
+    fake_ticks += 7 * 80;
+    profiler.record(test_profiler_t::INVALID, start);
+    TEST_ASSERT_EQUAL_UINT32(1, profiler.overflow().count());
+    std::vector<std::string> lines;
+    profiler.write_csv([&](const char* line) { lines.push_back(line); });
+    TEST_ASSERT_EQUAL_STRING("scope,(overflow),1,7,7,7,7,7", lines[7].c_str());
+    TEST_ASSERT_EQUAL_STRING("hist,(overflow),6,1", lines.back().c_str());
+}
+
+void test_loop_gap() {
+    test_profiler_t profiler;
+    for(uint32_t gap : {100u, 5000u, 200u}) {
+        {
+            loop_profiler::loop_timer<test_profiler_t> loop(profiler);
+            fake_us += 50;
+        }
+        fake_us += gap;
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, profiler.loop().count());
+    TEST_ASSERT_EQUAL_UINT32(50, profiler.loop().max());
+    TEST_ASSERT_EQUAL_UINT32(2, profiler.gap().count());        // последний промежуток еще не закрыт
+    TEST_ASSERT_EQUAL_UINT32(5000, profiler.gap().max());
+}
+
+void test_csv() {
+    test_profiler_t profiler;
+    int id = profiler.add("espnow");
+    uint32_t start = test_profiler_t::now();
+    fake_ticks += 12 * 80;
+    profiler.record(id, start);
+    std::vector<std::string> lines;
+    profiler.write_csv([&](const char* line) { lines.push_back(line); });
+    TEST_ASSERT_EQUAL_STRING("scope,espnow,1,12,12,12,12,12", lines[3].c_str());
+    TEST_ASSERT_EQUAL_STRING("hist,espnow,12,1", lines.back().c_str());
+
+    profiler.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, profiler.scope(id).us.count());
+    TEST_ASSERT_EQUAL_size_t(1, profiler.size());                // имена областей сохраняются
+}
+
+void test_macros() {
+    // Глобальный профилировщик на часах замены Arduino
+    arduino_shim::set_millis(0);
+    for(int i = 0; i < 3; ++i) {
+        PROFILE_LOOP();
+        PROFILE_SCOPE("macro");
+        delay(2);
+    }
+    const auto& instance = loop_profiler::instance;
+    TEST_ASSERT_EQUAL_STRING("macro", instance.scope(0).name);
+    TEST_ASSERT_EQUAL_UINT32(3, instance.scope(0).us.count());
+    TEST_ASSERT_EQUAL_UINT32(2000, instance.scope(0).us.max());
+}
+
+// Стоимость одной области на компьютере: порядок накладных расходов на замер
+void bench_scope_overhead() {
+    test_profiler_t profiler;
+    int id = profiler.add("bench");
+    const int iterations = 10000000;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) {
+        loop_profiler::scoped_timer<test_profiler_t> timer(profiler, id);
+        ++fake_ticks;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    char report[80];
+    snprintf(report, sizeof(report), "scope timer: %.1f ns/scope", double(ns) / iterations);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_EQUAL_UINT32(iterations, profiler.scope(id).us.count());
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_scope_stats);
+    RUN_TEST(test_scope_limit);
+    RUN_TEST(test_loop_gap);
+    RUN_TEST(test_csv);
+    RUN_TEST(test_macros);
+    RUN_TEST(bench_scope_overhead);
+
+    return UNITY_END();
+}
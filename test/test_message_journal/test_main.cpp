@@ -0,0 +1,199 @@
+// Журнал сообщений на каталоге вместо LittleFS: pio test -e native -f test_message_journal
+// Маленькие сегменты (4 x 1 КБ), чтобы проверить ротацию; бенчмарк - записей в секунду против дозаписи по одной
+#define JOURNAL_SEGMENTS     4
+#define JOURNAL_SEGMENT_SIZE 1024
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "dir_fs.h"
+#include "message_journal.h"
+
+using namespace message_journal;
+using journal_t = journal<dir_fs>;
+
+struct message_t { uint32_t timestamp; uint8_t id; uint32_t value; };
+
+static std::string root;
+
+static void clear_dir()
+{
+    for(int k = 0; k < 10; ++k) {
+        std::string name = root + "/journal" + std::to_string(k) + ".bin";
+        ::remove(name.c_str());
+    }
+    ::remove((root + "/naive.bin").c_str());
+}
+
+static std::vector<uint32_t> seqs(journal_t& j, uint32_t from)
+{
+    std::vector<uint32_t> out;
+    j.for_each(from, [&](const record_t& r) { out.push_back(r.seq); });
+    return out;
+}
+
+void setUp() { clear_dir(); }
+
+void tearDown() {}
+
+void test_record_codec() {
+    record_t r;
+    r.seq = 7;
+    r.kind = kReceived;
+    r.type = 2;
+    r.rssi = -71;
+    r.timestamp = 123456;
+    r.value = 42;
+    uint8_t raw[RECORD_SIZE];
+    encode(r, raw);
+    record_t back;
+    TEST_ASSERT_TRUE(decode(raw, back));
+    TEST_ASSERT_EQUAL_UINT32(7, back.seq);
+    TEST_ASSERT_EQUAL_INT(-71, back.rssi);
+    TEST_ASSERT_EQUAL_UINT32(42, back.value);
+    char line[96];
+    format_csv(back, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("log,7,0,received,2,-71,123456,42,", line);
+    raw[16] ^= 1;
+    TEST_ASSERT_FALSE(decode(raw, back));
+}
+
+void test_page_buffering() {
+    dir_fs fs(root);
+    journal_t j(fs, 2000);
+    TEST_ASSERT_TRUE(j.begin());
+    fs.reset_stats();
+
+    for(uint32_t i = 0; i < 7; ++i) j.append_text("123", 3, 100 + i);
+    TEST_ASSERT_EQUAL_UINT32(0, fs.stats().writes);             // 7 записей - страница еще не набралась
+    TEST_ASSERT_EQUAL_UINT32(2000 - 400, j.time_to_next(500));
+    j.append_message(kSent, message_t{5, 2, 9}, 0, 110);
+    TEST_ASSERT_EQUAL_UINT32(1, fs.stats().writes);             // 8-я - целая страница одним write
+    TEST_ASSERT_EQUAL_UINT32(JOURNAL_PAGE_SIZE, fs.stats().bytes_written);
+    TEST_ASSERT_EQUAL_UINT32(journal_t::NEVER, j.time_to_next(110));
+
+    // По времени: 3 записи, затем еще 5 дописывают ту же страницу файла
+    for(uint32_t i = 0; i < 3; ++i) j.append_text("x", 1, 1000);
+    j.tick(2999);
+    TEST_ASSERT_EQUAL_UINT32(1, fs.stats().writes);
+    j.tick(3000);
+    TEST_ASSERT_EQUAL_UINT32(2, fs.stats().writes);
+    for(uint32_t i = 0; i < 5; ++i) j.append_text("y", 1, 3100);
+    TEST_ASSERT_EQUAL_UINT32(3, fs.stats().writes);
+    TEST_ASSERT_EQUAL_UINT32(2 * JOURNAL_PAGE_SIZE, fs.stats().bytes_written);
+
+    record_t r;
+    TEST_ASSERT_TRUE(j.read(8, r));
+    TEST_ASSERT_EQUAL_STRING("x", std::string(r.text, r.length).c_str());
+    TEST_ASSERT_TRUE(j.read(7, r));
+    TEST_ASSERT_EQUAL_UINT8(kSent, r.kind);
+    TEST_ASSERT_EQUAL_UINT32(9, r.value);
+    TEST_ASSERT_FALSE(j.read(16, r));
+}
+
+void test_rotation_and_tail() {
+    dir_fs fs(root);
+    journal_t j(fs);
+    j.begin();
+    // 32 записи на сегмент, 4 сегмента: 128-я запись открывает /journal0.bin заново, записи 0..31 стерты
+    for(uint32_t i = 0; i < 150; ++i) j.append_text("m", 1, i);
+    TEST_ASSERT_EQUAL_UINT32(150, j.next_seq());
+    TEST_ASSERT_EQUAL_UINT32(32, j.first_seq());
+    auto all = seqs(j, 0);
+    TEST_ASSERT_EQUAL_size_t(150 - 32, all.size());
+    for(size_t i = 0; i < all.size(); ++i) TEST_ASSERT_EQUAL_UINT32(32 + i, all[i]);
+
+    std::vector<uint32_t> last;
+    j.tail(5, [&](const record_t& r) { last.push_back(r.seq); });
+    TEST_ASSERT_EQUAL_size_t(5, last.size());
+    TEST_ASSERT_EQUAL_UINT32(145, last[0]);
+    TEST_ASSERT_EQUAL_UINT32(149, last[4]);                     // 144..149 еще в буфере
+    record_t r;
+    TEST_ASSERT_FALSE(j.read(10, r));                           // стерто
+    TEST_ASSERT_TRUE(j.read(100, r));
+}
+
+void test_recovery_after_reboot() {
+    dir_fs fs(root);
+    {
+        journal_t j(fs);
+        j.begin();
+        for(uint32_t i = 0; i < 45; ++i) j.append_text("r", 1, i);
+        j.flush();
+    }
+    journal_t again(fs);
+    TEST_ASSERT_TRUE(again.begin());
+    TEST_ASSERT_EQUAL_UINT32(45, again.next_seq());
+    TEST_ASSERT_EQUAL_UINT32(0, again.first_seq());
+    again.append_text("after", 5, 1000);
+    again.flush();
+    TEST_ASSERT_EQUAL_size_t(46, seqs(again, 0).size());
+
+    // Оборванная запись в конце сегмента: новая запись начинает следующий сегмент
+    {
+        FILE* f = fopen((root + "/journal1.bin").c_str(), "ab");
+        fwrite("torn", 1, 4, f);
+        fclose(f);
+    }
+    journal_t torn(fs);
+    TEST_ASSERT_TRUE(torn.begin());
+    TEST_ASSERT_EQUAL_UINT32(46, torn.next_seq());
+    torn.append_text("new", 3, 2000);
+    torn.flush();
+    auto all = seqs(torn, 0);
+    TEST_ASSERT_EQUAL_size_t(47, all.size());
+    TEST_ASSERT_EQUAL_UINT32(46, all.back());
+}
+
+void test_benchmark_records_per_second() {
+    const uint32_t N = 20000;
+    dir_fs fs(root);
+    journal_t j(fs, 2000);
+    j.begin();
+    fs.reset_stats();
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < N; ++i) j.append_message(kReceived, message_t{i, 1, i}, -60, i);
+    j.flush();
+    double journal_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    dir_fs::stats_t journal_stats = fs.stats();
+
+    // Наивно: open("a") + write + close на каждое сообщение
+    fs.reset_stats();
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < N; ++i) {
+        record_t r;
+        r.seq = i;
+        uint8_t raw[RECORD_SIZE];
+        encode(r, raw);
+        auto file = fs.open("/naive.bin", "a");
+        file.write(raw, sizeof(raw));
+        file.close();
+    }
+    double naive_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TEST_ASSERT_EQUAL_UINT32(N / RECORDS_PER_PAGE, journal_stats.writes);
+    char report[160];
+    snprintf(report, sizeof(report), "journal: %.0f rec/s, %lu writes, %lu opens; per-record append: %.0f rec/s, %lu writes, %lu opens",
+             N / journal_s, static_cast<unsigned long>(journal_stats.writes), static_cast<unsigned long>(journal_stats.opens),
+             N / naive_s, static_cast<unsigned long>(fs.stats().writes), static_cast<unsigned long>(fs.stats().opens));
+    TEST_MESSAGE(report);
+}
+
+int main() {
+    char tmpl[] = "/tmp/journal_XXXXXX";
+    root = mkdtemp(tmpl);
+    UNITY_BEGIN();
+
+    RUN_TEST(test_record_codec);
+    RUN_TEST(test_page_buffering);
+    RUN_TEST(test_rotation_and_tail);
+    RUN_TEST(test_recovery_after_reboot);
+    RUN_TEST(test_benchmark_records_per_second);
+
+    int failures = UNITY_END();
+    clear_dir();
+    rmdir(root.c_str());
+    return failures;
+}
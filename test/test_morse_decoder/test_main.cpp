@@ -0,0 +1,185 @@
+// Тесты декодера по синтетическим трассам фронтов: pio test -e native -f test_morse_decoder
+// Трассы строятся потоковым кодировщиком с теми же интервалами, что у MorseCode::tick(),
+// к длительностям добавляется дрожание и плавный дрейф скорости.
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "morse_encoder.h"
+#include "morse_decoder.h"
+
+using namespace morse_code;
+
+struct trace_config_t {
+    double   dit_begin = 50;    // длительность точки в начале сообщения, мс
+    double   dit_end   = 50;    // и в конце (линейный дрейф)
+    double   jitter    = 0;     // относительное дрожание каждой длительности, 0.1 = ±10%
+    uint32_t seed      = 1;
+};
+
+static std::vector<edge_t> make_trace(const std::string& text, const trace_config_t& config)
+{
+    // Сначала элементы, чтобы знать долю пройденного сообщения для дрейфа
+    std::vector<element_t> elements;
+    string_source source(text.data(), text.size());
+    encoder enc(&source);
+    element_t element;
+    while(enc.next(element)) elements.push_back(element);
+
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<double> noise(-config.jitter, config.jitter);
+    std::vector<edge_t> edges;
+    double time = 1000;
+    for(size_t i = 0; i < elements.size(); ++i)
+    {
+        double dit = config.dit_begin + (config.dit_end - config.dit_begin) * i / elements.size();
+        auto duration = [&](int units) { return units * dit * (1.0 + noise(rng)); };
+        switch(elements[i])
+        {
+        case DOT:
+        case DASH:
+            edges.push_back({static_cast<uint32_t>(time), 1});
+            time += duration(elements[i] == DOT ? 1 : 3);
+            edges.push_back({static_cast<uint32_t>(time), 0});
+            time += duration(1);
+            break;
+        case PAUSE: time += duration(3); break;
+        case WDBR:  time += duration(7); break;
+        }
+    }
+    edges.push_back({static_cast<uint32_t>(time + 10 * config.dit_end), 1});  // начало следующей передачи закрывает последнее слово
+    return edges;
+}
+
+static std::string decode(const std::vector<edge_t>& edges, uint32_t initial_dit, decoder* out = nullptr)
+{
+    decoder dec(initial_dit);
+    std::string result;
+    char ch;
+    for(const auto& edge : edges) {
+        dec.on_edge(edge.level, edge.time);
+        while(dec.read(ch)) result.push_back(ch);
+    }
+    while(!result.empty() && result.back() == ' ') result.pop_back();
+    if(out) *out = dec;
+    return result;
+}
+
+// Доля правильно принятых символов по расстоянию Левенштейна
+static double accuracy(const std::string& expected, const std::string& actual)
+{
+    std::vector<size_t> prev(actual.size() + 1), curr(actual.size() + 1);
+    for(size_t j = 0; j <= actual.size(); ++j) prev[j] = j;
+    for(size_t i = 1; i <= expected.size(); ++i) {
+        curr[0] = i;
+        for(size_t j = 1; j <= actual.size(); ++j) {
+            curr[j] = std::min({prev[j] + 1, curr[j - 1] + 1, prev[j - 1] + (expected[i - 1] == actual[j - 1] ? 0 : 1)});
+        }
+        std::swap(prev, curr);
+    }
+    double errors = static_cast<double>(prev[actual.size()]);
+    return expected.empty() ? 1.0 : std::max(0.0, 1.0 - errors / expected.size());
+}
+
+static const std::string TEXT = "PARIS 12345 THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 67890 SOS";
+
+void test_clean_trace() {
+    trace_config_t config;
+    TEST_ASSERT_EQUAL_STRING(TEXT.c_str(), decode(make_trace(TEXT, config), 50).c_str());
+}
+
+void test_punctuation() {
+    const std::string text = "HELLO, WORLD? A/B=C.";
+    trace_config_t config;
+    TEST_ASSERT_EQUAL_STRING(text.c_str(), decode(make_trace(text, config), 50).c_str());
+}
+
+void test_adapts_to_slower_sender() {
+    trace_config_t config;
+    config.dit_begin = config.dit_end = 120;
+    decoder dec;
+    auto result = decode(make_trace(TEXT, config), 50, &dec);     // первое слово уходит на подстройку
+    TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(0.95, accuracy(TEXT, result));
+    TEST_ASSERT_UINT32_WITHIN(15, 120, dec.dit());
+}
+
+void test_drift_and_jitter() {
+    trace_config_t config;
+    config.dit_begin = 40;
+    config.dit_end = 110;
+    config.jitter = 0.15;
+    double total = 0;
+    for(uint32_t seed = 1; seed <= 20; ++seed) {
+        config.seed = seed;
+        total += accuracy(TEXT, decode(make_trace(TEXT, config), 50));
+    }
+    char report[80];
+    snprintf(report, sizeof(report), "drift 40->110 ms, jitter 15%%: accuracy %.1f%%", 100.0 * total / 20);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(0.95, total / 20);
+}
+
+void test_glitches_are_ignored() {
+    trace_config_t config;
+    auto edges = make_trace("E", config);
+    // Короткий провал внутри точки
+    edges.insert(edges.begin() + 1, {edge_t{edges[0].time + 20, 0}, edge_t{edges[0].time + 22, 1}});
+    decoder dec;
+    TEST_ASSERT_EQUAL_STRING("E", decode(edges, 50, &dec).c_str());
+    TEST_ASSERT_EQUAL_UINT32(2, dec.stats().glitches);
+}
+
+void test_poll_flushes_last_symbol() {
+    decoder dec(50);
+    dec.on_edge(true, 0);
+    dec.on_edge(false, 150);    // тире
+    char ch = 0;
+    dec.poll(200);
+    TEST_ASSERT_FALSE(dec.read(ch));
+    dec.poll(260);
+    TEST_ASSERT_TRUE(dec.read(ch));
+    TEST_ASSERT_EQUAL_CHAR('T', ch);
+}
+
+void bench_decode_throughput() {
+    trace_config_t config;
+    config.jitter = 0.1;
+    auto edges = make_trace(TEXT, config);
+    const int iterations = 2000;
+    size_t chars = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) {
+        decoder dec(50);
+        char ch;
+        for(const auto& edge : edges) {
+            dec.on_edge(edge.level, edge.time);
+            while(dec.read(ch)) ++chars;
+        }
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    char report[120];
+    snprintf(report, sizeof(report), "decode: %.1f ns/edge, %.2f M edges/s (%zu chars)",
+             double(ns) / (double(iterations) * edges.size()), 1e3 * iterations * edges.size() / ns, chars);
+    TEST_MESSAGE(report);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_clean_trace);
+    RUN_TEST(test_punctuation);
+    RUN_TEST(test_adapts_to_slower_sender);
+    RUN_TEST(test_drift_and_jitter);
+    RUN_TEST(test_glitches_are_ignored);
+    RUN_TEST(test_poll_flushes_last_symbol);
+    RUN_TEST(bench_decode_throughput);
+
+    return UNITY_END();
+}
@@ -0,0 +1,201 @@
+// Многоканальный передатчик: pio test -e native -f test_morse_multi
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "morse_multi.h"
+
+using namespace morse_code;
+
+// Выход теста: фронты по каналам и количество flush()
+struct record_output {
+    struct edge_t { size_t channel; uint32_t time; bool level; };
+    std::vector<edge_t> edges;
+    uint32_t now = 0;
+    size_t flushes = 0;
+
+    void set(size_t channel, bool level) { edges.push_back({channel, now, level}); }
+    void flush() { ++flushes; }
+
+    std::vector<edge_t> of(size_t channel) const {
+        std::vector<edge_t> result;
+        for(const auto& edge : edges) if(edge.channel == channel) result.push_back(edge);
+        return result;
+    }
+};
+
+// Фронты расписания одного сообщения от момента start
+static std::vector<record_output::edge_t> expected_edges(size_t channel, const char* text, uint32_t dit, uint32_t start)
+{
+    string_source source(text, strlen(text));
+    schedule_generator generator;
+    generator.start(&source, dit);
+    std::vector<record_output::edge_t> edges;
+    bool level = false;
+    run_t run;
+    while(generator.generate(&run, 1)) {
+        if(run.level() != level) edges.push_back({channel, start, run.level()});
+        level = run.level();
+        start += run.duration();
+    }
+    if(level) edges.push_back({channel, start, false});
+    return edges;
+}
+
+template<typename Transmitter>
+static void run_until_idle(Transmitter& tx, record_output& output, uint32_t limit = 60000)
+{
+    for(uint32_t i = 0; i < limit && tx.active(); ++i) {
+        tx.tick(output.now);
+        ++output.now;
+    }
+}
+
+static void assert_same(const std::vector<record_output::edge_t>& expected, const std::vector<record_output::edge_t>& actual)
+{
+    TEST_ASSERT_EQUAL_size_t(expected.size(), actual.size());
+    for(size_t i = 0; i < expected.size(); ++i) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i].time, actual[i].time);
+        TEST_ASSERT_EQUAL(expected[i].level, actual[i].level);
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_channels_independent() {
+    record_output output;
+    morse_transmitter<4, record_output> tx(output);
+    TEST_ASSERT_EQUAL_UINT32(decltype(tx)::NEVER, tx.tick(0));
+    TEST_ASSERT_TRUE(tx.send(0, "SOS", 50, 0));
+    TEST_ASSERT_TRUE(tx.send(2, "PARIS", 30, 0));
+    TEST_ASSERT_TRUE(tx.send(3, "73", 80, 0));
+    TEST_ASSERT_FALSE(tx.send(4, "E", 50, 0));
+    TEST_ASSERT_EQUAL_size_t(3, tx.active());
+    TEST_ASSERT_FALSE(tx.is_transmitting(1));
+
+    run_until_idle(tx, output);
+    assert_same(expected_edges(0, "SOS", 50, 0), output.of(0));
+    assert_same(expected_edges(2, "PARIS", 30, 0), output.of(2));
+    assert_same(expected_edges(3, "73", 80, 0), output.of(3));
+    TEST_ASSERT_EQUAL_size_t(0, output.of(1).size());
+    TEST_ASSERT_FALSE(tx.level(0));
+}
+
+void test_late_tick_keeps_schedule() {
+    // tick() с опозданием выдает пропущенные фронты, сроки следующих не сдвигаются
+    record_output output;
+    morse_transmitter<1, record_output> tx(output);
+    tx.send(0, "EE", 100, 0);
+    tx.tick(0);
+    output.now = 250;
+    tx.tick(250);       // on в 100 и off в 200 пропущены
+    TEST_ASSERT_FALSE(tx.level(0));
+    TEST_ASSERT_EQUAL_UINT32(350, tx.time_to_next(250));    // следующее включение в 600 по расписанию: 1 + 3 dit после точки
+}
+
+void test_repeat_and_stop() {
+    record_output output;
+    morse_transmitter<2, record_output> tx(output);
+    tx.send(1, "E", 50, 0, 40000);      // пауза повтора больше одного отрезка
+    // Цикл: пауза 1 dit, точка, 1 + 3 dit после символа, пауза повтора - 40300 мс
+    for(; output.now <= 2 * 40300 + 100; ++output.now) tx.tick(output.now);
+    auto edges = output.of(1);
+    TEST_ASSERT_EQUAL_size_t(6, edges.size());
+    TEST_ASSERT_EQUAL_UINT32(50, edges[0].time);
+    TEST_ASSERT_EQUAL_UINT32(40300 + 50, edges[2].time);
+    TEST_ASSERT_EQUAL_UINT32(2 * 40300 + 100, edges[5].time);
+    TEST_ASSERT_TRUE(tx.is_transmitting(1));
+
+    tx.stop(1);
+    TEST_ASSERT_FALSE(tx.is_transmitting(1));
+    TEST_ASSERT_EQUAL_UINT32(decltype(tx)::NEVER, tx.time_to_next(output.now));
+}
+
+void test_heap_many_channels() {
+    // Каналы с разной скоростью, часть перезапускается посреди передачи
+    record_output output;
+    morse_transmitter<48, record_output> tx(output);
+    for(size_t i = 0; i < 48; ++i) tx.send(i, "CQ TEST", 20 + static_cast<uint32_t>(i) * 3, 0);
+    for(; output.now < 500; ++output.now) tx.tick(output.now);
+    for(size_t i = 0; i < 48; i += 5) tx.send(i, "R", 25, output.now);
+    uint32_t restart = output.now;
+    run_until_idle(tx, output);
+    for(size_t i = 0; i < 48; ++i) {
+        if(i % 5 == 0) {
+            auto edges = output.of(i);
+            std::vector<record_output::edge_t> tail;
+            for(const auto& edge : edges) if(edge.time >= restart && edge.level) tail.push_back(edge);
+            TEST_ASSERT_EQUAL_size_t(3, tail.size());    // R: .-.
+        }
+        else {
+            assert_same(expected_edges(i, "CQ TEST", 20 + static_cast<uint32_t>(i) * 3, 0), output.of(i));
+        }
+    }
+}
+
+void test_shift_register() {
+    shift_register_output<12> output(4, 5, 6);
+    morse_transmitter<12, shift_register_output<12>> tx(output);
+    tx.send(9, "T", 10, 0);
+    tx.tick(10);
+    TEST_ASSERT_EQUAL_UINT8(0x02, output.bytes()[1]);
+    TEST_ASSERT_EQUAL_UINT8(HIGH, arduino_shim::pins[6]);      // защелка
+    tx.tick(40);
+    TEST_ASSERT_EQUAL_UINT8(0x00, output.bytes()[1]);
+}
+
+// Стоимость на компьютере: tick() без наступивших сроков не зависит от количества каналов, фронт - O(log N)
+struct count_output {
+    uint32_t edges = 0;
+    void set(size_t, bool) { ++edges; }
+    void flush() {}
+};
+
+template<size_t N>
+static void bench_channels()
+{
+    count_output output;
+    morse_transmitter<N, count_output> tx(output);
+    for(size_t i = 0; i < N; ++i) tx.send(i, "PARIS PARIS", 50, static_cast<uint32_t>(i * 7), 1000);
+    const uint32_t ticks = 2000000;
+    auto start = std::chrono::steady_clock::now();
+    uint32_t sum = 0;
+    for(uint32_t now = 0; now < ticks; ++now) sum += tx.tick(now);
+    auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // Все каналы ждут: tick() только сравнивает срок вершины кучи
+    const uint32_t idle_ticks = 10000000;
+    uint32_t now = ticks;
+    while(tx.time_to_next(now) < 2) tx.tick(++now);
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < idle_ticks; ++i) sum += tx.tick(now);
+    auto idle = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    char report[128];
+    snprintf(report, sizeof(report), "%u channels: %.1f ns/edge, idle tick %.1f ns", unsigned(N),
+             double(busy) / output.edges, double(idle) / idle_ticks);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_TRUE(sum > 0);
+}
+
+void bench_tick() {
+    bench_channels<8>();
+    bench_channels<64>();
+    bench_channels<200>();
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_channels_independent);
+    RUN_TEST(test_late_tick_keeps_schedule);
+    RUN_TEST(test_repeat_and_stop);
+    RUN_TEST(test_heap_many_channels);
+    RUN_TEST(test_shift_register);
+    RUN_TEST(bench_tick);
+
+    return UNITY_END();
+}
@@ -0,0 +1,94 @@
+// Тесты очереди SPSC: pio test -e native -f test_morse_queue
+#include <unity.h>
+#include <thread>
+#include "morse_queue.h"
+
+using namespace morse_code;
+
+void test_fifo_order() {
+    spsc_queue<int, 4> queue;
+    for(int i = 1; i <= 3; ++i) TEST_ASSERT_TRUE(queue.push(i));
+    TEST_ASSERT_EQUAL_size_t(3, queue.depth());
+    int value = 0;
+    for(int i = 1; i <= 3; ++i) { TEST_ASSERT_TRUE(queue.pop(value)); TEST_ASSERT_EQUAL_INT(i, value); }
+    TEST_ASSERT_FALSE(queue.pop(value));
+}
+
+void test_drop_newest() {
+    spsc_queue<int, 2> queue(overflow_t::kDropNewest);
+    queue.push(1); queue.push(2);
+    TEST_ASSERT_FALSE(queue.push(3));
+    int value = 0;
+    queue.pop(value);
+    TEST_ASSERT_EQUAL_INT(1, value);
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().dropped);
+    TEST_ASSERT_EQUAL_UINT32(2, queue.stats().max_depth);
+}
+
+void test_drop_oldest() {
+    spsc_queue<int, 2> queue(overflow_t::kDropOldest);
+    queue.push(1); queue.push(2);
+    TEST_ASSERT_TRUE(queue.push(3));
+    int value = 0;
+    queue.pop(value); TEST_ASSERT_EQUAL_INT(2, value);
+    queue.pop(value); TEST_ASSERT_EQUAL_INT(3, value);
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().dropped);
+}
+
+void test_coalesce() {
+    spsc_queue<text_t<8>, 4> queue(overflow_t::kCoalesce);
+    TEST_ASSERT_TRUE(queue.push(text_t<8>("sos")));
+    TEST_ASSERT_FALSE(queue.push(text_t<8>("sos")));
+    TEST_ASSERT_TRUE(queue.push(text_t<8>("123")));
+    TEST_ASSERT_EQUAL_size_t(2, queue.depth());
+    TEST_ASSERT_EQUAL_UINT32(1, queue.stats().coalesced);
+}
+
+void test_text_truncation() {
+    text_t<5> text("щщщ");      // 6 байт, вторая буква не должна разорваться
+    TEST_ASSERT_EQUAL_UINT8(4, text.length);
+}
+
+// Писатель и читатель в разных потоках: порядок сохраняется, потерянные учтены в счетчиках
+static void run_threads(overflow_t policy) {
+    spsc_queue<uint32_t, 16> queue(policy);
+    const uint32_t count = 200000;
+    std::atomic<bool> done {false};
+    std::thread producer([&] {
+        for(uint32_t i = 1; i <= count; ++i) queue.push(i);
+        done = true;
+    });
+    uint32_t received = 0, last = 0, value = 0;
+    bool ordered = true;
+    while(!done || !queue.empty()) {
+        if(queue.pop(value)) {
+            ordered = ordered && value > last;
+            last = value;
+            ++received;
+        }
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT32(count, received + queue.stats().dropped);
+}
+
+void test_threads_drop_newest() { run_threads(overflow_t::kDropNewest); }
+void test_threads_drop_oldest() { run_threads(overflow_t::kDropOldest); }
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fifo_order);
+    RUN_TEST(test_drop_newest);
+    RUN_TEST(test_drop_oldest);
+    RUN_TEST(test_coalesce);
+    RUN_TEST(test_text_truncation);
+    RUN_TEST(test_threads_drop_newest);
+    RUN_TEST(test_threads_drop_oldest);
+
+    return UNITY_END();
+}
@@ -0,0 +1,290 @@
+// Расписание фронтов и передача по таймеру: pio test -e native -f test_morse_schedule
+// Генератор сверяется с фронтами MorseCode::tick(), затем оба режима прогоняются с блокировками loop()
+// и сравнивается отклонение длительностей точек, тире и пауз от расписания.
+#include <unity.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "morse.h"
+#include "morse_timed.h"
+
+using morse_code::run_t;
+
+static const uint8_t PIN = 5;
+static const uint32_t DIT = 50;
+
+struct edge_t {
+    uint32_t time;
+    bool     level;
+    bool operator==(const edge_t& other) const { return time == other.time && level == other.level; }
+};
+
+// Фронты из расписания, начиная с момента start
+static std::vector<edge_t> schedule_edges(const char* text, uint32_t start, uint32_t dit = DIT)
+{
+    morse_code::string_source source(text, strlen(text));
+    morse_code::schedule_generator generator;
+    generator.start(&source, dit);
+    std::vector<edge_t> edges;
+    bool level = false;
+    uint32_t time = start;
+    run_t runs[3];     // маленькая порция: проверяет продолжение генерации между вызовами
+    while(size_t count = generator.generate(runs, 3)) {
+        for(size_t i = 0; i < count; ++i) {
+            if(runs[i].level() != level) edges.push_back({time, runs[i].level()});
+            level = runs[i].level();
+            time += runs[i].duration();
+        }
+    }
+    if(level) edges.push_back({time, false});
+    return edges;
+}
+
+// Фронты вывода PIN при вызове tick() каждую миллисекунду
+static std::vector<edge_t> run_edges(MorseCode& morse, uint32_t limit_ms = 20000)
+{
+    std::vector<edge_t> edges;
+    bool level = arduino_shim::pins[PIN];
+    for(uint32_t i = 0; i < limit_ms && (morse.is_transmitting() || !morse.queue().empty()); ++i) {
+        morse.tick();
+        if(bool now = arduino_shim::pins[PIN]; now != level) edges.push_back({static_cast<uint32_t>(millis()), now});
+        level = arduino_shim::pins[PIN];
+        delay(1);
+    }
+    return edges;
+}
+
+void setUp() { arduino_shim::set_millis(1000); arduino_shim::pins[PIN] = 0; }
+
+void tearDown() {}
+
+void test_generator_matches_tick() {
+    for(const char* text : {"E", "SOS", "73 DE", "PARIS PARIS"}) {
+        arduino_shim::set_millis(1000);
+        auto led = etl::make_shared<etl::led>(PIN);
+        MorseCode morse(led, DIT);
+        morse.send(text);
+        auto actual = run_edges(morse);
+        auto expected = schedule_edges(text, 1000);
+        TEST_ASSERT_EQUAL_size_t(expected.size(), actual.size());
+        TEST_ASSERT_TRUE_MESSAGE(expected == actual, text);
+    }
+}
+
+void test_generator_total_duration() {
+    const char* text = "CQ CQ DE TEST";
+    morse_code::string_source source(text, strlen(text));
+    morse_code::schedule_generator generator;
+    generator.start(&source, DIT);
+    run_t runs[64];
+    size_t count = generator.generate(runs, 64);
+    TEST_ASSERT_TRUE(generator.done());
+    uint32_t total = 0;
+    for(size_t i = 0; i < count; ++i) {
+        total += runs[i].duration();
+        if(i) TEST_ASSERT_NOT_EQUAL(runs[i - 1].level(), runs[i].level());      // соседние паузы слиты
+    }
+    // пауза перед первым элементом + длительность по таблице
+    TEST_ASSERT_EQUAL_UINT32(DIT + morse_code::duration_units(text, strlen(text)) * DIT, total);
+}
+
+void test_generator_split_long_pause() {
+    const char* text = "E E";
+    morse_code::string_source source(text, strlen(text));
+    morse_code::schedule_generator generator;
+    generator.start(&source, 3000);     // пауза слова 8 dit = 24 с, больше одного срабатывания таймера
+    run_t runs[16];
+    size_t count = generator.generate(runs, 16);
+    TEST_ASSERT_EQUAL_size_t(6, count);
+    TEST_ASSERT_TRUE(runs[1] == run_t(true, 3000));
+    TEST_ASSERT_TRUE(runs[2] == run_t(false, morse_code::schedule_generator::MAX_RUN_MS));
+    TEST_ASSERT_TRUE(runs[3] == run_t(false, 24000 - morse_code::schedule_generator::MAX_RUN_MS));
+    TEST_ASSERT_TRUE(runs[4] == run_t(true, 3000));
+
+    generator.reset();
+    TEST_ASSERT_TRUE(generator.done());
+    TEST_ASSERT_EQUAL_size_t(0, generator.generate(runs, 16));
+}
+
+void test_ring() {
+    morse_code::run_ring<4> ring;
+    run_t run;
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_FALSE(ring.pop(run));
+    for(uint32_t i = 1; i <= 4; ++i) TEST_ASSERT_TRUE(ring.push(run_t(i & 1, i)));
+    TEST_ASSERT_FALSE(ring.push(run_t(true, 5)));
+    TEST_ASSERT_EQUAL_size_t(0, ring.space());
+    // Счетчики 16 бит переполняются, размер - степень двойки, порядок сохраняется
+    for(uint32_t i = 1; i <= 70000; ++i) {
+        TEST_ASSERT_TRUE(ring.pop(run));
+        TEST_ASSERT_EQUAL_UINT16(((i - 1) % 0x7FFF) + 1, run.duration());
+        TEST_ASSERT_TRUE(ring.push(run_t(false, ((i + 3) % 0x7FFF) + 1)));
+    }
+    ring.clear();
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_timed_code_playback() {
+    // На компьютере отрезки проигрывает tick() по millis(): фронты те же, что у расписания
+    auto led = etl::make_shared<etl::led>(PIN);
+    MorseTimedCode morse(led, DIT, PIN, false);
+    TEST_ASSERT_TRUE(morse.enqueue("SOS SOS"));
+    auto actual = run_edges(morse);
+    auto expected = schedule_edges("SOS SOS", 1000);
+    TEST_ASSERT_TRUE(expected == actual);
+    TEST_ASSERT_TRUE(morse.is_completed());
+    TEST_ASSERT_FALSE(morse.is_playing());
+    TEST_ASSERT_EQUAL_UINT32(MorseCode::NEVER, morse.time_to_next(millis()));
+
+    // Сброс посреди передачи гасит светодиод и очищает кольцо
+    morse.send("PARIS");
+    for(int i = 0; i < 120; ++i) { morse.tick(); delay(1); }
+    TEST_ASSERT_TRUE(morse.is_transmitting());
+    morse.reset();
+    TEST_ASSERT_FALSE(morse.is_transmitting());
+    TEST_ASSERT_FALSE(morse.is_playing());
+    TEST_ASSERT_EQUAL_UINT8(LOW, arduino_shim::pins[PIN]);
+}
+
+void test_timed_code_inverse() {
+    auto led = etl::make_shared<etl::led>(PIN, false, true);
+    arduino_shim::pins[PIN] = LOW;                              // led уже выключил вывод, проверить, что конструктор не пишет
+    MorseTimedCode morse(led, DIT, PIN, true);
+    TEST_ASSERT_EQUAL_UINT8(LOW, arduino_shim::pins[PIN]);      // конструктор вывод не трогает
+    morse.begin();
+    TEST_ASSERT_EQUAL_UINT8(HIGH, arduino_shim::pins[PIN]);     // выключен
+    morse.send("E");
+    TEST_ASSERT_EQUAL_UINT8(HIGH, arduino_shim::pins[PIN]);     // выключен
+    delay(DIT);
+    morse.tick();
+    TEST_ASSERT_EQUAL_UINT8(LOW, arduino_shim::pins[PIN]);      // включен
+}
+
+void test_timed_code_stops_when_led_expires() {
+    auto led = etl::make_shared<etl::led>(PIN);
+    MorseTimedCode morse(led, DIT, PIN, false);
+    morse.send("PARIS");
+    for(int i = 0; i < 60; ++i) { morse.tick(); delay(1); }
+    TEST_ASSERT_TRUE(morse.is_playing());
+    led.reset();
+    morse.tick();
+    TEST_ASSERT_FALSE(morse.is_transmitting());
+    TEST_ASSERT_FALSE(morse.is_playing());
+    TEST_ASSERT_EQUAL_UINT32(MorseCode::NEVER, morse.time_to_next(millis()));
+}
+
+// Модель loop(): итерация 1 мс, иногда блокировка (вывод в Serial, LittleFS) и одна длинная, как перебор выводов в setup()
+struct loop_model_t {
+    uint32_t seed = 12345;
+
+    uint32_t next_step() {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t r = (seed >> 16) % 1000;
+        if(r < 40) return 5 + r * 5;        // 4% итераций блокируются на 5..200 мс
+        return 1;
+    }
+};
+
+// Отклонение длительности каждого отрезка между фронтами от ближайшей длительности того же уровня в расписании, мс:
+// так видит передачу декодер. Слившиеся из-за блокировки отрезки дают большое отклонение
+static std::vector<uint32_t> run_errors(const std::vector<edge_t>& actual, const std::vector<edge_t>& expected)
+{
+    std::vector<int32_t> legal[2];
+    for(size_t i = 1; i < expected.size(); ++i)
+        legal[expected[i - 1].level].push_back(static_cast<int32_t>(expected[i].time - expected[i - 1].time));
+    std::vector<uint32_t> errors;
+    for(size_t i = 1; i < actual.size(); ++i) {
+        int32_t duration = static_cast<int32_t>(actual[i].time - actual[i - 1].time);
+        uint32_t best = UINT32_MAX;
+        for(int32_t nominal : legal[actual[i - 1].level])
+            best = std::min(best, static_cast<uint32_t>(duration > nominal ? duration - nominal : nominal - duration));
+        errors.push_back(best);
+    }
+    std::sort(errors.begin(), errors.end());
+    return errors;
+}
+
+static void report(const char* mode, const std::vector<uint32_t>& errors, size_t lost_edges)
+{
+    auto at = [&](size_t p) { return errors.empty() ? 0u : errors[std::min(errors.size() - 1, errors.size() * p / 100)]; };
+    char line[128];
+    snprintf(line, sizeof(line), "%s: %zu runs, lost edges %zu, run error p50 %u ms, p90 %u ms, p99 %u ms, max %u ms", mode,
+             errors.size(), lost_edges, at(50), at(90), at(99), errors.empty() ? 0u : errors.back());
+    TEST_MESSAGE(line);
+}
+
+static const char* JITTER_TEXT = "PARIS PARIS PARIS PARIS PARIS";
+static const uint32_t LONG_BLOCK_AT = 3000;     // мс от начала: одна блокировка на 1 с
+static const uint32_t LONG_BLOCK = 1000;
+
+// Старый режим: фронты переключает tick() из loop(), блокировка растягивает текущий отрезок
+void report_jitter_polled() {
+    auto led = etl::make_shared<etl::led>(PIN);
+    MorseCode morse(led, DIT);
+    morse.send(JITTER_TEXT);
+    loop_model_t model;
+    std::vector<edge_t> edges;
+    bool level = false, blocked = false;
+    while(morse.is_transmitting()) {
+        morse.tick();
+        if(bool now = arduino_shim::pins[PIN]; now != level) edges.push_back({static_cast<uint32_t>(millis()), now});
+        level = arduino_shim::pins[PIN];
+        uint32_t step = model.next_step();
+        if(!blocked && millis() - 1000 >= LONG_BLOCK_AT) { step = LONG_BLOCK; blocked = true; }
+        delay(step);
+    }
+    auto expected = schedule_edges(JITTER_TEXT, 1000);
+    auto errors = run_errors(edges, expected);
+    report("polled tick()", errors, expected.size() - edges.size());
+    TEST_ASSERT_GREATER_THAN_UINT32(DIT, errors.back());
+}
+
+// Новый режим: MorseTimedCode, его обработчик таймера срабатывает в срок и посреди блокировки loop()
+// (на компьютере - poll_timer() каждую мс блокировки), loop() только дописывает кольцо в tick().
+// Та же модель loop(), что у MorseCode: отличие фронтов - заслуга таймера и кольца, а не модели теста
+void report_jitter_timer() {
+    auto led = etl::make_shared<etl::led>(PIN);
+    MorseTimedCode morse(led, DIT, PIN, false);
+    morse.send(JITTER_TEXT);
+    loop_model_t model;
+    std::vector<edge_t> edges;
+    bool level = false, blocked = false;
+    auto record = [&] {
+        if(bool now = arduino_shim::pins[PIN]; now != level) edges.push_back({static_cast<uint32_t>(millis()), now});
+        level = arduino_shim::pins[PIN];
+    };
+    record();
+    while(morse.is_transmitting()) {
+        morse.tick();
+        record();
+        uint32_t step = model.next_step();
+        if(!blocked && millis() - 1000 >= LONG_BLOCK_AT) { step = LONG_BLOCK; blocked = true; }
+        for(uint32_t i = 0; i < step; ++i) {
+            delay(1);
+            morse.poll_timer();
+            record();
+        }
+    }
+    auto expected = schedule_edges(JITTER_TEXT, 1000);
+    auto errors = run_errors(edges, expected);
+    report("MorseTimedCode", errors, expected.size() - edges.size());
+    TEST_ASSERT_TRUE(expected == edges);        // кольцо пережило и блокировку на LONG_BLOCK
+    TEST_ASSERT_EQUAL_UINT32(0, errors.back());
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_generator_matches_tick);
+    RUN_TEST(test_generator_total_duration);
+    RUN_TEST(test_generator_split_long_pause);
+    RUN_TEST(test_ring);
+    RUN_TEST(test_timed_code_playback);
+    RUN_TEST(test_timed_code_inverse);
+    RUN_TEST(test_timed_code_stops_when_led_expires);
+    RUN_TEST(report_jitter_polled);
+    RUN_TEST(report_jitter_timer);
+
+    return UNITY_END();
+}
@@ -0,0 +1,182 @@
+// Передатчик без кучи и счетчики кучи: pio test -e native -f test_morse_static
+// operator new/delete заменены: каждое выделение попадает в heap_stats::host_heap(), так видно,
+// сколько раз MorseCode и static_morse обращаются к куче за долгий прогон.
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "morse.h"
+#include "morse_static.h"
+#include "heap_stats.h"
+
+// Размер блока хранится перед данными, чтобы delete вернул его в счетчик.
+// noinline: иначе компилятор видит malloc() за new и предупреждает о free() смещенного указателя
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    auto* block = static_cast<size_t*>(std::malloc(size + sizeof(size_t)));
+    if(!block) throw std::bad_alloc();
+    block[0] = size;
+    auto& heap = heap_stats::host_heap();
+    heap.in_use += static_cast<uint32_t>(size);
+    ++heap.allocations;
+    return block + 1;
+}
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+    if(!ptr) return;
+    auto* block = static_cast<size_t*>(ptr) - 1;
+    heap_stats::host_heap().in_use -= static_cast<uint32_t>(block[0]);
+    std::free(block);
+}
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+
+constexpr uint8_t PIN = 2;
+
+void setUp() { arduino_shim::set_millis(1000); }
+void tearDown() {}
+
+// Прогон с шагом 1 мс до конца передачи и очереди: моменты переключения светодиода
+template<typename Morse>
+static std::vector<uint32_t> run_edges(Morse& morse, etl::led& led, uint32_t limit_ms = 60000)
+{
+    std::vector<uint32_t> edges;
+    bool was_on = led.is_on();
+    for(uint32_t i = 0; i < limit_ms && (morse.is_transmitting() || !morse.queue().empty()); ++i) {
+        morse.tick();
+        if(led.is_on() != was_on) edges.push_back(millis());
+        was_on = led.is_on();
+        delay(1);
+    }
+    return edges;
+}
+
+void test_same_timing_as_morse_code() {
+    const char* texts[] = {"SOS", "AE 73", "Привет, мир", "12:30 $"};
+    for(const char* text : texts) {
+        arduino_shim::set_millis(1000);
+        auto shared_led = etl::make_shared<etl::led>(PIN);
+        MorseCode reference(shared_led, 40);
+        uint32_t reference_duration = reference.send(String(text));
+        auto expected = run_edges(reference, *shared_led);
+
+        arduino_shim::set_millis(1000);
+        etl::led led(PIN);
+        morse_code::static_morse<256> morse(led, 40);
+        uint32_t duration = morse.send(text);
+        auto edges = run_edges(morse, led);
+
+        TEST_ASSERT_EQUAL_UINT32(reference_duration, duration);
+        TEST_ASSERT_EQUAL(expected.size(), edges.size());
+        TEST_ASSERT_TRUE(expected == edges);
+        TEST_ASSERT_TRUE(morse.is_completed());
+    }
+}
+
+void test_queue_and_time_to_next() {
+    etl::led led(PIN);
+    morse_code::static_morse<64> morse(led, 20);
+    TEST_ASSERT_EQUAL_UINT32(morse.NEVER, morse.time_to_next(millis()));
+    TEST_ASSERT_TRUE(morse.enqueue("E", 1));
+    TEST_ASSERT_TRUE(morse.enqueue("T", 1));
+    TEST_ASSERT_EQUAL_UINT32(0, morse.time_to_next(millis()));
+    morse.tick();
+    TEST_ASSERT_EQUAL_UINT32(20, morse.time_to_next(millis()));
+    auto edges = run_edges(morse, led);
+    TEST_ASSERT_EQUAL(4, edges.size());
+    TEST_ASSERT_EQUAL_UINT32(morse.NEVER, morse.time_to_next(millis()));
+}
+
+void test_long_text_cut_at_symbol() {
+    etl::led led(PIN);
+    morse_code::static_morse<10> morse(led, 10);
+    // S ... + пауза = 4, O --- + пауза = 4, третий символ уже не помещается
+    uint32_t duration = morse.send("SOS");
+    TEST_ASSERT_EQUAL_UINT32(8, morse.size());
+    TEST_ASSERT_EQUAL_UINT32(1, morse.truncated());
+    TEST_ASSERT_EQUAL_UINT32(morse_code::duration_units("SO", 2) * 10, duration);
+    TEST_ASSERT_EQUAL(12, run_edges(morse, led).size());
+}
+
+void test_no_heap_after_construction() {
+    etl::led led(PIN);
+    morse_code::static_morse<256> morse(led, 5);
+    morse.queue().set_policy(morse_code::overflow_t::kDropOldest);
+    auto& heap = heap_stats::host_heap();
+    uint32_t before = heap.allocations;
+    char text[12];
+    for(uint32_t i = 0; i < 200; ++i) {
+        int length = snprintf(text, sizeof(text), "%lu", static_cast<unsigned long>(millis()));
+        morse.enqueue(text, static_cast<size_t>(length));
+        if(i % 50 == 0) morse.send("CQ CQ");
+        for(int k = 0; k < 300; ++k) {
+            morse.tick();
+            delay(1);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(before, heap.allocations);
+}
+
+void test_morse_code_heap_use_for_comparison() {
+    auto led = etl::make_shared<etl::led>(PIN);
+    MorseCode morse(led, 5);
+    auto& heap = heap_stats::host_heap();
+    uint32_t before = heap.allocations;
+    for(uint32_t i = 0; i < 200; ++i) {
+        morse.send(String("message number ") + String(static_cast<unsigned long>(millis())));     // как String(millis()) в loop()
+        for(int k = 0; k < 300; ++k) {
+            morse.tick();
+            delay(1);
+        }
+    }
+    char line[80];
+    snprintf(line, sizeof(line), "MorseCode::send(String): %lu allocations for 200 messages", static_cast<unsigned long>(heap.allocations - before));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(heap.allocations > before);
+}
+
+void test_heap_monitor() {
+    TEST_ASSERT_EQUAL_UINT8(0, heap_stats::fragmentation(1000, 1000));
+    TEST_ASSERT_EQUAL_UINT8(75, heap_stats::fragmentation(40000, 10000));
+
+    heap_stats::monitor<4> monitor;
+    for(uint32_t i = 0; i < 10; ++i) {
+        uint32_t free = 40000 - i * 100;
+        uint32_t block = 30000 - i * 1000;
+        monitor.add(i * 600000, {free, block, heap_stats::fragmentation(free, block)});
+    }
+    TEST_ASSERT_EQUAL_UINT32(10, monitor.samples());
+    TEST_ASSERT_EQUAL_UINT32(39100, monitor.min_free());
+    TEST_ASSERT_EQUAL_UINT32(21000, monitor.min_block());
+    TEST_ASSERT_EQUAL_UINT8(47, monitor.max_fragmentation());
+    TEST_ASSERT_EQUAL_INT32(600, monitor.free_loss_per_hour());     // 100 байт за 10 минут
+
+    std::vector<std::string> lines;
+    monitor.write_csv([&](const char* line) { lines.push_back(line); });
+    TEST_ASSERT_EQUAL(2 + 1 + 4, lines.size());                    // итог и 4 последние выборки
+    TEST_ASSERT_EQUAL_STRING("heap,10,39100,21000,47,39100,21000,47,600", lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("heap_sample,3600000,39400,24000,40", lines[3].c_str());
+
+    // Выборка из заменного operator new
+    monitor.reset();
+    uint32_t free_before = heap_stats::read().free;
+    auto* block = new std::vector<uint8_t>(1000);
+    monitor.sample(millis());
+    TEST_ASSERT_TRUE(monitor.last().heap.free + 1000 <= free_before);
+    delete block;
+    TEST_ASSERT_EQUAL_UINT32(free_before, heap_stats::read().free);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_same_timing_as_morse_code);
+    RUN_TEST(test_queue_and_time_to_next);
+    RUN_TEST(test_long_text_cut_at_symbol);
+    RUN_TEST(test_no_heap_after_construction);
+    RUN_TEST(test_morse_code_heap_use_for_comparison);
+    RUN_TEST(test_heap_monitor);
+
+    return UNITY_END();
+}
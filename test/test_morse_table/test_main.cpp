@@ -0,0 +1,224 @@
+// Тесты и бенчмарк таблицы кодов Морзе и потокового кодировщика: pio test -e native -f test_morse_table
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "morse_table.h"
+#include "morse_encoder.h"
+
+// Эталонное кодирование текста в строку точек-тире с паузами ' ' и разделителями '|' через next_token()
+static std::string encode(const std::string& text)
+{
+    std::string codes;
+    const char* it  = text.data();
+    const char* end = it + text.size();
+    morse_code::symbol_t code;
+    for(auto token = morse_code::next_token(it, end, code); token != morse_code::token_t::kEnd; token = morse_code::next_token(it, end, code))
+    {
+        if(token == morse_code::token_t::kSymbol) {
+            for(uint8_t i = 0; i < code.length; ++i) codes.push_back(code.is_dash(i) ? '-' : '.');
+            codes.push_back(' ');
+        }
+        else if(token == morse_code::token_t::kWordBreak) {
+            if(!codes.empty() && codes.back() == ' ') codes.back() = '|';
+            else codes.push_back('|');
+        }
+    }
+    return codes;
+}
+
+// Прежняя реализация: линейный поиск по таблице цифр и строка на каждый символ
+namespace legacy {
+    struct table_t { char symbol; std::string value; };
+    static const table_t table_digits[10] {
+        {'1', ".----"}, {'2', "..---"}, {'3', "...--"}, {'4', "....-"}, {'5', "....."},
+        {'6', "-...."}, {'7', "--..."}, {'8', "---.."}, {'9', "----."}, {'0', "-----"}
+    };
+
+    static std::string get_char_code(char ch) {
+        for(auto item : table_digits) if(item.symbol == ch) return item.value;
+        return std::string("");
+    }
+
+    static std::vector<char> message_to_code(const std::string& text) {
+        static std::string separators = " ,.|!?-/\\";
+        std::vector<char> codes;
+        for(char ch : text) {
+            auto code = get_char_code(ch);
+            if(!code.empty()) {
+                for(auto dit : code) codes.push_back(dit);
+                codes.push_back(' ');
+            }
+            else {
+                for(auto sep : separators) {
+                    if(ch == sep) {
+                        if(!codes.empty() && codes.back() == ' ') codes.back() = '|';
+                        else codes.push_back('|');
+                        break;
+                    }
+                }
+            }
+        }
+        return codes;
+    }
+}// namespace legacy
+
+void test_make_symbol() {
+    auto a = morse_code::make_symbol(".-");
+    TEST_ASSERT_EQUAL_UINT8(2, a.length);
+    TEST_ASSERT_FALSE(a.is_dash(0));
+    TEST_ASSERT_TRUE(a.is_dash(1));
+    TEST_ASSERT_EQUAL_UINT8(7, morse_code::get_ascii_code('$').length);
+    TEST_ASSERT_TRUE(morse_code::get_ascii_code('#').empty());
+}
+
+void test_digits_match_legacy() {
+    const std::string text = "0123456789 42";
+    auto old_codes = legacy::message_to_code(text);
+    TEST_ASSERT_EQUAL_STRING(std::string(old_codes.begin(), old_codes.end()).c_str(), encode(text).c_str());
+}
+
+void test_letters_and_case() {
+    TEST_ASSERT_EQUAL_STRING(encode("SOS").c_str(), encode("sos").c_str());
+    TEST_ASSERT_EQUAL_STRING("... --- ... ", encode("SOS").c_str());
+    TEST_ASSERT_EQUAL_STRING(".-.-.- --..-- ", encode(".,").c_str());
+}
+
+void test_cyrillic() {
+    TEST_ASSERT_EQUAL_STRING("... --- ... ", encode("СОС").c_str());
+    TEST_ASSERT_EQUAL_STRING(encode("ПРИВЕТ").c_str(), encode("привет").c_str());
+    TEST_ASSERT_EQUAL_STRING("--.- . ", encode("щё").c_str());
+}
+
+void test_separators_and_unknown() {
+    TEST_ASSERT_EQUAL_STRING(".|.- ", encode("e a").c_str());
+    TEST_ASSERT_EQUAL_STRING(". ", encode("e#€").c_str());      // неизвестные ASCII и UTF-8 пропускаются
+    TEST_ASSERT_EQUAL_STRING("", encode("\xD0").c_str());       // оборванная UTF-8 последовательность
+}
+
+// Потоковый кодировщик
+static std::string stream_encode(const std::string& text)
+{
+    morse_code::string_source source(text.data(), text.size());
+    morse_code::encoder enc(&source);
+    std::string codes;
+    morse_code::element_t element;
+    while(enc.next(element)) codes.push_back(element);
+    return codes;
+}
+
+// Бесконечный источник: повторяет текст count раз, ничего не храня
+class repeat_source : public morse_code::source_t
+{
+    const char* text_;
+    size_t length_;
+    size_t pos_ = 0;
+    size_t count_;
+public:
+    repeat_source(const char* text, size_t count) : text_(text), length_(strlen(text)), count_(count) {}
+    int read() override {
+        if(count_ == 0) return -1;
+        int ch = static_cast<uint8_t>(text_[pos_++]);
+        if(pos_ == length_) { pos_ = 0; --count_; }
+        return ch;
+    }
+};
+
+void test_stream_matches_encode() {
+    const char* samples[] = { "123 123", "123.123,098", "pirat123.123 dde", "  a  b ", "СОС щё", "e#€x", "" };
+    for(auto sample : samples) {
+        TEST_ASSERT_EQUAL_STRING(encode(sample).c_str(), stream_encode(sample).c_str());
+    }
+}
+
+// Источник, в котором данные приходят по одному байту: перед каждым байтом - AGAIN
+class trickle_source : public morse_code::source_t
+{
+    morse_code::string_source source_;
+    bool ready_ = false;
+public:
+    trickle_source(const char* text, size_t length) : source_(text, length) {}
+    int read() override {
+        if(!ready_) { ready_ = true; return AGAIN; }
+        ready_ = false;
+        return source_.read();
+    }
+};
+
+void test_stream_again_is_not_end() {
+    const char* samples[] = { "e a", "СОС щё", "pirat 123", "e " };
+    for(auto sample : samples) {
+        trickle_source source(sample, strlen(sample));
+        morse_code::encoder enc(&source);
+        std::string codes;
+        morse_code::element_t element;
+        size_t waits = 0;
+        while(true) {
+            if(enc.next(element)) codes.push_back(element);
+            else if(enc.waiting()) ++waits;
+            else break;
+        }
+        TEST_ASSERT_EQUAL_STRING(stream_encode(sample).c_str(), codes.c_str());   // и посреди UTF-8, и перед пробелом
+        TEST_ASSERT_TRUE(waits >= strlen(sample));
+    }
+}
+
+void test_duration_units() {
+    // E: точка(2) + пауза(3), разделитель слова 7 вместо паузы
+    TEST_ASSERT_EQUAL_UINT32(5, morse_code::duration_units("e", 1));
+    TEST_ASSERT_EQUAL_UINT32(2 + 7 + 2 + 3, morse_code::duration_units("e e", 3));
+    TEST_ASSERT_EQUAL_UINT32(0, morse_code::duration_units("#", 1));
+}
+
+void test_unbounded_stream() {
+    const size_t repeats = 100000;
+    repeat_source source("SOS ", repeats);
+    TEST_ASSERT_EQUAL_UINT32(morse_code::duration_units("SOS ", 4) * repeats, morse_code::duration_units(source));
+}
+
+void bench_encode_throughput() {
+    const std::string text = "1234567890 0987654321 1122334455";
+    const int iterations = 200000;
+    size_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) sink += legacy::message_to_code(text).size();
+    auto legacy_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) sink += encode(text).size();
+    auto table_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) sink += morse_code::duration_units(text.data(), text.size());
+    auto stream_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    double chars = double(iterations) * text.size();
+    char report[200];
+    snprintf(report, sizeof(report), "encode: legacy %.1f ns/char, table %.1f ns/char, stream %.1f ns/char, speedup x%.1f (%zu)",
+             legacy_ns / chars, table_ns / chars, stream_ns / chars, double(legacy_ns) / double(table_ns), sink);
+    TEST_MESSAGE(report);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_make_symbol);
+    RUN_TEST(test_digits_match_legacy);
+    RUN_TEST(test_letters_and_case);
+    RUN_TEST(test_cyrillic);
+    RUN_TEST(test_separators_and_unknown);
+    RUN_TEST(test_stream_matches_encode);
+    RUN_TEST(test_stream_again_is_not_end);
+    RUN_TEST(test_duration_units);
+    RUN_TEST(test_unbounded_stream);
+    RUN_TEST(bench_encode_throughput);
+
+    return UNITY_END();
+}
@@ -0,0 +1,218 @@
+// Тесты компактного формата сообщений реле: pio test -e native -f test_morse_wire
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "espnow_batch.h"
+#include "morse_wire.h"
+
+using namespace morse_wire;
+
+using compact_sender_t   = espnow_batch::sender<morse_message_t, compact_codec>;
+using compact_receiver_t = espnow_batch::receiver<morse_message_t, compact_codec>;
+using raw_sender_t       = espnow_batch::sender<morse_message_t>;
+using raw_receiver_t     = espnow_batch::receiver<morse_message_t>;
+
+struct loopback_t {
+    std::vector<std::vector<uint8_t>> frames;
+    size_t bytes = 0;
+
+    static bool send(void* context, const uint8_t* data, size_t length) {
+        auto self = static_cast<loopback_t*>(context);
+        self->frames.emplace_back(data, data + length);
+        self->bytes += length;
+        return true;
+    }
+};
+
+template<typename Receiver>
+static std::vector<morse_message_t> deliver(loopback_t& link, Receiver& rx)
+{
+    std::vector<morse_message_t> result;
+    for(auto& frame : link.frames) rx.unpack(frame.data(), frame.size(), [&](const morse_message_t& m) { result.push_back(m); });
+    link.frames.clear();
+    return result;
+}
+
+static morse_message_t make_message(uint32_t timestamp, morse_message_t::type_t id, uint32_t value)
+{
+    morse_message_t message;
+    message.timestamp = timestamp;
+    message.id = id;
+    message.value = value;
+    return message;
+}
+
+void test_varint_roundtrip() {
+    const uint32_t values[] = {0, 1, 127, 128, 16383, 16384, 0x0FFFFFFF, 0x10000000, UINT32_MAX};
+    const size_t lengths[]  = {1, 1, 1,   2,   2,     3,     4,          5,          5};
+    for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        uint8_t buffer[MAX_VARINT_SIZE];
+        TEST_ASSERT_EQUAL_size_t(lengths[i], write_varint(buffer, values[i]));
+        const uint8_t* it = buffer;
+        uint32_t value = 0;
+        TEST_ASSERT_TRUE(read_varint(it, buffer + lengths[i], value));
+        TEST_ASSERT_EQUAL_UINT32(values[i], value);
+        TEST_ASSERT_EQUAL_PTR(buffer + lengths[i], it);
+    }
+    for(int32_t delta : {0, -1, 1, -1000, 1000, INT32_MIN, INT32_MAX}) TEST_ASSERT_EQUAL_INT32(delta, unzigzag(zigzag(delta)));
+}
+
+void test_varint_rejects_malformed() {
+    const uint8_t truncated[] = {0x80, 0x80};
+    const uint8_t too_long[]  = {0xFF, 0xFF, 0xFF, 0xFF, 0x7F};     // больше 32 бит
+    uint32_t value;
+    const uint8_t* it = truncated;
+    TEST_ASSERT_FALSE(read_varint(it, truncated + sizeof(truncated), value));
+    it = too_long;
+    TEST_ASSERT_FALSE(read_varint(it, too_long + sizeof(too_long), value));
+}
+
+void test_legacy_layout() {
+    // Старые узлы отправляют структуру как есть: новый разбор по смещениям должен совпасть с memcpy
+    morse_message_t message = make_message(0x12345678, morse_message_t::kCount, 0xCAFEBABE);
+    uint8_t raw[LEGACY_SIZE];
+    memcpy(raw, &message, sizeof(raw));
+    TEST_ASSERT_TRUE(message == read_legacy(raw));
+
+    uint8_t written[LEGACY_SIZE];
+    write_legacy(written, message);
+    morse_message_t copy;
+    memcpy(&copy, written, sizeof(copy));
+    TEST_ASSERT_TRUE(message == copy);
+}
+
+void test_compact_roundtrip() {
+    loopback_t link;
+    espnow_batch::policy_t policy;
+    policy.max_latency_ms = 0;
+    compact_sender_t tx(loopback_t::send, &link, policy);
+    compact_receiver_t rx;
+    std::vector<morse_message_t> sent = {
+        make_message(1000, morse_message_t::kCount, 1000),
+        make_message(1050, morse_message_t::kBlink, 50),
+        make_message(990,  morse_message_t::kCount, 0),             // метка назад: отрицательная разность
+        make_message(0xFFFFFFF0, morse_message_t::kCount, UINT32_MAX),
+        make_message(5, static_cast<morse_message_t::type_t>(7), 1), // неизвестный тип проходит как есть
+    };
+    for(auto& m : sent) tx.push(m, 0);
+    tx.flush();
+    TEST_ASSERT_EQUAL_size_t(1, link.frames.size());
+    TEST_ASSERT_EQUAL_UINT8(compact_codec::VERSION, espnow_batch::frame_version(link.frames[0].data(), link.frames[0].size()));
+    auto received = deliver(link, rx);
+    TEST_ASSERT_EQUAL_size_t(sent.size(), received.size());
+    for(size_t i = 0; i < sent.size(); ++i) TEST_ASSERT_TRUE(sent[i] == received[i]);
+}
+
+void test_compact_frame_never_legacy_size() {
+    // 5 заголовок + 4 метка + 3 запись = 12: кадр дополняется, чтобы не совпасть с одиночной структурой
+    loopback_t link;
+    compact_sender_t tx(loopback_t::send, &link);
+    compact_receiver_t rx;
+    tx.push(make_message(100, morse_message_t::kBlink, 50), 0);
+    tx.flush();
+    TEST_ASSERT_EQUAL_size_t(LEGACY_SIZE + 1, link.frames[0].size());
+    auto received = deliver(link, rx);
+    TEST_ASSERT_EQUAL_size_t(1, received.size());
+    TEST_ASSERT_EQUAL_UINT32(50, received[0].value);
+}
+
+void test_truncated_and_foreign_frames() {
+    loopback_t link;
+    compact_sender_t tx(loopback_t::send, &link);
+    for(uint32_t i = 0; i < 4; ++i) tx.push(make_message(i * 1000, morse_message_t::kCount, i * 300), 0);
+    tx.flush();
+    auto frame = link.frames[0];
+
+    compact_receiver_t rx;
+    auto ignore = [](const morse_message_t&) {};
+    TEST_ASSERT_EQUAL_size_t(0, rx.unpack(frame.data(), frame.size() - 1, ignore));   // обрезан: ни одного сообщения
+    frame.push_back(0x55);
+    TEST_ASSERT_EQUAL_size_t(0, rx.unpack(frame.data(), frame.size(), ignore));       // лишний хвост
+
+    // Кадр версии 1 не разбирается компактным приемником и наоборот
+    raw_sender_t raw_tx(loopback_t::send, &link);
+    raw_tx.push(make_message(1, morse_message_t::kCount, 1), 0);
+    raw_tx.flush();
+    auto& raw_frame = link.frames.back();
+    TEST_ASSERT_EQUAL_size_t(0, rx.unpack(raw_frame.data(), raw_frame.size(), ignore));
+    raw_receiver_t raw_rx;
+    TEST_ASSERT_EQUAL_size_t(1, raw_rx.unpack(raw_frame.data(), raw_frame.size(), ignore));
+    TEST_ASSERT_EQUAL_UINT32(3, rx.stats().invalid);
+}
+
+void test_capacity_grows() {
+    // Типичный поток: счетчик раз в 2-5 с и ответы мигать
+    loopback_t link;
+    espnow_batch::policy_t policy;
+    policy.max_latency_ms = 0;
+    compact_sender_t tx(loopback_t::send, &link, policy);
+    compact_receiver_t rx;
+    uint32_t now = 123456;
+    const uint32_t count = 200;
+    for(uint32_t i = 0; i < count; ++i) {
+        now += 3000;
+        tx.push(make_message(now, morse_message_t::kCount, i), now);
+        tx.push(make_message(now + 20, morse_message_t::kBlink, 50), now);
+    }
+    tx.flush();
+    TEST_ASSERT_LESS_THAN(2 * count / compact_sender_t::CAPACITY + 1, link.frames.size());
+    for(auto& frame : link.frames) TEST_ASSERT_LESS_OR_EQUAL(espnow_batch::MAX_FRAME_SIZE, frame.size());
+    TEST_ASSERT_EQUAL_size_t(2 * count, deliver(link, rx).size());
+}
+
+// Размер на сообщение и скорость разбора: компактный формат против структур подряд
+void bench_wire_size() {
+    std::vector<morse_message_t> stream;
+    uint32_t now = 100000;
+    for(uint32_t i = 0; i < 1000; ++i) {
+        now += 2000 + (i * 37) % 3000;
+        stream.push_back(make_message(now, morse_message_t::kCount, i));
+        stream.push_back(make_message(now + 15, morse_message_t::kBlink, 50));
+    }
+
+    loopback_t raw_link, compact_link;
+    espnow_batch::policy_t policy;
+    policy.max_latency_ms = 0;
+    raw_sender_t raw_tx(loopback_t::send, &raw_link, policy);
+    compact_sender_t compact_tx(loopback_t::send, &compact_link, policy);
+    for(auto& m : stream) { raw_tx.push(m, 0); compact_tx.push(m, 0); }
+    raw_tx.flush();
+    compact_tx.flush();
+
+    const int iterations = 200;
+    size_t decoded = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; ++i) {
+        compact_receiver_t rx;
+        for(auto& frame : compact_link.frames) decoded += rx.unpack(frame.data(), frame.size(), [](const morse_message_t&) {});
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    char report[200];
+    snprintf(report, sizeof(report), "raw v1: %zu frames, %.2f B/msg; compact v2: %zu frames, %.2f B/msg; decode %.1f ns/msg",
+             raw_link.frames.size(), double(raw_link.bytes) / stream.size(),
+             compact_link.frames.size(), double(compact_link.bytes) / stream.size(), double(ns) / decoded);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_LESS_THAN(raw_link.bytes / 2, compact_link.bytes);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_varint_roundtrip);
+    RUN_TEST(test_varint_rejects_malformed);
+    RUN_TEST(test_legacy_layout);
+    RUN_TEST(test_compact_roundtrip);
+    RUN_TEST(test_compact_frame_never_legacy_size);
+    RUN_TEST(test_truncated_and_foreign_frames);
+    RUN_TEST(test_capacity_grows);
+    RUN_TEST(bench_wire_size);
+
+    return UNITY_END();
+}
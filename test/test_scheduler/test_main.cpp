@@ -0,0 +1,107 @@
+// Тесты планировщика с управляемыми часами: pio test -e native -f test_scheduler
+#include <unity.h>
+#include <vector>
+#include <string>
+#include "deadline_scheduler.h"
+
+static unsigned long fake_now = 0;
+static unsigned long fake_clock() { return fake_now; }
+
+using scheduler_t = deadline_scheduler<8, fake_clock>;
+
+struct probe_t {
+    std::vector<uint32_t> runs;     // время каждого запуска
+    uint32_t period = 0;            // возвращаемая задержка
+};
+
+static uint32_t probe_task(void* context, uint32_t now)
+{
+    auto probe = static_cast<probe_t*>(context);
+    probe->runs.push_back(now);
+    return probe->period;
+}
+
+void setUp() { fake_now = 0; }
+
+void tearDown() {}
+
+void test_runs_only_due_tasks() {
+    scheduler_t scheduler;
+    probe_t fast {{}, 10}, slow {{}, 100};
+    scheduler.add("fast", probe_task, &fast, 10);
+    scheduler.add("slow", probe_task, &slow, 100);
+
+    TEST_ASSERT_EQUAL_UINT32(10, scheduler.dispatch());
+    TEST_ASSERT_EQUAL_size_t(0, fast.runs.size());
+
+    // Прогон 1 секунды: просыпаемся только к ближайшему сроку
+    uint32_t wakeups = 0;
+    while(fake_now < 1000) {
+        fake_now += scheduler.dispatch();
+        ++wakeups;
+    }
+    scheduler.dispatch();
+    TEST_ASSERT_EQUAL_size_t(100, fast.runs.size());
+    TEST_ASSERT_EQUAL_size_t(10, slow.runs.size());
+    TEST_ASSERT_LESS_OR_EQUAL(101, wakeups);
+    TEST_ASSERT_EQUAL_UINT32(1000, slow.runs.back());
+}
+
+void test_never_and_wake() {
+    scheduler_t scheduler;
+    probe_t idle {{}, scheduler_t::NEVER};
+    int id = scheduler.add("idle", probe_task, &idle);
+    scheduler.dispatch();
+    TEST_ASSERT_EQUAL_size_t(1, idle.runs.size());
+    TEST_ASSERT_EQUAL_UINT32(scheduler_t::NEVER, scheduler.dispatch());
+
+    fake_now = 500;
+    scheduler.wake(id, 5);
+    TEST_ASSERT_EQUAL_UINT32(5, scheduler.dispatch());
+    fake_now = 505;
+    scheduler.dispatch();
+    TEST_ASSERT_EQUAL_size_t(2, idle.runs.size());
+    TEST_ASSERT_EQUAL_UINT32(505, idle.runs.back());
+}
+
+void test_zero_delay_runs_once_per_dispatch() {
+    scheduler_t scheduler;
+    probe_t busy {{}, 0};
+    scheduler.add("busy", probe_task, &busy);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler.dispatch());
+    TEST_ASSERT_EQUAL_size_t(1, busy.runs.size());
+}
+
+void test_millis_overflow() {
+    scheduler_t scheduler;
+    fake_now = 0xFFFFFFF0ul;
+    probe_t probe {{}, 32};
+    scheduler.add("wrap", probe_task, &probe, 32);
+    TEST_ASSERT_EQUAL_UINT32(32, scheduler.dispatch());
+    fake_now = 0x10;
+    scheduler.dispatch();
+    TEST_ASSERT_EQUAL_size_t(1, probe.runs.size());
+}
+
+void test_late_stats() {
+    scheduler_t scheduler;
+    probe_t probe {{}, 10};
+    int id = scheduler.add("late", probe_task, &probe, 10);
+    fake_now = 25;
+    scheduler.dispatch();
+    TEST_ASSERT_EQUAL_UINT32(1, scheduler.stats(id).runs);
+    TEST_ASSERT_EQUAL_UINT32(15, scheduler.stats(id).late_max);
+    TEST_ASSERT_EQUAL_STRING("late", scheduler.stats(id).name);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_runs_only_due_tasks);
+    RUN_TEST(test_never_and_wake);
+    RUN_TEST(test_zero_delay_runs_once_per_dispatch);
+    RUN_TEST(test_millis_overflow);
+    RUN_TEST(test_late_stats);
+
+    return UNITY_END();
+}
@@ -0,0 +1,160 @@
+// Снимок настроек и отложенная запись: pio test -e native -f test_settings_store
+#include <unity.h>
+#include <cstdio>
+#include <vector>
+#include "settings_store.h"
+
+using namespace settings_store;
+
+// Файлы в памяти: счетчики операций вместо времени флеша
+struct mock_storage {
+    uint32_t stamp = 0x1234;
+    bool has_json = true;
+    bool fail_write = false;
+    std::vector<uint8_t> snapshot;
+    size_t snapshot_reads = 0, snapshot_writes = 0, json_parses = 0;
+
+    uint32_t json_stamp() { return has_json ? stamp : 0; }
+    size_t read_snapshot(uint8_t* out, size_t size) {
+        ++snapshot_reads;
+        if(snapshot.size() != size) return 0;
+        memcpy(out, snapshot.data(), size);
+        return size;
+    }
+    bool write_snapshot(const uint8_t* data, size_t size) {
+        if(fail_write) return false;
+        ++snapshot_writes;
+        snapshot.assign(data, data + size);
+        return true;
+    }
+    bool parse_json(settings_t& out) {
+        ++json_parses;
+        copy(out.device_name, "Kitchen");
+        out.default_brightness = 42;
+        copy(out.build_time, "2026-01-01T00:00:00");
+        return true;
+    }
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_crc32() {
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, checksum::crc32("123456789", 9));     // контрольное значение CRC-32/IEEE
+    uint32_t part = checksum::crc32("1234", 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, checksum::crc32("56789", 5, part));
+    TEST_ASSERT_EQUAL_HEX32(0, checksum::crc32("", 0));
+}
+
+void test_encode_decode() {
+    settings_t a;
+    copy(a.device_name, "Очень длинное имя устройства, которое не влезет");
+    TEST_ASSERT_EQUAL_size_t(sizeof(a.device_name) - 1, strlen(a.device_name));
+    a.default_brightness = 7;
+    uint8_t raw[SNAPSHOT_SIZE];
+    encode(a, 99, raw);
+
+    settings_t b;
+    TEST_ASSERT_TRUE(decode(raw, sizeof(raw), 99, b));
+    TEST_ASSERT_EQUAL_STRING(a.device_name, b.device_name);
+    TEST_ASSERT_EQUAL_UINT8(7, b.default_brightness);
+
+    TEST_ASSERT_FALSE(decode(raw, sizeof(raw), 100, b));            // JSON изменился
+    TEST_ASSERT_FALSE(decode(raw, sizeof(raw) - 1, 99, b));          // обрезан
+    raw[HEADER_SIZE + 3] ^= 1;
+    TEST_ASSERT_FALSE(decode(raw, sizeof(raw), 99, b));              // CRC
+    encode(a, 99, raw);
+    raw[4] = LAYOUT + 1;
+    TEST_ASSERT_FALSE(decode(raw, sizeof(raw), 99, b));              // другая раскладка
+}
+
+void test_boot_sequence() {
+    mock_storage fs;
+
+    // Первая загрузка: разбор JSON, снимок пишется в tick(), а не во время setup()
+    store<mock_storage> first(fs);
+    TEST_ASSERT_TRUE(source_t::kJson == first.load(0));
+    TEST_ASSERT_EQUAL_STRING("Kitchen", first.get().device_name);
+    TEST_ASSERT_EQUAL_STRING("1.0.0", first.get().version);          // нет в JSON - значение по умолчанию
+    TEST_ASSERT_EQUAL_size_t(0, fs.snapshot_writes);
+    TEST_ASSERT_EQUAL_UINT32(0, first.time_to_next(0));
+    TEST_ASSERT_EQUAL_UINT32(store<mock_storage>::NEVER, first.tick(1));
+    TEST_ASSERT_EQUAL_size_t(1, fs.snapshot_writes);
+
+    // Следующие: одно чтение снимка, JSON не трогается, записи нет
+    for(int boot = 0; boot < 3; ++boot) {
+        store<mock_storage> next(fs);
+        TEST_ASSERT_TRUE(source_t::kSnapshot == next.load(0));
+        TEST_ASSERT_EQUAL_UINT8(42, next.get().default_brightness);
+        TEST_ASSERT_FALSE(next.dirty());
+    }
+    TEST_ASSERT_EQUAL_size_t(1, fs.json_parses);
+    TEST_ASSERT_EQUAL_size_t(1, fs.snapshot_writes);
+
+    // uploadfs с новым JSON - снимок пересобирается
+    fs.stamp = 0x5678;
+    store<mock_storage> updated(fs);
+    TEST_ASSERT_TRUE(source_t::kJson == updated.load(0));
+    TEST_ASSERT_EQUAL_size_t(2, fs.json_parses);
+
+    // Снимок испорчен - снова JSON
+    updated.flush();
+    fs.snapshot[SNAPSHOT_SIZE - 1] ^= 0xFF;
+    store<mock_storage> corrupted(fs);
+    TEST_ASSERT_TRUE(source_t::kJson == corrupted.load(0));
+
+    // JSON нет - значения по умолчанию, они тоже попадают в снимок
+    mock_storage empty;
+    empty.has_json = false;
+    store<mock_storage> defaults(empty);
+    TEST_ASSERT_TRUE(source_t::kDefaults == defaults.load(0));
+    TEST_ASSERT_EQUAL_size_t(0, empty.json_parses);
+    defaults.tick(0);
+    store<mock_storage> again(empty);
+    TEST_ASSERT_TRUE(source_t::kSnapshot == again.load(0));
+}
+
+void test_coalesced_writes() {
+    mock_storage fs;
+    store<mock_storage> s(fs, 5000);
+    s.load(0);
+    s.tick(0);
+    TEST_ASSERT_EQUAL_size_t(1, fs.snapshot_writes);
+
+    // Ползунок: 200 правок за 3 с - одна запись через 5 с после первой
+    for(uint32_t now = 1000; now < 4000; now += 15) s.edit(now).default_brightness = static_cast<uint8_t>(now / 16);
+    TEST_ASSERT_EQUAL_UINT32(2000, s.tick(4000));
+    TEST_ASSERT_EQUAL_size_t(1, fs.snapshot_writes);
+    TEST_ASSERT_EQUAL_UINT32(store<mock_storage>::NEVER, s.tick(6000));
+    TEST_ASSERT_EQUAL_size_t(2, fs.snapshot_writes);
+
+    // Ошибка записи - повтор через write_delay_ms
+    fs.fail_write = true;
+    s.edit(7000).default_brightness = 1;
+    s.tick(12000);
+    TEST_ASSERT_TRUE(s.dirty());
+    TEST_ASSERT_EQUAL_UINT32(5000, s.time_to_next(12000));
+    fs.fail_write = false;
+    s.tick(17000);
+    TEST_ASSERT_FALSE(s.dirty());
+
+    store<mock_storage> reboot(fs);
+    TEST_ASSERT_TRUE(source_t::kSnapshot == reboot.load(0));
+    TEST_ASSERT_EQUAL_UINT8(1, reboot.get().default_brightness);     // правка из прошивки пережила перезагрузку
+
+    char report[96];
+    snprintf(report, sizeof(report), "snapshot %u bytes, 200 slider edits -> 1 write", unsigned(SNAPSHOT_SIZE));
+    TEST_MESSAGE(report);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_crc32);
+    RUN_TEST(test_encode_decode);
+    RUN_TEST(test_boot_sequence);
+    RUN_TEST(test_coalesced_writes);
+
+    return UNITY_END();
+}
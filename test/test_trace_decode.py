@@ -0,0 +1,61 @@
+# Тесты разбора журнала трассировки: python -m unittest discover -s test -p "test_*.py"
+# Кадры и форматы должны совпадать с src/trace_log.h и trace_log.cpp (см. test/test_trace_log)
+
+import os
+import struct
+import sys
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+import trace_decode
+
+
+def frame(event_id, time_us, *args):
+    body = struct.pack("<HBI", event_id, len(args), time_us) + struct.pack("<%di" % len(args), *args)
+    return trace_decode.SYNC + body + bytes([sum(body) & 0xFF])
+
+
+class TraceDecodeTest(unittest.TestCase):
+    def setUp(self):
+        self.events = trace_decode.load_events()
+        self.ids = {name: i for i, (name, _) in enumerate(self.events)}
+
+    def test_events_from_header(self):
+        self.assertEqual("kTraceDropped", self.events[0][0])
+        self.assertIn("kRelayReceive", self.ids)
+        self.assertEqual("relay: принято id %u, value %u, rssi %d", self.events[self.ids["kRelayReceive"]][1])
+
+    def test_frame_matches_firmware(self):
+        # trace_log::encode() для kRelayReceive(2, 70000, -71) в момент 1 с
+        golden = bytes.fromhex("A55A08000340420F000200000070110100B9FFFFFFD6")
+        self.assertEqual(golden, frame(self.ids["kRelayReceive"], 1000000, 2, 70000, -71))
+        items = trace_decode.parse(golden)
+        self.assertEqual([("event", self.ids["kRelayReceive"], 1000000, [2, 70000, -71])], items)
+
+    def test_format_like_firmware(self):
+        text = trace_decode.format_event(self.events, self.ids["kMorseElement"], [ord("-"), 3, 1])
+        self.assertEqual("morse: '-' свет 3 dit, пауза 1 dit", text)
+        self.assertEqual("relay: кадр 4294967295 байт, rssi -1", trace_decode.format_event(self.events, self.ids["kRelayFrame"], [-1, -1]))
+        self.assertEqual("event 999 5 -2", trace_decode.format_event(self.events, 999, [5, -2]))
+
+    def test_console_text_and_broken_frames(self):
+        good = frame(self.ids["kMorseDone"], 2500000)
+        broken = bytearray(frame(self.ids["kMorseDone"], 2600000))
+        broken[-1] ^= 0xFF
+        data = b"start...\r\n" + good + b"/trace\r\n" + bytes(broken) + b"tail"
+        lines = trace_decode.decode(data, self.events)
+        self.assertEqual("              | start...", lines[0])
+        self.assertEqual("     2.500000  morse: передача завершена", lines[1])
+        self.assertEqual("              | /trace", lines[2])
+        self.assertTrue(lines[3].endswith("tail"))          # испорченный кадр остается текстом
+        self.assertEqual(4, len(lines))
+
+    def test_micros_wrap(self):
+        data = frame(self.ids["kMorseDone"], 0xFFFFFF00) + frame(self.ids["kMorseDone"], 0x100)
+        lines = trace_decode.decode(data, self.events)
+        self.assertTrue(lines[0].startswith("  4294.967040"))
+        self.assertTrue(lines[1].startswith("  4294.967552"))
+
+
+if __name__ == "__main__":
+    unittest.main()
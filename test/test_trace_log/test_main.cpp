@@ -0,0 +1,210 @@
+// Журнал трассировки: pio test -e native -f test_trace_log
+// Кадры, текст по форматам, потери при переполнении, выгрузка без ожидания и несколько писателей из потоков.
+// Разбор двоичной выгрузки на компьютере проверяет test/test_trace_decode.py.
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace_log.h"
+#include "morse.h"
+
+void setUp()
+{
+    arduino_shim::set_millis(1000);
+    Serial.take();
+    Serial.tx_space = -1;
+}
+void tearDown() {}
+
+// Разбор кадров из выгрузки так же, как trace_decode.py
+static std::vector<trace_log::record_t> decode(const std::string& data)
+{
+    std::vector<trace_log::record_t> records;
+    for(size_t i = 0; i + trace_log::FRAME_HEADER + 1 <= data.size(); ++i) {
+        auto byte = [&](size_t k) { return static_cast<uint8_t>(data[i + k]); };
+        if(byte(0) != trace_log::SYNC[0] || byte(1) != trace_log::SYNC[1]) continue;
+        trace_log::record_t r;
+        r.id = static_cast<uint16_t>(byte(2) | (byte(3) << 8));
+        r.argc = byte(4);
+        size_t length = trace_log::FRAME_HEADER + 4 * r.argc + 1;
+        if(r.argc > trace_log::MAX_ARGS || i + length > data.size()) continue;
+        uint8_t sum = 0;
+        for(size_t k = 2; k + 1 < length; ++k) sum = static_cast<uint8_t>(sum + byte(k));
+        if(sum != byte(length - 1)) continue;
+        auto u32 = [&](size_t k) { return static_cast<uint32_t>(byte(k) | (byte(k + 1) << 8) | (byte(k + 2) << 16) | (uint32_t(byte(k + 3)) << 24)); };
+        r.time_us = u32(5);
+        for(uint8_t a = 0; a < r.argc; ++a) r.args[a] = static_cast<int32_t>(u32(9 + 4 * a));
+        records.push_back(r);
+        i += length - 1;
+    }
+    return records;
+}
+
+void test_binary_round_trip() {
+    trace_log::logger<8> log;
+    TEST_ASSERT_TRUE(log.event(trace_log::kRelayReceive, 2, 70000, -71));
+    delay(3);
+    TEST_ASSERT_TRUE(log.event(trace_log::kMorseDone));
+    Serial.print("text between frames\r\n");
+    TEST_ASSERT_EQUAL(2, log.drain(Serial, trace_log::output_t::kBinary));
+
+    auto records = decode(Serial.take());
+    TEST_ASSERT_EQUAL(2, records.size());
+    TEST_ASSERT_EQUAL_UINT16(trace_log::kRelayReceive, records[0].id);
+    TEST_ASSERT_EQUAL_UINT8(3, records[0].argc);
+    TEST_ASSERT_EQUAL_INT32(70000, records[0].args[1]);
+    TEST_ASSERT_EQUAL_INT32(-71, records[0].args[2]);
+    TEST_ASSERT_EQUAL_UINT32(1000000, records[0].time_us);
+    TEST_ASSERT_EQUAL_UINT32(1003000, records[1].time_us);
+    TEST_ASSERT_EQUAL_UINT8(0, records[1].argc);
+}
+
+void test_text_format() {
+    char line[100];
+    trace_log::record_t r;
+    r.time_us = 1234;
+    r.id = trace_log::kMorseElement;
+    r.argc = 3;
+    r.args[0] = '-';
+    r.args[1] = 3;
+    r.args[2] = 1;
+    trace_log::format(r, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("1234 morse: '-' свет 3 dit, пауза 1 dit", line);
+
+    r.id = trace_log::kRelayBlink;
+    r.argc = 2;
+    r.args[0] = 50;
+    r.args[1] = -2;
+    trace_log::format(r, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("1234 relay: моргание 50 мс, опоздание -2 мс", line);
+
+    r.id = 999;                                 // событие из более новой прошивки
+    trace_log::format(r, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("1234 event 999 50 -2", line);
+
+    TEST_ASSERT_EQUAL(12, trace_log::format(r, line, 13));     // обрезка по размеру буфера
+    TEST_ASSERT_NULL(trace_log::format_of(trace_log::kEventCount));
+}
+
+void test_overflow_is_counted_and_reported() {
+    trace_log::logger<4> log;
+    for(int i = 0; i < 10; ++i) log.event(trace_log::kRelaySend, 1, i);
+    auto stats = log.stats();
+    TEST_ASSERT_EQUAL_UINT32(4, stats.logged);
+    TEST_ASSERT_EQUAL_UINT32(6, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.max_depth);
+
+    TEST_ASSERT_EQUAL(5, log.drain(Serial, trace_log::output_t::kText));
+    std::string text = Serial.take();
+    TEST_ASSERT_TRUE(text.find("trace: потеряно 6 событий") != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("value 3\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("value 4") == std::string::npos);
+
+    // Место освободилось - события снова принимаются, о потерях второй раз не сообщается
+    TEST_ASSERT_TRUE(log.event(trace_log::kRelaySend, 1, 11));
+    TEST_ASSERT_EQUAL(1, log.drain(Serial, trace_log::output_t::kText));
+    TEST_ASSERT_TRUE(Serial.take().find("потеряно") == std::string::npos);
+}
+
+void test_drain_never_waits_for_uart() {
+    trace_log::logger<16> log;
+    for(int i = 0; i < 10; ++i) log.event(trace_log::kRelaySend, 1, i);
+    const size_t frame = trace_log::FRAME_HEADER + 2 * 4 + 1;
+
+    Serial.tx_space = static_cast<int>(2 * frame + 3);      // FIFO почти полон
+    TEST_ASSERT_EQUAL(2, log.drain(Serial, trace_log::output_t::kBinary));
+    TEST_ASSERT_EQUAL(0, log.drain(Serial, trace_log::output_t::kBinary));
+    TEST_ASSERT_EQUAL(7, log.depth());                     // третье событие уже взято и ждет места
+
+    Serial.tx_space = -1;
+    TEST_ASSERT_EQUAL(3, log.drain(Serial, trace_log::output_t::kBinary, 3));     // ограничение за один вызов
+    TEST_ASSERT_EQUAL(5, log.drain(Serial, trace_log::output_t::kBinary));
+    auto records = decode(Serial.take());
+    TEST_ASSERT_EQUAL(10, records.size());
+    for(int i = 0; i < 10; ++i) TEST_ASSERT_EQUAL_INT32(i, records[i].args[1]);
+    TEST_ASSERT_EQUAL(0, log.drain(Serial, trace_log::output_t::kOff));
+}
+
+void test_concurrent_writers() {
+    // Четыре писателя (callback WiFi, loop() ...) и читатель: каждое событие либо выгружено, либо посчитано потерянным,
+    // события одного писателя не перемешаны
+    static trace_log::logger<64> log;
+    constexpr int WRITERS = 4, EVENTS = 20000;
+    std::atomic<int> running {WRITERS};
+    std::vector<std::thread> writers;
+    for(int w = 0; w < WRITERS; ++w) {
+        writers.emplace_back([w, &running] {
+            for(int i = 0; i < EVENTS; ++i) log.event(trace_log::kRelaySend, w, i);
+            --running;
+        });
+    }
+    std::vector<int> last(WRITERS, -1);
+    uint32_t received = 0, dropped_reported = 0;
+    bool ordered = true;
+    trace_log::record_t r;
+    for(;;) {
+        bool done = running.load() == 0;
+        while(log.pop(r)) {
+            ++received;
+            int w = r.args[0], i = r.args[1];
+            if(i <= last[w]) ordered = false;
+            last[w] = i;
+        }
+        if(done) break;
+        std::this_thread::yield();
+    }
+    for(auto& t : writers) t.join();
+    while(log.pop(r)) ++received;
+    auto stats = log.stats();
+    dropped_reported = stats.dropped;
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT32(WRITERS * EVENTS, received + dropped_reported);
+    TEST_ASSERT_EQUAL_UINT32(received, stats.logged);
+}
+
+void test_morse_code_traces_elements() {
+    auto led = etl::make_shared<etl::led>(2);
+    MorseCode morse(led, 10);
+    while(trace_log::instance.drain(Serial, trace_log::output_t::kBinary)) {}
+    Serial.take();
+    morse.send("ET");
+    for(int i = 0; i < 200 && !morse.is_completed(); ++i) {
+        morse.tick();
+        delay(1);
+    }
+    trace_log::instance.drain(Serial, trace_log::output_t::kText);
+    std::string text = Serial.take();
+    TEST_ASSERT_TRUE(text.find("morse: начало") != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("morse: '.' свет 1 dit") != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("morse: '-' свет 3 dit") != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("morse: передача завершена") != std::string::npos);
+}
+
+void test_event_cost() {
+    trace_log::logger<1024> log;
+    constexpr int COUNT = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < COUNT; ++i) log.event(trace_log::kRelayReceive, 1, i, -60);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    char line[80];
+    snprintf(line, sizeof(line), "TRACE(): %.1f ns per event, %u bytes per slot", double(ns) / COUNT, unsigned(sizeof(trace_log::record_t)));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(COUNT, log.stats().logged);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_binary_round_trip);
+    RUN_TEST(test_text_format);
+    RUN_TEST(test_overflow_is_counted_and_reported);
+    RUN_TEST(test_drain_never_waits_for_uart);
+    RUN_TEST(test_concurrent_writers);
+    RUN_TEST(test_morse_code_traces_elements);
+    RUN_TEST(test_event_cost);
+
+    return UNITY_END();
+}
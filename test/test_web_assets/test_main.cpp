@@ -0,0 +1,196 @@
+// Манифест assets.bin и отдача файлов: pio test -e native -f test_web_assets
+// Упаковщик проверяет test/test_asset_pack.py: python -m unittest discover -s test -p "test_*.py"
+#include <unity.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "web_assets.h"
+
+using namespace web_assets;
+
+// Те же значения проверяет test_asset_pack.py
+static_assert(fnv1a("/index.html", 11) == 0x457c5a71, "fnv1a");
+static_assert(fnv1a("/js/app.js", 10) == 0x5731c89e, "fnv1a");
+
+// assets.bin в памяти, в формате asset_pack.py
+struct memory_file {
+    std::vector<uint8_t> data;
+    size_t pos = 0;
+    size_t read_limit = SIZE_MAX;     // обрыв чтения для теста
+
+    bool seek(uint32_t offset) { if(offset > data.size()) return false; pos = offset; return true; }
+    size_t read(uint8_t* out, size_t length) {
+        if(length > read_limit) length = read_limit;
+        if(length > data.size() - pos) length = data.size() - pos;
+        memcpy(out, data.data() + pos, length);
+        pos += length;
+        return length;
+    }
+};
+
+struct asset_t { const char* path; std::string body; uint32_t etag; uint8_t type; uint8_t flags; };
+
+static void put32(std::vector<uint8_t>& out, uint32_t v) { for(int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(v >> (8 * i))); }
+static void put16(std::vector<uint8_t>& out, uint16_t v) { out.push_back(static_cast<uint8_t>(v)); out.push_back(static_cast<uint8_t>(v >> 8)); }
+
+static memory_file make_pack(std::vector<asset_t> assets)
+{
+    std::sort(assets.begin(), assets.end(), [](const asset_t& a, const asset_t& b) {
+        return fnv1a(a.path, strlen(a.path)) < fnv1a(b.path, strlen(b.path));
+    });
+    memory_file file;
+    auto& out = file.data;
+    uint32_t offset = static_cast<uint32_t>(HEADER_SIZE + ENTRY_SIZE * assets.size());
+    for(char c : {'W', 'A', 'S', 'T'}) out.push_back(static_cast<uint8_t>(c));
+    put16(out, VERSION);
+    put16(out, static_cast<uint16_t>(assets.size()));
+    put32(out, 0);
+    put32(out, offset);
+    for(const auto& a : assets) {
+        put32(out, fnv1a(a.path, strlen(a.path)));
+        put32(out, offset);
+        put32(out, static_cast<uint32_t>(a.body.size()));
+        put32(out, a.etag);
+        out.push_back(a.type);
+        out.push_back(a.flags);
+        put16(out, 0);
+        offset += static_cast<uint32_t>(a.body.size());
+    }
+    for(const auto& a : assets) out.insert(out.end(), a.body.begin(), a.body.end());
+    return file;
+}
+
+static memory_file sample_pack()
+{
+    return make_pack({
+        {"/index.html", "<html>index</html>", 0x1234abcd, 1, FLAG_GZIP},
+        {"/css/style.css", "body{}", 0x00000001, 2, FLAG_GZIP},
+        {"/js/app.js", std::string(1300, 'x'), 0xdeadbeef, 3, FLAG_GZIP},
+        {"/img/logo.png", "PNG", 0x0badf00d, 5, 0},
+    });
+}
+
+struct string_writer {
+    std::string out;
+    size_t limit = SIZE_MAX;
+    std::vector<size_t> writes;
+    size_t write(const uint8_t* data, size_t length) {
+        if(length > limit) length = limit;
+        writes.push_back(length);
+        out.append(reinterpret_cast<const char*>(data), length);
+        return length;
+    }
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_load_and_find() {
+    memory_file file = sample_pack();
+    manifest assets;
+    TEST_ASSERT_TRUE(assets.load(file));
+    TEST_ASSERT_EQUAL_size_t(4, assets.size());
+
+    const entry_t* css = assets.find("/css/style.css");
+    TEST_ASSERT_NOT_NULL(css);
+    TEST_ASSERT_EQUAL_STRING("text/css", content_type(css->type));
+    TEST_ASSERT_TRUE(css->gzip());
+    TEST_ASSERT_EQUAL_UINT32(6, css->size);
+
+    TEST_ASSERT_EQUAL_PTR(assets.find("/index.html"), assets.find("/"));
+    TEST_ASSERT_EQUAL_PTR(assets.find("/index.html"), assets.find(""));
+    TEST_ASSERT_EQUAL_PTR(assets.find("/index.html"), assets.find("/?lang=ru"));
+    TEST_ASSERT_EQUAL_PTR(css, assets.find("/css/style.css?v=2"));
+    TEST_ASSERT_NULL(assets.find("/css/"));         // index.html в каталоге css нет
+    TEST_ASSERT_NULL(assets.find("/missing.js"));
+    TEST_ASSERT_FALSE(assets.find("/img/logo.png")->gzip());
+    TEST_ASSERT_EQUAL_STRING("application/octet-stream", content_type(200));
+}
+
+void test_load_rejects() {
+    manifest assets;
+    memory_file file = sample_pack();
+    file.data[0] = 'X';
+    TEST_ASSERT_FALSE(assets.load(file));
+    TEST_ASSERT_EQUAL_size_t(0, assets.size());
+
+    file = sample_pack();
+    file.data.resize(HEADER_SIZE + ENTRY_SIZE);       // обрезанная таблица
+    TEST_ASSERT_FALSE(assets.load(file));
+
+    std::vector<asset_t> many;
+    static char names[WEB_ASSETS_MAX + 1][16];
+    for(size_t i = 0; i <= WEB_ASSETS_MAX; ++i) {
+        snprintf(names[i], sizeof(names[i]), "/f%u", unsigned(i));
+        many.push_back({names[i], "x", 0, 0, 0});
+    }
+    file = make_pack(many);
+    TEST_ASSERT_FALSE(assets.load(file));
+}
+
+void test_etag() {
+    char etag[ETAG_SIZE];
+    format_etag(0xdeadbeef, etag);
+    TEST_ASSERT_EQUAL_STRING("\"deadbeef\"", etag);
+    TEST_ASSERT_TRUE(etag_matches("\"deadbeef\"", 0xdeadbeef));
+    TEST_ASSERT_TRUE(etag_matches("W/\"deadbeef\"", 0xdeadbeef));
+    TEST_ASSERT_TRUE(etag_matches("\"00000001\", \"deadbeef\"", 0xdeadbeef));
+    TEST_ASSERT_TRUE(etag_matches("*", 0xdeadbeef));
+    TEST_ASSERT_FALSE(etag_matches("\"deadbeee\"", 0xdeadbeef));
+    TEST_ASSERT_FALSE(etag_matches("", 0xdeadbeef));
+    TEST_ASSERT_FALSE(etag_matches(nullptr, 0xdeadbeef));
+}
+
+void test_resolve() {
+    memory_file file = sample_pack();
+    manifest assets;
+    assets.load(file);
+    TEST_ASSERT_EQUAL(status_t::kOk, assets.resolve("/js/app.js", nullptr).status);
+    TEST_ASSERT_EQUAL(status_t::kOk, assets.resolve("/js/app.js", "\"12345678\"").status);
+    auto cached = assets.resolve("/js/app.js", "\"deadbeef\"");
+    TEST_ASSERT_EQUAL(status_t::kNotModified, cached.status);
+    TEST_ASSERT_NOT_NULL(cached.entry);
+    TEST_ASSERT_EQUAL(status_t::kNotFound, assets.resolve("/nope", "*").status);
+}
+
+void test_stream_chunks() {
+    memory_file file = sample_pack();
+    manifest assets;
+    assets.load(file);
+    const entry_t& js = *assets.find("/js/app.js");
+    uint8_t buffer[WEB_ASSETS_CHUNK];
+    string_writer out;
+    TEST_ASSERT_EQUAL_size_t(1300, stream_body(file, js, out, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_STRING(std::string(1300, 'x').c_str(), out.out.c_str());
+    TEST_ASSERT_EQUAL_size_t(3, out.writes.size());            // 512 + 512 + 276
+    TEST_ASSERT_EQUAL_size_t(276, out.writes.back());
+
+    string_writer html;
+    stream_body(file, *assets.find("/"), html, buffer, sizeof(buffer));
+    TEST_ASSERT_EQUAL_STRING("<html>index</html>", html.out.c_str());
+
+    // Клиент отвалился - отдача прекращается
+    string_writer broken;
+    broken.limit = 100;
+    TEST_ASSERT_EQUAL_size_t(100, stream_body(file, js, broken, buffer, sizeof(buffer)));
+
+    // Короткое чтение из файла - продолжаем с того же места
+    file.read_limit = 200;
+    string_writer slow;
+    TEST_ASSERT_EQUAL_size_t(1300, stream_body(file, js, slow, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_size_t(7, slow.writes.size());
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_load_and_find);
+    RUN_TEST(test_load_rejects);
+    RUN_TEST(test_etag);
+    RUN_TEST(test_resolve);
+    RUN_TEST(test_stream_chunks);
+
+    return UNITY_END();
+}
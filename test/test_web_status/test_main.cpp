@@ -0,0 +1,220 @@
+// Поток статуса SSE и пачки команд: pio test -e native -f test_web_status
+// Стенд: мок-сокет считает байты, operator new - выделения памяти на клиента за минуту
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "web_status.h"
+
+using namespace web_status;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if(void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// Сокет: запись в общий журнал, без выделений памяти
+struct mock_socket {
+    struct wire_t {
+        char   data[4096];
+        size_t length = 0;
+        size_t bytes = 0;         // всего, журнал может переполниться
+        size_t writes = 0;
+        bool   connected = true;
+        size_t limit = SIZE_MAX;  // сколько принимает write() (полный буфер)
+    };
+    wire_t* wire = nullptr;
+
+    size_t write(const uint8_t* data, size_t length) {
+        if(length > wire->limit) length = wire->limit;
+        size_t copy = length < sizeof(wire->data) - wire->length ? length : sizeof(wire->data) - wire->length;
+        memcpy(wire->data + wire->length, data, copy);
+        wire->length += copy;
+        wire->bytes += length;
+        ++wire->writes;
+        return length;
+    }
+    bool connected() const { return wire && wire->connected; }
+    void stop() { if(wire) wire->connected = false; }
+};
+
+static std::string last_event(const mock_socket::wire_t& wire)
+{
+    std::string all(wire.data, wire.length);
+    size_t end = all.rfind("\n\n");
+    if(end == std::string::npos) return "";
+    size_t begin = all.rfind("data: ", end);
+    return all.substr(begin + 6, end - begin - 6);
+}
+
+static status_t online()
+{
+    status_t s;
+    s.wifi = true;
+    s.ip = 192 | (168 << 8) | (1 << 16) | (5u << 24);
+    s.uptime = 12;
+    s.light = true;
+    s.brightness = 100;
+    return s;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_format() {
+    char out[128];
+    status_t s = online();
+    size_t length = format_json(out, sizeof(out), s, kAll);
+    TEST_ASSERT_EQUAL_size_t(strlen(out), length);
+    TEST_ASSERT_EQUAL_STRING("{\"wifi\":\"connected\",\"ip\":\"192.168.1.5\",\"uptime\":12,\"light\":1,\"brightness\":100}", out);
+    format_json(out, sizeof(out), s, kBrightness | kUptime);
+    TEST_ASSERT_EQUAL_STRING("{\"uptime\":12,\"brightness\":100}", out);
+    format_event(out, sizeof(out), s, kLight);
+    TEST_ASSERT_EQUAL_STRING("data: {\"light\":1}\n\n", out);
+    TEST_ASSERT_EQUAL_size_t(0, format_json(out, 20, s, kAll));      // не помещается
+    TEST_ASSERT_EQUAL_size_t(0, format_event(out, 8, s, kLight));
+
+    status_t b = s;
+    b.uptime = 99;
+    TEST_ASSERT_EQUAL_UINT8(0, diff(s, b));                          // uptime не изменение
+    b.brightness = 1;
+    b.wifi = false;
+    TEST_ASSERT_EQUAL_UINT8(kBrightness | kWifi, diff(s, b));
+}
+
+void test_commands() {
+    command_t c;
+    TEST_ASSERT_TRUE(apply_arg(c, "light", "on"));
+    TEST_ASSERT_TRUE(apply_arg(c, "brightness", "120"));
+    TEST_ASSERT_EQUAL_UINT8(kLight | kBrightness, c.fields);
+    TEST_ASSERT_TRUE(c.light);
+    TEST_ASSERT_EQUAL_UINT8(120, c.brightness);
+    TEST_ASSERT_FALSE(apply_arg(c, "brightness", "256"));
+    TEST_ASSERT_FALSE(apply_arg(c, "brightness", "12x"));
+    TEST_ASSERT_FALSE(apply_arg(c, "brightness", ""));
+    TEST_ASSERT_FALSE(apply_arg(c, "light", "maybe"));
+    TEST_ASSERT_FALSE(apply_arg(c, "color", "red"));
+
+    // Последнее значение каждого поля, light из первой пачки сохраняется
+    command_t pending, drag;
+    merge(pending, c);
+    apply_arg(drag, "brightness", "7");
+    merge(pending, drag);
+    TEST_ASSERT_EQUAL_UINT8(kLight | kBrightness, pending.fields);
+    TEST_ASSERT_TRUE(pending.light);
+    TEST_ASSERT_EQUAL_UINT8(7, pending.brightness);
+}
+
+void test_snapshot_then_changes() {
+    event_stream<2, mock_socket> stream(200, 15000);
+    mock_socket::wire_t wire;
+    stream.publish(online(), 0);
+    TEST_ASSERT_TRUE(stream.subscribe(mock_socket{&wire}, 1000));
+    stream.tick(1000);
+    TEST_ASSERT_EQUAL_STRING("{\"wifi\":\"connected\",\"ip\":\"192.168.1.5\",\"uptime\":12,\"light\":1,\"brightness\":100}",
+                             last_event(wire).c_str());
+
+    // Без изменений - тишина до keepalive
+    status_t s = online();
+    s.uptime = 13;
+    stream.publish(s, 1100);
+    stream.tick(1100);
+    TEST_ASSERT_EQUAL_size_t(1, wire.writes);
+    TEST_ASSERT_EQUAL_UINT32(14900, stream.time_to_next(1100));
+
+    // Изменения в окне coalesce_ms сливаются в одно событие
+    s.brightness = 10;
+    stream.publish(s, 1150);
+    TEST_ASSERT_EQUAL_UINT32(50, stream.tick(1150));
+    s.brightness = 20;
+    s.light = false;
+    stream.publish(s, 1180);
+    stream.tick(1199);
+    TEST_ASSERT_EQUAL_size_t(1, wire.writes);
+    stream.tick(1200);
+    TEST_ASSERT_EQUAL_size_t(2, wire.writes);
+    TEST_ASSERT_EQUAL_STRING("{\"uptime\":13,\"light\":0,\"brightness\":20}", last_event(wire).c_str());
+
+    // Окно после прошлого события прошло - изменение уходит сразу
+    s.brightness = 30;
+    stream.publish(s, 1500);
+    stream.tick(1500);
+    TEST_ASSERT_EQUAL_STRING("{\"uptime\":13,\"brightness\":30}", last_event(wire).c_str());
+
+    // keepalive с uptime
+    s.uptime = 16;
+    stream.publish(s, 16499);
+    stream.tick(16499);
+    TEST_ASSERT_EQUAL_size_t(3, wire.writes);
+    stream.tick(16500);
+    TEST_ASSERT_EQUAL_STRING("{\"uptime\":16}", last_event(wire).c_str());
+}
+
+void test_clients_and_drop() {
+    event_stream<2, mock_socket> stream;
+    mock_socket::wire_t a, b, c;
+    TEST_ASSERT_TRUE(stream.subscribe(mock_socket{&a}, 0));
+    TEST_ASSERT_TRUE(stream.subscribe(mock_socket{&b}, 0));
+    TEST_ASSERT_FALSE(stream.subscribe(mock_socket{&c}, 0));
+    TEST_ASSERT_EQUAL_size_t(2, stream.clients());
+    using stream_t = event_stream<2, mock_socket>;
+    TEST_ASSERT_EQUAL_UINT32(stream_t::NEVER, stream_t().time_to_next(0));
+
+    a.connected = false;                // вкладку закрыли
+    b.limit = 10;                       // буфер сокета полон - клиент не успевает
+    stream.tick(0);
+    TEST_ASSERT_EQUAL_size_t(0, stream.clients());
+    TEST_ASSERT_EQUAL_size_t(0, a.writes);
+    TEST_ASSERT_FALSE(b.connected);
+
+    TEST_ASSERT_TRUE(stream.subscribe(mock_socket{&c}, 5));
+    stream.tick(5);
+    TEST_ASSERT_EQUAL_size_t(1, c.writes);
+}
+
+// Минута работы с одним клиентом: ползунок двигают 2 с (событие каждые 16 мс), uptime идет каждую секунду
+void test_minute_per_client() {
+    event_stream<4, mock_socket> stream(200, 15000);
+    mock_socket::wire_t wire;
+    status_t s = online();
+    stream.publish(s, 0);
+    size_t before = allocations;
+    stream.subscribe(mock_socket{&wire}, 0);
+    for(uint32_t now = 0; now < 60000; now += 2) {
+        s.uptime = now / 1000;
+        if(now >= 10000 && now < 12000 && now % 16 == 0) s.brightness = static_cast<uint8_t>((now - 10000) / 16);
+        stream.publish(s, now);
+        stream.tick(now);
+    }
+    size_t sse_allocations = allocations - before;
+    TEST_ASSERT_EQUAL_size_t(0, sse_allocations);
+    TEST_ASSERT_LESS_OR_EQUAL(16, wire.writes);     // снимок + 10 пачек ползунка + keepalive
+
+    // Опрос раз в 5 с: 12 полных JSON за минуту, без заголовков HTTP и TCP
+    char json[128];
+    size_t poll_body = 12 * format_json(json, sizeof(json), s, kAll);
+    char report[160];
+    snprintf(report, sizeof(report), "SSE: %u events, %u bytes/min, %u allocations; polling: 12 requests, >= %u body bytes/min",
+             unsigned(wire.writes), unsigned(wire.bytes), unsigned(sse_allocations), unsigned(poll_body));
+    TEST_MESSAGE(report);
+}
+
+int main() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_format);
+    RUN_TEST(test_commands);
+    RUN_TEST(test_snapshot_then_changes);
+    RUN_TEST(test_clients_and_drop);
+    RUN_TEST(test_minute_per_client);
+
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+# Разбор двоичной выгрузки журнала трассировки (src/trace_log.h, команда консоли /trace bin)
+# Кадр (little-endian): 0xA5 0x5A, id u16, argc u8, time_us u32, args i32 * argc, сумма байт id..args (u8)
+# Форматы событий берутся из src/trace_events.h - тот же список, из которого собрана прошивка.
+# Байты вне кадров - обычный вывод консоли, печатаются как есть построчно.
+# Время micros() переполняется раз в ~71 минуту, скрипт продолжает счет.
+#
+# Запуск: python trace_decode.py capture.bin > trace.txt
+#         python trace_decode.py - < /dev/ttyUSB0        (порт заранее настроен на 115200)
+
+import os
+import re
+import struct
+import sys
+
+SYNC = b"\xA5\x5A"
+HEADER = struct.Struct("<HBI")          # id, argc, time_us после SYNC
+MAX_ARGS = 3
+EVENTS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "src", "trace_events.h")
+
+_EVENT = re.compile(r'X\(\s*([A-Za-z_]\w*)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+_SPEC = re.compile(r"%([%duxc])")
+
+
+def load_events(path=EVENTS_H):
+    """Список (имя, формат) в порядке номеров событий"""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    text = text[text.index("#define TRACE_EVENTS"):]        # пример X(...) в комментарии выше - не событие
+    return [(name, fmt.encode("utf-8").decode("unicode_escape").encode("latin-1").decode("utf-8"))
+            for name, fmt in _EVENT.findall(text)]
+
+
+def format_event(events, event_id, args):
+    """Текст события так же, как trace_log::format() на плате, без метки времени"""
+    if event_id >= len(events):
+        return " ".join(["event %d" % event_id] + ["%d" % a for a in args])
+    values = iter(args)
+
+    def spec(match):
+        kind = match.group(1)
+        if kind == "%":
+            return "%"
+        value = next(values, None)
+        if value is None:
+            return match.group(0)
+        if kind == "d":
+            return "%d" % value
+        if kind == "u":
+            return "%d" % (value & 0xFFFFFFFF)
+        if kind == "x":
+            return "%x" % (value & 0xFFFFFFFF)
+        return chr(value & 0xFF)
+
+    return _SPEC.sub(spec, events[event_id][1])
+
+
+def parse(data):
+    """Кадры и текст по порядку: ("event", id, time_us, args) или ("text", строка)"""
+    items = []
+    text = bytearray()
+    i = 0
+
+    def flush_text(final=False):
+        nonlocal text
+        while True:
+            end = text.find(b"\n")
+            if end < 0:
+                break
+            line = text[:end].rstrip(b"\r")
+            items.append(("text", line.decode("utf-8", "replace")))
+            text = text[end + 1:]
+        if final and text:
+            items.append(("text", text.decode("utf-8", "replace")))
+            text = bytearray()
+
+    while i < len(data):
+        if data[i:i + 2] == SYNC and i + 2 + HEADER.size <= len(data):
+            event_id, argc, time_us = HEADER.unpack_from(data, i + 2)
+            length = 2 + HEADER.size + 4 * argc + 1
+            if argc <= MAX_ARGS and i + length <= len(data) and sum(data[i + 2:i + length - 1]) & 0xFF == data[i + length - 1]:
+                flush_text()
+                args = list(struct.unpack_from("<%di" % argc, data, i + 2 + HEADER.size))
+                items.append(("event", event_id, time_us, args))
+                i += length
+                continue
+        text.append(data[i])
+        i += 1
+    flush_text(final=True)
+    return items
+
+
+def decode(data, events):
+    """Строки журнала: "секунды.микросекунды  текст"; текст консоли - с отступом"""
+    lines = []
+    wraps = 0
+    last = None
+    for item in parse(data):
+        if item[0] == "text":
+            if item[1]:
+                lines.append("              | " + item[1])
+            continue
+        _, event_id, time_us, args = item
+        if last is not None and time_us < last and last - time_us > 0x80000000:
+            wraps += 1
+        last = time_us
+        t = (wraps << 32) + time_us
+        lines.append("%6d.%06d  %s" % (t // 1000000, t % 1000000, format_event(events, event_id, args)))
+    return lines
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print("usage: trace_decode.py <capture.bin | ->")
+        sys.exit(1)
+    source = sys.stdin.buffer if sys.argv[1] == "-" else open(sys.argv[1], "rb")
+    with source:
+        for line in decode(source.read(), load_events()):
+            print(line)